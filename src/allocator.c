@@ -0,0 +1,235 @@
+#include <stdlib.h>
+#include <stdio.h>
+#include "allocator.h"
+
+/****************************************************************
+ File: Allocator.c
+ ----------------
+ Implementation for allocator.h interface. The counts are plain
+ arrays indexed by site. As nothing allocated here is freed, small
+ objects such as cells and List wrappers are carved one after
+ another out of large blocks, saving a call to malloc and its
+ bookkeeping on each, while larger ones go straight to malloc.
+ Small objects given back are chained by size, through their first
+ bytes, and handed out again before the block is carved further.
+ Every cell goes through here, so this file is built optimized.
+ An AddressSet uses open addressing with linear probing, as
+ HashTable does, keyed by the address itself.
+ ****************************************************************/
+
+/****************************************************************
+ Set of addresses. Unused slots hold NULL.
+*/
+struct addressSet {
+    void** mSlots;
+    int mCount;
+    int mCapacity;
+};
+
+// Objects up to ALLOCATION_SMALL bytes are carved out of blocks of
+// ALLOCATION_BLOCK bytes, at multiples of ALLOCATION_ALIGN so that
+// the pointers, longs and doubles they hold are aligned
+#define ALLOCATION_BLOCK 65536
+#define ALLOCATION_SMALL 256
+#define ALLOCATION_ALIGN 8
+
+// Counts of objects and bytes allocated at each site
+static long mObjects[SITE_COUNT];
+static long mBytes[SITE_COUNT];
+static long mTotalBytes = 0;
+// Site counting allocate(size_t)
+static int mSite = SITE_EVALUATION;
+// Unused end of the current block
+static char* mFree = NULL;
+static size_t mFreeBytes = 0;
+// Small objects given back, by multiple of ALLOCATION_ALIGN
+static void* mReleased[ALLOCATION_SMALL / ALLOCATION_ALIGN + 1];
+
+// Names of the sites, in the order of enum allocationSite
+static char* mSiteNames[SITE_COUNT] = {
+    "evaluation", "parser", "cons", "arithmetic", "assoc", "environment"
+};
+
+// Prototypes for private helpers
+static void* allocateCounted(size_t, int);
+static int findAddress(AddressSet*, void*);
+static void growAddresses(AddressSet*);
+
+/****************************************************************
+ allocate(): See header file for documentation.
+*/
+void* allocate(size_t size)
+{
+    return allocateCounted(size, mSite);
+}
+
+/****************************************************************
+ allocateAt(): See header file for documentation.
+*/
+void* allocateAt(size_t size, int site)
+{
+    return allocateCounted(size, mSite == SITE_EVALUATION ? site : mSite);
+}
+
+/****************************************************************
+ release(): See header file for documentation.
+*/
+void release(void* memory, size_t size)
+{
+    mObjects[mSite]--;
+    mBytes[mSite] -= size;
+    mTotalBytes -= size;
+    if (size <= ALLOCATION_SMALL) {
+        size_t index = (size + ALLOCATION_ALIGN - 1) / ALLOCATION_ALIGN;
+        *(void**) memory = mReleased[index];
+        mReleased[index] = memory;
+    } else {
+        free(memory);
+    }
+}
+
+/****************************************************************
+ enterSite(): See header file for documentation.
+*/
+int enterSite(int site)
+{
+    int previous = mSite;
+    if (mSite == SITE_EVALUATION) mSite = site;
+    return previous;
+}
+
+/****************************************************************
+ leaveSite(): See header file for documentation.
+*/
+void leaveSite(int site)
+{
+    mSite = site;
+}
+
+/****************************************************************
+ siteName(): See header file for documentation.
+*/
+char* siteName(int site)
+{
+    return mSiteNames[site];
+}
+
+/****************************************************************
+ siteAllocations(): See header file for documentation.
+*/
+long siteAllocations(int site, long* bytes)
+{
+    *bytes = mBytes[site];
+    return mObjects[site];
+}
+
+/****************************************************************
+ allocatedBytes(): See header file for documentation.
+*/
+long allocatedBytes()
+{
+    return mTotalBytes;
+}
+
+/****************************************************************
+ iniAddressSet(): See header file for documentation.
+*/
+AddressSet* iniAddressSet()
+{
+    AddressSet* set = malloc(sizeof(AddressSet));
+    set->mCount = 0;
+    set->mCapacity = 1024;
+    set->mSlots = calloc(set->mCapacity, sizeof(void*));
+    return set;
+}
+
+/****************************************************************
+ addAddress(): See header file for documentation.
+*/
+int addAddress(AddressSet* set, void* address)
+{
+    // Keep at most half of the slots occupied
+    if ((set->mCount + 1) * 2 > set->mCapacity) growAddresses(set);
+    int slot = findAddress(set, address);
+    if (set->mSlots[slot] != NULL) return 0;
+    set->mSlots[slot] = address;
+    set->mCount++;
+    return 1;
+}
+
+/****************************************************************
+ freeAddressSet(): See header file for documentation.
+*/
+void freeAddressSet(AddressSet* set)
+{
+    free(set->mSlots);
+    free(set);
+}
+
+/****************************************************************
+ Private helper counting an allocation at the given site before
+ making it, out of those given back or the current block when it
+ is small.
+*/
+static void* allocateCounted(size_t size, int site)
+{
+    mObjects[site]++;
+    mBytes[site] += size;
+    mTotalBytes += size;
+    if (size <= ALLOCATION_SMALL) {
+        size_t aligned = (size + ALLOCATION_ALIGN - 1) & ~(size_t) (ALLOCATION_ALIGN - 1);
+        void* released = mReleased[aligned / ALLOCATION_ALIGN];
+        if (released != NULL) {
+            mReleased[aligned / ALLOCATION_ALIGN] = *(void**) released;
+            return released;
+        }
+        if (aligned > mFreeBytes) {
+            mFree = malloc(ALLOCATION_BLOCK);
+            mFreeBytes = ALLOCATION_BLOCK;
+            if (mFree == NULL) {
+                printf("Out of memory.\n");
+                exit(1);
+            }
+        }
+        void* memory = mFree;
+        mFree += aligned;
+        mFreeBytes -= aligned;
+        return memory;
+    }
+    void* memory = malloc(size);
+    if (memory == NULL) {
+        printf("Out of memory.\n");
+        exit(1);
+    }
+    return memory;
+}
+
+/****************************************************************
+ Private helper giving the slot holding an address, or the unused
+ slot where it would go.
+*/
+static int findAddress(AddressSet* set, void* address)
+{
+    int mask = set->mCapacity - 1;
+    size_t hash = (size_t) address;
+    int slot = (int) ((hash >> 4) ^ (hash >> 16)) & mask;
+    while (set->mSlots[slot] != NULL && set->mSlots[slot] != address)
+        slot = (slot + 1) & mask;
+    return slot;
+}
+
+/****************************************************************
+ Private helper doubling the slots of a set and re-inserting its
+ addresses.
+*/
+static void growAddresses(AddressSet* set)
+{
+    int oldCapacity = set->mCapacity;
+    void** old = set->mSlots;
+    set->mCapacity = oldCapacity * 2;
+    set->mSlots = calloc(set->mCapacity, sizeof(void*));
+    int i;
+    for (i = 0; i < oldCapacity; i++)
+        if (old[i] != NULL) set->mSlots[findAddress(set, old[i])] = old[i];
+    free(old);
+}
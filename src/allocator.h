@@ -0,0 +1,111 @@
+#ifndef ALLOCATOR_H_INCLUDED
+#define ALLOCATOR_H_INCLUDED
+
+#include <stdlib.h>
+
+/****************************************************************
+ File: Allocator.h
+ ----------------
+ Interface for Allocator, through which the interpreter allocates
+ everything that outlives the call making it: cells, List wrappers,
+ symbol text and native data. Every allocation is counted, in
+ objects and bytes, under the site it was made for, which the
+ function call (memory-stats) reports.
+
+ The site is either given or taken from the current one, so that
+ the evaluator can mark a helper such as the one binding a variable
+ once, and have every cell it allocates counted there. The helpers
+ called most, such as cons, give their site with each allocation
+ instead of entering and leaving it on every call. The interpreter
+ frees no cells, so memory is only given back where one is dropped
+ as soon as it is made, as the parser does with the duplicates it
+ finds when hash-consing. The counts are of everything allocated
+ so far and not given back.
+ ****************************************************************/
+
+/****************************************************************
+ Sites counted. SITE_EVALUATION is the current site unless one is
+ entered, and covers whatever is not counted elsewhere.
+*/
+enum allocationSite {
+    SITE_EVALUATION = 0,
+    SITE_PARSER,
+    SITE_CONS,
+    SITE_ARITHMETIC,
+    SITE_ASSOC,
+    SITE_ENVIRONMENT,
+    SITE_COUNT
+};
+
+/****************************************************************
+ Allocates the given number of bytes at the current site.
+*/
+void* allocate(size_t);
+
+/****************************************************************
+ Allocates the given number of bytes at the given site, unless
+ another site has been entered, in which case they are counted as
+ allocate(size_t) would. Helpers called often name their site this
+ way rather than entering it around every call.
+*/
+void* allocateAt(size_t, int);
+
+/****************************************************************
+ Gives back memory of the given number of bytes, obtained from
+ allocate(size_t) or allocateAt(size_t, int) and no longer
+ referenced, uncounting it at the current site. Small objects are
+ kept for allocations of the same size to reuse.
+*/
+void release(void*, size_t);
+
+/****************************************************************
+ Makes the given site current, unless a site other than
+ SITE_EVALUATION already is, so that allocations are counted for
+ the outermost site entered. Returns the site to restore with
+ leaveSite(int) afterwards.
+*/
+int enterSite(int);
+
+/****************************************************************
+ Restores the site returned by enterSite(int).
+*/
+void leaveSite(int);
+
+/****************************************************************
+ Gives the name of a site, such as "cons".
+*/
+char* siteName(int);
+
+/****************************************************************
+ Gives the number of objects allocated at a site so far, and
+ through the last parameter the number of bytes.
+*/
+long siteAllocations(int, long*);
+
+/****************************************************************
+ Gives the number of bytes allocated at every site so far.
+*/
+long allocatedBytes();
+
+/****************************************************************
+ Set of addresses, for walking structures that share cells.
+*/
+typedef struct addressSet AddressSet;
+
+/****************************************************************
+ Makes an empty AddressSet.
+*/
+AddressSet* iniAddressSet();
+
+/****************************************************************
+ Adds an address to the set. Returns 1 when it was not there yet
+ and 0 otherwise.
+*/
+int addAddress(AddressSet*, void*);
+
+/****************************************************************
+ Frees an AddressSet.
+*/
+void freeAddressSet(AddressSet*);
+
+#endif
@@ -0,0 +1,386 @@
+#include <stdlib.h>
+#include <string.h>
+#include <stdio.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "astcache.h"
+#include "reader.h"
+#include "lexer.h"
+#include "hashtable.h"
+#include "number.h"
+#include "allocator.h"
+
+/****************************************************************
+ File: AstCache.c
+ ----------------
+ Implementation for astcache.h interface. A cache is laid out as
+
+    header | symbol text | cell records
+
+ with every symbol ending in '\0', in the order of its number, the
+ text padded with '\0' to align the records, and the records of
+ each form in turn. A record holds the number of the symbol of a
+ cell plus one, or 0 for none, shifted left past two flags telling
+ whether the cell has a sub branch and a next cell. Records follow
+ the order in which the parser makes cells, each one followed by
+ those of its sub branch and then by those of the cells after it,
+ so where a sub branch or next cell is never needs storing. A
+ cached file is read whole and its cells made in a single block.
+ ****************************************************************/
+
+#define CACHE_MAGIC "SCMAST02"
+
+// Flags of a record, below the symbol number
+#define NODE_SUB 2
+#define NODE_NEXT 1
+#define NODE_FLAGS 2
+
+/****************************************************************
+ Start of every cache.
+*/
+typedef struct cacheHeader CacheHeader;
+struct cacheHeader {
+    char mMagic[8];
+    long mSourceLength;
+    unsigned long mSourceHash;
+    unsigned long mChecksum;
+    int mSymbolCount;
+    int mSymbolBytes;
+    int mNodeCount;
+    int mFormCount;
+};
+
+// Cells and symbols of the cache being written, the symbols found
+// by their text through an open addressing table of positions
+static unsigned int* mNodes = NULL;
+static int mNodeCount = 0;
+static int mNodeCapacity = 0;
+static char** mSymbols = NULL;
+static int mSymbolCount = 0;
+static int mSymbolBytes = 0;
+static int* mSymbolSlots = NULL;
+static int mSlotCapacity = 0;
+
+// Prototypes for private helpers
+static char* readSource(char*, long*);
+static char* mapSource(char*, long*);
+static unsigned long hashBytes(unsigned long, char*, long);
+static Cell** parseForms(char*, long, int*);
+static Cell** readCache(char*, long, unsigned long, int*);
+static void writeCache(char*, long, unsigned long, Cell**, int);
+static void addNodes(Cell*);
+static int symbolNumber(char*);
+static unsigned int hashText(char*);
+
+/****************************************************************
+ loadForms(): See header file for documentation.
+*/
+Cell** loadForms(char* path, int* count)
+{
+    long length;
+    char* source = mapSource(path, &length);
+    if (source == NULL) return NULL;
+    if (isHashConsing()) {
+        Cell** forms = parseForms(source, length, count);
+        if (length > 0) munmap(source, length);
+        return forms;
+    }
+
+    unsigned long hash = hashBytes(14695981039346656037UL, source, length);
+    char* cachePath = malloc(sizeof(char) * (strlen(path) + 5));
+    sprintf(cachePath, "%s.ast", path);
+    Cell** forms = readCache(cachePath, length, hash, count);
+    if (forms == NULL) {
+        forms = parseForms(source, length, count);
+        writeCache(cachePath, length, hash, forms, *count);
+    }
+    free(cachePath);
+    if (length > 0) munmap(source, length);
+    return forms;
+}
+
+/****************************************************************
+ Private helper reading a whole file, giving its length through
+ the second parameter, or NULL when it cannot be read.
+*/
+static char* readSource(char* path, long* length)
+{
+    FILE* file = fopen(path, "rb");
+    if (file == NULL) return NULL;
+    fseek(file, 0, SEEK_END);
+    *length = ftell(file);
+    fseek(file, 0, SEEK_SET);
+    char* source = malloc(sizeof(char) * (*length + 1));
+    if (*length < 0 || fread(source, 1, *length, file) != (size_t) *length) {
+        free(source);
+        fclose(file);
+        return NULL;
+    }
+    source[*length] = '\0';
+    fclose(file);
+    return source;
+}
+
+/****************************************************************
+ Private helper mapping a source file privately, giving its length
+ through the second parameter, or NULL when it cannot be read. An
+ empty file is given as an empty string, which is not mapped.
+*/
+static char* mapSource(char* path, long* length)
+{
+    int file = open(path, O_RDONLY);
+    if (file < 0) return NULL;
+    struct stat status;
+    char* source = NULL;
+    if (fstat(file, &status) == 0 && S_ISREG(status.st_mode)) {
+        *length = status.st_size;
+        if (*length == 0) source = "";
+        else source = mmap(NULL, *length, PROT_READ, MAP_PRIVATE, file, 0);
+        if (source == MAP_FAILED) source = NULL;
+    }
+    close(file);
+    return source;
+}
+
+/****************************************************************
+ Private helper continuing the 64 bit FNV-1a hash of some bytes from
+ the given hash, which is 14695981039346656037 to start with.
+*/
+static unsigned long hashBytes(unsigned long hash, char* bytes, long length)
+{
+    long i;
+    for (i = 0; i < length; i++) {
+        hash ^= (unsigned char) bytes[i];
+        hash *= 1099511628211UL;
+    }
+    return hash;
+}
+
+/****************************************************************
+ Private helper parsing every top level form of a source, on as
+ many threads as readForms() uses unless quoted data are shared.
+*/
+static Cell** parseForms(char* source, long length, int* count)
+{
+    if (!isHashConsing()) {
+        Cell** forms = readForms(source, length, count);
+        if (forms != NULL) return forms;
+    }
+
+    int capacity = 64;
+    Cell** forms = malloc(sizeof(Cell*) * capacity);
+    *count = 0;
+    FILE* stream = fmemopen(source, length > 0 ? length : 1, "r");
+    pushTokenSource(stream);
+    while (length > 0 && moreTokens()) {
+        if (*count == capacity) {
+            capacity *= 2;
+            forms = realloc(forms, sizeof(Cell*) * capacity);
+        }
+        forms[(*count)++] = S_Expression()->mStructure;
+    }
+    popTokenSource();
+    fclose(stream);
+    return forms;
+}
+
+/****************************************************************
+ Private helper making the forms kept in a cache, or giving NULL
+ when there is no cache for the given source or it does not hold
+ together, as when its checksum does not match what it holds.
+*/
+static Cell** readCache(char* path, long sourceLength, unsigned long sourceHash, int* count)
+{
+    long length;
+    char* cache = readSource(path, &length);
+    if (cache == NULL) return NULL;
+    CacheHeader* header = (CacheHeader*) cache;
+    long symbolsAt = sizeof(CacheHeader);
+    long nodesAt = symbolsAt + (length >= symbolsAt ? header->mSymbolBytes : 0);
+    if (length < symbolsAt || memcmp(header->mMagic, CACHE_MAGIC, 8) != 0
+        || header->mSourceLength != sourceLength || header->mSourceHash != sourceHash
+        || header->mSymbolCount < 0 || header->mSymbolBytes < 0 || header->mNodeCount < 0
+        || header->mSymbolBytes % sizeof(unsigned int) != 0
+        || header->mFormCount < 0
+        || length != nodesAt + (long) sizeof(unsigned int) * header->mNodeCount
+        || hashBytes(14695981039346656037UL, cache + symbolsAt, length - symbolsAt) != header->mChecksum) {
+        free(cache);
+        return NULL;
+    }
+
+    // Symbols are interned as the parser does
+    char** symbols = malloc(sizeof(char*) * (header->mSymbolCount > 0 ? header->mSymbolCount : 1));
+    char* text = cache + symbolsAt;
+    int i;
+    for (i = 0; i < header->mSymbolCount; i++) {
+        if (text >= cache + nodesAt) break;
+        symbols[i] = internSymbol(text);
+        text += strlen(text) + 1;
+    }
+    int valid = i == header->mSymbolCount;
+
+    // Each record fills the place on top of the stack, and leaves the
+    // place of its next cell and then of its sub branch to fill. More
+    // places than records left means the cache does not hold together.
+    unsigned int* nodes = (unsigned int*) (cache + nodesAt);
+    Cell** forms = malloc(sizeof(Cell*) * (header->mFormCount > 0 ? header->mFormCount : 1));
+    Cell*** places = malloc(sizeof(Cell**) * (header->mNodeCount + 1));
+    int site = enterSite(SITE_PARSER);
+    size_t size = sizeof(Cell) * (header->mNodeCount > 0 ? header->mNodeCount : 1);
+    Cell* cells = allocate(size);
+    int node = 0;
+    int form;
+    for (form = 0; valid && form < header->mFormCount; form++) {
+        int depth = 0;
+        places[depth++] = &forms[form];
+        while (valid && depth > 0) {
+            valid = node + depth <= header->mNodeCount
+                    && nodes[node] >> NODE_FLAGS <= (unsigned int) header->mSymbolCount;
+            if (!valid) break;
+            unsigned int symbol = nodes[node] >> NODE_FLAGS;
+            Cell* cell = &cells[node];
+            *places[--depth] = cell;
+            cell->mSymbol = symbol > 0 ? symbols[symbol - 1] : NULL;
+            cell->mNext = NULL;
+            cell->mSub = NULL;
+            cell->mType = CELL_PLAIN;
+            cell->mHash = 0;
+            cell->mData = NULL;
+            // Numbers are tagged as the parser's, as S_Expression() would
+            if (cell->mSymbol != NULL) tagNumber(cell);
+            if (nodes[node] & NODE_NEXT) places[depth++] = &cell->mNext;
+            if (nodes[node] & NODE_SUB) places[depth++] = &cell->mSub;
+            node++;
+        }
+    }
+    if (node != header->mNodeCount) valid = 0;
+    if (!valid) release(cells, size);
+    leaveSite(site);
+    if (valid) *count = header->mFormCount;
+    free(places);
+    free(symbols);
+    free(cache);
+    if (!valid) {
+        free(forms);
+        return NULL;
+    }
+    return forms;
+}
+
+/****************************************************************
+ Private helper writing the cache of the given forms, beside the
+ file and then over it, so that a batch run reading the cache at
+ the same moment never sees half of it.
+*/
+static void writeCache(char* path, long sourceLength, unsigned long sourceHash, Cell** forms, int count)
+{
+    int i;
+    for (i = 0; i < count; i++)
+        addNodes(forms[i]);
+
+    char padding[sizeof(unsigned int)] = { 0 };
+    int padded = (sizeof(unsigned int) - mSymbolBytes % sizeof(unsigned int)) % sizeof(unsigned int);
+    unsigned long checksum = 14695981039346656037UL;
+    for (i = 0; i < mSymbolCount; i++)
+        checksum = hashBytes(checksum, mSymbols[i], strlen(mSymbols[i]) + 1);
+    checksum = hashBytes(checksum, padding, padded);
+    CacheHeader header;
+    memcpy(header.mMagic, CACHE_MAGIC, 8);
+    header.mSourceLength = sourceLength;
+    header.mSourceHash = sourceHash;
+    header.mChecksum = hashBytes(checksum, (char*) mNodes, sizeof(unsigned int) * mNodeCount);
+    header.mSymbolCount = mSymbolCount;
+    header.mSymbolBytes = mSymbolBytes + padded;
+    header.mNodeCount = mNodeCount;
+    header.mFormCount = count;
+
+    char* written = malloc(sizeof(char) * (strlen(path) + 24));
+    sprintf(written, "%s.%d", path, (int) getpid());
+    FILE* file = fopen(written, "wb");
+    if (file != NULL) {
+        int failed = fwrite(&header, sizeof(CacheHeader), 1, file) != 1;
+        for (i = 0; i < mSymbolCount && !failed; i++)
+            failed = fwrite(mSymbols[i], 1, strlen(mSymbols[i]) + 1, file) != strlen(mSymbols[i]) + 1;
+        if (!failed) failed = fwrite(padding, 1, padded, file) != (size_t) padded;
+        if (!failed) failed = fwrite(mNodes, sizeof(unsigned int), mNodeCount, file) != (size_t) mNodeCount;
+        failed = fclose(file) != 0 || failed;
+        if (failed || rename(written, path) != 0) remove(written);
+    }
+
+    free(written);
+    free(mNodes);
+    mNodes = NULL;
+    mNodeCount = 0;
+    mNodeCapacity = 0;
+    free(mSymbols);
+    mSymbols = NULL;
+    mSymbolCount = 0;
+    mSymbolBytes = 0;
+    free(mSymbolSlots);
+    mSymbolSlots = NULL;
+    mSlotCapacity = 0;
+}
+
+/****************************************************************
+ Private helper adding records for the given cell and every cell
+ after it on its level, along with everything below them. Levels
+ are followed in a loop, so only nesting recurses.
+*/
+static void addNodes(Cell* cell)
+{
+    for (; cell != NULL; cell = cell->mNext) {
+        if (mNodeCount == mNodeCapacity) {
+            mNodeCapacity = mNodeCapacity == 0 ? 1024 : mNodeCapacity * 2;
+            mNodes = realloc(mNodes, sizeof(unsigned int) * mNodeCapacity);
+        }
+        unsigned int symbol = cell->mSymbol != NULL ? symbolNumber(cell->mSymbol) + 1 : 0;
+        mNodes[mNodeCount++] = symbol << NODE_FLAGS | (cell->mSub != NULL ? NODE_SUB : 0)
+                               | (cell->mNext != NULL ? NODE_NEXT : 0);
+        addNodes(cell->mSub);
+    }
+}
+
+/****************************************************************
+ Private helper giving the number of a symbol in the cache being
+ written, adding it the first time.
+*/
+static int symbolNumber(char* symbol)
+{
+    if ((mSymbolCount + 1) * 2 > mSlotCapacity) {
+        // Grow and re-insert every symbol
+        mSlotCapacity = mSlotCapacity == 0 ? 1024 : mSlotCapacity * 2;
+        free(mSymbolSlots);
+        mSymbolSlots = malloc(sizeof(int) * mSlotCapacity);
+        memset(mSymbolSlots, -1, sizeof(int) * mSlotCapacity);
+        mSymbols = realloc(mSymbols, sizeof(char*) * mSlotCapacity / 2);
+        int i;
+        for (i = 0; i < mSymbolCount; i++) {
+            unsigned int slot = hashText(mSymbols[i]) & (mSlotCapacity - 1);
+            while (mSymbolSlots[slot] != -1)
+                slot = (slot + 1) & (mSlotCapacity - 1);
+            mSymbolSlots[slot] = i;
+        }
+    }
+    unsigned int slot = hashText(symbol) & (mSlotCapacity - 1);
+    while (mSymbolSlots[slot] != -1) {
+        if (strcmp(mSymbols[mSymbolSlots[slot]], symbol) == 0) return mSymbolSlots[slot];
+        slot = (slot + 1) & (mSlotCapacity - 1);
+    }
+    mSymbolSlots[slot] = mSymbolCount;
+    mSymbols[mSymbolCount] = symbol;
+    mSymbolBytes += strlen(symbol) + 1;
+    return mSymbolCount++;
+}
+
+/****************************************************************
+ Private helper hashing symbol text (djb2).
+*/
+static unsigned int hashText(char* text)
+{
+    unsigned int hash = 5381;
+    while (*text != '\0')
+        hash = hash * 33 + (unsigned char) *text++;
+    return hash;
+}
@@ -0,0 +1,34 @@
+#ifndef ASTCACHE_H_INCLUDED
+#define ASTCACHE_H_INCLUDED
+
+#include "parser.h"
+
+/****************************************************************
+ File: AstCache.h
+ ----------------
+ Interface for AstCache, which reads the top level forms of Scheme
+ files for the function call (load file), keeping the parsed forms
+ of each file beside it in a binary cache, file.ast, so that
+ loading the same source again skips the lexer and parser.
+
+ A cache holds a table of the symbols used and a fixed size record
+ of one number for each cell, giving its symbol and whether it has
+ a sub branch and a next cell, which the order of the records
+ places. It is keyed by the length and a 64 bit FNV-1a hash of the
+ source, and checked against the same hash of what it holds, so
+ an edited source or a damaged cache is parsed again and the cache
+ rewritten, while a cache that cannot be written is simply not
+ kept. While hash-consing is on (see setHashConsing(int)), sources
+ are always parsed, so that quoted data share their cells.
+ ****************************************************************/
+
+/****************************************************************
+ Gives the top level forms of the Scheme file at the given path,
+ each as the structure S_Expression() would produce, and their
+ number through the second parameter. Returns NULL when the file
+ cannot be read. The lexer must have been started with
+ startTokens(int).
+*/
+Cell** loadForms(char*, int*);
+
+#endif
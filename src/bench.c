@@ -0,0 +1,362 @@
+#define _GNU_SOURCE
+#include <stdlib.h>
+#include <string.h>
+#include <stdio.h>
+#include <time.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/resource.h>
+#include "lexer.h"
+#include "parser.h"
+#include "evaluation.h"
+
+/****************************************************************
+ File: Bench.c
+ ----------------
+ Self-timing benchmark harness, built and run by "make bench".
+ Every workload is an input run through S_Expression(), eval(List*)
+ and printList(List*) as the read-eval-print loop would, after a
+ setup input evaluated once, apart from the lexer and parser
+ workloads which stop after getToken() and S_Expression().
+
+ Each workload is timed over several rounds and the fastest round
+ is kept, which filters out most of the noise of a shared machine.
+ Results are written one workload per line, fields separated by
+ tabs:
+
+    name  iterations  ns/op  allocs/op  bytes/op  peak-rss-kb
+
+ Allocations are counted by wrapping malloc, calloc and realloc at
+ link time (see the Makefile), so every allocation the interpreter
+ makes of the C library is seen. Cells and other small objects are
+ carved out of larger blocks by Allocator (see allocator.h), so only
+ those blocks are counted here, while (memory-stats) counts the
+ objects themselves. Peak RSS is that of the whole run so far, as
+ the interpreter never frees cells.
+
+ Usage: schemer-bench [-O<level>] [--save file] [--baseline file]
+                      [--tolerance percent]
+
+ With --baseline, each workload is compared against a results file
+ written by --save, and the run fails when one got slower by more
+ than the tolerance (50% unless given) or allocates more per op.
+ Times only compare on the machine the baseline was saved on, while
+ allocation counts are exact anywhere.
+ ****************************************************************/
+
+// Allocations counted by the wrappers below
+static long mAllocations = 0;
+static long mAllocatedBytes = 0;
+
+// Real allocators behind the wrappers, see ld --wrap
+void* __real_malloc(size_t);
+void* __real_calloc(size_t, size_t);
+void* __real_realloc(void*, size_t);
+
+// Rounds each workload is timed over
+#define ROUNDS 5
+
+/****************************************************************
+ One workload. The setup input, if any, is evaluated once before
+ timing, and the input is then run the given number of times in
+ every round.
+*/
+typedef struct workload Workload;
+struct workload {
+    char* mName;
+    char* mSetup;
+    char* mInput;
+    int mIterations;
+    int mKind;
+};
+
+// Kinds of workload
+#define RUN_EVAL 0
+#define RUN_LEXER 1
+#define RUN_PARSER 2
+
+/****************************************************************
+ Measured results of a workload, or of a line of a baseline file.
+*/
+typedef struct result Result;
+struct result {
+    char mName[64];
+    long mIterations;
+    double mNanoseconds;
+    double mAllocations;
+    double mBytes;
+    long mPeakKilobytes;
+};
+
+// Prototypes for private helpers
+static char* generatedAlist(int);
+static char* generatedSource(int);
+static void evaluateText(char*);
+static void runOnce(Workload*);
+static void measure(Workload*, Result*);
+static double now();
+static int readBaseline(char*, Result*, int);
+static void printResult(FILE*, Result*);
+
+/****************************************************************
+ Runs every workload, prints the results, and saves or compares
+ them as asked. Returns 1 when a workload regressed against the
+ baseline.
+*/
+int main(int argc, char** argv)
+{
+    char* saved = NULL;
+    char* baseline = NULL;
+    double tolerance = 50;
+    int i;
+    for (i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--save") == 0 && i + 1 < argc) saved = argv[++i];
+        else if (strcmp(argv[i], "--baseline") == 0 && i + 1 < argc) baseline = argv[++i];
+        else if (strcmp(argv[i], "--tolerance") == 0 && i + 1 < argc) tolerance = atof(argv[++i]);
+        else if (strncmp(argv[i], "-O", 2) == 0 && argv[i][2] >= '0' && argv[i][2] <= '9')
+            setOptimizationLevel(atoi(argv[i] + 2));
+        else {
+            printf("Unknown option %s.\n", argv[i]);
+            return 1;
+        }
+    }
+    startTokens(TOKEN_LENGTH);
+
+    Workload workloads[] = {
+        { "fib", "(define (fib n) (if (< n 2) n (+ (fib (- n 1)) (fib (- n 2)))))",
+          "(fib 15)", 4, RUN_EVAL },
+        { "ackermann", "(define (ack m n) (cond ((equal? m 0) (+ n 1)) ((equal? n 0) (ack (- m 1) 1))"
+          " (else (ack (- m 1) (ack m (- n 1))))))", "(ack 2 3)", 40, RUN_EVAL },
+        { "list-build", "(define (build n) (if (< n 1) (quote ()) (cons n (build (- n 1)))))",
+          "(append (build 200) (list 1 2 3 (list 4 5) 6))", 40, RUN_EVAL },
+        { "assoc-deep", generatedAlist(500), "(assoc 'k499 alist)", 4000, RUN_EVAL },
+        { "equal-large", "(define (build n) (if (< n 1) (quote ()) (cons (list n 'a) (build (- n 1)))))"
+          " (define big (build 1000)) (define other (build 1000))", "(equal? big other)", 400, RUN_EVAL },
+        { "lexer", NULL, generatedSource(2000), 4, RUN_LEXER },
+        { "parser", NULL, generatedSource(2000), 4, RUN_PARSER }
+    };
+    int count = sizeof(workloads) / sizeof(Workload);
+
+    Result* results = malloc(sizeof(Result) * count);
+    for (i = 0; i < count; i++)
+        measure(&workloads[i], &results[i]);
+
+    printf("# name\titerations\tns/op\tallocs/op\tbytes/op\tpeak-rss-kb\n");
+    for (i = 0; i < count; i++)
+        printResult(stdout, &results[i]);
+
+    if (saved != NULL) {
+        FILE* file = fopen(saved, "w");
+        if (file == NULL) {
+            printf("bench: cannot write %s.\n", saved);
+            return 1;
+        }
+        fprintf(file, "# name\titerations\tns/op\tallocs/op\tbytes/op\tpeak-rss-kb\n");
+        for (i = 0; i < count; i++)
+            printResult(file, &results[i]);
+        fclose(file);
+    }
+
+    int regressed = 0;
+    if (baseline != NULL) {
+        Result* expected = malloc(sizeof(Result) * 64);
+        int known = readBaseline(baseline, expected, 64);
+        if (known < 0) {
+            printf("bench: cannot read %s.\n", baseline);
+            return 1;
+        }
+        printf("# name\tratio\tstatus\n");
+        for (i = 0; i < count; i++) {
+            int j;
+            for (j = 0; j < known && strcmp(expected[j].mName, results[i].mName) != 0; j++);
+            if (j == known) {
+                printf("%s\t-\tnew\n", results[i].mName);
+                continue;
+            }
+            double ratio = results[i].mNanoseconds / expected[j].mNanoseconds;
+            char* status = "ok";
+            if (ratio > 1 + tolerance / 100) status = "slower";
+            // Allocation counts are exact, so any growth is reported
+            else if (results[i].mAllocations > expected[j].mAllocations + 0.5) status = "more-allocations";
+            if (strcmp(status, "ok") != 0) regressed = 1;
+            printf("%s\t%.2f\t%s\n", results[i].mName, ratio, status);
+        }
+        free(expected);
+    }
+    free(results);
+    return regressed;
+}
+
+/****************************************************************
+ Wrappers counting every allocation before handing it on.
+*/
+void* __wrap_malloc(size_t size)
+{
+    mAllocations++;
+    mAllocatedBytes += size;
+    return __real_malloc(size);
+}
+
+void* __wrap_calloc(size_t count, size_t size)
+{
+    mAllocations++;
+    mAllocatedBytes += count * size;
+    return __real_calloc(count, size);
+}
+
+void* __wrap_realloc(void* old, size_t size)
+{
+    mAllocations++;
+    mAllocatedBytes += size;
+    return __real_realloc(old, size);
+}
+
+/****************************************************************
+ Private helper generating the definition of alist, an association
+ list of the given number of pairs (k0 0) (k1 1) and so on.
+*/
+static char* generatedAlist(int count)
+{
+    char* text = malloc(sizeof(char) * (count * 24 + 32));
+    int length = sprintf(text, "(define alist '(");
+    int i;
+    for (i = 0; i < count; i++)
+        length += sprintf(text + length, "(k%d %d) ", i, i);
+    sprintf(text + length, "))");
+    return text;
+}
+
+/****************************************************************
+ Private helper generating the given number of top level forms
+ mixing the kinds of tokens found in Scheme source.
+*/
+static char* generatedSource(int count)
+{
+    static char* form = "(define (f%d x) (cond ((< x 2.5) 'small) (else (+ x %d \"text\" #t))))"
+                        " ; comment\n";
+    char* text = malloc(sizeof(char) * (count * (strlen(form) + 24) + 1));
+    int length = 0;
+    int i;
+    for (i = 0; i < count; i++)
+        length += sprintf(text + length, form, i, i);
+    text[length] = '\0';
+    return text;
+}
+
+/****************************************************************
+ Private helper reading and evaluating every form of the given
+ text, printing the results as the read-eval-print loop does.
+*/
+static void evaluateText(char* text)
+{
+    FILE* stream = fmemopen(text, strlen(text), "r");
+    pushTokenSource(stream);
+    while (moreTokens())
+        printList(eval(S_Expression()));
+    popTokenSource();
+    fclose(stream);
+}
+
+/****************************************************************
+ Private helper running the input of a workload once.
+*/
+static void runOnce(Workload* workload)
+{
+    if (workload->mKind == RUN_EVAL) {
+        evaluateText(workload->mInput);
+        return;
+    }
+    FILE* stream = fmemopen(workload->mInput, strlen(workload->mInput), "r");
+    pushTokenSource(stream);
+    while (moreTokens()) {
+        if (workload->mKind == RUN_LEXER) getToken();
+        else S_Expression();
+    }
+    popTokenSource();
+    fclose(stream);
+}
+
+/****************************************************************
+ Private helper timing a workload. Printed results are sent to
+ /dev/null meanwhile, though still formatted. Allocations are
+ averaged over every round.
+*/
+static void measure(Workload* workload, Result* result)
+{
+    fflush(stdout);
+    int console = dup(STDOUT_FILENO);
+    int discarded = open("/dev/null", O_WRONLY);
+    dup2(discarded, STDOUT_FILENO);
+    close(discarded);
+
+    if (workload->mSetup != NULL) evaluateText(workload->mSetup);
+    // Warm up caches once outside the measurement
+    runOnce(workload);
+
+    long allocations = mAllocations;
+    long bytes = mAllocatedBytes;
+    double fastest = 0;
+    int round;
+    for (round = 0; round < ROUNDS; round++) {
+        double start = now();
+        int i;
+        for (i = 0; i < workload->mIterations; i++)
+            runOnce(workload);
+        double elapsed = now() - start;
+        if (round == 0 || elapsed < fastest) fastest = elapsed;
+    }
+    fflush(stdout);
+    dup2(console, STDOUT_FILENO);
+    close(console);
+
+    struct rusage usage;
+    getrusage(RUSAGE_SELF, &usage);
+    strncpy(result->mName, workload->mName, sizeof(result->mName) - 1);
+    result->mName[sizeof(result->mName) - 1] = '\0';
+    result->mIterations = (long) workload->mIterations * ROUNDS;
+    result->mNanoseconds = fastest / workload->mIterations;
+    result->mAllocations = (double) (mAllocations - allocations) / result->mIterations;
+    result->mBytes = (double) (mAllocatedBytes - bytes) / result->mIterations;
+    result->mPeakKilobytes = usage.ru_maxrss;
+}
+
+/****************************************************************
+ Private helper giving a monotonic time in nanoseconds.
+*/
+static double now()
+{
+    struct timespec time;
+    clock_gettime(CLOCK_MONOTONIC, &time);
+    return time.tv_sec * 1e9 + time.tv_nsec;
+}
+
+/****************************************************************
+ Private helper reading at most the given number of results from a
+ file written by --save. Returns how many were read, or -1 when
+ the file cannot be opened.
+*/
+static int readBaseline(char* path, Result* results, int capacity)
+{
+    FILE* file = fopen(path, "r");
+    if (file == NULL) return -1;
+    char line[256];
+    int count = 0;
+    while (count < capacity && fgets(line, sizeof(line), file) != NULL) {
+        if (line[0] == '#') continue;
+        Result* result = &results[count];
+        if (sscanf(line, "%63s %ld %lf %lf %lf %ld", result->mName, &result->mIterations,
+                   &result->mNanoseconds, &result->mAllocations, &result->mBytes,
+                   &result->mPeakKilobytes) == 6) count++;
+    }
+    fclose(file);
+    return count;
+}
+
+/****************************************************************
+ Private helper writing one result line.
+*/
+static void printResult(FILE* file, Result* result)
+{
+    fprintf(file, "%s\t%ld\t%.0f\t%.1f\t%.0f\t%ld\n", result->mName, result->mIterations,
+            result->mNanoseconds, result->mAllocations, result->mBytes, result->mPeakKilobytes);
+}
@@ -0,0 +1,508 @@
+#include <stdlib.h>
+#include <string.h>
+#include "bignum.h"
+
+/****************************************************************
+ File: Bignum.c
+ ----------------
+ Implementation for bignum.h interface. The signed operations are
+ thin wrappers around private helpers that work on magnitudes,
+ that is, plain arrays of limbs with an explicit length.
+ ****************************************************************/
+
+// Operands with fewer limbs than this are multiplied the schoolbook way
+#define KARATSUBA_THRESHOLD 32
+
+// Largest power of ten fitting in a limb, used for decimal conversion
+#define DECIMAL_BASE 1000000000u
+#define DECIMAL_DIGITS 9
+
+// Prototypes for private helpers
+static Bignum* iniBignum(int, int);
+static int normalize(unsigned int*, int);
+static int compareMagnitude(unsigned int*, int, unsigned int*, int);
+static void addInto(unsigned int*, int, unsigned int*, int, int);
+static void subtractFrom(unsigned int*, int, unsigned int*, int);
+static void multiplyMagnitude(unsigned int*, int, unsigned int*, int, unsigned int*);
+static Bignum* addSigned(Bignum*, Bignum*, int);
+static void divideMagnitude(unsigned int*, int, unsigned int*, int, unsigned int*, unsigned int*);
+
+/****************************************************************
+ bignumFromLong(): See header file for documentation.
+*/
+Bignum* bignumFromLong(long value)
+{
+    Bignum* big = iniBignum(2, 0);
+    unsigned long magnitude = value < 0 ? -(unsigned long) value : (unsigned long) value;
+    big->mLimbs[0] = (unsigned int) magnitude;
+    big->mLimbs[1] = (unsigned int) (magnitude >> 32);
+    big->mLength = normalize(big->mLimbs, 2);
+    big->mSign = big->mLength == 0 ? 0 : (value < 0 ? -1 : 1);
+    return big;
+}
+
+/****************************************************************
+ bignumFromText() implementation notes: Digits are consumed in
+ chunks of up to nine, each multiplying the magnitude so far by
+ the matching power of ten before adding the chunk.
+*/
+Bignum* bignumFromText(char* text)
+{
+    int negative = text[0] == '-';
+    if (negative) text++;
+    int digits = strlen(text);
+
+    // Every nine digits need at most one limb
+    Bignum* big = iniBignum(digits / DECIMAL_DIGITS + 2, 0);
+    int length = 0;
+    int i = 0;
+    while (i < digits) {
+        int chunk = digits - i < DECIMAL_DIGITS ? digits - i : DECIMAL_DIGITS;
+        unsigned int scale = 1;
+        unsigned int value = 0;
+        int j;
+        for (j = 0; j < chunk; j++) {
+            scale *= 10;
+            value = value * 10 + (text[i + j] - '0');
+        }
+        i += chunk;
+
+        // magnitude = magnitude * scale + value
+        unsigned long carry = value;
+        for (j = 0; j < length; j++) {
+            unsigned long product = (unsigned long) big->mLimbs[j] * scale + carry;
+            big->mLimbs[j] = (unsigned int) product;
+            carry = product >> 32;
+        }
+        if (carry != 0) big->mLimbs[length++] = (unsigned int) carry;
+    }
+    big->mLength = normalize(big->mLimbs, length);
+    big->mSign = big->mLength == 0 ? 0 : (negative ? -1 : 1);
+    return big;
+}
+
+/****************************************************************
+ bignumToText() implementation notes: A copy of the magnitude is
+ repeatedly divided by 10^9, and the remainders give the digits
+ nine at a time from least to most significant.
+*/
+char* bignumToText(Bignum* big)
+{
+    // Ten decimal digits cover every 32 bit limb
+    int capacity = big->mLength * 10 + 2;
+    char* text = malloc(capacity + 1);
+    char* digit = text + capacity;
+    *digit = '\0';
+
+    unsigned int* work = malloc(sizeof(unsigned int) * (big->mLength > 0 ? big->mLength : 1));
+    memcpy(work, big->mLimbs, sizeof(unsigned int) * big->mLength);
+    int length = big->mLength;
+    do {
+        unsigned long remainder = 0;
+        int i;
+        for (i = length - 1; i >= 0; i--) {
+            unsigned long current = (remainder << 32) | work[i];
+            work[i] = (unsigned int) (current / DECIMAL_BASE);
+            remainder = current % DECIMAL_BASE;
+        }
+        length = normalize(work, length);
+
+        // Pad every chunk but the most significant to nine digits
+        int j;
+        for (j = 0; j < DECIMAL_DIGITS && (length > 0 || remainder != 0 || j == 0); j++) {
+            *--digit = '0' + remainder % 10;
+            remainder /= 10;
+        }
+    } while (length > 0);
+    free(work);
+
+    if (big->mSign < 0) *--digit = '-';
+    memmove(text, digit, strlen(digit) + 1);
+    return text;
+}
+
+/****************************************************************
+ bignumToLong(): See header file for documentation.
+*/
+int bignumToLong(Bignum* big, long* value)
+{
+    if (big->mLength > 2) return 0;
+    unsigned long magnitude = 0;
+    if (big->mLength > 0) magnitude = big->mLimbs[0];
+    if (big->mLength > 1) magnitude |= (unsigned long) big->mLimbs[1] << 32;
+
+    if (big->mSign >= 0) {
+        if (magnitude > (unsigned long) __LONG_MAX__) return 0;
+        *value = (long) magnitude;
+    } else {
+        if (magnitude > (unsigned long) __LONG_MAX__ + 1) return 0;
+        *value = (long) -magnitude;
+    }
+    return 1;
+}
+
+/****************************************************************
+ bignumToDouble(): See header file for documentation. Only the top
+ three limbs can affect a 53 bit mantissa, so lower ones are only
+ counted through their scale.
+*/
+double bignumToDouble(Bignum* big)
+{
+    double value = 0;
+    int i;
+    int lowest = big->mLength > 3 ? big->mLength - 3 : 0;
+    for (i = big->mLength - 1; i >= lowest; i--)
+        value = value * 4294967296.0 + big->mLimbs[i];
+    for (i = 0; i < lowest; i++)
+        value *= 4294967296.0;
+    return big->mSign < 0 ? -value : value;
+}
+
+/****************************************************************
+ bignumAdd(): See header file for documentation.
+*/
+Bignum* bignumAdd(Bignum* a, Bignum* b)
+{
+    return addSigned(a, b, b->mSign);
+}
+
+/****************************************************************
+ bignumSubtract(): See header file for documentation.
+*/
+Bignum* bignumSubtract(Bignum* a, Bignum* b)
+{
+    return addSigned(a, b, -b->mSign);
+}
+
+/****************************************************************
+ bignumMultiply(): See header file for documentation.
+*/
+Bignum* bignumMultiply(Bignum* a, Bignum* b)
+{
+    if (a->mSign == 0 || b->mSign == 0) return iniBignum(1, 0);
+    Bignum* product = iniBignum(a->mLength + b->mLength, 0);
+    multiplyMagnitude(a->mLimbs, a->mLength, b->mLimbs, b->mLength, product->mLimbs);
+    product->mLength = normalize(product->mLimbs, a->mLength + b->mLength);
+    product->mSign = a->mSign * b->mSign;
+    return product;
+}
+
+/****************************************************************
+ bignumDivide(): See header file for documentation.
+*/
+Bignum* bignumDivide(Bignum* a, Bignum* b, Bignum** remainder)
+{
+    Bignum* quotient;
+    Bignum* rest;
+    if (compareMagnitude(a->mLimbs, a->mLength, b->mLimbs, b->mLength) < 0) {
+        // Dividend smaller than the divisor leaves it all as remainder
+        quotient = iniBignum(1, 0);
+        rest = addSigned(a, quotient, 0);
+    } else {
+        quotient = iniBignum(a->mLength, a->mLength);
+        rest = iniBignum(b->mLength, b->mLength);
+        divideMagnitude(a->mLimbs, a->mLength, b->mLimbs, b->mLength,
+                        quotient->mLimbs, rest->mLimbs);
+        quotient->mLength = normalize(quotient->mLimbs, a->mLength);
+        quotient->mSign = quotient->mLength == 0 ? 0 : a->mSign * b->mSign;
+        rest->mLength = normalize(rest->mLimbs, b->mLength);
+        rest->mSign = rest->mLength == 0 ? 0 : a->mSign;
+    }
+    if (remainder != NULL) *remainder = rest;
+    return quotient;
+}
+
+/****************************************************************
+ bignumCompare(): See header file for documentation.
+*/
+int bignumCompare(Bignum* a, Bignum* b)
+{
+    if (a->mSign != b->mSign) return a->mSign < b->mSign ? -1 : 1;
+    int order = compareMagnitude(a->mLimbs, a->mLength, b->mLimbs, b->mLength);
+    return a->mSign < 0 ? -order : order;
+}
+
+/****************************************************************
+ Private helper allocating a Bignum with room for the given number
+ of limbs, all zero, and the given length.
+*/
+static Bignum* iniBignum(int capacity, int length)
+{
+    Bignum* big = malloc(sizeof(Bignum));
+    big->mSign = 0;
+    big->mLength = length;
+    big->mLimbs = calloc(capacity > 0 ? capacity : 1, sizeof(unsigned int));
+    return big;
+}
+
+/****************************************************************
+ Private helper giving the length of a magnitude once its leading
+ zero limbs are dropped.
+*/
+static int normalize(unsigned int* limbs, int length)
+{
+    while (length > 0 && limbs[length - 1] == 0)
+        length--;
+    return length;
+}
+
+/****************************************************************
+ Private helper comparing two normalized magnitudes.
+*/
+static int compareMagnitude(unsigned int* a, int na, unsigned int* b, int nb)
+{
+    if (na != nb) return na < nb ? -1 : 1;
+    int i;
+    for (i = na - 1; i >= 0; i--)
+        if (a[i] != b[i]) return a[i] < b[i] ? -1 : 1;
+    return 0;
+}
+
+/****************************************************************
+ Private helper adding a magnitude into a destination of the given
+ length, starting at the given limb offset. Limbs and carries that
+ would land past the destination must be zero and are dropped.
+*/
+static void addInto(unsigned int* destination, int length, unsigned int* source, int count, int offset)
+{
+    unsigned long carry = 0;
+    int i;
+    for (i = 0; offset + i < length && (i < count || carry != 0); i++) {
+        unsigned long sum = (unsigned long) destination[offset + i] + carry;
+        if (i < count) sum += source[i];
+        destination[offset + i] = (unsigned int) sum;
+        carry = sum >> 32;
+    }
+}
+
+/****************************************************************
+ Private helper subtracting a magnitude from a destination of the
+ given length. The destination must hold the larger value.
+*/
+static void subtractFrom(unsigned int* destination, int length, unsigned int* source, int count)
+{
+    long borrow = 0;
+    int i;
+    for (i = 0; i < length && (i < count || borrow != 0); i++) {
+        long difference = (long) destination[i] - borrow;
+        if (i < count) difference -= source[i];
+        borrow = difference < 0;
+        destination[i] = (unsigned int) (difference + (borrow << 32));
+    }
+}
+
+/****************************************************************
+ Private helper multiplying two magnitudes into an output of
+ na + nb limbs, which is overwritten. Operands need not be
+ normalized.
+
+ Karatsuba's method splits both operands at half limbs, with
+ a = a1 * B^half + a0 and b = b1 * B^half + b0, and forms the
+ product from three half sized products instead of four:
+
+    z0 = a0 * b0
+    z2 = a1 * b1
+    z1 = (a0 + a1) * (b0 + b1) - z0 - z2
+    a * b = z2 * B^(2 * half) + z1 * B^half + z0
+
+ When one operand is much shorter than the other, only the longer
+ one is split and the two partial products are summed instead.
+*/
+static void multiplyMagnitude(unsigned int* a, int na, unsigned int* b, int nb, unsigned int* out)
+{
+    int i, j;
+    memset(out, 0, sizeof(unsigned int) * (na + nb));
+
+    if (na < KARATSUBA_THRESHOLD || nb < KARATSUBA_THRESHOLD) {
+        for (i = 0; i < na; i++) {
+            unsigned long carry = 0;
+            for (j = 0; j < nb; j++) {
+                unsigned long product = (unsigned long) a[i] * b[j] + out[i + j] + carry;
+                out[i + j] = (unsigned int) product;
+                carry = product >> 32;
+            }
+            out[i + nb] = (unsigned int) carry;
+        }
+        return;
+    }
+
+    // Make a the longer operand
+    if (na < nb) {
+        unsigned int* swap = a;
+        a = b;
+        b = swap;
+        int swapLength = na;
+        na = nb;
+        nb = swapLength;
+    }
+    int half = na / 2;
+
+    if (nb <= half) {
+        // Unbalanced: a0 * b + a1 * b * B^half
+        unsigned int* partial = malloc(sizeof(unsigned int) * (na - half + nb));
+        multiplyMagnitude(a, half, b, nb, partial);
+        addInto(out, na + nb, partial, half + nb, 0);
+        multiplyMagnitude(a + half, na - half, b, nb, partial);
+        addInto(out, na + nb, partial, na - half + nb, half);
+        free(partial);
+        return;
+    }
+
+    int highA = na - half;
+    int highB = nb - half;
+    unsigned int* z0 = malloc(sizeof(unsigned int) * 2 * half);
+    unsigned int* z2 = malloc(sizeof(unsigned int) * (highA + highB));
+    multiplyMagnitude(a, half, b, half, z0);
+    multiplyMagnitude(a + half, highA, b + half, highB, z2);
+
+    // Sums of the halves, each at most one limb longer than its longer half
+    int lengthA = (highA > half ? highA : half) + 1;
+    int lengthB = (highB > half ? highB : half) + 1;
+    unsigned int* sumA = calloc(lengthA, sizeof(unsigned int));
+    unsigned int* sumB = calloc(lengthB, sizeof(unsigned int));
+    memcpy(sumA, a + half, sizeof(unsigned int) * highA);
+    memcpy(sumB, b + half, sizeof(unsigned int) * highB);
+    addInto(sumA, lengthA, a, half, 0);
+    addInto(sumB, lengthB, b, half, 0);
+
+    int lengthZ1 = lengthA + lengthB;
+    unsigned int* z1 = malloc(sizeof(unsigned int) * lengthZ1);
+    multiplyMagnitude(sumA, lengthA, sumB, lengthB, z1);
+    subtractFrom(z1, lengthZ1, z0, 2 * half);
+    subtractFrom(z1, lengthZ1, z2, highA + highB);
+
+    addInto(out, na + nb, z0, 2 * half, 0);
+    addInto(out, na + nb, z2, highA + highB, 2 * half);
+    addInto(out, na + nb, z1, lengthZ1, half);
+
+    free(z0);
+    free(z1);
+    free(z2);
+    free(sumA);
+    free(sumB);
+}
+
+/****************************************************************
+ Private helper adding b to a, with b's sign replaced by the given
+ sign. This lets subtraction share the same code as addition.
+*/
+static Bignum* addSigned(Bignum* a, Bignum* b, int signB)
+{
+    if (signB == 0) {
+        Bignum* copy = iniBignum(a->mLength, a->mLength);
+        memcpy(copy->mLimbs, a->mLimbs, sizeof(unsigned int) * a->mLength);
+        copy->mSign = a->mSign;
+        return copy;
+    }
+    if (a->mSign == 0) {
+        Bignum* copy = iniBignum(b->mLength, b->mLength);
+        memcpy(copy->mLimbs, b->mLimbs, sizeof(unsigned int) * b->mLength);
+        copy->mSign = signB;
+        return copy;
+    }
+
+    int length = (a->mLength > b->mLength ? a->mLength : b->mLength) + 1;
+    Bignum* result = iniBignum(length, 0);
+    if (a->mSign == signB) {
+        // Same signs add magnitudes
+        memcpy(result->mLimbs, a->mLimbs, sizeof(unsigned int) * a->mLength);
+        addInto(result->mLimbs, length, b->mLimbs, b->mLength, 0);
+        result->mSign = signB;
+    } else {
+        // Opposite signs subtract the smaller magnitude from the larger
+        int order = compareMagnitude(a->mLimbs, a->mLength, b->mLimbs, b->mLength);
+        if (order == 0) return result;
+        Bignum* larger = order > 0 ? a : b;
+        Bignum* smaller = order > 0 ? b : a;
+        memcpy(result->mLimbs, larger->mLimbs, sizeof(unsigned int) * larger->mLength);
+        subtractFrom(result->mLimbs, length, smaller->mLimbs, smaller->mLength);
+        result->mSign = order > 0 ? a->mSign : signB;
+    }
+    result->mLength = normalize(result->mLimbs, length);
+    if (result->mLength == 0) result->mSign = 0;
+    return result;
+}
+
+/****************************************************************
+ Private helper dividing magnitude u of m limbs by magnitude v of
+ n limbs, where m >= n and v has no leading zero limb, into a
+ quotient of m limbs and a remainder of n limbs. A single limb
+ divisor is a simple pass of short division, otherwise this is
+ Knuth's Algorithm D: both operands are shifted so the divisor's
+ top bit is set, which keeps each estimated quotient limb at most
+ two too large.
+*/
+static void divideMagnitude(unsigned int* u, int m, unsigned int* v, int n,
+                            unsigned int* quotient, unsigned int* remainder)
+{
+    int i, j;
+    if (n == 1) {
+        unsigned long rest = 0;
+        for (j = m - 1; j >= 0; j--) {
+            unsigned long current = (rest << 32) | u[j];
+            quotient[j] = (unsigned int) (current / v[0]);
+            rest = current % v[0];
+        }
+        remainder[0] = (unsigned int) rest;
+        return;
+    }
+
+    // Normalize so that the top bit of the divisor is set
+    int shift = __builtin_clz(v[n - 1]);
+    unsigned int* vn = malloc(sizeof(unsigned int) * n);
+    unsigned int* un = malloc(sizeof(unsigned int) * (m + 1));
+    for (i = n - 1; i > 0; i--)
+        vn[i] = (v[i] << shift) | (unsigned int) ((unsigned long) v[i - 1] >> (32 - shift));
+    vn[0] = v[0] << shift;
+    un[m] = (unsigned int) ((unsigned long) u[m - 1] >> (32 - shift));
+    for (i = m - 1; i > 0; i--)
+        un[i] = (u[i] << shift) | (unsigned int) ((unsigned long) u[i - 1] >> (32 - shift));
+    un[0] = u[0] << shift;
+
+    for (i = 0; i < m; i++)
+        quotient[i] = 0;
+    for (j = m - n; j >= 0; j--) {
+        // Estimate the quotient limb from the top two limbs
+        unsigned long top = ((unsigned long) un[j + n] << 32) | un[j + n - 1];
+        unsigned long estimate = top / vn[n - 1];
+        unsigned long rest = top % vn[n - 1];
+        while (estimate >> 32 != 0
+               || estimate * vn[n - 2] > ((rest << 32) | un[j + n - 2])) {
+            estimate--;
+            rest += vn[n - 1];
+            if (rest >> 32 != 0) break;
+        }
+
+        // Multiply and subtract
+        long borrow = 0;
+        long difference;
+        for (i = 0; i < n; i++) {
+            unsigned long product = estimate * vn[i];
+            difference = (long) un[i + j] - borrow - (long) (product & 0xFFFFFFFFUL);
+            un[i + j] = (unsigned int) difference;
+            borrow = (long) (product >> 32) - (difference >> 32);
+        }
+        difference = (long) un[j + n] - borrow;
+        un[j + n] = (unsigned int) difference;
+
+        // The estimate was one too large, so add the divisor back
+        quotient[j] = (unsigned int) estimate;
+        if (difference < 0) {
+            quotient[j]--;
+            unsigned long carry = 0;
+            for (i = 0; i < n; i++) {
+                unsigned long sum = (unsigned long) un[i + j] + vn[i] + carry;
+                un[i + j] = (unsigned int) sum;
+                carry = sum >> 32;
+            }
+            un[j + n] += (unsigned int) carry;
+        }
+    }
+
+    // Undo the normalization of the remainder
+    for (i = 0; i < n - 1; i++)
+        remainder[i] = (un[i] >> shift) | (unsigned int) ((unsigned long) un[i + 1] << (32 - shift));
+    remainder[n - 1] = un[n - 1] >> shift;
+    free(vn);
+    free(un);
+}
@@ -0,0 +1,76 @@
+#ifndef BIGNUM_H_INCLUDED
+#define BIGNUM_H_INCLUDED
+
+/****************************************************************
+ File: Bignum.h
+ ----------------
+ Interface for Bignum, arbitrary precision integers for numbers
+ that do not fit in a long. Results are always newly allocated
+ and the operands are never modified.
+ ****************************************************************/
+
+/****************************************************************
+ Integer stored as a sign and a magnitude. The magnitude is an
+ array of mLength 32 bit limbs, least significant first, with no
+ leading zero limbs. Zero has an mLength of 0 and an mSign of 0,
+ while any other value has an mSign of 1 or -1.
+*/
+typedef struct bignum Bignum;
+struct bignum {
+    int mSign;
+    int mLength;
+    unsigned int* mLimbs;
+};
+
+/****************************************************************
+ Converts a long into a Bignum.
+*/
+Bignum* bignumFromLong(long);
+
+/****************************************************************
+ Converts decimal text, optionally starting with '-', into a
+ Bignum. The text must hold at least one digit and nothing else.
+*/
+Bignum* bignumFromText(char*);
+
+/****************************************************************
+ Converts a Bignum into newly allocated decimal text.
+*/
+char* bignumToText(Bignum*);
+
+/****************************************************************
+ Converts a Bignum into a long. Returns 1 if the value fits and
+ 0 otherwise, in which case the long is left untouched.
+*/
+int bignumToLong(Bignum*, long*);
+
+/****************************************************************
+ Converts a Bignum into the nearest double, which may be infinite
+ for enormous values.
+*/
+double bignumToDouble(Bignum*);
+
+/****************************************************************
+ Arithmetic on two Bignums. Multiplication switches from the
+ schoolbook method to Karatsuba's once both operands are large.
+*/
+Bignum* bignumAdd(Bignum*, Bignum*);
+Bignum* bignumSubtract(Bignum*, Bignum*);
+Bignum* bignumMultiply(Bignum*, Bignum*);
+
+/****************************************************************
+ Divides the first Bignum by the second, which must not be zero,
+ truncating towards zero. The remainder, which takes the sign of
+ the dividend, is given through the last parameter when it is not
+ NULL.
+*/
+Bignum* bignumDivide(Bignum*, Bignum*, Bignum**);
+
+/****************************************************************
+ Compares two Bignums, giving a negative number, zero, or a
+ positive number when the first is respectively less than, equal
+ to, or greater than the second.
+*/
+int bignumCompare(Bignum*, Bignum*);
+
+#endif
@@ -0,0 +1,740 @@
+#include <stdlib.h>
+#include <string.h>
+#include <stdio.h>
+#include <stdarg.h>
+#include <unistd.h>
+#include <dlfcn.h>
+#include <sys/wait.h>
+#include "parser.h"
+#include "lexer.h"
+#include "number.h"
+#include "evaluation.h"
+#include "compiler.h"
+
+/****************************************************************
+ File: Compiler.c
+ ----------------
+ Implementation for compiler.h interface. A function compiles to a
+ C function taking one Cell* per formal parameter, named s<n> after
+ the position of its definition in the file, along with a wrapper
+ w<n> taking an array of arguments as the interpreter calls it.
+ Formal parameters become v<n> and quoted data, call forms and
+ other atoms become entries of the array k, read back from their
+ text when the library is loaded.
+
+ Expressions compile to C expressions. Operands are evaluated left
+ to right as the interpreter does, using statement expressions to
+ hold each in a temporary t<n> when the order of C would be free.
+ Tests of if and cond compile to C conditions, so comparisons never
+ build #t or #f, and arithmetic keeps intermediate values unboxed
+ in a Number.
+ ****************************************************************/
+
+// Directory holding native.h, given by the Makefile
+#ifndef SCHEMER_INCLUDE
+#define SCHEMER_INCLUDE "."
+#endif
+
+/****************************************************************
+ Generated text, grown as needed.
+*/
+typedef struct text Text;
+struct text {
+    char* mChars;
+    int mLength;
+    int mCapacity;
+};
+
+// Top level forms of the file being compiled, and for each the
+// index of the function compiled from it or -1
+static Cell** mForms = NULL;
+static int mFormCount = 0;
+static int* mCompiled = NULL;
+// Formal parameters of the function being compiled, and the count
+// of temporaries it used so far
+static Cell* mFormals = NULL;
+static int mTemporaries = 0;
+// Initializers of the entries of k
+static Text mConstants;
+static int mConstantCount = 0;
+
+// Prototypes for private helpers
+static void emit(Text*, char*, ...);
+static void emitEscaped(Text*, char*);
+static void writeDatum(Text*, Cell*);
+static int readForms(char*);
+static int isFunctionDefine(Cell*);
+static int isCompilable(Cell*);
+static int directCall(Cell*, int);
+static int addConstant(Cell*);
+static int formalIndex(Cell*);
+static int isTrivial(Cell*);
+static int isCondition(Cell*);
+static int countOperands(Cell*);
+static void compileValue(Text*, Cell*);
+static void compileTest(Text*, Cell*);
+static void compileNumber(Text*, Cell*);
+static void compileArithmetic(Text*, Cell*);
+static void compileCall(Text*, Cell*, char*);
+static void compileFunction(Text*, Cell*, int);
+static int isSymbol(Cell*, char*);
+static int writeOutput(char*, Text*);
+static int buildLibrary(char*, Text*);
+
+/****************************************************************
+ compileFile(): See header file for documentation.
+*/
+int compileFile(char* source, char* output)
+{
+    if (readForms(source) == 0) return 0;
+
+    mConstants.mChars = NULL;
+    mConstants.mLength = 0;
+    mConstants.mCapacity = 0;
+    mConstantCount = 0;
+    mCompiled = malloc(sizeof(int) * (mFormCount > 0 ? mFormCount : 1));
+    int functions = 0;
+    int i;
+    for (i = 0; i < mFormCount; i++) {
+        mCompiled[i] = -1;
+        if (isFunctionDefine(mForms[i]) && isCompilable(mForms[i]->mNext->mNext->mSub))
+            mCompiled[i] = functions++;
+    }
+
+    Text bodies = { NULL, 0, 0 };
+    Text prototypes = { NULL, 0, 0 };
+    for (i = 0; i < mFormCount; i++) {
+        if (mCompiled[i] == -1) continue;
+        Cell* nameParams = mForms[i]->mNext->mSub;
+        int count = countOperands(nameParams);
+        int n = mCompiled[i];
+        int j;
+        emit(&prototypes, "static Cell* s%d(", n);
+        for (j = 0; j < count; j++)
+            emit(&prototypes, "%sCell* v%d", j > 0 ? ", " : "", j);
+        emit(&prototypes, "%s);\n", count == 0 ? "void" : "");
+        compileFunction(&bodies, mForms[i], n);
+    }
+
+    Text code = { NULL, 0, 0 };
+    emit(&code, "/* Generated by schemer --compile from %s */\n", source);
+    emit(&code, "#include \"native.h\"\n\n");
+    emit(&code, "static Cell* k[%d];\n\n", mConstantCount > 0 ? mConstantCount : 1);
+    emit(&code, "%s\n", prototypes.mChars != NULL ? prototypes.mChars : "");
+    emit(&code, "%s", bodies.mChars != NULL ? bodies.mChars : "");
+    emit(&code, "void schemerLibrary(void)\n{\n");
+    emit(&code, "%s", mConstants.mChars != NULL ? mConstants.mChars : "");
+    for (i = 0; i < mFormCount; i++) {
+        Text text = { NULL, 0, 0 };
+        if (mCompiled[i] == -1) {
+            writeDatum(&text, mForms[i]);
+            emit(&code, "    nativeEvaluate(\"");
+            emitEscaped(&code, text.mChars);
+            emit(&code, "\");\n");
+        } else {
+            Cell* nameParams = mForms[i]->mNext->mSub;
+            emit(&code, "    nativeDefine(\"");
+            emitEscaped(&code, nameParams->mSub->mSymbol);
+            emit(&code, "\", f%d, %d, w%d);\n", mCompiled[i], countOperands(nameParams), mCompiled[i]);
+        }
+        free(text.mChars);
+    }
+    emit(&code, "}\n");
+
+    int built;
+    if (strlen(output) > 3 && strcmp(output + strlen(output) - 3, ".so") == 0)
+        built = buildLibrary(output, &code);
+    else built = writeOutput(output, &code);
+    free(code.mChars);
+    free(bodies.mChars);
+    free(prototypes.mChars);
+    free(mConstants.mChars);
+    free(mCompiled);
+    free(mForms);
+    if (built) printf("Compiled %d of %d forms of %s to %s.\n", functions, mFormCount, source, output);
+    return built;
+}
+
+/****************************************************************
+ loadNative(): See header file for documentation.
+*/
+int loadNative(char* path)
+{
+    // A bare file name is taken from the current directory rather
+    // than the library search path
+    char* located = path;
+    if (strchr(path, '/') == NULL) {
+        located = malloc(sizeof(char) * (strlen(path) + 3));
+        sprintf(located, "./%s", path);
+    }
+    void* library = dlopen(located, RTLD_NOW);
+    if (located != path) free(located);
+    if (library == NULL) {
+        printf("native: %s.\n", dlerror());
+        return 0;
+    }
+    void (*setup)(void) = (void (*)(void)) dlsym(library, "schemerLibrary");
+    if (setup == NULL) {
+        printf("native: %s is not a compiled library.\n", path);
+        return 0;
+    }
+    setup();
+    return 1;
+}
+
+/****************************************************************
+ Private helper reading every top level form of the given file
+ into mForms. Returns 0 when the file cannot be read.
+*/
+static int readForms(char* source)
+{
+    FILE* file = fopen(source, "r");
+    if (file == NULL) {
+        printf("compile: cannot read %s.\n", source);
+        return 0;
+    }
+    int capacity = 16;
+    mForms = malloc(sizeof(Cell*) * capacity);
+    mFormCount = 0;
+    pushTokenSource(file);
+    while (moreTokens()) {
+        if (mFormCount == capacity) {
+            capacity *= 2;
+            mForms = realloc(mForms, sizeof(Cell*) * capacity);
+        }
+        List* input = S_Expression();
+        // Macros are defined as they are read, so that functions
+        // using them are compiled from their expansion
+        if (isSymbol(input->mStructure->mSub, "define-syntax")) eval(input);
+        Cell* form = expandSyntax(input->mStructure);
+        mForms[mFormCount++] = form != NULL ? form : input->mStructure;
+    }
+    popTokenSource();
+    fclose(file);
+    return 1;
+}
+
+/****************************************************************
+ Private helper checking that a form is (define (name formal ...)
+ body) with only symbols for the name and formal parameters.
+*/
+static int isFunctionDefine(Cell* form)
+{
+    if (!isSymbol(form->mSub, "define") || form->mNext == NULL
+        || form->mNext->mNext == NULL || form->mNext->mNext->mNext != NULL) return 0;
+    Cell* nameParams = form->mNext->mSub;
+    if (nameParams->mSub == NULL) return 0;
+    Cell* focus;
+    for (focus = nameParams; focus != NULL; focus = focus->mNext)
+        if (focus->mSub == NULL || focus->mSub->mSub != NULL || focus->mSub->mSymbol == NULL)
+            return 0;
+    return 1;
+}
+
+/****************************************************************
+ Private helper checking that every form in the given expression
+ is one the compiler can translate with the same meaning. Forms
+ that define, or take operands the interpreter does not evaluate
+ other than those handled here, are left to the interpreter.
+*/
+static int isCompilable(Cell* expression)
+{
+    if (expression == NULL) return 0;
+    if (expression->mSub == NULL) return expression->mSymbol != NULL;
+    Cell* head = expression->mSub;
+    if (head->mSymbol == NULL) return 0;
+    if (isSymbol(head, "quote")) return expression->mNext != NULL;
+    if (isSymbol(head, "define") || isSymbol(head, "define-memo") || isSymbol(head, "lambda")
+        || isSymbol(head, "let") || isSymbol(head, "let*") || isSymbol(head, "letrec")
+        || isSymbol(head, "delay") || isSymbol(head, "cons-stream")) return 0;
+    if (isSymbol(head, "if") && countOperands(expression) != 3) return 0;
+    if (isSymbol(head, "-") && countOperands(expression) == 0) return 0;
+    if (isSymbol(head, "assoc")) {
+        Cell* key = expression->mNext != NULL ? expression->mNext->mSub : NULL;
+        if (countOperands(expression) != 2 || key->mSub == NULL || !isSymbol(key->mSub, "quote")
+            || key->mNext == NULL) return 0;
+        return isCompilable(expression->mNext->mNext->mSub);
+    }
+
+    Cell* operand;
+    for (operand = expression->mNext; operand != NULL; operand = operand->mNext) {
+        Cell* part = operand->mSub;
+        if (isSymbol(head, "cond")) {
+            // Each clause is a test and an expression
+            if (part == NULL || part->mSub == NULL || part->mNext == NULL) return 0;
+            if (!isSymbol(part->mSub, "else") && !isSymbol(part->mSub, "#t")
+                && !isCompilable(part->mSub)) return 0;
+            part = part->mNext->mSub;
+        }
+        if (!isCompilable(part)) return 0;
+    }
+    return 1;
+}
+
+/****************************************************************
+ Private helper giving the index of the compiled function that a
+ call of the given name with the given number of operands can call
+ directly, or -1. The name must be defined only once in the file
+ and not be a builtin, which a user defined function cannot shadow.
+*/
+static int directCall(Cell* name, int count)
+{
+    if (isBuiltin(name->mSymbol)) return -1;
+    int found = -1;
+    int i;
+    for (i = 0; i < mFormCount; i++) {
+        Cell* form = mForms[i];
+        if (!isSymbol(form->mSub, "define") && !isSymbol(form->mSub, "define-memo")) continue;
+        if (form->mNext == NULL || form->mNext->mSub->mSub == NULL) continue;
+        Cell* defined = form->mNext->mSub->mSub;
+        if (defined->mSymbol == NULL || strcmp(defined->mSymbol, name->mSymbol) != 0) continue;
+        if (found != -1 || mCompiled[i] == -1) return -1;
+        found = i;
+    }
+    if (found == -1 || countOperands(mForms[found]->mNext->mSub) != count) return -1;
+    return mCompiled[found];
+}
+
+/****************************************************************
+ Private helper compiling one function and its wrapper.
+*/
+static void compileFunction(Text* out, Cell* form, int n)
+{
+    Cell* nameParams = form->mNext->mSub;
+    int count = countOperands(nameParams);
+    mFormals = nameParams->mNext;
+    mTemporaries = 0;
+
+    int j;
+    emit(out, "static char* f%d[] = { ", n);
+    Cell* formal;
+    for (formal = mFormals; formal != NULL; formal = formal->mNext) {
+        emit(out, "\"");
+        emitEscaped(out, formal->mSub->mSymbol);
+        emit(out, "\", ");
+    }
+    emit(out, "NULL };\n\n");
+
+    emit(out, "/* ");
+    emitEscaped(out, nameParams->mSub->mSymbol);
+    emit(out, " */\nstatic Cell* s%d(", n);
+    for (j = 0; j < count; j++)
+        emit(out, "%sCell* v%d", j > 0 ? ", " : "", j);
+    emit(out, "%s)\n{\n    return ", count == 0 ? "void" : "");
+    compileValue(out, form->mNext->mNext->mSub);
+    emit(out, ";\n}\n\n");
+
+    emit(out, "static Cell* w%d(Cell** a)\n{\n    return s%d(", n, n);
+    for (j = 0; j < count; j++)
+        emit(out, "%sa[%d]", j > 0 ? ", " : "", j);
+    emit(out, ");\n}\n\n");
+    mFormals = NULL;
+}
+
+/****************************************************************
+ Private helper compiling an expression into a C expression giving
+ its value as a Cell*.
+*/
+static void compileValue(Text* out, Cell* expression)
+{
+    if (expression->mSub == NULL) {
+        int formal = formalIndex(expression);
+        // Any other atom evaluates to itself in a function body
+        if (formal != -1) emit(out, "v%d", formal);
+        else emit(out, "k[%d]", addConstant(expression));
+        return;
+    }
+
+    Cell* head = expression->mSub;
+    int count = countOperands(expression);
+    if (isSymbol(head, "quote")) {
+        emit(out, "k[%d]", addConstant(expression->mNext->mSub));
+    } else if (isSymbol(head, "if")) {
+        emit(out, "(");
+        compileTest(out, expression->mNext->mSub);
+        emit(out, " ? ");
+        compileValue(out, expression->mNext->mNext->mSub);
+        emit(out, " : ");
+        compileValue(out, expression->mNext->mNext->mNext->mSub);
+        emit(out, ")");
+    } else if (isSymbol(head, "cond")) {
+        Cell* clause;
+        int open = 0;
+        for (clause = expression->mNext; clause != NULL; clause = clause->mNext) {
+            Cell* test = clause->mSub->mSub;
+            if (isSymbol(test, "else") || isSymbol(test, "#t")) break;
+            emit(out, "(");
+            compileTest(out, test);
+            emit(out, " ? ");
+            compileValue(out, clause->mSub->mNext->mSub);
+            emit(out, " : ");
+            open++;
+        }
+        if (clause != NULL) compileValue(out, clause->mSub->mNext->mSub);
+        else emit(out, "FALSE");
+        for (; open > 0; open--)
+            emit(out, ")");
+    } else if (isCondition(expression)) {
+        emit(out, "(");
+        compileTest(out, expression);
+        emit(out, " ? TRUE : FALSE)");
+    } else if ((isSymbol(head, "+") || isSymbol(head, "-") || isSymbol(head, "*"))) {
+        emit(out, "nativeBox(");
+        compileArithmetic(out, expression);
+        emit(out, ")");
+    } else if ((isSymbol(head, "car") || isSymbol(head, "cdr")) && count == 1) {
+        emit(out, "%s(", isSymbol(head, "car") ? "nativeCar" : "nativeCdr");
+        compileValue(out, expression->mNext->mSub);
+        emit(out, ")");
+    } else if (isSymbol(head, "cons") && count == 2) {
+        compileCall(out, expression, "nativeCons");
+    } else {
+        int direct = directCall(head, count);
+        char callee[24];
+        if (direct != -1) sprintf(callee, "s%d", direct);
+        else callee[0] = '\0';
+        compileCall(out, expression, callee);
+    }
+}
+
+/****************************************************************
+ Private helper compiling a call whose operands are all evaluated,
+ left to right. A C function is called with one argument for each
+ operand, and without one the call goes through nativeCall(...).
+*/
+static void compileCall(Text* out, Cell* expression, char* function)
+{
+    int count = countOperands(expression);
+    Cell* operand;
+    int i;
+    if (function[0] == '\0') {
+        if (count == 0) {
+            emit(out, "nativeCall(k[%d], NULL, 0)", addConstant(expression));
+            return;
+        }
+        int t = mTemporaries++;
+        emit(out, "({ Cell* t%d[%d]; ", t, count);
+        for (i = 0, operand = expression->mNext; operand != NULL; i++, operand = operand->mNext) {
+            emit(out, "t%d[%d] = ", t, i);
+            compileValue(out, operand->mSub);
+            emit(out, "; ");
+        }
+        emit(out, "nativeCall(k[%d], t%d, %d); })", addConstant(expression), t, count);
+        return;
+    }
+
+    // Hold operands in temporaries only when more than one of them
+    // can have effects
+    int calls = 0;
+    for (operand = expression->mNext; operand != NULL; operand = operand->mNext)
+        if (!isTrivial(operand->mSub)) calls++;
+    if (calls < 2) {
+        emit(out, "%s(", function);
+        for (operand = expression->mNext; operand != NULL; operand = operand->mNext) {
+            compileValue(out, operand->mSub);
+            if (operand->mNext != NULL) emit(out, ", ");
+        }
+        emit(out, ")");
+        return;
+    }
+    int t = mTemporaries++;
+    emit(out, "({ ");
+    for (i = 0, operand = expression->mNext; operand != NULL; i++, operand = operand->mNext) {
+        emit(out, "Cell* t%d_%d = ", t, i);
+        compileValue(out, operand->mSub);
+        emit(out, "; ");
+    }
+    emit(out, "%s(", function);
+    for (i = 0; i < count; i++)
+        emit(out, "%st%d_%d", i > 0 ? ", " : "", t, i);
+    emit(out, "); })");
+}
+
+/****************************************************************
+ Private helper compiling an expression into a C condition that
+ holds exactly when the interpreter would find the value TRUE.
+*/
+static void compileTest(Text* out, Cell* expression)
+{
+    if (!isCondition(expression)) {
+        emit(out, "(");
+        compileValue(out, expression);
+        emit(out, " == TRUE)");
+        return;
+    }
+
+    Cell* head = expression->mSub;
+    Cell* operand;
+    if (isSymbol(head, "and") || isSymbol(head, "AND")
+        || isSymbol(head, "or") || isSymbol(head, "OR")) {
+        // and stops at the first FALSE, or at the first TRUE
+        int isAnd = isSymbol(head, "and") || isSymbol(head, "AND");
+        if (expression->mNext == NULL) {
+            emit(out, isAnd ? "1" : "0");
+            return;
+        }
+        emit(out, "(");
+        for (operand = expression->mNext; operand != NULL; operand = operand->mNext) {
+            if (isCondition(operand->mSub)) compileTest(out, operand->mSub);
+            else {
+                emit(out, "(");
+                compileValue(out, operand->mSub);
+                emit(out, isAnd ? " != FALSE)" : " == TRUE)");
+            }
+            if (operand->mNext != NULL) emit(out, isAnd ? " && " : " || ");
+        }
+        emit(out, ")");
+    } else if (isSymbol(head, "not") || isSymbol(head, "NOT")) {
+        emit(out, "!");
+        compileTest(out, expression->mNext->mSub);
+    } else if (isSymbol(head, "null?")) {
+        emit(out, "nativeNull(");
+        compileValue(out, expression->mNext->mSub);
+        emit(out, ")");
+    } else if (isSymbol(head, "equal?")) {
+        compileCall(out, expression, "nativeEqual");
+    } else {
+        char* comparison = isSymbol(head, "<") ? "<" : isSymbol(head, ">") ? ">"
+                           : isSymbol(head, "<=") ? "<=" : ">=";
+        Cell* second = expression->mNext->mNext->mSub;
+        if (isTrivial(second)) {
+            emit(out, "(compareNumbers(");
+            compileNumber(out, expression->mNext->mSub);
+            emit(out, ", ");
+            compileNumber(out, second);
+            emit(out, ") %s 0)", comparison);
+        } else {
+            int t = mTemporaries++;
+            emit(out, "({ Number t%d = ", t);
+            compileNumber(out, expression->mNext->mSub);
+            emit(out, "; compareNumbers(t%d, ", t);
+            compileNumber(out, second);
+            emit(out, ") %s 0; })", comparison);
+        }
+    }
+}
+
+/****************************************************************
+ Private helper compiling an operand of arithmetic into a C
+ expression giving its Number.
+*/
+static void compileNumber(Text* out, Cell* expression)
+{
+    if (expression->mSub == NULL && formalIndex(expression) == -1
+        && tagNumber(expression) && expression->mType == CELL_FIXNUM
+        && expression->mFixnum > -__LONG_MAX__ - 1) {
+        emit(out, "fixnumNumber(%ldL)", expression->mFixnum);
+    } else if (expression->mSub != NULL && (isSymbol(expression->mSub, "+")
+               || isSymbol(expression->mSub, "-") || isSymbol(expression->mSub, "*"))) {
+        compileArithmetic(out, expression);
+    } else {
+        emit(out, "nativeOperand(");
+        compileValue(out, expression);
+        emit(out, ")");
+    }
+}
+
+/****************************************************************
+ Private helper compiling +, - or * into a statement expression
+ that accumulates the operands from left to right into a Number,
+ starting from 0 for +, 1 for * and the first operand for -.
+*/
+static void compileArithmetic(Text* out, Cell* expression)
+{
+    Cell* head = expression->mSub;
+    char* function = isSymbol(head, "+") ? "addNumbers"
+                     : isSymbol(head, "-") ? "subtractNumbers" : "multiplyNumbers";
+    Cell* operand = expression->mNext;
+    int t = mTemporaries++;
+    emit(out, "({ Number t%d = ", t);
+    if (isSymbol(head, "-")) {
+        compileNumber(out, operand->mSub);
+        operand = operand->mNext;
+    } else emit(out, "fixnumNumber(%d)", isSymbol(head, "*") ? 1 : 0);
+    emit(out, "; ");
+    for (; operand != NULL; operand = operand->mNext) {
+        emit(out, "t%d = %s(t%d, ", t, function, t);
+        compileNumber(out, operand->mSub);
+        emit(out, "); ");
+    }
+    emit(out, "t%d; })", t);
+}
+
+/****************************************************************
+ Private helper checking whether an expression is one whose value
+ is always TRUE or FALSE, so that it compiles to a C condition.
+*/
+static int isCondition(Cell* expression)
+{
+    if (expression->mSub == NULL) return 0;
+    Cell* head = expression->mSub;
+    int count = countOperands(expression);
+    if (isSymbol(head, "and") || isSymbol(head, "AND") || isSymbol(head, "or")
+        || isSymbol(head, "OR")) return 1;
+    if ((isSymbol(head, "not") || isSymbol(head, "NOT") || isSymbol(head, "null?")) && count == 1)
+        return 1;
+    return (isSymbol(head, "equal?") || isSymbol(head, "<") || isSymbol(head, ">")
+            || isSymbol(head, "<=") || isSymbol(head, ">=")) && count == 2;
+}
+
+/****************************************************************
+ Private helper checking whether an expression has no effects and
+ may be evaluated in any order: an atom or quoted data.
+*/
+static int isTrivial(Cell* expression)
+{
+    return expression->mSub == NULL || isSymbol(expression->mSub, "quote");
+}
+
+/****************************************************************
+ Private helper giving the position of the formal parameter named
+ by the given atom in the function being compiled, or -1. A name
+ given twice refers to the last, as its binding hides the first.
+*/
+static int formalIndex(Cell* atom)
+{
+    int found = -1;
+    int i = 0;
+    Cell* formal;
+    if (atom->mSymbol == NULL) return -1;
+    for (formal = mFormals; formal != NULL; formal = formal->mNext, i++)
+        if (strcmp(formal->mSub->mSymbol, atom->mSymbol) == 0) found = i;
+    return found;
+}
+
+/****************************************************************
+ Private helper adding the given datum to the entries of k, to be
+ read back from its text when the library is loaded, and giving
+ its index.
+*/
+static int addConstant(Cell* datum)
+{
+    Text text = { NULL, 0, 0 };
+    writeDatum(&text, datum);
+    emit(&mConstants, "    k[%d] = nativeDatum(\"", mConstantCount);
+    emitEscaped(&mConstants, text.mChars);
+    emit(&mConstants, "\");\n");
+    free(text.mChars);
+    return mConstantCount++;
+}
+
+/****************************************************************
+ Private helper writing a parsed datum back as text the parser
+ reads into the same structure.
+*/
+static void writeDatum(Text* out, Cell* cell)
+{
+    if (cell->mSub == NULL) {
+        emit(out, "%s", cell->mSymbol != NULL ? cell->mSymbol : "()");
+        return;
+    }
+    emit(out, "(");
+    Cell* focus;
+    for (focus = cell; focus != NULL; focus = focus->mNext) {
+        if (focus != cell) emit(out, " ");
+        if (focus->mSub != NULL) writeDatum(out, focus->mSub);
+        else emit(out, "()");
+    }
+    emit(out, ")");
+}
+
+/****************************************************************
+ Private helper counting the operands of a call, or the formal
+ parameters after the name of a function.
+*/
+static int countOperands(Cell* expression)
+{
+    int count = 0;
+    Cell* operand;
+    for (operand = expression->mNext; operand != NULL; operand = operand->mNext)
+        count++;
+    return count;
+}
+
+/****************************************************************
+ Private helper checking whether a Cell is the atom of the given
+ name.
+*/
+static int isSymbol(Cell* cell, char* name)
+{
+    return cell != NULL && cell->mSub == NULL && cell->mSymbol != NULL
+           && strcmp(cell->mSymbol, name) == 0;
+}
+
+/****************************************************************
+ Private helper appending formatted text.
+*/
+static void emit(Text* out, char* format, ...)
+{
+    va_list arguments;
+    va_start(arguments, format);
+    int length = vsnprintf(NULL, 0, format, arguments);
+    va_end(arguments);
+
+    if (out->mLength + length + 1 > out->mCapacity) {
+        out->mCapacity = (out->mLength + length + 1) * 2;
+        out->mChars = realloc(out->mChars, out->mCapacity);
+    }
+    va_start(arguments, format);
+    vsnprintf(out->mChars + out->mLength, length + 1, format, arguments);
+    va_end(arguments);
+    out->mLength += length;
+}
+
+/****************************************************************
+ Private helper appending text as the inside of a C string.
+*/
+static void emitEscaped(Text* out, char* text)
+{
+    for (; *text != '\0'; text++) {
+        if (*text == '"' || *text == '\\') emit(out, "\\%c", *text);
+        else if (*text < ' ' || *text > '~') emit(out, "\\%03o", (unsigned char) *text);
+        else emit(out, "%c", *text);
+    }
+}
+
+/****************************************************************
+ Private helper writing generated code to the given path.
+*/
+static int writeOutput(char* path, Text* code)
+{
+    FILE* file = fopen(path, "w");
+    if (file == NULL) {
+        printf("compile: cannot write %s.\n", path);
+        return 0;
+    }
+    fputs(code->mChars, file);
+    fclose(file);
+    return 1;
+}
+
+/****************************************************************
+ Private helper building generated code into a shared library at
+ the given path with gcc, through a temporary file.
+*/
+static int buildLibrary(char* path, Text* code)
+{
+    char source[] = "/tmp/schemerXXXXXX.c";
+    int descriptor = mkstemps(source, 2);
+    if (descriptor == -1) {
+        printf("compile: cannot create a temporary file.\n");
+        return 0;
+    }
+    close(descriptor);
+    if (writeOutput(source, code) == 0) return 0;
+
+    int status = -1;
+    pid_t child = fork();
+    if (child == 0) {
+        execlp("gcc", "gcc", "-shared", "-fPIC", "-O2", "-I", SCHEMER_INCLUDE,
+               "-o", path, source, (char*) NULL);
+        _exit(127);
+    }
+    if (child > 0) waitpid(child, &status, 0);
+    unlink(source);
+    if (status != 0) {
+        printf("compile: gcc could not build %s.\n", path);
+        return 0;
+    }
+    return 1;
+}
@@ -0,0 +1,42 @@
+#ifndef COMPILER_H_INCLUDED
+#define COMPILER_H_INCLUDED
+
+/****************************************************************
+ File: Compiler.h
+ ----------------
+ Interface for Compiler, which translates the functions defined in
+ a file of Scheme code into C against the runtime of native.h, and
+ loads the shared libraries built from that C.
+
+ Each top level (define (name formal ...) body) whose body only
+ uses forms the compiler knows becomes a C function. Arithmetic on
+ numbers, comparisons, if, cond, and, or and not are done in C,
+ calls between the functions compiled together are direct C calls,
+ and every other call goes through the interpreter's own builtins
+ and function table, so compiled code gives the same results as
+ interpreted code. Any other top level form, including functions
+ the compiler cannot translate, is kept as text and evaluated when
+ the library is loaded, in the order written.
+
+ Calls from one compiled function to another of the same file stay
+ direct even if the callee is redefined or memoized afterwards.
+ Calls from interpreted code always reach the current definition.
+ ****************************************************************/
+
+/****************************************************************
+ Compiles the Scheme file at the first path into C written to the
+ second. When the second path ends in ".so", the C is built into a
+ shared library at that path with gcc instead. Returns 1 on success
+ and 0 after printing what went wrong. The lexer must have been
+ started with startTokens(int).
+*/
+int compileFile(char*, char*);
+
+/****************************************************************
+ Loads a shared library built by compileFile(char*, char*),
+ defining its functions and evaluating its other forms. Returns 1
+ on success and 0 after printing what went wrong.
+*/
+int loadNative(char*);
+
+#endif
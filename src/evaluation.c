@@ -1,8 +1,21 @@
 #include <stdlib.h>
 #include <string.h>
 #include <stdio.h>
+#include <setjmp.h>
+#include <time.h>
+#include <limits.h>
 #include "parser.h"
 #include "lexer.h"
+#include "hashtable.h"
+#include "numeric.h"
+#include "number.h"
+#include "memo.h"
+#include "native.h"
+#include "profiler.h"
+#include "allocator.h"
+#include "image.h"
+#include "astcache.h"
+#include "reader.h"
 
 
 /****************************************************************
@@ -16,7 +29,12 @@
  not matching in an association list. In that case, #f is
  explicitly returned as per the assignment page example.
 
- Besides integer operations +, -, and *, here is a list of
+ Integers are exact and of any size (see number.h), small ones
+ staying in a long and larger ones becoming bignums. Flonums such
+ as 2.5 or 1e-3 are inexact, and mixing them with integers gives
+ a flonum.
+
+ Besides arithmetic operations +, -, *, and /, here is a list of
  currently supported functions:
     list
     length
@@ -44,6 +62,60 @@
     append
     assoc
     define
+    lambda
+    let + named let
+    let*
+    letrec
+    make-vector
+    vector
+    vector-ref
+    vector-set!
+    vector-length
+    list->vector
+    vector->list
+    make-hash-table
+    hash-ref
+    hash-set!
+    hash-remove!
+    hash-count
+    hash-keys
+    map
+    filter
+    fold
+    for-each
+    apply
+    sort
+    delay
+    force
+    cons-stream
+    stream-car
+    stream-cdr
+    stream-map
+    stream-filter
+    stream-take
+    stream->list
+    min
+    max
+    vector-sum
+    vector-product
+    vector-min
+    vector-max
+    vector-dot
+    vector-map+
+    vector-scale
+    define-memo
+    memoize
+    memo-stats
+    result-cache-stats
+    memory-stats
+    heap-snapshot
+    profile-start
+    profile-stop
+    profile-report
+    save-image
+    load
+    load-data
+    define-syntax
 
 
  Author: Christian Ramos
@@ -52,25 +124,278 @@
 
 // Association list for variables
 static List* mAssocVars = NULL;
-static List* mAssocFns = NULL;
+// Definitions of user defined functions by name
+static HashTable* mFunctions = NULL;
+// Bumped whenever a new function name is defined, see CallCache
+static long mFunctionsVersion = 0;
+
+// Most results a memoized function keeps unless told otherwise
+#define MEMO_LIMIT 4096
+
+// Level of the optimization pass, see setOptimizationLevel(int)
+static int mOptimizationLevel = 0;
+// Set while the pass folds a constant call, silencing its errors
+static int mFolding = 0;
+static int mFoldFailed = 0;
+
+// Largest body, in cells, that level 2 inlines at a call site
+#define INLINE_LIMIT 32
+// Function whose body is being optimized, so that calls it makes
+// can be inlined, along with the functions it inlined so far
+static Cell* mInlining = NULL;
+static Cell* mInlinedNow = NULL;
+// Bodies of functions as written, kept to optimize them again
+static HashTable* mSources = NULL;
+// Chains of the functions each function inlined, directly or not
+static HashTable* mInlined = NULL;
+
+// Names handled by recurse_eval(Cell*) itself, which a user defined
+// function cannot shadow. Keep in step with recurse_eval(Cell*).
+static char* mBuiltins[] = {
+    "quote", "cons", "list", "last", "length", "+", "-", "*", "/", "AND", "and", "OR", "or",
+    "NOT", "not", "<", ">", "<=", ">=", "car", "cdr", "cadr", "caddr", "cadddr", "caddddr",
+    "cdar", "symbol?", "append", "null?", "equal?", "define-memo", "memoize", "memo-stats",
+    "result-cache-stats", "memory-stats", "heap-snapshot", "profile-start", "profile-stop",
+    "profile-report", "save-image", "load", "load-data", "define-syntax", "define", "lambda",
+    "let", "let*", "letrec", "assoc", "cond", "if", "number?", "list?", "make-vector", "vector",
+    "vector-ref", "vector-set!", "vector-length", "list->vector", "vector->list",
+    "make-hash-table", "hash-ref", "hash-set!", "hash-remove!", "hash-count", "hash-keys",
+    "map", "filter", "fold", "for-each", "apply", "sort", "delay", "force", "cons-stream",
+    "stream-car", "stream-cdr", "stream-map", "stream-filter", "stream-take", "stream->list",
+    "min", "max", "vector-sum", "vector-product", "vector-min", "vector-max", "vector-dot",
+    "vector-map+", "vector-scale", NULL
+};
+
+// Builtins that take their operands unevaluated, which cannot be
+// applied to values by map, sort, apply and the like
+static char* mSpecialForms[] = {
+    "quote", "define", "define-memo", "define-syntax", "lambda", "let", "let*", "letrec",
+    "cond", "if", "delay", "cons-stream", NULL
+};
+
+// Set while calls are profiled, see setProfiling(int)
+static int mProfiling = 0;
+// Call being timed by profiledCall(Cell*, List*), which evaluates it
+// through recurse_eval(Cell*) once more
+static Cell* mProfiledCall = NULL;
+
+// Limits of every evaluation, see setBudget(int, long), and whether
+// any is set
+static long mBudgets[BUDGET_COUNT];
+static int mBudgeted = 0;
+// Set while the outermost eval(List*) runs with a budget, along with
+// the resources it used so far
+static int mMetering = 0;
+static long mSteps = 0;
+static long mDepth = 0;
+static long mFirstByte = 0;
+static long mStarted = 0;
+// Evaluation counted by budgetedEval(Cell*, List*), which evaluates
+// it through recurse_eval(Cell*) once more
+static Cell* mBudgetedCall = NULL;
+// Where eval(List*) resumes once a budget runs out, and which one
+static jmp_buf mAbort;
+static int mExceeded = 0;
+
+// Macros by name, each kept as the form that defined it, see
+// defineSyntax(Cell*)
+static HashTable* mMacros = NULL;
+// Most expansions nested within one another before giving up
+#define EXPANSION_LIMIT 1000
+// Expansions made of the input under way, which number the
+// variables they bind, and how deeply they nest
+static int mExpansions = 0;
+static int mExpanding = 0;
+// Literals of the macro being expanded
+static Cell* mLiterals = NULL;
+
+// Cache of top level results by input, see setResultCaching(int)
+static HashTable* mResults = NULL;
+// Chains of the cached inputs that read each global symbol
+static HashTable* mReaders = NULL;
+// Global variables bound to a value holding a vector or hash table
+static HashTable* mVolatile = NULL;
+// Global symbols read by the input being evaluated for the cache
+static Cell* mReads = NULL;
+static int mRecording = 0;
+// Cleared when the input being evaluated must not be cached
+static int mCacheable = 0;
+// Result cache counters, along with its cells still allocated
+static long mCacheHits = 0;
+static long mCacheMisses = 0;
+static long mCacheInvalidations = 0;
+static long mCacheCells = 0;
+
+/****************************************************************
+ A procedure value resolved once so that it can be applied to
+ many sets of already evaluated arguments. A user defined
+ function keeps its definition, along with its cache of results
+ when memoized, a closure keeps itself and the number of
+ arguments, and any other procedure keeps a call form whose
+ parameters are quoted slots refilled on every application. The
+ first two keep a name for the profile (see setProfiling(int)).
+*/
+typedef struct procedure Procedure;
+struct procedure {
+    Cell* mForm;
+    Cell** mSlots;
+    Cell* mFormals;
+    Cell* mBody;
+    MemoTable* mMemo;
+    Cell* mClosure;
+    int mCount;
+    char* mName;
+};
+
+/****************************************************************
+ Inline cache kept in the mData member of the cell of a call site,
+ the one whose mSub is the name called. It holds the definition the
+ name resolved to, or NULL when it named no function, as of the
+ given version of the function table. Redefinitions update the
+ definition in place, so only a new name makes the cache stale.
+*/
+typedef struct callCache CallCache;
+struct callCache {
+    Cell* mDefinition;
+    long mVersion;
+};
+
+/****************************************************************
+ What a pattern variable of a syntax rule matched in a use of the
+ macro. A subpattern followed by "..." matches any number of
+ forms and is kept as a single Binding of no variable, holding the
+ subpattern and the bindings of each repetition in turn.
+*/
+typedef struct binding Binding;
+struct binding {
+    Cell* mVariable;
+    Cell* mValue;
+    Cell* mPattern;
+    Binding** mRepeats;
+    int mCount;
+    Binding* mNextBinding;
+};
 
 // Constants for TRUE / FALSE
 Cell* TRUE = NULL;
 Cell* FALSE = NULL;
 
+// Shared "#f" symbol returned when a lookup finds no match
+static Cell* mNoMatch = NULL;
+
 // Prototypes for helpers to the main scheme functions
 static List* wrapStructure(Cell*);
+static List* wrapStructureAt(Cell*, int);
 static Cell* iniCell();
+static Cell* iniCellAt(int);
+static Cell* iniLinkCell();
 static List* iniAssocList();
 static int isEmptyStructure(Cell*);
 static List* bindLocals(List*, List*, List*, List*);
 static List* defineFunction(List*, List*);
 static List* assocForVar(Cell*, List*);
 static List* assocForFn(Cell*);
+static Cell* lookupFunction(Cell*);
 static List* recurse_eval(Cell*, List*);
 static Cell* compareEqual(Cell*, Cell*);
 static Cell* findAssoc(Cell*, Cell*);
+static int bindsSymbol(Cell*, Cell*);
 static Cell* appendSubstitute(Cell*, List*);
+static Cell* firstMember(Cell*);
+static Cell* buildList(Cell**, int);
+static Cell* iniVector(int);
+static List* wrapNumber(long);
+static List* wrapValue(Number);
+static Number operandOf(List*);
+static int fixnumOperand(List*, long*);
+static Number* listNumbers(Cell**, int);
+static Cell** listMembers(Cell*, int*);
+static long* packFixnums(Cell**, int);
+static double* packFlonums(Cell**, int);
+static int countFlonums(Cell**, int);
+static void sortMembers(Cell**, Cell**, int, Procedure*, int);
+static void mergeMembers(Cell**, int, Cell**, int, Cell**, Procedure*, int);
+static int sortsBefore(Cell*, Cell*, Procedure*, int);
+static List* reportError(char*, char*);
+static int equalCells(Cell*, Cell*);
+static int prepareProcedure(Cell*, int, Procedure*);
+static int countFormals(Cell*);
+static void prepareForm(Cell*, int, Procedure*);
+static List* applyProcedure(Procedure*, Cell**);
+static List* applyDefinition(Cell*, Cell*, MemoTable*, Cell**);
+static Cell* makeClosure(Cell*, Cell*, Cell*, List*, Cell*);
+static List* applyClosure(Cell*, Cell**, int);
+static List* callClosure(Cell*, Cell*, List*);
+static Cell* freeVariables(Cell*, Cell*, Cell*);
+static void collectFree(Cell*, Cell*, Cell**);
+static int isFormal(Cell*, Cell*);
+static Cell* lookupVariable(Cell*, List*);
+static List* variableOf(Cell*, List*);
+static List* slotVariable(Cell*, int);
+static List* globalVariable(Cell*);
+static Cell* slotName(Cell*, List*);
+static int slotIndex(Closure*, Cell*);
+static Cell* localValue(Cell*, List*);
+static Cell* closureCode(Closure*);
+static Cell* convertExpression(Cell*, Closure*, Cell*);
+static Cell* makeFrame(Cell*, Cell**, int);
+static List* evalBody(Cell*, List*);
+static Cell* makePromise(Cell*, List*);
+static Cell* forceValue(Cell*);
+static Cell* delayedCall(char*, Cell*, Cell*);
+static Cell* memoizedDefinition(char*, Cell*);
+static int checkImageRoots(Cell**, int);
+static List* statsList(char**, Cell**, int);
+static List* cachedEval(Cell*);
+static List* profiledCall(Cell*, List*);
+static List* evalInput(Cell*);
+static List* budgetedEval(Cell*, List*);
+static void exceedBudget(int);
+static List* abandonEval();
+static long milliseconds();
+static long retainedBy(Cell*, AddressSet*, long*);
+static void noteRead(Cell*);
+static void invalidateReaders(Cell*);
+static void noteVolatile(Cell*, Cell*);
+static int holdsNative(Cell*);
+static int holdsNativeFrom(Cell*, AddressSet**);
+static Cell* optimize(Cell*);
+static Cell* optimizeOperands(Cell*, int);
+static Cell* optimizeIf(Cell*);
+static Cell* optimizeCond(Cell*);
+static Cell* simplifyAccessors(Cell*);
+static Cell* foldConstant(Cell*);
+static int foldableArity(char*);
+static int isConstant(Cell*);
+static Cell* constantValue(Cell*);
+static Cell* constantExpression(Cell*);
+static Cell* quoteValue(Cell*);
+static int isCallTo(Cell*, char*, int);
+static Cell* optimizeBody(Cell*, Cell*);
+static void refreshInliners(Cell*);
+static Cell* inlineCall(Cell*);
+static int isInlinable(Cell*, Cell*, Cell*, int*);
+static int countUses(Cell*, Cell*);
+static int isSimpleOperand(Cell*, int);
+static Cell* substitute(Cell*, Cell*, Cell**);
+static Cell* formalValue(Cell*, Cell*, Cell**);
+static void addInlined(Cell*);
+static Cell* expandMacros(Cell*);
+static Cell* expandItems(Cell*, int, int);
+static Cell* expandBindings(Cell*);
+static Cell* expandUse(Cell*, Cell*);
+static int matchItems(Cell*, Cell*, Binding**);
+static int matchDatum(Cell*, Cell*, Binding**);
+static int isPatternVariable(Cell*);
+static int isEllipsis(Cell*);
+static int mentionsVariable(Cell*, Cell*);
+static Binding* findBinding(Cell*, Binding*);
+static Cell* instantiate(Cell*, Binding*, Binding*);
+static int repeatTemplate(Cell*, Binding*, Binding*, Cell**);
+static int repeatsGroup(Cell*, Binding*, Binding*);
+static Binding* renameBinders(Cell*, Cell*, Binding*);
+static Binding* renameBinder(Cell*, Cell*, Binding*);
+static void freeBindings(Binding*);
 // Prototypes for the main scheme functions the user can use
 static List* quote(List*);
 static List* makeList(Cell*, List*);
@@ -79,6 +404,7 @@ static List* length(List*);
 static List* add(Cell*, List*);
 static List* subtract(Cell*, List*);
 static List* multiply(Cell*, List*);
+static List* divide(Cell*, List*);
 static List* logicAnd(Cell*, List*);
 static List* logicOr(Cell*, List*);
 static List* logicNot(List*);
@@ -102,8 +428,59 @@ static List* append(List*, List*);
 static List* cond(Cell*, List*);
 static List* alternateIf(Cell*, List*);
 static List* define(List*, List*, List*);
+static List* lambda(Cell*, List*);
+static List* let(Cell*, List*);
+static List* namedLet(Cell*, List*);
+static List* letStar(Cell*, List*);
+static List* letrec(Cell*, List*);
 static List* isList(List*);
 static List* isNumber(List*);
+static List* makeVector(Cell*, List*);
+static List* vector(Cell*, List*);
+static List* vectorRef(List*, List*);
+static List* vectorSet(List*, List*, List*);
+static List* vectorLength(List*);
+static List* listToVector(List*);
+static List* vectorToList(List*);
+static List* makeHashTable();
+static List* hashRef(Cell*, List*);
+static List* hashSet(List*, List*, List*);
+static List* hashRemoveKey(List*, List*);
+static List* hashCount(List*);
+static List* hashKeys(List*);
+static List* map(Cell*, List*);
+static List* filter(Cell*, List*);
+static List* fold(Cell*, List*);
+static List* forEach(Cell*, List*);
+static List* apply(Cell*, List*);
+static List* sort(Cell*, List*);
+static List* delay(Cell*, List*);
+static List* force(List*);
+static List* consStream(Cell*, List*);
+static List* streamCar(List*);
+static List* streamCdr(List*);
+static List* streamMap(Cell*, List*);
+static List* streamFilter(Cell*, List*);
+static List* streamTake(List*, List*);
+static List* streamToList(List*);
+static List* minimum(Cell*, List*);
+static List* maximum(Cell*, List*);
+static List* vectorReduce(char*, List*);
+static List* vectorDot(List*, List*);
+static List* vectorAdd(List*, List*);
+static List* vectorScale(List*, List*);
+static List* defineMemo(Cell*, List*);
+static List* memoize(Cell*, List*);
+static List* memoStats(List*);
+static List* resultCacheStats();
+static List* profileReportOf(Cell*);
+static List* memoryStats();
+static List* heapSnapshot();
+static List* saveImage(Cell*, List*);
+static char* fileName(char*, Cell*, List*);
+static List* load(Cell*, List*);
+static List* loadData(Cell*, List*);
+static List* defineSyntax(Cell*);
 
 /****************************************************************
  Sets up globals such as the TRUE / FALSE "constants" to make
@@ -115,14 +492,16 @@ static void setupGlobals()
     if (TRUE == NULL || FALSE == NULL) {
         TRUE = iniCell();
         FALSE = iniCell();
+        mNoMatch = iniCell();
+        mNoMatch->mSymbol = "#f";
     }
 
     // Setup reference variables environment
     if (mAssocVars == NULL) {
         mAssocVars = iniAssocList();
     }
-    // Setup reference functions environment
-    if (mAssocFns == NULL) mAssocFns = iniAssocList();
+    // Setup the function table
+    if (mFunctions == NULL) mFunctions = iniHashTable(equalCells);
 }
 
 /****************************************************************
@@ -135,305 +514,2061 @@ List* eval(List* list)
 {
     // Prep global members
     setupGlobals();
-    return recurse_eval(list->mStructure, mAssocVars);
+    // Calls made while evaluating, as by compiled code, share its budget
+    if (!mBudgeted || mMetering) return evalInput(list->mStructure);
+    mSteps = 0;
+    mDepth = 0;
+    mFirstByte = allocatedBytes();
+    mStarted = milliseconds();
+    mMetering = 1;
+    if (setjmp(mAbort) != 0) return abandonEval();
+    List* result = evalInput(list->mStructure);
+    mMetering = 0;
+    return result;
 }
+
 /****************************************************************
- Helper for eval(List*) to recursively evaluate the structure of
- the List given to eval(List*).
+ setBudget(): See header file for documentation.
 */
-static List* recurse_eval(Cell* cell, List* environment)
+void setBudget(int kind, long limit)
 {
-    // Detect a symbol in the cell below the current in focus
-    // and check if the symbol matches a supported function.
-    // After a match with the list of if/else comparisons
-    // below, the corresponding function is called with
-    // a recursive evaluation of the presumed next parameters
-    // passed in, and where a function is only given the current
-    // cell, the recursion is handled specially within the function
-    List* list = NULL;
-    int atomBelow = 0;
-    if (cell->mSub != NULL) {
-        char* sym = cell->mSub->mSymbol;
-        // Drop a level since no function yet
-        if (sym == NULL) {
-            list = recurse_eval(cell->mSub, environment);
-        // No need to recurse further if found a quote
-        } else if (strcmp(sym, "quote") == 0) {
-            list = malloc(sizeof(List));
-            if (cell->mNext->mSub->mSub == NULL) list->mStructure = cell->mNext->mSub;
-            else list->mStructure = cell->mNext->mSub;
-            return quote(list);
-            // Guide recursion down specific branch for cons params
-        } else if (strcmp(sym, "cons") == 0) {
-            return cons(recurse_eval(cell->mNext->mSub, environment), recurse_eval(cell->mNext->mNext->mSub, environment));
-            // Recurse evaluate car function's param
-        } else if (strcmp(sym, "list") == 0) {
-            return makeList(cell, environment);
-        } else if (strcmp(sym, "last") == 0) {
-            return last(recurse_eval(cell->mNext->mSub, environment));
-        } else if (strcmp(sym, "length") == 0) {
-            return length(recurse_eval(cell->mNext->mSub, environment));
-        } else if (strcmp(sym, "+") == 0) {
-            return add(cell, environment);
-        } else if (strcmp(sym, "-") == 0) {
-            return subtract(cell, environment);
-        } else if (strcmp(sym, "*") == 0) {
-            return multiply(cell, environment);
-        } else if ((strcmp(sym, "AND") == 0) || (strcmp(sym, "and") == 0)) {
-            return logicAnd(cell, environment);
-        } else if ((strcmp(sym, "OR") == 0) || (strcmp(sym, "or") == 0)) {
-            return logicOr(cell, environment);
-        } else if ((strcmp(sym, "NOT") == 0) || (strcmp(sym, "not") == 0)) {
-            return logicNot(recurse_eval(cell->mNext->mSub, environment));
-        } else if (strcmp(sym, "<") == 0) {
-            return lessThan(recurse_eval(cell->mNext->mSub, environment), recurse_eval(cell->mNext->mNext->mSub, environment));
-        } else if (strcmp(sym, ">") == 0) {
-            return greaterThan(recurse_eval(cell->mNext->mSub, environment), recurse_eval(cell->mNext->mNext->mSub, environment));
-        } else if (strcmp(sym, "<=") == 0) {
-            return lessThanOrEqualTo(recurse_eval(cell->mNext->mSub, environment), recurse_eval(cell->mNext->mNext->mSub, environment));
-        } else if (strcmp(sym, ">=") == 0) {
-            return greaterThanOrEqualTo(recurse_eval(cell->mNext->mSub, environment), recurse_eval(cell->mNext->mNext->mSub, environment));
-        } else if (strcmp(sym, "car") == 0) {
-            return car(recurse_eval(cell->mNext->mSub, environment));
-        // Recurse evaluate cdr function's param
-        } else if (strcmp(sym, "cdr") == 0) {
-            return cdr(recurse_eval(cell->mNext->mSub, environment));
-        } else if (strcmp(sym, "cadr") == 0) {
-            return cadr(recurse_eval(cell->mNext->mSub, environment));
-        } else if (strcmp(sym, "caddr") == 0) {
-            return caddr(recurse_eval(cell->mNext->mSub, environment));
-        } else if (strcmp(sym, "cadddr") == 0) {
-            return cadddr(recurse_eval(cell->mNext->mSub, environment));
-        } else if (strcmp(sym, "caddddr") == 0) {
-            return caddddr(recurse_eval(cell->mNext->mSub, environment));
-        } else if (strcmp(sym, "cdar") == 0) {
-            return cdar(recurse_eval(cell->mNext->mSub, environment));
-        // Recurse evaluate symbol? function's param
-        } else if (strcmp(sym, "symbol?") == 0) {
-            return isSymbol(recurse_eval(cell->mNext->mSub, environment));
-        } else if (strcmp(sym, "append") == 0) {
-            return append(recurse_eval(cell->mNext->mSub, environment), recurse_eval(cell->mNext->mNext->mSub, environment));
-        } else if (strcmp(sym,  "null?") == 0) {
-            return isNull(recurse_eval(cell->mNext->mSub, environment));
-        } else if (strcmp(sym, "equal?") == 0) {
-            return isEqual(recurse_eval(cell->mNext->mSub, environment), recurse_eval(cell->mNext->mNext->mSub, environment));
-        } else if (strcmp(sym, "define") == 0) {
-            // Define either as a variable or a function
-            List* key = recurse_eval(cell->mNext->mSub, environment);
-            List* value = recurse_eval(cell->mNext->mNext->mSub, environment);
-            if (isList(key)->mStructure == FALSE) {
-                List* enviro = define(key, value, environment);
-                // Update the global environment at first level of recursion
-                if (environment == mAssocVars) mAssocVars = enviro;
-                // Don't print anything - just defining
-                return NULL;
-            } else return defineFunction(key, wrapStructure(cell->mNext->mNext->mSub));
-            //return define(recurse_eval(cell->mNext->mSub), recurse_eval(cell->mNext->mNext->mSub));
-        } else if (strcmp(sym, "assoc") == 0) {
-            return assoc(cell->mNext->mSub->mNext, recurse_eval(cell->mNext->mNext->mSub, environment));
-        } else if (strcmp(sym, "cond") == 0) {
-            return cond(cell, environment);
-        } else if (strcmp(sym, "if") == 0) {
-            return alternateIf(cell, environment);
-        } else if (strcmp(sym, "number?") == 0) {
-            return isNumber(recurse_eval(cell->mNext->mSub, environment));
-        } else if (strcmp(sym, "list?") == 0) {
-            return isList(recurse_eval(cell->mNext->mSub, environment));
-            // Atom symbol found below current cell
-        } else atomBelow = 1;
-        // This case occurs during raw symbols not in a list
-    } else if (cell->mSymbol != NULL){
-        List* associated = assoc(cell, environment);
-        // Try to associate the symbol
-        if (associated->mStructure->mSymbol != NULL
-            && (strcmp(associated->mStructure->mSymbol, "#f") == 0))
-            return wrapStructure(cell);
-        return car(cdr(associated));
-    }
-    // Recurse right then update last cell seen coming back left
-    if (cell->mNext != NULL) {
-        list = recurse_eval(cell->mNext, environment);
-        list->mStructure = cell;
-    } else {
-        // Found a deep end of structure so go back up
-        list = malloc(sizeof(List));
-        list->mStructure = cell;
-    }
-
-    // Found an atom before evaluating deeper so try to associate when returning from recursion
-    if (atomBelow == 1) {
-        list = assocForFn(cell);
-
-        // Different cell returned means a function was matched
-        if (list->mStructure != cell) {
-            // Extract the formal params
-            List* formalParams = cdr(wrapStructure(list->mStructure->mSub));
-            List* actualParams = cdr(wrapStructure(cell));
+    mBudgets[kind] = limit > 0 ? limit : 0;
+    mBudgeted = 0;
+    int i;
+    for (i = 0; i < BUDGET_COUNT; i++)
+        if (mBudgets[i] > 0) mBudgeted = 1;
+}
 
-            // Generate local environment from user's definition and bind params
-            List* localEnv = iniAssocList();
-            localEnv = bindLocals(formalParams, actualParams, localEnv, environment);
+/****************************************************************
+ loadImage(): See header file for documentation.
+*/
+int loadImage(char* path)
+{
+    setupGlobals();
+    Cell* fixed[] = { TRUE, FALSE, mNoMatch };
+    int count;
+    Cell** roots = mapImage(path, &count, fixed, 3, equalCells);
+    if (roots == NULL) return 0;
+    if (!checkImageRoots(roots, count)) {
+        printf("image: %s is not an image.\n", path);
+        free(roots);
+        return 0;
+    }
 
-            list = recurse_eval((car(cdr(list)))->mStructure, localEnv);
-            // Symbol was not a function so try to identify as a variable
-        } else list = assocForVar(cell, environment);
+    mAssocVars->mStructure = roots[0];
+    int i;
+    for (i = 1; i < count - 1; i += 5) {
+        Cell* definition = roots[i + 1];
+        hashPut(mFunctions, roots[i], definition);
+        if (roots[i + 2] != NULL) definition->mData = iniMemoTable((int) roots[i + 2]->mFixnum, equalCells);
+        if (roots[i + 3] != NULL) {
+            if (mSources == NULL) {
+                mSources = iniHashTable(equalCells);
+                mInlined = iniHashTable(equalCells);
+            }
+            hashPut(mSources, roots[i], roots[i + 3]);
+            if (roots[i + 4] != NULL) hashPut(mInlined, roots[i], roots[i + 4]);
+        }
     }
-    return list;
+    Cell* macro;
+    for (macro = roots[count - 1]; macro != NULL; macro = macro->mNext) {
+        if (mMacros == NULL) mMacros = iniHashTable(equalCells);
+        hashPut(mMacros, macro->mSub->mNext->mSub, macro->mSub);
+    }
+    mFunctionsVersion++;
+    // Variables holding vectors or hash tables are never cached
+    Cell* binding;
+    for (binding = mAssocVars->mStructure; binding != NULL && binding->mSub != NULL; binding = binding->mNext) {
+        Cell* pair = binding->mSub;
+        if (pair->mNext != NULL) noteVolatile(pair->mSub, pair->mNext->mSub);
+    }
+    free(roots);
+    return 1;
 }
 
 /****************************************************************
- Helper that binds a list of formal parameters with a list of
- actual parameters for a given environment. This function is
- meant to be used during evaluation of user defined functions.
+ Helper for loadImage(char*) telling whether the roots of an image
+ have the shapes save-image wrote, as every offset may be within the
+ image and still lead to the wrong cell: the variables, then for
+ each function its name, a definition with a body, an optional
+ limit defineMemo would accept, its source and what it inlined,
+ then the macros last.
 */
-static List* bindLocals(List* formalParams, List* actualParams, List* newEnviro, List* oldEnviro)
+static int checkImageRoots(Cell** roots, int count)
 {
-    Cell* focus = formalParams->mStructure;
-    Cell* param = actualParams->mStructure;
-
-    while (focus != NULL) {
-        // Fill the new environment with the new parameters
-        newEnviro = define(wrapStructure(focus->mSub), recurse_eval(param->mSub, oldEnviro), newEnviro);
-        // Move on to next parameter
-        focus = focus->mNext;
-        param = param->mNext;
+    if (count < 2 || (count - 2) % 5 != 0) return 0;
+    int i;
+    for (i = 1; i < count - 1; i += 5) {
+        Cell* definition = roots[i + 1];
+        if (roots[i] == NULL || roots[i]->mSymbol == NULL || definition == NULL
+            || definition->mSub == NULL || definition->mNext == NULL
+            || (roots[i + 2] != NULL && (roots[i + 2]->mType != CELL_FIXNUM
+                || roots[i + 2]->mFixnum < 0 || roots[i + 2]->mFixnum > INT_MAX)))
+            return 0;
     }
-    return newEnviro;
+    Cell* macro;
+    for (macro = roots[count - 1]; macro != NULL; macro = macro->mNext)
+        if (macro->mSub == NULL || macro->mSub->mNext == NULL || macro->mSub->mNext->mSub == NULL) return 0;
+    return 1;
 }
 
 /****************************************************************
- Essentially a call to assoc(Cell*, List*) but specifically
- associates with the assumption that the first of the pair
- is not a list. This function modifies the output list from
- assoc(Cell*, List*) such that not finding a match returns the
- given Cell instead of #f and only the value is returned without
- the identifier.
+ setOptimizationLevel(): See header file for documentation.
 */
-static List* assocForVar(Cell* cell, List* environment)
+void setOptimizationLevel(int level)
 {
-    List* associated = assoc(cell, environment);
-    // Return original cell if no association found
-    if (associated->mStructure->mSymbol != NULL
-        && (strcmp(associated->mStructure->mSymbol, "#f") == 0))
-        return wrapStructure(cell);
-    return cadr(associated);
+    mOptimizationLevel = level;
 }
 
 /****************************************************************
- Essentially a call to assoc(Cell*, List*) but specifically
- associates with the global association list for functions. This
- function modifies the output list from assoc(Cell*, List*) such
- that not finding a match returns the given Cell instead of #f
- and only the value is returned without the identifier.
+ setProfiling(): See header file for documentation.
 */
-static List* assocForFn(Cell* cell)
+void setProfiling(int enabled)
 {
-    // Return original cell if no association found
-    List* associated = assoc(cell, mAssocFns);
-    if ((associated->mStructure->mSymbol != NULL)
-        && (strcmp(associated->mStructure->mSymbol, "#f") == 0))
-        return wrapStructure(cell);
-    return assoc(cell->mSub, mAssocFns);
+    if (enabled && !mProfiling) profileReset();
+    mProfiling = enabled;
 }
 
 /****************************************************************
- Helper function for recurse_eval(Cell*) for quoting params
- during evaluation.
+ isProfiling(): See header file for documentation.
 */
-static List* quote(List* list)
+int isProfiling()
 {
-    return list;
+    return mProfiling;
 }
 
 /****************************************************************
- Helper function for recurse_eval(Cell*) for taking the first
- element of a given List during evaluation.
+ setResultCaching(): See header file for documentation.
 */
-static List* car(List* list)
+void setResultCaching(int enabled)
 {
-    list->mStructure = list->mStructure->mSub;
-    return list;
+    if (enabled && mResults == NULL) {
+        mResults = iniHashTable(equalCells);
+        mReaders = iniHashTable(equalCells);
+        mVolatile = iniHashTable(equalCells);
+    } else if (!enabled) mResults = NULL;
 }
 
 /****************************************************************
- Helper function for recurse_eval(Cell*) for taking everything
- but the first element in a List during evaluation.
+ expandSyntax(): See header file for documentation. The variables
+ renamed are numbered afresh for every form, so the same input
+ always expands alike and its result can be cached.
 */
-static List* cdr(List* list)
+Cell* expandSyntax(Cell* form)
 {
-    if (list->mStructure->mNext != NULL)
-        list->mStructure = list->mStructure->mNext;
-        // When there is nothing else in the list, return an empty list / #f
-    else list->mStructure = iniCell();
-    return list;
+    if (mMacros == NULL || mMacros->mCount == 0) return form;
+    mExpansions = 0;
+    mExpanding = 0;
+    return expandMacros(form);
 }
 
 /****************************************************************
- Helper function for recurse_eval(Cell*) for checking whether or
- not the given List is a #t or #f (represented by the
- empty list "()") as a symbol during evaluation. The returned
- List pointer references a Cell which is itself either the
- global TRUE or FALSE "constant" Cell.
+ nativeDefine(): See native.h for documentation.
 */
-static List* isSymbol(List* list)
+void nativeDefine(char* name, char** formals, int count, NativeFunction function)
 {
-    Cell* s = list->mStructure;
-    if (s->mSymbol != NULL) return wrapStructure(TRUE);
-    else return wrapStructure(FALSE);
+    setupGlobals();
+    // Build (name formal ...) as written after define
+    Cell* nameParams = iniCell();
+    nameParams->mSub = iniCell();
+    nameParams->mSub->mSymbol = internSymbol(name);
+    Cell* tail = nameParams;
+    int i;
+    for (i = 0; i < count; i++) {
+        tail->mNext = iniCell();
+        tail = tail->mNext;
+        tail->mSub = iniCell();
+        tail->mSub->mSymbol = internSymbol(formals[i]);
+    }
+
+    Cell* body = iniCell();
+    body->mType = CELL_NATIVE;
+    body->mData = (void*) function;
+    defineFunction(wrapStructure(nameParams), wrapStructure(body));
 }
 
 /****************************************************************
- Helper function for recurse_eval(Cell*) that inserts the first
- List as the first element of the second List.
+ nativeCall(): See native.h for documentation. The call form of a
+ builtin is kept in the mData member of the given form, which is
+ only ever passed here, and a nested call from the same place while
+ it is in use builds a form of its own.
 */
-static List* cons(List* la, List* lb)
+Cell* nativeCall(Cell* form, Cell** args, int count)
 {
-    Cell* host = iniCell();
-
-    // Check if list is #f (the empty list convention)
-    Cell* shell = lb->mStructure;
-    if ((shell->mSub != NULL) && (shell->mSub->mSymbol != NULL)
-        && (strcmp(shell->mSub->mSymbol, "#f") == 0)) {
-        host->mSub = iniCell();
-        host->mSub->mSub = la->mStructure;
+    Cell* name = form->mSub;
+    List* result;
+    if (isBuiltin(name->mSymbol)) {
+        Procedure* applied = form->mData;
+        form->mData = NULL;
+        if (applied == NULL) {
+            applied = allocate(sizeof(Procedure));
+            prepareForm(name, count, applied);
+        }
+        result = applyProcedure(applied, args);
+        form->mData = applied;
     } else {
-        // Normal case consing
-        host->mNext = shell;
-        host->mSub = la->mStructure;
+        Cell* definition = lookupFunction(name);
+        if (definition == NULL) return form;
+        if (count < countFormals(definition->mSub->mNext)) return reportError(name->mSymbol, "too few parameters")->mStructure;
+        result = applyDefinition(definition->mSub->mNext, definition->mNext->mSub, definition->mData, args);
     }
-    return wrapStructure(host);
+    return result != NULL ? result->mStructure : NULL;
 }
 
 /****************************************************************
- Helper function for recurse_eval(Cell*) that checks whether or
- not the given List resolves to null ("#f").
+ nativeDatum(): See native.h for documentation.
 */
-static List* isNull(List* list)
+Cell* nativeDatum(char* text)
 {
-    Cell* cell = list->mStructure;
+    FILE* stream = fmemopen(text, strlen(text), "r");
+    pushTokenSource(stream);
+    List* datum = S_Expression();
+    popTokenSource();
+    fclose(stream);
+    return datum->mStructure;
+}
 
-    // Evaluated #t
-    if (cell == TRUE || (cell->mSymbol != NULL && strcmp(cell->mSymbol, "#t") == 0)) return wrapStructure(FALSE);
-        // Explicit #f encountered
-    else if (cell == FALSE || (cell != NULL && cell->mSymbol != NULL
-             && (strcmp(cell->mSymbol, "#f") == 0)))
-        return wrapStructure(TRUE);
-        // Normal case list
-    else if (cell != NULL) {
-        if (isEmptyStructure(cell) == 1) return wrapStructure(TRUE);
-        else return wrapStructure(FALSE);
-        // In case of a NULL cell structure in List
-    } else return wrapStructure(TRUE);
+/****************************************************************
+ nativeEvaluate(): See native.h for documentation.
+*/
+void nativeEvaluate(char* text)
+{
+    FILE* stream = fmemopen(text, strlen(text), "r");
+    pushTokenSource(stream);
+    List* input = S_Expression();
+    popTokenSource();
+    fclose(stream);
+    eval(input);
+}
 
+/****************************************************************
+ nativeOperand(): See native.h for documentation.
+*/
+Number nativeOperand(Cell* cell)
+{
+    List operand = { cell };
+    return operandOf(&operand);
 }
 
 /****************************************************************
- Helper function for isNull(List*) to recursively search a
- cell structure if it's empty or not (void of symbols).
+ nativeBox(): See native.h for documentation.
 */
-static int isEmptyStructure(Cell* cell)
+Cell* nativeBox(Number value)
 {
-    // Ignore special symbols
+    Cell* num = iniCell();
+    setNumber(num, value);
+    return num;
+}
+
+/****************************************************************
+ nativeCar(): See native.h for documentation.
+*/
+Cell* nativeCar(Cell* cell)
+{
+    List list = { cell };
+    return car(&list)->mStructure;
+}
+
+/****************************************************************
+ nativeCdr(): See native.h for documentation.
+*/
+Cell* nativeCdr(Cell* cell)
+{
+    List list = { cell };
+    return cdr(&list)->mStructure;
+}
+
+/****************************************************************
+ nativeCons(): See native.h for documentation.
+*/
+Cell* nativeCons(Cell* first, Cell* rest)
+{
+    List la = { first };
+    List lb = { rest };
+    return cons(&la, &lb)->mStructure;
+}
+
+/****************************************************************
+ nativeNull(): See native.h for documentation.
+*/
+int nativeNull(Cell* cell)
+{
+    List list = { cell };
+    return isNull(&list)->mStructure == TRUE;
+}
+
+/****************************************************************
+ nativeEqual(): See native.h for documentation.
+*/
+int nativeEqual(Cell* c1, Cell* c2)
+{
+    List la = { c1 };
+    List lb = { c2 };
+    return isEqual(&la, &lb)->mStructure == TRUE;
+}
+
+/****************************************************************
+ Helper for recurse_eval(Cell*) that times a call to a builtin or
+ a user defined function while profiling, including a closure
+ called through a variable. The call is evaluated by
+ recurse_eval(Cell*) as usual, which knows not to profile it
+ again. Forms whose head is none of these, such as quoted data,
+ are evaluated without being timed.
+*/
+static List* profiledCall(Cell* cell, List* environment)
+{
+    char* sym = cell->mSub->mSymbol;
+    int builtin = isBuiltin(sym);
+    int timed = builtin || lookupFunction(cell->mSub) != NULL;
+    if (!timed) {
+        Cell* bound = lookupVariable(cell->mSub, environment);
+        timed = bound != NULL && bound->mType == CELL_CLOSURE;
+    }
+    // The call was already counted against any budget
+    mBudgetedCall = cell;
+    if (!timed) {
+        mProfiledCall = cell;
+        return recurse_eval(cell, environment);
+    }
+    profileEnter(sym, builtin);
+    mProfiledCall = cell;
+    List* result = recurse_eval(cell, environment);
+    profileExit();
+    return result;
+}
+
+/****************************************************************
+ Helper for eval(List*) that evaluates an input once the macros it
+ uses are expanded, through the result cache when it is on.
+*/
+static List* evalInput(Cell* input)
+{
+    input = expandSyntax(input);
+    if (input == NULL) return wrapStructure(FALSE);
+    if (mResults != NULL) return cachedEval(input);
+    return recurse_eval(optimize(input), mAssocVars);
+}
+
+/****************************************************************
+ Helper for recurse_eval(Cell*) that counts an evaluation against
+ the budgets of the input under way, abandoning the input when one
+ runs out. The evaluation is then done by recurse_eval(Cell*) as
+ usual, which knows not to count it again. The clock is only read
+ every 256 steps.
+*/
+static List* budgetedEval(Cell* cell, List* environment)
+{
+    mSteps++;
+    if (mBudgets[BUDGET_STEPS] > 0 && mSteps > mBudgets[BUDGET_STEPS]) exceedBudget(BUDGET_STEPS);
+    if (mBudgets[BUDGET_DEPTH] > 0 && mDepth >= mBudgets[BUDGET_DEPTH]) exceedBudget(BUDGET_DEPTH);
+    if (mBudgets[BUDGET_BYTES] > 0 && allocatedBytes() - mFirstByte > mBudgets[BUDGET_BYTES])
+        exceedBudget(BUDGET_BYTES);
+    if (mBudgets[BUDGET_MILLISECONDS] > 0 && (mSteps & 255) == 0
+        && milliseconds() - mStarted > mBudgets[BUDGET_MILLISECONDS]) exceedBudget(BUDGET_MILLISECONDS);
+    mDepth++;
+    mBudgetedCall = cell;
+    List* result = recurse_eval(cell, environment);
+    mDepth--;
+    return result;
+}
+
+/****************************************************************
+ Helper for budgetedEval(Cell*, List*) that abandons the input under
+ way, resuming eval(List*) where it set the input going.
+*/
+static void exceedBudget(int kind)
+{
+    mExceeded = kind;
+    longjmp(mAbort, 1);
+}
+
+/****************************************************************
+ Helper for eval(List*) that clears whatever the abandoned input
+ left half done and reports the budget it ran out of. Budgets are
+ only checked as a cell is about to be evaluated, so no table was
+ being changed at the time.
+*/
+static List* abandonEval()
+{
+    static char* resources[BUDGET_COUNT] = { "steps", "bytes", "levels of depth", "milliseconds" };
+    mMetering = 0;
+    mBudgetedCall = NULL;
+    mProfiledCall = NULL;
+    if (mProfiling) profileUnwind();
+    mFolding = 0;
+    mInlining = NULL;
+    mInlinedNow = NULL;
+    leaveSite(SITE_EVALUATION);
+    // Symbols read for the result cache are of no use any more
+    mRecording = 0;
+    while (mReads != NULL) {
+        Cell* next = mReads->mNext;
+        free(mReads);
+        mCacheCells--;
+        mReads = next;
+    }
+    char message[80];
+    sprintf(message, "ran out of its budget of %ld %s", mBudgets[mExceeded], resources[mExceeded]);
+    return reportError("eval", message);
+}
+
+/****************************************************************
+ Helper giving a monotonic time in milliseconds.
+*/
+static long milliseconds()
+{
+    struct timespec time;
+    clock_gettime(CLOCK_MONOTONIC, &time);
+    return time.tv_sec * 1000L + time.tv_nsec / 1000000;
+}
+
+/****************************************************************
+ Helper for eval(List*) that answers an input from the result
+ cache, or evaluates it while recording the global symbols it
+ reads and caches the result when the evaluation turned out to be
+ pure. Each symbol read keeps a chain of the inputs that read it
+ so that redefining the symbol drops their results.
+*/
+static List* cachedEval(Cell* input)
+{
+    Cell* cached = hashGet(mResults, input);
+    if (cached != NULL) {
+        mCacheHits++;
+        return wrapStructure(cached->mSub);
+    }
+    mCacheMisses++;
+
+    Cell* optimized = optimize(input);
+    mReads = NULL;
+    mRecording = 1;
+    mCacheable = 1;
+    List* result = recurse_eval(optimized, mAssocVars);
+    mRecording = 0;
+
+    Cell* read = mReads;
+    mReads = NULL;
+    // Definitions give no result and are never cached
+    if (result == NULL || result->mStructure == NULL) mCacheable = 0;
+    if (mCacheable) {
+        Cell* holder = iniLinkCell();
+        holder->mSub = result->mStructure;
+        hashPut(mResults, input, holder);
+        mCacheCells++;
+    }
+    while (read != NULL) {
+        Cell* next = read->mNext;
+        if (mCacheable) {
+            // Reuse the cell as a link of the symbol's reader chain
+            Cell* symbol = read->mSub;
+            read->mSub = input;
+            read->mNext = hashGet(mReaders, symbol);
+            hashPut(mReaders, symbol, read);
+        } else {
+            free(read);
+            mCacheCells--;
+        }
+        read = next;
+    }
+    return result;
+}
+
+/****************************************************************
+ Helper recording that the input being evaluated for the result
+ cache read the given global symbol. Reading a variable that holds
+ a vector or hash table makes the result depend on data that can
+ change without a define, so such an input is not cached.
+*/
+static void noteRead(Cell* symbol)
+{
+    if (symbol->mSymbol == NULL) return;
+    if (hashGet(mVolatile, symbol) != NULL) mCacheable = 0;
+
+    Cell* read;
+    for (read = mReads; read != NULL; read = read->mNext)
+        if (read->mSub->mSymbol == symbol->mSymbol
+            || strcmp(read->mSub->mSymbol, symbol->mSymbol) == 0) return;
+    read = iniLinkCell();
+    read->mSub = symbol;
+    read->mNext = mReads;
+    mReads = read;
+    mCacheCells++;
+}
+
+/****************************************************************
+ Helper dropping the cached result of every input that read the
+ given global symbol, called when define rebinds it. A chain may
+ still name inputs already dropped through another symbol, which
+ only removes their result again should it have been recached.
+*/
+static void invalidateReaders(Cell* symbol)
+{
+    if (mResults == NULL || symbol == NULL || symbol->mSymbol == NULL) return;
+    Cell* reader = hashGet(mReaders, symbol);
+    if (reader == NULL) return;
+    hashRemove(mReaders, symbol);
+    while (reader != NULL) {
+        Cell* next = reader->mNext;
+        Cell* holder = hashGet(mResults, reader->mSub);
+        if (holder != NULL) {
+            hashRemove(mResults, reader->mSub);
+            free(holder);
+            mCacheCells--;
+            mCacheInvalidations++;
+        }
+        free(reader);
+        mCacheCells--;
+        reader = next;
+    }
+}
+
+/****************************************************************
+ Helper keeping track of which global variables hold a vector or
+ hash table as they are defined, directly or through a closure or
+ promise, for noteRead(Cell*).
+*/
+static void noteVolatile(Cell* symbol, Cell* value)
+{
+    if (mResults == NULL || symbol == NULL || symbol->mSymbol == NULL) return;
+    if (value != NULL && holdsNative(value)) hashPut(mVolatile, symbol, TRUE);
+    else hashRemove(mVolatile, symbol);
+}
+
+/****************************************************************
+ Helper checking whether the given structure, or anything after
+ it on the same level, holds a vector or hash table.
+*/
+static int holdsNative(Cell* cell)
+{
+    AddressSet* seen = NULL;
+    int holds = holdsNativeFrom(cell, &seen);
+    if (seen != NULL) freeAddressSet(seen);
+    return holds;
+}
+
+/****************************************************************
+ Helper for holdsNative(Cell*) that also looks into the values a
+ closure captured and the value of a forced promise. A promise not
+ forced yet may give anything, so it is taken to hold one. The set
+ of closures and promises looked into, as they may refer to
+ themselves, is only made once one is met.
+*/
+static int holdsNativeFrom(Cell* cell, AddressSet** seen)
+{
+    for (; cell != NULL; cell = cell->mNext) {
+        if (cell->mType == CELL_VECTOR || cell->mType == CELL_HASH) return 1;
+        if (cell->mType == CELL_CLOSURE || cell->mType == CELL_PROMISE) {
+            if (*seen == NULL) *seen = iniAddressSet();
+            if (!addAddress(*seen, cell)) continue;
+        }
+        if (cell->mType == CELL_CLOSURE) {
+            Closure* closure = cell->mData;
+            int i;
+            for (i = 0; i < closure->mCount; i++)
+                if (closure->mValues[i] != NULL && holdsNativeFrom(closure->mValues[i], seen)) return 1;
+        } else if (cell->mType == CELL_PROMISE) {
+            Promise* promise = cell->mData;
+            if (promise->mValue == NULL || holdsNativeFrom(promise->mValue, seen)) return 1;
+        }
+        if (cell->mSub != NULL && holdsNativeFrom(cell->mSub, seen)) return 1;
+    }
+    return 0;
+}
+
+/****************************************************************
+ Optimization pass run over top level input and over the bodies of
+ functions as they are defined. It gives an expression that
+ evaluates to the same result as the given one, sharing the cells
+ of the parts it leaves alone and never changing the given cells.
+
+ Calls of pure builtins whose operands are all constants, that is
+ numbers, #t, #f or quoted data, are evaluated once and replaced
+ by their result. An if or cond whose test turns out constant is
+ replaced by the branch taken, and chains such as (car (cdr x))
+ become the single builtin (cadr x). Operands that are not
+ evaluated, such as the name given to define, are left alone.
+*/
+static Cell* optimize(Cell* expression)
+{
+    if (mOptimizationLevel <= 0 || expression == NULL || expression->mType != CELL_PLAIN
+        || expression->mSub == NULL || expression->mSub->mSymbol == NULL)
+        return expression;
+
+    char* sym = expression->mSub->mSymbol;
+    if (strcmp(sym, "quote") == 0 || strcmp(sym, "define-memo") == 0
+        || strcmp(sym, "define-syntax") == 0) return expression;
+    // Binding forms name variables among their operands
+    if (strcmp(sym, "lambda") == 0 || strcmp(sym, "let") == 0 || strcmp(sym, "let*") == 0
+        || strcmp(sym, "letrec") == 0) return expression;
+    // Delayed operands must stay as written until forced
+    if (strcmp(sym, "delay") == 0 || strcmp(sym, "cons-stream") == 0) return expression;
+    if (strcmp(sym, "define") == 0) {
+        // Only the value of a variable is evaluated, and the body of
+        // a function is optimized by defineFunction(List*, List*)
+        if (expression->mNext == NULL || expression->mNext->mSub->mSub != NULL) return expression;
+        return optimizeOperands(expression, 2);
+    }
+    if (strcmp(sym, "if") == 0) return optimizeIf(expression);
+    if (strcmp(sym, "cond") == 0) return optimizeCond(expression);
+
+    // The key given to assoc is taken as written
+    Cell* form = optimizeOperands(expression, strcmp(sym, "assoc") == 0 ? 2 : 1);
+    form = simplifyAccessors(form);
+    if (mInlining != NULL && mOptimizationLevel >= 2) {
+        Cell* inlined = inlineCall(form);
+        if (inlined != form) return inlined;
+    }
+    return foldConstant(form);
+}
+
+/****************************************************************
+ Helper for optimize(Cell*) that optimizes the operands of a call
+ from the given position on, the first operand being 1. The call
+ is copied only when one of its operands changed.
+*/
+static Cell* optimizeOperands(Cell* form, int first)
+{
+    Cell* operand;
+    int position = 1;
+    int changed = 0;
+    int count = 0;
+    for (operand = form->mNext; operand != NULL; operand = operand->mNext)
+        count++;
+    Cell** optimized = malloc(sizeof(Cell*) * (count > 0 ? count : 1));
+    for (operand = form->mNext; operand != NULL; operand = operand->mNext, position++) {
+        optimized[position - 1] = operand->mSub;
+        if (position >= first) optimized[position - 1] = optimize(operand->mSub);
+        if (optimized[position - 1] != operand->mSub) changed = 1;
+    }
+    if (changed) {
+        Cell* copy = iniCell();
+        copy->mSub = form->mSub;
+        copy->mNext = count > 0 ? buildList(optimized, count) : NULL;
+        form = copy;
+    }
+    free(optimized);
+    return form;
+}
+
+/****************************************************************
+ Helper for optimize(Cell*) that reduces (if test then else) to
+ one of its branches when the test is constant. Only #t as given
+ by a builtin selects the first branch, just as when evaluating.
+*/
+static Cell* optimizeIf(Cell* form)
+{
+    form = optimizeOperands(form, 1);
+    Cell* test = form->mNext;
+    if (test == NULL || test->mNext == NULL || test->mNext->mNext == NULL
+        || !isConstant(test->mSub)) return form;
+    if (constantValue(test->mSub) == TRUE) return test->mNext->mSub;
+    return test->mNext->mNext->mSub;
+}
+
+/****************************************************************
+ Helper for optimize(Cell*) that drops the clauses of a cond whose
+ test is a constant other than #t and ends the cond at the first
+ clause certain to be taken. A cond left with that clause alone is
+ replaced by its expression, and one with no clauses by #f.
+*/
+static Cell* optimizeCond(Cell* form)
+{
+    int count = 0;
+    Cell* clause;
+    for (clause = form->mNext; clause != NULL; clause = clause->mNext)
+        count++;
+    Cell** kept = malloc(sizeof(Cell*) * (count > 0 ? count : 1));
+    int changed = 0;
+    int taken = 0;
+    count = 0;
+    for (clause = form->mNext; clause != NULL && !taken; clause = clause->mNext) {
+        Cell* pair = clause->mSub;
+        // Clauses without an expression are kept as written
+        if (pair == NULL || pair->mSub == NULL || pair->mNext == NULL) {
+            kept[count++] = pair;
+            continue;
+        }
+        Cell* test = pair->mSub;
+        int isElse = test->mSymbol != NULL
+                     && (strcmp(test->mSymbol, "else") == 0 || strcmp(test->mSymbol, "#t") == 0);
+        if (!isElse) test = optimize(test);
+        if (!isElse && isConstant(test)) {
+            changed = 1;
+            if (constantValue(test) != TRUE) continue;
+            // Always taken, so it may as well be an else clause
+            test = iniCell();
+            test->mSymbol = "else";
+            isElse = 1;
+        }
+        Cell* expression = optimize(pair->mNext->mSub);
+        if (test != pair->mSub || expression != pair->mNext->mSub) {
+            changed = 1;
+            pair = iniCell();
+            pair->mSub = test;
+            pair->mNext = iniCell();
+            pair->mNext->mSub = expression;
+            pair->mNext->mNext = clause->mSub->mNext->mNext;
+        }
+        kept[count++] = pair;
+        if (isElse) {
+            taken = 1;
+            if (clause->mNext != NULL) changed = 1;
+        }
+    }
+
+    Cell* result = form;
+    if (count == 0) result = quoteValue(FALSE);
+    else if (taken && count == 1) result = kept[0]->mNext->mSub;
+    else if (changed) {
+        result = iniCell();
+        result->mSub = form->mSub;
+        result->mNext = buildList(kept, count);
+    }
+    free(kept);
+    return result;
+}
+
+/****************************************************************
+ Helper for optimize(Cell*) that turns (car (cdr ... x)) with up
+ to four cdr calls into cadr through caddddr, and (cdr (car x))
+ into cdar.
+*/
+static Cell* simplifyAccessors(Cell* form)
+{
+    char* names[] = {NULL, "cadr", "caddr", "cadddr", "caddddr"};
+    Cell* inner = NULL;
+    char* name = NULL;
+    if (isCallTo(form, "car", 1)) {
+        int depth = 0;
+        inner = form->mNext->mSub;
+        while (depth < 4 && isCallTo(inner, "cdr", 1)) {
+            inner = inner->mNext->mSub;
+            depth++;
+        }
+        name = names[depth];
+    } else if (isCallTo(form, "cdr", 1) && isCallTo(form->mNext->mSub, "car", 1)) {
+        inner = form->mNext->mSub->mNext->mSub;
+        name = "cdar";
+    }
+    if (name == NULL) return form;
+
+    Cell* simplified = iniCell();
+    simplified->mSub = iniCell();
+    simplified->mSub->mSymbol = name;
+    simplified->mNext = iniCell();
+    simplified->mNext->mSub = inner;
+    return simplified;
+}
+
+/****************************************************************
+ Helper for optimize(Cell*) that evaluates a call of a pure builtin
+ whose operands are all constants and gives its result as a
+ constant expression. The call is kept when evaluating it reports
+ an error, so that the error still shows when it runs.
+*/
+static Cell* foldConstant(Cell* form)
+{
+    int arity = foldableArity(form->mSub->mSymbol);
+    if (arity < 0) return form;
+    int count = 0;
+    Cell* operand;
+    for (operand = form->mNext; operand != NULL; operand = operand->mNext) {
+        if (!isConstant(operand->mSub)) return form;
+        count++;
+    }
+    if (count < arity) return form;
+
+    mFolding = 1;
+    mFoldFailed = 0;
+    List* result = recurse_eval(form, iniAssocList());
+    mFolding = 0;
+    if (mFoldFailed || result == NULL || result->mStructure == NULL) return form;
+    return constantExpression(result->mStructure);
+}
+
+/****************************************************************
+ Helper for foldConstant(Cell*) giving the least number of
+ operands a pure builtin needs, or -1 for anything that is not a
+ pure builtin.
+*/
+static int foldableArity(char* sym)
+{
+    char* unary[] = {"car", "cdr", "cadr", "caddr", "cadddr", "caddddr", "cdar", "length",
+                     "last", "symbol?", "null?", "list?", "number?", "not", "NOT", "min", "max",
+                     "+", "-", "*", "/", "and", "AND", "or", "OR", "list"};
+    char* binary[] = {"cons", "append", "equal?", "<", ">", "<=", ">="};
+    int i;
+    for (i = 0; i < (int) (sizeof(unary) / sizeof(char*)); i++)
+        if (strcmp(sym, unary[i]) == 0) return 1;
+    for (i = 0; i < (int) (sizeof(binary) / sizeof(char*)); i++)
+        if (strcmp(sym, binary[i]) == 0) return 2;
+    return -1;
+}
+
+/****************************************************************
+ Helper for the optimization pass checking whether an expression
+ always evaluates to the same value: a number, #t or #f as written,
+ or quoted data.
+*/
+static int isConstant(Cell* expression)
+{
+    if (expression == NULL || expression->mType == CELL_VECTOR || expression->mType == CELL_HASH)
+        return 0;
+    if (expression->mSub == NULL)
+        return expression->mSymbol != NULL && (tagNumber(expression)
+               || strcmp(expression->mSymbol, "#t") == 0 || strcmp(expression->mSymbol, "#f") == 0);
+    return expression->mSub->mSymbol != NULL && strcmp(expression->mSub->mSymbol, "quote") == 0
+           && expression->mNext != NULL;
+}
+
+/****************************************************************
+ Helper giving the value of an expression for which
+ isConstant(Cell*) holds.
+*/
+static Cell* constantValue(Cell* expression)
+{
+    if (expression->mSub == NULL) return expression;
+    return expression->mNext->mSub;
+}
+
+/****************************************************************
+ Helper giving an expression that evaluates to the given value. A
+ number stands for itself and anything else gets quoted.
+*/
+static Cell* constantExpression(Cell* value)
+{
+    if (value->mSub == NULL && value->mNext == NULL && value->mSymbol != NULL
+        && value != TRUE && value != FALSE && tagNumber(value))
+        return value;
+    return quoteValue(value);
+}
+
+/****************************************************************
+ Helper building (quote value) around an already evaluated value,
+ which evaluates to that very value, be it #t or #f.
+*/
+static Cell* quoteValue(Cell* value)
+{
+    Cell* quoted = iniCell();
+    quoted->mSub = iniCell();
+    quoted->mSub->mSymbol = "quote";
+    quoted->mNext = iniCell();
+    quoted->mNext->mSub = value;
+    return quoted;
+}
+
+/****************************************************************
+ Helper checking whether an expression is a call of the named
+ builtin with exactly the given number of operands.
+*/
+static int isCallTo(Cell* expression, char* name, int operands)
+{
+    if (expression == NULL || expression->mType != CELL_PLAIN || expression->mSub == NULL
+        || expression->mSub->mSymbol == NULL || strcmp(expression->mSub->mSymbol, name) != 0)
+        return 0;
+    Cell* operand;
+    for (operand = expression->mNext; operand != NULL; operand = operand->mNext)
+        operands--;
+    return operands == 0;
+}
+
+/****************************************************************
+ Helper for defineFunction(List*, List*) that optimizes the body of
+ the named function. At level 2 its calls to small functions are
+ inlined, and the body as written is kept so that it can be
+ optimized again once a function it inlined is redefined.
+*/
+static Cell* optimizeBody(Cell* name, Cell* body)
+{
+    if (mOptimizationLevel < 2) return optimize(body);
+    if (mSources == NULL) {
+        mSources = iniHashTable(equalCells);
+        mInlined = iniHashTable(equalCells);
+    }
+    hashPut(mSources, name, body);
+
+    mInlining = name;
+    mInlinedNow = NULL;
+    Cell* optimized = optimize(body);
+    if (mInlinedNow != NULL) hashPut(mInlined, name, mInlinedNow);
+    else hashRemove(mInlined, name);
+    mInlining = NULL;
+    mInlinedNow = NULL;
+    return optimized;
+}
+
+/****************************************************************
+ Helper for defineFunction(List*, List*) that optimizes again, from
+ the body as written, every function holding an inlined copy of
+ the named function once it has been redefined or memoized. As the
+ functions a function inlined include those inlined into them, a
+ single pass over the table reaches every stale copy.
+*/
+static void refreshInliners(Cell* name)
+{
+    if (mInlined == NULL || mInlined->mCount == 0) return;
+    Cell* stale = NULL;
+    Cell* caller;
+    Cell* inlined;
+    int i = 0;
+    while ((i = hashNext(mInlined, i, &caller, &inlined)) != -1) {
+        for (; inlined != NULL; inlined = inlined->mNext) {
+            if (equalCells(inlined->mSub, name)) {
+                Cell* link = iniLinkCell();
+                link->mSub = caller;
+                link->mNext = stale;
+                stale = link;
+                break;
+            }
+        }
+    }
+
+    while (stale != NULL) {
+        Cell* definition = hashGet(mFunctions, stale->mSub);
+        if (definition != NULL && !equalCells(stale->mSub, name)) {
+            definition->mNext->mSub = optimizeBody(stale->mSub, hashGet(mSources, stale->mSub));
+            // Cached results never looked the inlined function up
+            invalidateReaders(stale->mSub);
+        }
+        Cell* next = stale->mNext;
+        free(stale);
+        stale = next;
+    }
+}
+
+/****************************************************************
+ Helper for optimize(Cell*) that replaces a call of a small user
+ defined function by its body, with each formal parameter replaced
+ by the operand given for it. The function must not call itself
+ nor use any name other than its formal parameters and the
+ functions it calls, so that the body means the same wherever it
+ lands. Operands other than variables and constants must be pure
+ and used at most once by the body, so nothing is evaluated more
+ often than before. Memoized functions keep their calls.
+*/
+static Cell* inlineCall(Cell* form)
+{
+    if (isBuiltin(form->mSub->mSymbol) || equalCells(form->mSub, mInlining)) return form;
+    Cell* definition = hashGet(mFunctions, form->mSub);
+    if (definition == NULL || definition->mData != NULL) return form;
+
+    Cell* formals = definition->mSub->mNext;
+    Cell* body = definition->mNext->mSub;
+    int size = 0;
+    if (body->mType == CELL_NATIVE) return form;
+    if (!isInlinable(body, formals, definition->mSub->mSub, &size)) return form;
+
+    int count = 0;
+    Cell* formal;
+    Cell* operand = form->mNext;
+    for (formal = formals; formal != NULL; formal = formal->mNext, operand = operand->mNext) {
+        if (operand == NULL) return form;
+        count++;
+    }
+    if (operand != NULL) return form;
+
+    Cell** operands = malloc(sizeof(Cell*) * (count > 0 ? count : 1));
+    int i = 0;
+    for (formal = formals, operand = form->mNext; formal != NULL;
+         formal = formal->mNext, operand = operand->mNext, i++) {
+        operands[i] = operand->mSub;
+        if (!isSimpleOperand(operand->mSub, 0) && (countUses(body, formal->mSub) > 1
+                                                   || !isSimpleOperand(operand->mSub, 1))) {
+            free(operands);
+            return form;
+        }
+    }
+
+    Cell* inlined = substitute(body, formals, operands);
+    free(operands);
+    addInlined(definition->mSub->mSub);
+    // The body was optimized when defined, so only fold what the
+    // operands made constant
+    Cell* defining = mInlining;
+    mInlining = NULL;
+    inlined = optimize(inlined);
+    mInlining = defining;
+    return inlined;
+}
+
+/****************************************************************
+ Helper for inlineCall(Cell*) checking that a body is small enough,
+ does not call the named function, and uses only its formal
+ parameters as variables. The size so far is counted in cells.
+*/
+static int isInlinable(Cell* expression, Cell* formals, Cell* name, int* size)
+{
+    if (++*size > INLINE_LIMIT) return 0;
+    if (expression->mSub == NULL) {
+        if (isConstant(expression)) return 1;
+        Cell* formal;
+        for (formal = formals; formal != NULL; formal = formal->mNext)
+            if (equalCells(formal->mSub, expression)) return 1;
+        return 0;
+    }
+    if (isConstant(expression)) return 1;
+
+    Cell* head = expression->mSub;
+    if (head->mSymbol == NULL || equalCells(head, name)) return 0;
+    if (strcmp(head->mSymbol, "define") == 0 || strcmp(head->mSymbol, "define-memo") == 0
+        || strcmp(head->mSymbol, "memoize") == 0 || strcmp(head->mSymbol, "assoc") == 0
+        || strcmp(head->mSymbol, "lambda") == 0 || strcmp(head->mSymbol, "let") == 0
+        || strcmp(head->mSymbol, "let*") == 0 || strcmp(head->mSymbol, "letrec") == 0
+        || strcmp(head->mSymbol, "delay") == 0 || strcmp(head->mSymbol, "cons-stream") == 0)
+        return 0;
+    if (!isBuiltin(head->mSymbol) && hashGet(mFunctions, head) == NULL) return 0;
+
+    Cell* operand;
+    for (operand = expression->mNext; operand != NULL; operand = operand->mNext) {
+        Cell* part = operand->mSub;
+        if (strcmp(head->mSymbol, "cond") == 0) {
+            // Each clause is a test and an expression
+            if (part == NULL || part->mSub == NULL || part->mNext == NULL || part->mNext->mNext != NULL)
+                return 0;
+            int isElse = part->mSub->mSymbol != NULL && (strcmp(part->mSub->mSymbol, "else") == 0
+                                                          || strcmp(part->mSub->mSymbol, "#t") == 0);
+            if (!isElse && !isInlinable(part->mSub, formals, name, size)) return 0;
+            part = part->mNext->mSub;
+        }
+        if (part == NULL || !isInlinable(part, formals, name, size)) return 0;
+    }
+    return 1;
+}
+
+/****************************************************************
+ Helper for inlineCall(Cell*) counting how many times a body that
+ passed isInlinable(...) uses the given formal parameter.
+*/
+static int countUses(Cell* expression, Cell* formal)
+{
+    if (expression->mSub == NULL) return equalCells(expression, formal);
+    if (isConstant(expression)) return 0;
+    int uses = 0;
+    Cell* operand;
+    for (operand = expression->mNext; operand != NULL; operand = operand->mNext) {
+        if (strcmp(expression->mSub->mSymbol, "cond") == 0) {
+            Cell* test = operand->mSub->mSub;
+            if (test->mSymbol == NULL || (strcmp(test->mSymbol, "else") != 0
+                                          && strcmp(test->mSymbol, "#t") != 0))
+                uses += countUses(test, formal);
+            uses += countUses(operand->mSub->mNext->mSub, formal);
+        } else uses += countUses(operand->mSub, formal);
+    }
+    return uses;
+}
+
+/****************************************************************
+ Helper for inlineCall(Cell*) checking whether an operand can be
+ copied into a body freely: a variable or a constant. When pure
+ is set, calls of pure builtins on such operands are accepted too,
+ except for / which can report an error.
+*/
+static int isSimpleOperand(Cell* expression, int pure)
+{
+    if (expression == NULL || expression->mType != CELL_PLAIN) return 0;
+    if (expression->mSub == NULL) return expression->mSymbol != NULL;
+    if (isConstant(expression)) return 1;
+    if (!pure || expression->mSub->mSymbol == NULL || foldableArity(expression->mSub->mSymbol) < 0
+        || strcmp(expression->mSub->mSymbol, "/") == 0) return 0;
+    Cell* operand;
+    for (operand = expression->mNext; operand != NULL; operand = operand->mNext)
+        if (!isSimpleOperand(operand->mSub, 1)) return 0;
+    return 1;
+}
+
+/****************************************************************
+ Helper for inlineCall(Cell*) that copies a body which passed
+ isInlinable(...), putting the given operands in place of the
+ formal parameters. Quoted data is shared rather than copied.
+*/
+static Cell* substitute(Cell* expression, Cell* formals, Cell** operands)
+{
+    if (expression->mSub == NULL) return formalValue(expression, formals, operands);
+    if (isConstant(expression)) return expression;
+
+    Cell* copy = iniCell();
+    copy->mSub = expression->mSub;
+    Cell* tail = copy;
+    Cell* operand;
+    for (operand = expression->mNext; operand != NULL; operand = operand->mNext) {
+        tail->mNext = iniCell();
+        tail = tail->mNext;
+        Cell* part = operand->mSub;
+        if (strcmp(expression->mSub->mSymbol, "cond") == 0) {
+            Cell* test = part->mSub;
+            if (test->mSymbol == NULL || (strcmp(test->mSymbol, "else") != 0
+                                          && strcmp(test->mSymbol, "#t") != 0))
+                test = substitute(test, formals, operands);
+            tail->mSub = iniCell();
+            tail->mSub->mSub = test;
+            tail->mSub->mNext = iniCell();
+            tail->mSub->mNext->mSub = substitute(part->mNext->mSub, formals, operands);
+        } else tail->mSub = substitute(part, formals, operands);
+    }
+    return copy;
+}
+
+/****************************************************************
+ Helper for substitute(...) giving the operand for an atom that is
+ a formal parameter, or the atom itself for a constant.
+*/
+static Cell* formalValue(Cell* atom, Cell* formals, Cell** operands)
+{
+    int i = 0;
+    Cell* formal;
+    for (formal = formals; formal != NULL; formal = formal->mNext, i++)
+        if (equalCells(formal->mSub, atom)) return operands[i];
+    return atom;
+}
+
+/****************************************************************
+ isBuiltin(): See header file for documentation.
+*/
+int isBuiltin(char* sym)
+{
+    int i;
+    for (i = 0; mBuiltins[i] != NULL; i++)
+        if (strcmp(sym, mBuiltins[i]) == 0) return 1;
+    return 0;
+}
+
+/****************************************************************
+ Helper recording that the function being optimized inlined the
+ named one, along with everything the named one inlined itself.
+*/
+static void addInlined(Cell* name)
+{
+    Cell* names = iniLinkCell();
+    names->mSub = name;
+    names->mNext = hashGet(mInlined, name);
+    Cell* focus;
+    for (focus = names; focus != NULL; focus = focus->mNext) {
+        Cell* known;
+        for (known = mInlinedNow; known != NULL; known = known->mNext)
+            if (equalCells(known->mSub, focus->mSub)) break;
+        if (known != NULL) continue;
+        Cell* link = iniCell();
+        link->mSub = focus->mSub;
+        link->mNext = mInlinedNow;
+        mInlinedNow = link;
+    }
+    free(names);
+}
+
+/****************************************************************
+ Helper for expandSyntax(Cell*) that expands the uses of macros
+ within an expression, copying only the lists that changed, so
+ that shared quoted data are never touched. Quoted data, the rules
+ of define-syntax and the names that define, lambda and the let
+ forms bind are left as written. A use is replaced by its
+ expansion, which is expanded in turn.
+*/
+static Cell* expandMacros(Cell* expression)
+{
+    if (expression == NULL || expression->mType != CELL_PLAIN || expression->mSub == NULL)
+        return expression;
+    char* sym = expression->mSub->mSymbol;
+    if (sym == NULL) return expandItems(expression, 0, -1);
+    if (strcmp(sym, "quote") == 0 || strcmp(sym, "define-syntax") == 0) return expression;
+
+    Cell* definition = hashGet(mMacros, expression->mSub);
+    if (definition != NULL) {
+        if (mExpanding >= EXPANSION_LIMIT) {
+            reportError(sym, "macro expands too deeply");
+            return NULL;
+        }
+        Cell* expanded = expandUse(definition, expression);
+        if (expanded == NULL) return NULL;
+        mExpanding++;
+        expanded = expandMacros(expanded);
+        mExpanding--;
+        return expanded;
+    }
+
+    // The key given to assoc is taken as written
+    if (strcmp(sym, "define") == 0 || strcmp(sym, "define-memo") == 0
+        || strcmp(sym, "lambda") == 0 || strcmp(sym, "assoc") == 0)
+        return expandItems(expression, 2, -1);
+    if (strcmp(sym, "let") == 0 || strcmp(sym, "let*") == 0 || strcmp(sym, "letrec") == 0) {
+        // A named let has its name before the bindings
+        Cell* first = expression->mNext != NULL ? expression->mNext->mSub : NULL;
+        int named = strcmp(sym, "let") == 0 && first != NULL && first->mSub == NULL
+                    && first->mSymbol != NULL && strcmp(first->mSymbol, "()") != 0;
+        return expandItems(expression, named ? 3 : 2, named ? 2 : 1);
+    }
+    return expandItems(expression, 1, -1);
+}
+
+/****************************************************************
+ Helper for expandMacros(Cell*) that expands the members of a list
+ from the given position on, the first member being 0, except for
+ the member at the second position given, a list of bindings as
+ in let, whose values alone are expanded. Gives a new list when a
+ member changed, and NULL when an expansion failed.
+*/
+static Cell* expandItems(Cell* list, int first, int bindings)
+{
+    int count = 0;
+    Cell* item;
+    for (item = list; item != NULL; item = item->mNext)
+        count++;
+    Cell** expanded = malloc(sizeof(Cell*) * count);
+    int changed = 0;
+    int position = 0;
+    for (item = list; item != NULL; item = item->mNext, position++) {
+        Cell* part = item->mSub;
+        if (position == bindings) part = expandBindings(part);
+        else if (position >= first) part = expandMacros(part);
+        if (part == NULL && item->mSub != NULL) {
+            free(expanded);
+            return NULL;
+        }
+        if (part != item->mSub) changed = 1;
+        expanded[position] = part;
+    }
+    if (changed) list = buildList(expanded, count);
+    free(expanded);
+    return list;
+}
+
+/****************************************************************
+ Helper for expandItems(Cell*, int, int) that expands the values
+ of the bindings of a let form, as in ((x 1) (y 2)), leaving the
+ names alone.
+*/
+static Cell* expandBindings(Cell* bindings)
+{
+    if (bindings == NULL || bindings->mSub == NULL) return bindings;
+    int count = 0;
+    Cell* binding;
+    for (binding = bindings; binding != NULL; binding = binding->mNext)
+        count++;
+    Cell** expanded = malloc(sizeof(Cell*) * count);
+    int changed = 0;
+    int i = 0;
+    for (binding = bindings; binding != NULL; binding = binding->mNext, i++) {
+        Cell* part = binding->mSub;
+        if (part->mSub != NULL) part = expandItems(part, 1, -1);
+        if (part == NULL) {
+            free(expanded);
+            return NULL;
+        }
+        if (part != binding->mSub) changed = 1;
+        expanded[i] = part;
+    }
+    if (changed) bindings = buildList(expanded, count);
+    free(expanded);
+    return bindings;
+}
+
+/****************************************************************
+ Helper for expandMacros(Cell*) that expands one use of the macro
+ defined by the given form with the first of its rules whose
+ pattern matches the use. The keyword heading a pattern stands for
+ the name of the macro and is not matched. Variables that the
+ template binds with lambda or the let forms, other than pattern
+ variables, are renamed, with a number of their own for every
+ expansion, so that they cannot capture the variables of the code
+ given to the macro. Gives NULL after reporting a use that matches
+ no rule.
+*/
+static Cell* expandUse(Cell* definition, Cell* use)
+{
+    Cell* rules = definition->mNext->mNext->mSub;
+    mLiterals = rules->mNext->mSub;
+    Cell* rule;
+    for (rule = rules->mNext->mNext; rule != NULL; rule = rule->mNext) {
+        Cell* pattern = rule->mSub->mSub;
+        Binding* bindings = NULL;
+        if (!matchItems(pattern->mNext, use->mNext, &bindings)) {
+            freeBindings(bindings);
+            continue;
+        }
+        Cell* template = rule->mSub->mNext->mSub;
+        mExpansions++;
+        Binding* renames = renameBinders(template, pattern, NULL);
+        Cell* expanded = instantiate(template, bindings, renames);
+        freeBindings(bindings);
+        freeBindings(renames);
+        return expanded;
+    }
+    reportError(use->mSub->mSymbol, "no syntax rule matches");
+    return NULL;
+}
+
+/****************************************************************
+ Helper for expandUse(Cell*, Cell*) that matches the members of a
+ list pattern, given from its first cons cell on, against those of
+ a form, adding what its pattern variables matched to the given
+ bindings. A member followed by "..." matches as many forms as the
+ members after it leave over.
+*/
+static int matchItems(Cell* patterns, Cell* forms, Binding** bindings)
+{
+    while (patterns != NULL) {
+        Cell* next = patterns->mNext;
+        if (next != NULL && isEllipsis(next->mSub)) {
+            int count = 0;
+            Cell* focus;
+            for (focus = forms; focus != NULL; focus = focus->mNext)
+                count++;
+            for (focus = next->mNext; focus != NULL; focus = focus->mNext)
+                count--;
+            if (count < 0) return 0;
+            Binding* group = calloc(1, sizeof(Binding));
+            group->mPattern = patterns->mSub;
+            group->mRepeats = malloc(sizeof(Binding*) * (count > 0 ? count : 1));
+            group->mNextBinding = *bindings;
+            *bindings = group;
+            int i;
+            for (i = 0; i < count; i++, forms = forms->mNext) {
+                group->mRepeats[i] = NULL;
+                group->mCount = i + 1;
+                if (!matchDatum(patterns->mSub, forms->mSub, &group->mRepeats[i])) return 0;
+            }
+            patterns = next->mNext;
+            continue;
+        }
+        if (forms == NULL || !matchDatum(patterns->mSub, forms->mSub, bindings)) return 0;
+        patterns = next;
+        forms = forms->mNext;
+    }
+    return forms == NULL;
+}
+
+/****************************************************************
+ Helper for matchItems(Cell*, Cell*, Binding**) that matches a
+ single pattern against a form. A pattern variable matches any
+ form and "_" matches any form without binding it, while literals
+ and constants match only themselves. A list pattern matches a
+ list, the empty one included.
+*/
+static int matchDatum(Cell* pattern, Cell* form, Binding** bindings)
+{
+    if (pattern->mSub == NULL) {
+        if (strcmp(pattern->mSymbol, "_") == 0) return 1;
+        if (isPatternVariable(pattern)) {
+            Binding* binding = calloc(1, sizeof(Binding));
+            binding->mVariable = pattern;
+            binding->mValue = form;
+            binding->mNextBinding = *bindings;
+            *bindings = binding;
+            return 1;
+        }
+        return form->mSub == NULL && form->mSymbol != NULL && strcmp(form->mSymbol, pattern->mSymbol) == 0;
+    }
+    if (form->mSub != NULL) return form->mType == CELL_PLAIN && matchItems(pattern, form, bindings);
+    return form->mSymbol != NULL && strcmp(form->mSymbol, "()") == 0 && matchItems(pattern, NULL, bindings);
+}
+
+/****************************************************************
+ Helper checking whether an atom of a syntax rule is a pattern
+ variable, rather than a literal of the macro being expanded, a
+ constant such as a number, #t or a string, "_" or "...".
+*/
+static int isPatternVariable(Cell* atom)
+{
+    if (atom->mSub != NULL || atom->mSymbol == NULL || atom->mType != CELL_PLAIN) return 0;
+    char* sym = atom->mSymbol;
+    if (isEllipsis(atom) || strcmp(sym, "_") == 0 || strcmp(sym, "()") == 0
+        || strcmp(sym, "#t") == 0 || strcmp(sym, "#f") == 0 || sym[0] == '"') return 0;
+    Cell* literal;
+    for (literal = mLiterals->mSub != NULL ? mLiterals : NULL; literal != NULL; literal = literal->mNext)
+        if (strcmp(literal->mSub->mSymbol, sym) == 0) return 0;
+    return 1;
+}
+
+/****************************************************************
+ Helper checking whether a member of a syntax rule is "...".
+*/
+static int isEllipsis(Cell* cell)
+{
+    return cell != NULL && cell->mSub == NULL && cell->mSymbol != NULL
+           && strcmp(cell->mSymbol, "...") == 0;
+}
+
+/****************************************************************
+ Helper checking whether the given atom is a pattern variable
+ anywhere within the given pattern.
+*/
+static int mentionsVariable(Cell* pattern, Cell* atom)
+{
+    if (pattern->mSub == NULL)
+        return isPatternVariable(pattern) && strcmp(pattern->mSymbol, atom->mSymbol) == 0;
+    Cell* item;
+    for (item = pattern; item != NULL; item = item->mNext)
+        if (mentionsVariable(item->mSub, atom)) return 1;
+    return 0;
+}
+
+/****************************************************************
+ Helper giving the nearest binding of the given atom, either what
+ it matched or the group of repetitions it matched within, or NULL
+ when it is no pattern variable.
+*/
+static Binding* findBinding(Cell* atom, Binding* bindings)
+{
+    if (atom->mSymbol == NULL) return NULL;
+    for (; bindings != NULL; bindings = bindings->mNextBinding) {
+        if (bindings->mVariable == NULL) {
+            if (mentionsVariable(bindings->mPattern, atom)) return bindings;
+        } else if (strcmp(bindings->mVariable->mSymbol, atom->mSymbol) == 0) return bindings;
+    }
+    return NULL;
+}
+
+/****************************************************************
+ Helper for expandUse(Cell*, Cell*) that builds the expansion from
+ a template, putting what each pattern variable matched in its
+ place and the new name of each renamed variable in place of the
+ old, except within quoted data. A member followed by "..." is
+ repeated for every repetition its pattern variables matched.
+ Gives NULL after reporting a template that does not fit its
+ pattern.
+*/
+static Cell* instantiate(Cell* template, Binding* bindings, Binding* renames)
+{
+    if (template->mSub == NULL) {
+        Binding* bound = findBinding(template, bindings);
+        if (bound != NULL && bound->mVariable == NULL) {
+            reportError("syntax-rules", "pattern variable used without an ellipsis");
+            return NULL;
+        }
+        if (bound == NULL) bound = findBinding(template, renames);
+        return bound != NULL ? bound->mValue : template;
+    }
+
+    if (template->mSub->mSymbol != NULL && strcmp(template->mSub->mSymbol, "quote") == 0)
+        renames = NULL;
+    Cell start;
+    start.mNext = NULL;
+    Cell* tail = &start;
+    Cell* item;
+    for (item = template; item != NULL; item = item->mNext) {
+        if (item->mNext != NULL && isEllipsis(item->mNext->mSub)) {
+            if (!repeatTemplate(item->mSub, bindings, renames, &tail)) return NULL;
+            item = item->mNext;
+            continue;
+        }
+        Cell* part = instantiate(item->mSub, bindings, renames);
+        if (part == NULL) return NULL;
+        tail->mNext = iniCell();
+        tail = tail->mNext;
+        tail->mSub = part;
+    }
+    if (start.mNext != NULL) return start.mNext;
+    // Nothing repeated leaves the empty list
+    Cell* empty = iniCell();
+    empty->mSymbol = internSymbol("()");
+    return empty;
+}
+
+/****************************************************************
+ Helper for instantiate(Cell*, Binding*, Binding*) that adds a
+ copy of a template after the given tail for every repetition of
+ the groups its pattern variables belong to, with the bindings of
+ that repetition put before the others.
+*/
+static int repeatTemplate(Cell* template, Binding* bindings, Binding* renames, Cell** tail)
+{
+    int count = -1;
+    Binding* group;
+    for (group = bindings; group != NULL; group = group->mNextBinding) {
+        if (group->mVariable != NULL || !repeatsGroup(template, group, bindings)) continue;
+        if (count != -1 && group->mCount != count) {
+            reportError("syntax-rules", "repeated pattern variables differ in length");
+            return 0;
+        }
+        count = group->mCount;
+    }
+    if (count == -1) {
+        reportError("syntax-rules", "no pattern variable to repeat before an ellipsis");
+        return 0;
+    }
+
+    int i;
+    for (i = 0; i < count; i++) {
+        Binding* scope = bindings;
+        for (group = bindings; group != NULL; group = group->mNextBinding) {
+            if (group->mVariable != NULL || !repeatsGroup(template, group, bindings)) continue;
+            Binding* binding;
+            for (binding = group->mRepeats[i]; binding != NULL; binding = binding->mNextBinding) {
+                Binding* copy = malloc(sizeof(Binding));
+                *copy = *binding;
+                copy->mNextBinding = scope;
+                scope = copy;
+            }
+        }
+        Cell* part = instantiate(template, scope, renames);
+        while (scope != bindings) {
+            Binding* next = scope->mNextBinding;
+            free(scope);
+            scope = next;
+        }
+        if (part == NULL) return 0;
+        (*tail)->mNext = iniCell();
+        *tail = (*tail)->mNext;
+        (*tail)->mSub = part;
+    }
+    return 1;
+}
+
+/****************************************************************
+ Helper for repeatTemplate(Cell*, Binding*, Binding*, Cell**)
+ checking whether a pattern variable of the template is bound by
+ the given group of repetitions.
+*/
+static int repeatsGroup(Cell* template, Binding* group, Binding* bindings)
+{
+    if (template->mSub == NULL) return findBinding(template, bindings) == group;
+    Cell* item;
+    for (item = template; item != NULL; item = item->mNext)
+        if (repeatsGroup(item->mSub, group, bindings)) return 1;
+    return 0;
+}
+
+/****************************************************************
+ Helper for expandUse(Cell*, Cell*) that gives a new name to every
+ variable a template binds with lambda, let, let* or letrec, or
+ names a named let with, adding them to the given renames.
+*/
+static Binding* renameBinders(Cell* template, Cell* pattern, Binding* renames)
+{
+    if (template->mSub == NULL) return renames;
+    char* sym = template->mSub->mSymbol;
+    if (sym != NULL && strcmp(sym, "quote") == 0) return renames;
+    if (sym != NULL && template->mNext != NULL) {
+        Cell* bound = template->mNext->mSub;
+        Cell* focus;
+        if (strcmp(sym, "lambda") == 0) {
+            if (bound->mSub == NULL) renames = renameBinder(bound, pattern, renames);
+            else for (focus = bound; focus != NULL; focus = focus->mNext)
+                renames = renameBinder(focus->mSub, pattern, renames);
+        } else if (strcmp(sym, "let") == 0 || strcmp(sym, "let*") == 0 || strcmp(sym, "letrec") == 0) {
+            if (strcmp(sym, "let") == 0 && bound->mSub == NULL && strcmp(bound->mSymbol, "()") != 0
+                && template->mNext->mNext != NULL) {
+                renames = renameBinder(bound, pattern, renames);
+                bound = template->mNext->mNext->mSub;
+            }
+            for (focus = bound->mSub != NULL ? bound : NULL; focus != NULL; focus = focus->mNext)
+                if (focus->mSub->mSub != NULL) renames = renameBinder(focus->mSub->mSub, pattern, renames);
+        }
+    }
+    Cell* item;
+    for (item = template; item != NULL; item = item->mNext)
+        renames = renameBinders(item->mSub, pattern, renames);
+    return renames;
+}
+
+/****************************************************************
+ Helper for renameBinders(Cell*, Cell*, Binding*) that renames one
+ bound variable, as in t%3 for t in the third expansion of the
+ input, unless it is a pattern variable or already renamed.
+*/
+static Binding* renameBinder(Cell* atom, Cell* pattern, Binding* renames)
+{
+    if (atom->mSub != NULL || atom->mSymbol == NULL || atom->mType != CELL_PLAIN
+        || isEllipsis(atom) || strcmp(atom->mSymbol, "()") == 0
+        || mentionsVariable(pattern, atom) || findBinding(atom, renames) != NULL)
+        return renames;
+    char* name = malloc(strlen(atom->mSymbol) + 24);
+    sprintf(name, "%s%%%d", atom->mSymbol, mExpansions);
+    Binding* rename = calloc(1, sizeof(Binding));
+    rename->mVariable = atom;
+    rename->mValue = iniCell();
+    rename->mValue->mSymbol = internSymbol(name);
+    rename->mNextBinding = renames;
+    free(name);
+    return rename;
+}
+
+/****************************************************************
+ Helper freeing bindings along with the repetitions they hold.
+*/
+static void freeBindings(Binding* bindings)
+{
+    while (bindings != NULL) {
+        Binding* next = bindings->mNextBinding;
+        int i;
+        for (i = 0; i < bindings->mCount; i++)
+            freeBindings(bindings->mRepeats[i]);
+        free(bindings->mRepeats);
+        free(bindings);
+        bindings = next;
+    }
+}
+
+/****************************************************************
+ Helper for eval(List*) to recursively evaluate the structure of
+ the List given to eval(List*).
+*/
+static List* recurse_eval(Cell* cell, List* environment)
+{
+    // Detect a symbol in the cell below the current in focus
+    // and check if the symbol matches a supported function.
+    // After a match with the list of if/else comparisons
+    // below, the corresponding function is called with
+    // a recursive evaluation of the presumed next parameters
+    // passed in, and where a function is only given the current
+    // cell, the recursion is handled specially within the function
+    List* list = NULL;
+    int atomBelow = 0;
+    if (mMetering) {
+        if (cell != mBudgetedCall) return budgetedEval(cell, environment);
+        mBudgetedCall = NULL;
+    }
+    if (mProfiling) {
+        if (cell != mProfiledCall && cell->mSub != NULL && cell->mSub->mSymbol != NULL)
+            return profiledCall(cell, environment);
+        mProfiledCall = NULL;
+    }
+    if (cell->mSub != NULL) {
+        char* sym = cell->mSub->mSymbol;
+        // Drop a level since no function yet
+        if (sym == NULL) {
+            list = recurse_eval(cell->mSub, environment);
+            // Apply a procedure made on the spot, as in ((lambda (x) x) 1)
+            if (list != NULL && list->mStructure != NULL && list->mStructure->mType == CELL_CLOSURE)
+                return callClosure(list->mStructure, cell, environment);
+        // No need to recurse further if found a quote
+        } else if (strcmp(sym, "quote") == 0) {
+            list = allocate(sizeof(List));
+            if (cell->mNext->mSub->mSub == NULL) list->mStructure = cell->mNext->mSub;
+            else list->mStructure = cell->mNext->mSub;
+            return quote(list);
+            // Guide recursion down specific branch for cons params
+        } else if (strcmp(sym, "cons") == 0) {
+            return cons(recurse_eval(cell->mNext->mSub, environment), recurse_eval(cell->mNext->mNext->mSub, environment));
+            // Recurse evaluate car function's param
+        } else if (strcmp(sym, "list") == 0) {
+            return makeList(cell, environment);
+        } else if (strcmp(sym, "last") == 0) {
+            return last(recurse_eval(cell->mNext->mSub, environment));
+        } else if (strcmp(sym, "length") == 0) {
+            return length(recurse_eval(cell->mNext->mSub, environment));
+        } else if (strcmp(sym, "+") == 0) {
+            return add(cell, environment);
+        } else if (strcmp(sym, "-") == 0) {
+            return subtract(cell, environment);
+        } else if (strcmp(sym, "*") == 0) {
+            return multiply(cell, environment);
+        } else if (strcmp(sym, "/") == 0) {
+            return divide(cell, environment);
+        } else if ((strcmp(sym, "AND") == 0) || (strcmp(sym, "and") == 0)) {
+            return logicAnd(cell, environment);
+        } else if ((strcmp(sym, "OR") == 0) || (strcmp(sym, "or") == 0)) {
+            return logicOr(cell, environment);
+        } else if ((strcmp(sym, "NOT") == 0) || (strcmp(sym, "not") == 0)) {
+            return logicNot(recurse_eval(cell->mNext->mSub, environment));
+        } else if (strcmp(sym, "<") == 0) {
+            return lessThan(recurse_eval(cell->mNext->mSub, environment), recurse_eval(cell->mNext->mNext->mSub, environment));
+        } else if (strcmp(sym, ">") == 0) {
+            return greaterThan(recurse_eval(cell->mNext->mSub, environment), recurse_eval(cell->mNext->mNext->mSub, environment));
+        } else if (strcmp(sym, "<=") == 0) {
+            return lessThanOrEqualTo(recurse_eval(cell->mNext->mSub, environment), recurse_eval(cell->mNext->mNext->mSub, environment));
+        } else if (strcmp(sym, ">=") == 0) {
+            return greaterThanOrEqualTo(recurse_eval(cell->mNext->mSub, environment), recurse_eval(cell->mNext->mNext->mSub, environment));
+        } else if (strcmp(sym, "car") == 0) {
+            return car(recurse_eval(cell->mNext->mSub, environment));
+        // Recurse evaluate cdr function's param
+        } else if (strcmp(sym, "cdr") == 0) {
+            return cdr(recurse_eval(cell->mNext->mSub, environment));
+        } else if (strcmp(sym, "cadr") == 0) {
+            return cadr(recurse_eval(cell->mNext->mSub, environment));
+        } else if (strcmp(sym, "caddr") == 0) {
+            return caddr(recurse_eval(cell->mNext->mSub, environment));
+        } else if (strcmp(sym, "cadddr") == 0) {
+            return cadddr(recurse_eval(cell->mNext->mSub, environment));
+        } else if (strcmp(sym, "caddddr") == 0) {
+            return caddddr(recurse_eval(cell->mNext->mSub, environment));
+        } else if (strcmp(sym, "cdar") == 0) {
+            return cdar(recurse_eval(cell->mNext->mSub, environment));
+        // Recurse evaluate symbol? function's param
+        } else if (strcmp(sym, "symbol?") == 0) {
+            return isSymbol(recurse_eval(cell->mNext->mSub, environment));
+        } else if (strcmp(sym, "append") == 0) {
+            return append(recurse_eval(cell->mNext->mSub, environment), recurse_eval(cell->mNext->mNext->mSub, environment));
+        } else if (strcmp(sym,  "null?") == 0) {
+            return isNull(recurse_eval(cell->mNext->mSub, environment));
+        } else if (strcmp(sym, "equal?") == 0) {
+            return isEqual(recurse_eval(cell->mNext->mSub, environment), recurse_eval(cell->mNext->mNext->mSub, environment));
+        } else if (strcmp(sym, "define-memo") == 0) {
+            return defineMemo(cell, environment);
+        } else if (strcmp(sym, "memoize") == 0) {
+            return memoize(cell, environment);
+        } else if (strcmp(sym, "memo-stats") == 0) {
+            return memoStats(recurse_eval(cell->mNext->mSub, environment));
+        } else if (strcmp(sym, "result-cache-stats") == 0) {
+            return resultCacheStats();
+        } else if (strcmp(sym, "memory-stats") == 0) {
+            return memoryStats();
+        } else if (strcmp(sym, "heap-snapshot") == 0) {
+            return heapSnapshot();
+        } else if (strcmp(sym, "profile-start") == 0) {
+            // Starting again forgets the previous profile
+            mProfiling = 0;
+            setProfiling(1);
+            return NULL;
+        } else if (strcmp(sym, "profile-stop") == 0) {
+            setProfiling(0);
+            return NULL;
+        } else if (strcmp(sym, "profile-report") == 0) {
+            return profileReportOf(cell);
+        } else if (strcmp(sym, "save-image") == 0) {
+            return saveImage(cell, environment);
+        } else if (strcmp(sym, "load") == 0) {
+            return load(cell, environment);
+        } else if (strcmp(sym, "load-data") == 0) {
+            return loadData(cell, environment);
+        } else if (strcmp(sym, "define-syntax") == 0) {
+            return defineSyntax(cell);
+        } else if (strcmp(sym, "define") == 0) {
+            // Define either as a variable or a function, leaving the
+            // name and formal parameters unevaluated
+            List* key = wrapStructure(cell->mNext->mSub);
+            if (key->mStructure->mSub == NULL) {
+                List* value = recurse_eval(cell->mNext->mNext->mSub, environment);
+                List* enviro = define(key, value, environment);
+                // Update the global environment at first level of recursion
+                if (environment == mAssocVars) {
+                    mAssocVars = enviro;
+                    invalidateReaders(key->mStructure);
+                    noteVolatile(key->mStructure, value->mStructure);
+                }
+                // Don't print anything - just defining
+                return NULL;
+            } else return defineFunction(key, wrapStructure(cell->mNext->mNext->mSub));
+            //return define(recurse_eval(cell->mNext->mSub), recurse_eval(cell->mNext->mNext->mSub));
+        } else if (strcmp(sym, "lambda") == 0) {
+            return lambda(cell, environment);
+        } else if (strcmp(sym, "let") == 0) {
+            return let(cell, environment);
+        } else if (strcmp(sym, "let*") == 0) {
+            return letStar(cell, environment);
+        } else if (strcmp(sym, "letrec") == 0) {
+            return letrec(cell, environment);
+        } else if (strcmp(sym, "assoc") == 0) {
+            return assoc(cell->mNext->mSub->mNext, recurse_eval(cell->mNext->mNext->mSub, environment));
+        } else if (strcmp(sym, "cond") == 0) {
+            return cond(cell, environment);
+        } else if (strcmp(sym, "if") == 0) {
+            return alternateIf(cell, environment);
+        } else if (strcmp(sym, "number?") == 0) {
+            return isNumber(recurse_eval(cell->mNext->mSub, environment));
+        } else if (strcmp(sym, "list?") == 0) {
+            return isList(recurse_eval(cell->mNext->mSub, environment));
+        } else if (strcmp(sym, "make-vector") == 0) {
+            return makeVector(cell, environment);
+        } else if (strcmp(sym, "vector") == 0) {
+            return vector(cell, environment);
+        } else if (strcmp(sym, "vector-ref") == 0) {
+            return vectorRef(recurse_eval(cell->mNext->mSub, environment), recurse_eval(cell->mNext->mNext->mSub, environment));
+        } else if (strcmp(sym, "vector-set!") == 0) {
+            return vectorSet(recurse_eval(cell->mNext->mSub, environment), recurse_eval(cell->mNext->mNext->mSub, environment),
+                             recurse_eval(cell->mNext->mNext->mNext->mSub, environment));
+        } else if (strcmp(sym, "vector-length") == 0) {
+            return vectorLength(recurse_eval(cell->mNext->mSub, environment));
+        } else if (strcmp(sym, "list->vector") == 0) {
+            return listToVector(recurse_eval(cell->mNext->mSub, environment));
+        } else if (strcmp(sym, "vector->list") == 0) {
+            return vectorToList(recurse_eval(cell->mNext->mSub, environment));
+        } else if (strcmp(sym, "make-hash-table") == 0) {
+            return makeHashTable();
+        } else if (strcmp(sym, "hash-ref") == 0) {
+            return hashRef(cell, environment);
+        } else if (strcmp(sym, "hash-set!") == 0) {
+            return hashSet(recurse_eval(cell->mNext->mSub, environment), recurse_eval(cell->mNext->mNext->mSub, environment),
+                           recurse_eval(cell->mNext->mNext->mNext->mSub, environment));
+        } else if (strcmp(sym, "hash-remove!") == 0) {
+            return hashRemoveKey(recurse_eval(cell->mNext->mSub, environment), recurse_eval(cell->mNext->mNext->mSub, environment));
+        } else if (strcmp(sym, "hash-count") == 0) {
+            return hashCount(recurse_eval(cell->mNext->mSub, environment));
+        } else if (strcmp(sym, "hash-keys") == 0) {
+            return hashKeys(recurse_eval(cell->mNext->mSub, environment));
+        } else if (strcmp(sym, "map") == 0) {
+            return map(cell, environment);
+        } else if (strcmp(sym, "filter") == 0) {
+            return filter(cell, environment);
+        } else if (strcmp(sym, "fold") == 0) {
+            return fold(cell, environment);
+        } else if (strcmp(sym, "for-each") == 0) {
+            return forEach(cell, environment);
+        } else if (strcmp(sym, "apply") == 0) {
+            return apply(cell, environment);
+        } else if (strcmp(sym, "sort") == 0) {
+            return sort(cell, environment);
+        } else if (strcmp(sym, "delay") == 0) {
+            return delay(cell, environment);
+        } else if (strcmp(sym, "force") == 0) {
+            return force(recurse_eval(cell->mNext->mSub, environment));
+        } else if (strcmp(sym, "cons-stream") == 0) {
+            return consStream(cell, environment);
+        } else if (strcmp(sym, "stream-car") == 0) {
+            return streamCar(recurse_eval(cell->mNext->mSub, environment));
+        } else if (strcmp(sym, "stream-cdr") == 0) {
+            return streamCdr(recurse_eval(cell->mNext->mSub, environment));
+        } else if (strcmp(sym, "stream-map") == 0) {
+            return streamMap(cell, environment);
+        } else if (strcmp(sym, "stream-filter") == 0) {
+            return streamFilter(cell, environment);
+        } else if (strcmp(sym, "stream-take") == 0) {
+            return streamTake(recurse_eval(cell->mNext->mSub, environment), recurse_eval(cell->mNext->mNext->mSub, environment));
+        } else if (strcmp(sym, "stream->list") == 0) {
+            return streamToList(recurse_eval(cell->mNext->mSub, environment));
+        } else if (strcmp(sym, "min") == 0) {
+            return minimum(cell, environment);
+        } else if (strcmp(sym, "max") == 0) {
+            return maximum(cell, environment);
+        } else if ((strcmp(sym, "vector-sum") == 0) || (strcmp(sym, "vector-product") == 0)
+                   || (strcmp(sym, "vector-min") == 0) || (strcmp(sym, "vector-max") == 0)) {
+            return vectorReduce(sym, recurse_eval(cell->mNext->mSub, environment));
+        } else if (strcmp(sym, "vector-dot") == 0) {
+            return vectorDot(recurse_eval(cell->mNext->mSub, environment), recurse_eval(cell->mNext->mNext->mSub, environment));
+        } else if (strcmp(sym, "vector-map+") == 0) {
+            return vectorAdd(recurse_eval(cell->mNext->mSub, environment), recurse_eval(cell->mNext->mNext->mSub, environment));
+        } else if (strcmp(sym, "vector-scale") == 0) {
+            return vectorScale(recurse_eval(cell->mNext->mSub, environment), recurse_eval(cell->mNext->mNext->mSub, environment));
+            // Atom symbol found below current cell
+        } else atomBelow = 1;
+        // This case occurs during raw symbols not in a list
+    } else if (cell->mSymbol != NULL){
+        // Try to associate the symbol
+        List* value = variableOf(cell, environment);
+        if (value != NULL) return value;
+        // A read of a frame names the variable it reads
+        if (cell->mType == CELL_SLOT) return wrapStructure(slotName(cell, environment));
+        return wrapStructure(cell);
+    }
+    // Recurse right then update last cell seen coming back left
+    if (cell->mNext != NULL) {
+        list = recurse_eval(cell->mNext, environment);
+        list->mStructure = cell;
+    } else {
+        // Found a deep end of structure so go back up
+        list = allocate(sizeof(List));
+        list->mStructure = cell;
+    }
+
+    // Found an atom before evaluating deeper so try to associate when returning from recursion
+    if (atomBelow == 1) {
+        list = assocForFn(cell);
+
+        // Different cell returned means a function was matched
+        if (list->mStructure != cell && (list->mStructure->mData != NULL
+                                         || list->mStructure->mNext->mSub->mType == CELL_NATIVE)) {
+            // Memoized functions evaluate their parameters up front
+            // to look for a cached result, as compiled functions
+            // take them in an array
+            Cell* definition = list->mStructure;
+            int count = 0;
+            Cell* param;
+            for (param = cell->mNext; param != NULL; param = param->mNext)
+                count++;
+            // A parameter is read for each formal, to key the cache,
+            // bind it or hand it to the compiled code
+            if (count < countFormals(definition->mSub->mNext))
+                return reportError(cell->mSub->mSymbol, "too few parameters");
+            Cell** args = malloc(sizeof(Cell*) * (count > 0 ? count : 1));
+            int i = 0;
+            for (param = cell->mNext; param != NULL; param = param->mNext)
+                args[i++] = recurse_eval(param->mSub, environment)->mStructure;
+            list = applyDefinition(definition->mSub->mNext, definition->mNext->mSub,
+                                   definition->mData, args);
+            free(args);
+        } else if (list->mStructure != cell) {
+            // Extract the formal params
+            List* formalParams = cdr(wrapStructure(list->mStructure->mSub));
+            List* actualParams = cdr(wrapStructure(cell));
+
+            // Generate local environment from user's definition and bind params
+            List* localEnv = iniAssocList();
+            localEnv = bindLocals(formalParams, actualParams, localEnv, environment);
+
+            list = recurse_eval((car(cdr(list)))->mStructure, localEnv);
+        } else {
+            // Symbol was not a function so try to identify as a
+            // variable, which may hold a closure to call
+            Cell* bound = lookupVariable(cell->mSub, environment);
+            if (bound != NULL && bound->mType == CELL_CLOSURE)
+                list = callClosure(bound, cell, environment);
+            else list = assocForVar(cell, environment);
+        }
+    }
+    return list;
+}
+
+/****************************************************************
+ Helper that binds a list of formal parameters with a list of
+ actual parameters for a given environment. This function is
+ meant to be used during evaluation of user defined functions.
+*/
+static List* bindLocals(List* formalParams, List* actualParams, List* newEnviro, List* oldEnviro)
+{
+    Cell* focus = formalParams->mStructure;
+    Cell* param = actualParams->mStructure;
+
+    while (focus != NULL) {
+        // Fill the new environment with the new parameters
+        newEnviro = define(wrapStructure(focus->mSub), recurse_eval(param->mSub, oldEnviro), newEnviro);
+        // Move on to next parameter
+        focus = focus->mNext;
+        param = param->mNext;
+    }
+    return newEnviro;
+}
+
+/****************************************************************
+ Essentially a call to assoc(Cell*, List*) but specifically
+ associates with the assumption that the first of the pair
+ is not a list. This function modifies the output list from
+ assoc(Cell*, List*) such that not finding a match returns the
+ given Cell instead of #f and only the value is returned without
+ the identifier.
+*/
+static List* assocForVar(Cell* cell, List* environment)
+{
+    List* value = variableOf(cell->mSub == NULL ? cell : cell->mSub, environment);
+    // Return original cell if no association found
+    if (value == NULL) return wrapStructure(cell);
+    return value;
+}
+
+/****************************************************************
+ Resolves the function named at the given call site, giving its
+ definition or the given Cell when the name is not a function. The
+ answer is kept in an inline cache on the call site (see CallCache)
+ so that calling from the same place again skips the lookup.
+*/
+static List* assocForFn(Cell* cell)
+{
+    CallCache* cache = cell->mData;
+    if (cache != NULL && cache->mVersion == mFunctionsVersion) {
+        if (mRecording) noteRead(cell->mSub);
+    } else {
+        if (cache == NULL) {
+            cache = allocate(sizeof(CallCache));
+            cell->mData = cache;
+        }
+        cache->mDefinition = lookupFunction(cell->mSub);
+        cache->mVersion = mFunctionsVersion;
+    }
+    // Return original cell if no function found
+    if (cache->mDefinition == NULL) return wrapStructure(cell);
+    return wrapStructure(cache->mDefinition);
+}
+
+/****************************************************************
+ Helper that finds the current definition of the user defined
+ function of the given name in the function table, or NULL when
+ there is none.
+*/
+static Cell* lookupFunction(Cell* symbol)
+{
+    if (symbol == NULL || symbol->mSymbol == NULL) return NULL;
+    // Results read from globals depend on their bindings
+    if (mRecording) noteRead(symbol);
+    return hashGet(mFunctions, symbol);
+}
+
+/****************************************************************
+ Helper function for recurse_eval(Cell*) for quoting params
+ during evaluation.
+*/
+static List* quote(List* list)
+{
+    return list;
+}
+
+/****************************************************************
+ Helper function for recurse_eval(Cell*) for taking the first
+ element of a given List during evaluation.
+*/
+static List* car(List* list)
+{
+    list->mStructure = forceData(forceData(list->mStructure)->mSub);
+    return list;
+}
+
+/****************************************************************
+ Helper function for recurse_eval(Cell*) for taking everything
+ but the first element in a List during evaluation.
+*/
+static List* cdr(List* list)
+{
+    if (forceData(list->mStructure)->mNext != NULL)
+        list->mStructure = list->mStructure->mNext;
+        // When there is nothing else in the list, return an empty list / #f
+    else list->mStructure = iniCell();
+    return list;
+}
+
+/****************************************************************
+ Helper function for recurse_eval(Cell*) for checking whether or
+ not the given List is a #t or #f (represented by the
+ empty list "()") as a symbol during evaluation. The returned
+ List pointer references a Cell which is itself either the
+ global TRUE or FALSE "constant" Cell.
+*/
+static List* isSymbol(List* list)
+{
+    Cell* s = list->mStructure;
+    if (s->mSymbol != NULL) return wrapStructure(TRUE);
+    else return wrapStructure(FALSE);
+}
+
+/****************************************************************
+ Helper function for recurse_eval(Cell*) that inserts the first
+ List as the first element of the second List.
+*/
+static List* cons(List* la, List* lb)
+{
+    Cell* host = iniCellAt(SITE_CONS);
+
+    // Check if list is #f (the empty list convention)
+    Cell* shell = lb->mStructure;
+    if ((shell->mSub != NULL) && (shell->mSub->mSymbol != NULL)
+        && (strcmp(shell->mSub->mSymbol, "#f") == 0)) {
+        host->mSub = iniCellAt(SITE_CONS);
+        host->mSub->mSub = la->mStructure;
+    } else {
+        // Normal case consing
+        host->mNext = shell;
+        host->mSub = la->mStructure;
+    }
+    return wrapStructureAt(host, SITE_CONS);
+}
+
+/****************************************************************
+ Helper function for recurse_eval(Cell*) that checks whether or
+ not the given List resolves to null ("#f").
+*/
+static List* isNull(List* list)
+{
+    Cell* cell = list->mStructure;
+
+    // Evaluated #t
+    if (cell == TRUE || (cell->mSymbol != NULL && strcmp(cell->mSymbol, "#t") == 0)) return wrapStructure(FALSE);
+        // Explicit #f encountered
+    else if (cell == FALSE || (cell != NULL && cell->mSymbol != NULL
+             && (strcmp(cell->mSymbol, "#f") == 0)))
+        return wrapStructure(TRUE);
+        // Normal case list
+    else if (cell != NULL) {
+        if (isEmptyStructure(cell) == 1) return wrapStructure(TRUE);
+        else return wrapStructure(FALSE);
+        // In case of a NULL cell structure in List
+    } else return wrapStructure(TRUE);
+
+}
+
+/****************************************************************
+ Helper function for isNull(List*) to recursively search a
+ cell structure if it's empty or not (void of symbols).
+*/
+static int isEmptyStructure(Cell* cell)
+{
+    // Native data such as a vector is never empty
+    if (cell->mType != CELL_PLAIN) return 0;
+    // Ignore special symbols
     if (cell->mSymbol != NULL
         && strcmp(cell->mSymbol, "quote") != 0
         && strcmp(cell->mSymbol, "()") != 0
@@ -448,555 +2583,3121 @@ static int isEmptyStructure(Cell* cell)
 }
 
 /****************************************************************
- Helper function for recurse_eval(Cell*) that checks a given List
- for a name value pair that matches the given identifying name.
- The pair is returned - both name and value. This function should
- never return a List* whose mStructure is NULL.
+ Helper function for recurse_eval(Cell*) that checks a given List
+ for a name value pair that matches the given identifying name.
+ The pair is returned - both name and value. This function should
+ never return a List* whose mStructure is NULL.
+*/
+static List* assoc(Cell* symbolParent, List* assocList)
+{
+    // Assoc list is empty so end early
+    if (assocList->mStructure == NULL) return wrapStructure(symbolParent);
+
+    // Search the immediate give Cell if it's lone (missing a sub branch)
+    Cell* symbol = symbolParent->mSub == NULL ? symbolParent : symbolParent->mSub;
+    // Results read from globals depend on their bindings
+    if (mRecording && assocList == mAssocVars) noteRead(symbol);
+    Cell* found = findAssoc(symbol, assocList->mStructure);
+
+    // Return any match, or #f, synonymous to the empty list ()
+    return wrapStructureAt(found != NULL ? found : mNoMatch, SITE_ASSOC);
+}
+
+/****************************************************************
+ Helper function for assoc(Cell*, List*) that recursively
+ scans the association list in assoc(Cell*, List*) for a match.
+*/
+static Cell* findAssoc(Cell* symbol, Cell* pair)
+{
+    // Bail out early if NULL (in the case that the cell itself contains #f or empty list)
+    if (pair->mSub == NULL) {
+        return NULL;
+    }
+
+    if (bindsSymbol(pair, symbol)) {
+        return pair->mSub;
+    } else if (pair->mNext != NULL) {
+        return findAssoc(symbol, pair->mNext);
+    } else return NULL;
+}
+
+/****************************************************************
+ Helper for findAssoc(Cell*, Cell*) checking whether the given
+ member of an association list pairs the given symbol.
+*/
+static int bindsSymbol(Cell* pair, Cell* symbol)
+{
+    // Find the lowest Cell* with a symbol, parsing lazy data on the way
+    Cell* focus = pair;
+    while (focus->mSub != NULL)
+        focus = forceData(focus->mSub);
+
+    // Interned symbols usually match by reference alone
+    return focus != pair && focus->mSymbol != NULL
+           && (focus->mSymbol == symbol->mSymbol || strcmp(symbol->mSymbol, focus->mSymbol) == 0);
+}
+
+/****************************************************************
+ Helper function for recurse_eval(Cell*) that checks whether or
+ not two Lists are equal in content. This function represents
+ the keyword "equal?".
+*/
+static List* isEqual(List* la, List* lb)
+{
+    // Recursively compare the structure
+    if (la->mStructure != NULL && lb->mStructure != NULL)
+        return wrapStructure(compareEqual(la->mStructure, lb->mStructure));
+        // NULL is equal to NULL
+    else if (la->mStructure == NULL && lb->mStructure == NULL)
+        return wrapStructure(TRUE);
+    else // Not equal all other cases
+        return wrapStructure(FALSE);
+}
+
+/****************************************************************
+ Helper function for isEqual(List*, List*) to recursively
+ compare the two Lists for equality.
+*/
+static Cell* compareEqual(Cell* c1, Cell* c2)
+{
+    // #t is a bare cell like the empty list, so only identity
+    // tells it apart
+    if ((c1 == TRUE) != (c2 == TRUE)) return FALSE;
+
+    // Shared cells and cached hashes settle most comparisons of
+    // hash-consed data without a walk
+    if (c1 == c2) return TRUE;
+    forceData(c1);
+    forceData(c2);
+    if (c1->mHash != 0 && c2->mHash != 0 && c1->mHash != c2->mHash) return FALSE;
+
+    // Hash tables and closures only match themselves
+    if (c1->mType == CELL_HASH || c2->mType == CELL_HASH
+        || c1->mType == CELL_CLOSURE || c2->mType == CELL_CLOSURE
+        || c1->mType == CELL_PROMISE || c2->mType == CELL_PROMISE)
+        return c1 == c2 ? TRUE : FALSE;
+
+    // Vectors match only other vectors with equal members
+    if (c1->mType == CELL_VECTOR || c2->mType == CELL_VECTOR) {
+        if (c1->mType != c2->mType) return FALSE;
+        Vector* v1 = c1->mData;
+        Vector* v2 = c2->mData;
+        if (v1->mLength != v2->mLength) return FALSE;
+        int i;
+        for (i = 0; i < v1->mLength; i++) {
+            if (v1->mItems[i] == v2->mItems[i]) continue;
+            if (v1->mItems[i] == TRUE || v1->mItems[i] == FALSE
+                || v2->mItems[i] == TRUE || v2->mItems[i] == FALSE)
+                return FALSE;
+            if (compareEqual(v1->mItems[i], v2->mItems[i]) == FALSE) return FALSE;
+        }
+        return TRUE;
+    }
+
+    // Compare symbol
+    if (c1->mSymbol != NULL && c2->mSymbol != NULL) {
+        // Check if symbols are the same
+        if (strcmp(c1->mSymbol, c2->mSymbol) != 0)
+            return FALSE;
+    } else if (((c1->mSymbol == NULL) && (c2->mSymbol != NULL))
+               || ((c1->mSymbol != NULL) && (c2->mSymbol == NULL))) {
+        return FALSE;
+    }
+
+    // Recurse compare down
+    Cell* equals = TRUE;
+    if ((c1->mSub != NULL) && (c2->mSub != NULL))
+        equals = compareEqual(c1->mSub, c2->mSub);
+    // Branch existence does not match
+    else if (((c1->mSub == NULL) && (c2->mSub != NULL))
+            || ((c1->mSub != NULL) && (c2->mSub == NULL))) {
+        return FALSE;
+    }
+
+    // Bail out early if found reason to not match
+    if (equals == FALSE) return FALSE;
+
+    // Recurse compare on same level
+    if ((c1->mNext != NULL) && (c2->mNext != NULL))
+        equals = compareEqual(c1->mNext, c2->mNext);
+    else if (((c1->mNext != NULL) && (c2->mNext == NULL))
+             || ((c1->mNext == NULL) && (c2->mNext != NULL)))
+        return FALSE;
+    // Assume branch is matched in every way
+    return equals;
+}
+
+/****************************************************************
+ Helper function for recurse_eval(Cell*) that appends two Lists
+ into one. The second List is tacked onto the end of the first.
+*/
+static List* append(List* la, List* lb)
+{
+    Cell* head = appendSubstitute(la->mStructure, lb);
+    return wrapStructure(head);
+}
+
+/****************************************************************
+ Helper function for append(List*, List*) that joins the two
+ Lists non-destructively. That is, the original cons cell
+ structure remains with their pointers pointing to the original
+ individual List structures.
+*/
+static Cell* appendSubstitute(Cell* cell, List* secondList)
+{
+    // Create substitute cell
+    Cell* surrogate = iniCell();
+    surrogate->mSub = cell->mSub;
+
+    // Build the list along the same level
+    if (cell->mNext != NULL) {
+        surrogate->mNext = appendSubstitute(cell->mNext, secondList);
+    } else {
+        // Tack on the second list
+        surrogate->mNext = secondList->mStructure;
+    }
+
+    return surrogate;
+}
+
+/****************************************************************
+ Helper function for recurse_eval(Cell*) that evaluates a
+ condition and returns an expression if the condition evaluates
+ to TRUE. This function supports the keyword "else".
+*/
+static List* cond(Cell* cell, List* environment)
+{
+    Cell* pairParent = cell->mNext;
+    while (pairParent != NULL) {
+
+        // Check for else keyword if should directly evaluate
+        if ((pairParent->mSub != NULL) && (pairParent->mSub->mSub != NULL)
+            && (pairParent->mSub->mSub->mSymbol != NULL)
+            && ((strcmp(pairParent->mSub->mSub->mSymbol, "else") == 0)
+                || (strcmp(pairParent->mSub->mSub->mSymbol, "#t") == 0)))
+            return recurse_eval(pairParent->mSub->mNext->mSub, environment);
+        // Resolve condition
+        List* resolution = recurse_eval(pairParent->mSub->mSub, environment);
+        // Evaluate expression if condition is true
+        if (resolution->mStructure == TRUE)
+            return recurse_eval(pairParent->mSub->mNext->mSub, environment);
+        // Focus on next predicate expression pair
+        pairParent = pairParent->mNext;
+    }
+    // Return an empty list (equivalent to NULL and FALSE)
+    return wrapStructure(FALSE);
+}
+
+/****************************************************************
+ Helper function for recurse_eval(Cell*) that evaluates a
+ condition and returns an expression if the condition evaluates
+ to TRUE, and another expression if FALSE.
+*/
+static List* alternateIf(Cell* cell, List* environment)
+{
+    Cell* condition = cell->mNext->mSub;
+    List* resolution = recurse_eval(condition, environment);
+    if (resolution->mStructure == TRUE)
+        return recurse_eval(cell->mNext->mNext->mSub, environment);
+    else
+        return recurse_eval(cell->mNext->mNext->mNext->mSub, environment);
+}
+
+/****************************************************************
+ Helper function for recurse_eval(Cell*) that binds the given
+ value to the given name. The new binding goes in front of the
+ association list, so binding to name "dog" a second time hides
+ the previous value.
+*/
+static List* define(List* symbol, List* value, List* environment)
+{
+    int site = enterSite(SITE_ENVIRONMENT);
+
+    // Bury the values one level deep
+    Cell* emptyList = iniCell();
+    emptyList->mSymbol = allocate(sizeof(char) * 20);
+    strcpy(emptyList->mSymbol, "#f");
+    List* droppedLevel = cons(value, wrapStructure(emptyList));
+
+    // Insert the symbol into the pair
+    List* pair = cons(symbol, droppedLevel);
+
+    // Add to variable association list
+    environment = cons(pair, environment);
+    leaveSite(site);
+    return environment;
+}
+
+/****************************************************************
+ Helper function for recurse_eval(Cell*) that binds the given
+ name and formal parameters to the given expression in the
+ function table. Binding to function name "add" a second time
+ replaces its definition in place, so that call sites caching the
+ definition and procedures already resolved to it run the new one.
+ A memoized function loses its cache when redefined, and a macro
+ of the same name is dropped. The body of a compiled function is
+ run as is.
+*/
+static List* defineFunction(List* nameParams, List* expression)
+{
+    Cell* name = nameParams->mStructure->mSub;
+    if (expression->mStructure->mType != CELL_NATIVE)
+        expression = wrapStructure(optimizeBody(name, expression->mStructure));
+    else if (mSources != NULL) {
+        // No source is left to inline or optimize again
+        hashRemove(mSources, name);
+        hashRemove(mInlined, name);
+    }
+    Cell* definition = hashGet(mFunctions, name);
+    if (definition != NULL) {
+        definition->mSub = nameParams->mStructure;
+        definition->mNext->mSub = expression->mStructure;
+        definition->mData = NULL;
+    } else {
+        // Bury the values one level deep
+        Cell* emptyList = iniCell();
+        emptyList->mSymbol = allocate(sizeof(char) * 20);
+        strcpy(emptyList->mSymbol, "#f");
+        List* droppedLevel = cons(expression, wrapStructure(emptyList));
+
+        // Insert the symbol into the pair
+        List* pair = cons(nameParams, droppedLevel);
+        hashPut(mFunctions, name, pair->mStructure);
+        // Call sites that found no function under this name are stale
+        mFunctionsVersion++;
+    }
+    if (mMacros != NULL) hashRemove(mMacros, name);
+    invalidateReaders(name);
+    refreshInliners(name);
+
+    // Return nothing
+    return NULL;
+}
+
+/****************************************************************
+ Helper function for recurse_eval(Cell*) that makes a closure, as
+ in (lambda (x y) (+ x y)), or (lambda args args) to take any
+ number of arguments as a list. The body may be several
+ expressions, the last giving the value.
+*/
+static List* lambda(Cell* cell, List* environment)
+{
+    if (cell->mNext == NULL || cell->mNext->mNext == NULL)
+        return reportError("lambda", "missing parameters or body");
+    return wrapStructure(makeClosure(cell, cell->mNext->mSub, cell->mNext->mNext, environment, NULL));
+}
+
+/****************************************************************
+ Helper function for recurse_eval(Cell*) that evaluates a body
+ with local variables, as in (let ((x 1) (y 2)) (+ x y)). Every
+ value is evaluated before any variable is bound. A name before
+ the bindings, as in (let loop ((i 0)) ...), makes a named let.
+*/
+static List* let(Cell* cell, List* environment)
+{
+    if (cell->mNext == NULL) return reportError("let", "missing bindings");
+    Cell* bindings = cell->mNext->mSub;
+    if (bindings->mSub == NULL && strcmp(bindings->mSymbol, "()") != 0)
+        return namedLet(cell, environment);
+
+    int count = 0;
+    Cell* binding;
+    for (binding = bindings->mSub != NULL ? bindings : NULL; binding != NULL; binding = binding->mNext)
+        count++;
+    Cell** values = malloc(sizeof(Cell*) * (count > 0 ? count : 1));
+    int i = 0;
+    for (binding = bindings->mSub != NULL ? bindings : NULL; binding != NULL; binding = binding->mNext)
+        values[i++] = recurse_eval(binding->mSub->mNext->mSub, environment)->mStructure;
+
+    // Reads of globals through the longer environment go unnoticed
+    if (environment == mAssocVars) mCacheable = 0;
+    List* local = environment;
+    i = 0;
+    for (binding = bindings->mSub != NULL ? bindings : NULL; binding != NULL; binding = binding->mNext)
+        local = define(wrapStructure(binding->mSub->mSub), wrapStructure(values[i++]), local);
+    free(values);
+    return evalBody(cell->mNext->mNext, local);
+}
+
+/****************************************************************
+ Helper for let(Cell*, List*) that runs a named let, as in
+ (let loop ((i 0)) (if (< i 10) (loop (+ i 1)) i)). The body
+ becomes a closure that can call itself by the name given, and is
+ applied to the initial values.
+*/
+static List* namedLet(Cell* cell, List* environment)
+{
+    Cell* name = cell->mNext->mSub;
+    if (cell->mNext->mNext == NULL) return reportError("let", "missing bindings");
+    Cell* bindings = cell->mNext->mNext->mSub;
+
+    // Gather the formal parameters and their initial values
+    int count = 0;
+    Cell* binding;
+    for (binding = bindings->mSub != NULL ? bindings : NULL; binding != NULL; binding = binding->mNext)
+        count++;
+    Cell** values = malloc(sizeof(Cell*) * (count > 0 ? count : 1));
+    Cell* formals = bindings->mSub != NULL ? iniCell() : bindings;
+    Cell* tail = NULL;
+    int i = 0;
+    for (binding = bindings->mSub != NULL ? bindings : NULL; binding != NULL; binding = binding->mNext) {
+        if (tail == NULL) tail = formals;
+        else {
+            tail->mNext = iniCell();
+            tail = tail->mNext;
+        }
+        tail->mSub = binding->mSub->mSub;
+        values[i++] = recurse_eval(binding->mSub->mNext->mSub, environment)->mStructure;
+    }
+
+    Cell* loop = makeClosure(cell, formals, cell->mNext->mNext->mNext, environment, name);
+    List* result = applyClosure(loop, values, count);
+    free(values);
+    return result;
+}
+
+/****************************************************************
+ Helper function for recurse_eval(Cell*) that evaluates a body
+ with local variables bound one after the other, so that each
+ value can use the variables before it, as in
+ (let* ((x 1) (y (+ x 1))) (* x y)).
+*/
+static List* letStar(Cell* cell, List* environment)
+{
+    if (cell->mNext == NULL) return reportError("let*", "missing bindings");
+    Cell* bindings = cell->mNext->mSub;
+    if (environment == mAssocVars) mCacheable = 0;
+    List* local = environment;
+    Cell* binding;
+    for (binding = bindings->mSub != NULL ? bindings : NULL; binding != NULL; binding = binding->mNext) {
+        List* value = recurse_eval(binding->mSub->mNext->mSub, local);
+        local = define(wrapStructure(binding->mSub->mSub), value, local);
+    }
+    return evalBody(cell->mNext->mNext, local);
+}
+
+/****************************************************************
+ Helper function for recurse_eval(Cell*) that evaluates a body
+ with local variables whose values can refer to one another, as
+ in mutually recursive closures,
+
+    (letrec ((even? (lambda (n) (if (= n 0) #t (odd? (- n 1)))))
+             (odd? (lambda (n) (if (= n 0) #f (even? (- n 1))))))
+      (even? 10))
+
+ Each variable is first bound to a placeholder. Once the values
+ are evaluated, the bindings and every closure among the values
+ that copied a placeholder are pointed at the actual values.
+*/
+static List* letrec(Cell* cell, List* environment)
+{
+    if (cell->mNext == NULL) return reportError("letrec", "missing bindings");
+    Cell* bindings = cell->mNext->mSub;
+    int count = 0;
+    Cell* binding;
+    for (binding = bindings->mSub != NULL ? bindings : NULL; binding != NULL; binding = binding->mNext)
+        count++;
+    Cell** placeholders = malloc(sizeof(Cell*) * (count > 0 ? count : 1));
+    Cell** pairs = malloc(sizeof(Cell*) * (count > 0 ? count : 1));
+    Cell** values = malloc(sizeof(Cell*) * (count > 0 ? count : 1));
+
+    if (environment == mAssocVars) mCacheable = 0;
+    List* local = environment;
+    int i = 0;
+    for (binding = bindings->mSub != NULL ? bindings : NULL; binding != NULL; binding = binding->mNext, i++) {
+        placeholders[i] = iniCell();
+        local = define(wrapStructure(binding->mSub->mSub), wrapStructure(placeholders[i]), local);
+        pairs[i] = local->mStructure->mSub;
+    }
+    i = 0;
+    for (binding = bindings->mSub != NULL ? bindings : NULL; binding != NULL; binding = binding->mNext)
+        values[i++] = recurse_eval(binding->mSub->mNext->mSub, local)->mStructure;
+
+    int j;
+    for (i = 0; i < count; i++) {
+        // The value of a binding sits under (name value)
+        pairs[i]->mNext->mSub = values[i];
+        if (values[i] == NULL || values[i]->mType != CELL_CLOSURE) continue;
+        Closure* closure = values[i]->mData;
+        int k;
+        for (k = 0; k < closure->mCount; k++)
+            for (j = 0; j < count; j++)
+                if (closure->mValues[k] == placeholders[j]) closure->mValues[k] = values[j];
+    }
+    free(placeholders);
+    free(pairs);
+    free(values);
+    return evalBody(cell->mNext->mNext, local);
+}
+
+/****************************************************************
+ Helper function for the shorthand support of calling cdr(List*)
+ within car(List*).
+*/
+static List* cadr(List* list)
+{
+    return car(cdr(list));
+}
+
+/****************************************************************
+ Helper function for the shorthand support of calling
+ car(cdr(cdr(List*)))).
+*/
+static List* caddr(List* list)
+{
+    return car(cdr(cdr(list)));
+}
+
+/****************************************************************
+ Helper function for the shorthand support of calling
+ car(cdr(cdr(cdr(List*)))).
+*/
+static List* cadddr(List* list)
+{
+    return car(cdr(cdr(cdr(list))));
+}
+
+/****************************************************************
+ Helper function for the shorthand support of calling
+ car(cdr(cdr(cdr(cdr(List*))))).
+*/
+static List* caddddr(List* list)
+{
+    return car(cdr(cdr(cdr(cdr(list)))));
+}
+
+
+/****************************************************************
+ Helper function for the shorthand support of calling car(List*)
+ within cdr(List*).
+*/
+static List* cdar(List* list)
+{
+    return cdr(car(list));
+}
+
+/****************************************************************
+ Helper function for recurse_eval(Cell*) that wraps the given
+ parameters into a list.
+*/
+static List* makeList(Cell* cell, List* environment)
+{
+    Cell* parent = cell->mNext;
+    List* list = allocate(sizeof(List));
+    list->mStructure = iniCell();
+    Cell* tail = list->mStructure;
+    while (parent != NULL) {
+        // Evaluate member to attach
+        List* toJoin = recurse_eval(parent->mSub, environment);
+
+        // Attach evaluation to list and move to next member
+        tail->mSub = toJoin->mStructure;
+        parent = parent->mNext;
+
+        // Prep next attachment
+        if (parent != NULL) {
+            tail->mNext = iniCell();
+            tail = tail->mNext;
+        }
+    }
+    return list;
+}
+
+/****************************************************************
+ Helper function for recurse_eval(Cell*) that gets the last
+ member of a list.
+*/
+static List* last(List* list)
+{
+    Cell* focus = forceData(list->mStructure);
+    while (focus != NULL) {
+        if (focus->mNext != NULL) focus = focus->mNext;
+        else break;
+    }
+    return wrapStructure(forceData(focus->mSub));
+}
+
+/****************************************************************
+ Helper function for recurse_eval(Cell*) that counts the number
+ of members in the given list.
+*/
+static List* length(List* list)
+{
+    int count = 0;
+
+    // Count the length if the structure isn't empty
+    forceData(list->mStructure);
+    if (isEmptyStructure(list->mStructure) != 1) {
+        Cell* focus = list->mStructure;
+        while (focus != NULL) {
+            count++;
+            focus = focus->mNext;
+        }
+    }
+    // Generate List and convert number to string
+    List* countList = allocate(sizeof(List));
+    countList->mStructure = iniCell();
+    countList->mStructure->mSymbol = allocate(sizeof(char) * 20);
+    sprintf(countList->mStructure->mSymbol, "%i", count);
+    return countList;
+}
+
+/****************************************************************
+ Helper function for recurse_eval(Cell*) that adds any number
+ of numerical atoms.
+*/
+static List* add(Cell* cell, List* environment)
+{
+    Cell* parent = cell->mNext;
+    Number sum = fixnumNumber(0);
+    while (parent != NULL) {
+        List* member = recurse_eval(parent->mSub, environment);
+        sum = addNumbers(sum, operandOf(member));
+
+        parent = parent->mNext;
+    }
+
+    return wrapValue(sum);
+}
+
+/****************************************************************
+ Helper function for recurse_eval(Cell*) that subtracts any
+ number of numerical atoms.
+*/
+static List* subtract(Cell* cell, List* environment)
+{
+    Cell* parent = cell->mNext;
+    List* firstNum = recurse_eval(parent->mSub, environment);
+    Number difference = operandOf(firstNum);
+    parent = parent->mNext;
+
+    // Begin subtracting all other numbers
+    while (parent != NULL) {
+        List* member = recurse_eval(parent->mSub, environment);
+        difference = subtractNumbers(difference, operandOf(member));
+
+        parent = parent->mNext;
+    }
+
+    return wrapValue(difference);
+}
+
+/****************************************************************
+ Helper function for recurse_eval(Cell*) that multiplies any
+ number of numerical atoms.
+*/
+static List* multiply(Cell* cell, List* environment)
+{
+    Cell* parent = cell->mNext;
+    Number product = fixnumNumber(1);
+    while (parent != NULL) {
+        List* member = recurse_eval(parent->mSub, environment);
+        product = multiplyNumbers(product, operandOf(member));
+
+        parent = parent->mNext;
+    }
+
+    return wrapValue(product);
+}
+
+/****************************************************************
+ Helper function for recurse_eval(Cell*) that divides the first
+ numerical atom by any number of others, or gives the reciprocal
+ of a lone one. Integers that divide evenly stay exact.
+*/
+static List* divide(Cell* cell, List* environment)
+{
+    Cell* parent = cell->mNext;
+    Number quotient = operandOf(recurse_eval(parent->mSub, environment));
+    if (parent->mNext == NULL) {
+        quotient = divideNumbers(fixnumNumber(1), quotient);
+        if (quotient.mKind == NUMBER_NONE) return reportError("/", "division by zero");
+        return wrapValue(quotient);
+    }
+
+    for (parent = parent->mNext; parent != NULL; parent = parent->mNext) {
+        Number divisor = operandOf(recurse_eval(parent->mSub, environment));
+        quotient = divideNumbers(quotient, divisor);
+        if (quotient.mKind == NUMBER_NONE) return reportError("/", "division by zero");
+    }
+    return wrapValue(quotient);
+}
+
+/****************************************************************
+ Helper function for recurse_eval(Cell*) that evaluates to TRUE
+ if all given parameters also evaluate to TRUE. Otherwise, this
+ function returns FALSE.
+*/
+static List* logicAnd(Cell* cell, List* environment)
+{
+    Cell* parent = cell->mNext;
+
+    while (parent != NULL) {
+        List* resolution = recurse_eval(parent->mSub, environment);
+        if (resolution->mStructure == FALSE) return wrapStructure(FALSE);
+        parent = parent->mNext;
+    }
+    return wrapStructure(TRUE);
+}
+
+/****************************************************************
+ Helper function for recurse_eval(Cell*) that evaluates to TRUE
+ if at least one of its given parameters evaluate to TRUE. If
+ none evaluate to TRUE, this function returns FALSE.
+*/
+static List* logicOr(Cell* cell, List* environment)
+{
+    Cell* parent = cell->mNext;
+
+    while (parent != NULL) {
+        List* resolution = recurse_eval(parent->mSub, environment);
+        if (resolution->mStructure == TRUE) return wrapStructure(TRUE);
+        parent = parent->mNext;
+    }
+    return wrapStructure(FALSE);
+}
+
+/****************************************************************
+ Helper function for recurse_eval(Cell*) that inverts the
+ evaluated value of its given parameter. If its parameter's
+ evaluation returns TRUE, this function returns FALSE. If the
+ parameter evaluates to FALSE, this function returns TRUE.
+*/
+static List* logicNot(List* list)
+{
+    if (list->mStructure == TRUE) return wrapStructure(FALSE);
+    else return wrapStructure(TRUE);
+}
+
+/****************************************************************
+ Helper function for recurse_eval(Cell*) that checks whether or
+ not a numerical atom is less than another numerical atom.
+*/
+static List* lessThan(List* la, List* lb)
+{
+    if (compareNumbers(operandOf(la), operandOf(lb)) < 0) return wrapStructure(TRUE);
+    else return wrapStructure(FALSE);
+}
+
+/****************************************************************
+ Helper function for recurse_eval(Cell*) that checks whether or
+ not a numerical atom is greater than another numerical atom.
+*/
+static List* greaterThan(List* la, List* lb)
+{
+    if (compareNumbers(operandOf(la), operandOf(lb)) > 0) return wrapStructure(TRUE);
+    else return wrapStructure(FALSE);
+}
+
+/****************************************************************
+ Helper function for recurse_eval(Cell*) that checks whether or
+ not a numerical atom is less than or equal to another numerical
+ atom.
+*/
+static List* lessThanOrEqualTo(List* la, List* lb)
+{
+    if (compareNumbers(operandOf(la), operandOf(lb)) <= 0) return wrapStructure(TRUE);
+    else return wrapStructure(FALSE);
+}
+
+/****************************************************************
+ Helper function for recurse_eval(Cell*) that checks whether or
+ not a numerical atom is greater than or equal to another numerical
+ atom.
+*/
+static List* greaterThanOrEqualTo(List* la, List* lb)
+{
+    if (compareNumbers(operandOf(la), operandOf(lb)) >= 0) return wrapStructure(TRUE);
+    else return wrapStructure(FALSE);
+}
+
+/****************************************************************
+ Helper function for recurse_eval(Cell*) that checks whether or
+ not a given List* actually refers to a list structure or just a
+ standalone atom.
+*/
+static List* isList(List* list)
+{
+    forceData(list->mStructure);
+    if (list->mStructure == NULL || list->mStructure->mSub == NULL) return wrapStructure(FALSE);
+    else return wrapStructure(TRUE);
+}
+
+/****************************************************************
+ Helper function for recurse_eval(Cell*) that checks whether or
+ not a given List* refers to a numerical atom.
+*/
+static List* isNumber(List* list)
+{
+    Cell* cell = list->mStructure;
+    if (cell->mSub != NULL) cell = cell->mSub;
+
+    // Cell is a number if its symbol is an optional '-' followed
+    // only by digits, in which case its value is cached as well
+    if (tagNumber(cell)) return wrapStructure(TRUE);
+    return wrapStructure(FALSE);
+}
+
+/****************************************************************
+ Helper function for recurse_eval(Cell*) that creates a vector of
+ the given length. Every member is set to the optional second
+ parameter, or to #f (the empty list) when it is not given.
+*/
+static List* makeVector(Cell* cell, List* environment)
+{
+    long length;
+    if (!fixnumOperand(recurse_eval(cell->mNext->mSub, environment), &length))
+        return reportError("make-vector", "length not an integer");
+    if (length < 0) return reportError("make-vector", "negative length");
+    if (length > INT_MAX) return reportError("make-vector", "length too large");
+
+    Cell* fill = FALSE;
+    if (cell->mNext->mNext != NULL)
+        fill = recurse_eval(cell->mNext->mNext->mSub, environment)->mStructure;
+
+    Cell* host = iniVector(length);
+    Vector* vector = host->mData;
+    int i;
+    for (i = 0; i < length; i++)
+        vector->mItems[i] = fill;
+    return wrapStructure(host);
+}
+
+/****************************************************************
+ Helper function for recurse_eval(Cell*) that wraps the given
+ parameters into a vector.
+*/
+static List* vector(Cell* cell, List* environment)
+{
+    // Count the members before allocating the contiguous array
+    int length = 0;
+    Cell* parent = cell->mNext;
+    while (parent != NULL) {
+        length++;
+        parent = parent->mNext;
+    }
+
+    Cell* host = iniVector(length);
+    Vector* vector = host->mData;
+    int i = 0;
+    for (parent = cell->mNext; parent != NULL; parent = parent->mNext)
+        vector->mItems[i++] = recurse_eval(parent->mSub, environment)->mStructure;
+    return wrapStructure(host);
+}
+
+/****************************************************************
+ Helper function for recurse_eval(Cell*) that gets the member of
+ a vector at the given index.
+*/
+static List* vectorRef(List* vector, List* index)
+{
+    if (vector->mStructure == NULL || vector->mStructure->mType != CELL_VECTOR)
+        return reportError("vector-ref", "not a vector");
+    Vector* items = vector->mStructure->mData;
+    long i;
+    if (!fixnumOperand(index, &i))
+        return reportError("vector-ref", "index not an integer");
+    if (i < 0 || i >= items->mLength)
+        return reportError("vector-ref", "index out of range");
+    return wrapStructure(items->mItems[i]);
+}
+
+/****************************************************************
+ Helper function for recurse_eval(Cell*) that replaces the member
+ of a vector at the given index. Like define, nothing is printed.
+*/
+static List* vectorSet(List* vector, List* index, List* value)
+{
+    if (vector->mStructure == NULL || vector->mStructure->mType != CELL_VECTOR)
+        return reportError("vector-set!", "not a vector");
+    Vector* items = vector->mStructure->mData;
+    long i;
+    if (!fixnumOperand(index, &i))
+        return reportError("vector-set!", "index not an integer");
+    if (i < 0 || i >= items->mLength)
+        return reportError("vector-set!", "index out of range");
+    items->mItems[i] = value->mStructure;
+    return NULL;
+}
+
+/****************************************************************
+ Helper function for recurse_eval(Cell*) that gives the number of
+ members in a vector.
+*/
+static List* vectorLength(List* vector)
+{
+    if (vector->mStructure == NULL || vector->mStructure->mType != CELL_VECTOR)
+        return reportError("vector-length", "not a vector");
+    Vector* items = vector->mStructure->mData;
+    return wrapNumber(items->mLength);
+}
+
+/****************************************************************
+ Helper function for recurse_eval(Cell*) that copies the members
+ of a list into a new vector.
+*/
+static List* listToVector(List* list)
+{
+    int length = 0;
+    Cell* focus;
+    for (focus = firstMember(list->mStructure); focus != NULL && focus->mSub != NULL; focus = focus->mNext)
+        length++;
+
+    Cell* host = iniVector(length);
+    Vector* vector = host->mData;
+    int i = 0;
+    for (focus = firstMember(list->mStructure); i < length; focus = focus->mNext)
+        vector->mItems[i++] = focus->mSub;
+    return wrapStructure(host);
+}
+
+/****************************************************************
+ Helper function for recurse_eval(Cell*) that copies the members
+ of a vector into a new list.
+*/
+static List* vectorToList(List* vector)
+{
+    if (vector->mStructure == NULL || vector->mStructure->mType != CELL_VECTOR)
+        return reportError("vector->list", "not a vector");
+    Vector* items = vector->mStructure->mData;
+    return wrapStructure(buildList(items->mItems, items->mLength));
+}
+
+/****************************************************************
+ Helper function for recurse_eval(Cell*) that creates an empty
+ hash table whose keys are matched as with equal?.
+*/
+static List* makeHashTable()
+{
+    // A new table must stay distinct from any cached one
+    mCacheable = 0;
+    Cell* host = iniCell();
+    host->mType = CELL_HASH;
+    host->mData = iniHashTable(equalCells);
+    return wrapStructure(host);
+}
+
+/****************************************************************
+ Helper function for recurse_eval(Cell*) that gets the value
+ stored under a key of a hash table. A missing key gives the
+ optional third parameter, or #f like assoc when it is not given.
+*/
+static List* hashRef(Cell* cell, List* environment)
+{
+    List* table = recurse_eval(cell->mNext->mSub, environment);
+    if (table->mStructure == NULL || table->mStructure->mType != CELL_HASH)
+        return reportError("hash-ref", "not a hash table");
+    List* key = recurse_eval(cell->mNext->mNext->mSub, environment);
+
+    Cell* found = hashGet(table->mStructure->mData, key->mStructure);
+    if (found != NULL) return wrapStructure(found);
+    if (cell->mNext->mNext->mNext != NULL)
+        return recurse_eval(cell->mNext->mNext->mNext->mSub, environment);
+    return wrapStructure(mNoMatch);
+}
+
+/****************************************************************
+ Helper function for recurse_eval(Cell*) that stores a value
+ under a key of a hash table. Like define, nothing is printed.
+*/
+static List* hashSet(List* table, List* key, List* value)
+{
+    if (table->mStructure == NULL || table->mStructure->mType != CELL_HASH)
+        return reportError("hash-set!", "not a hash table");
+    hashPut(table->mStructure->mData, key->mStructure, value->mStructure);
+    return NULL;
+}
+
+/****************************************************************
+ Helper function for recurse_eval(Cell*) that removes a key from
+ a hash table. Like define, nothing is printed.
+*/
+static List* hashRemoveKey(List* table, List* key)
+{
+    if (table->mStructure == NULL || table->mStructure->mType != CELL_HASH)
+        return reportError("hash-remove!", "not a hash table");
+    hashRemove(table->mStructure->mData, key->mStructure);
+    return NULL;
+}
+
+/****************************************************************
+ Helper function for recurse_eval(Cell*) that gives the number of
+ keys in a hash table.
+*/
+static List* hashCount(List* table)
+{
+    if (table->mStructure == NULL || table->mStructure->mType != CELL_HASH)
+        return reportError("hash-count", "not a hash table");
+    return wrapNumber(((HashTable*) table->mStructure->mData)->mCount);
+}
+
+/****************************************************************
+ Helper function for recurse_eval(Cell*) that lists the keys of a
+ hash table in no particular order.
+*/
+static List* hashKeys(List* table)
+{
+    if (table->mStructure == NULL || table->mStructure->mType != CELL_HASH)
+        return reportError("hash-keys", "not a hash table");
+    HashTable* hash = table->mStructure->mData;
+
+    Cell** keys = malloc(sizeof(Cell*) * (hash->mCount > 0 ? hash->mCount : 1));
+    Cell* key;
+    Cell* value;
+    int count = 0;
+    int i = 0;
+    while ((i = hashNext(hash, i, &key, &value)) != -1)
+        keys[count++] = key;
+
+    Cell* head = buildList(keys, count);
+    free(keys);
+    return wrapStructure(head);
+}
+
+/****************************************************************
+ Helper function for recurse_eval(Cell*) that applies a procedure
+ to the members of one or more lists and collects the results
+ into a new list. With several lists, the procedure gets one
+ member of each and mapping stops at the end of the shortest.
+*/
+static List* map(Cell* cell, List* environment)
+{
+    if (cell->mNext == NULL || cell->mNext->mNext == NULL)
+        return reportError("map", "missing parameters");
+    Cell* procedure = recurse_eval(cell->mNext->mSub, environment)->mStructure;
+
+    // Evaluate every list and focus on its first member
+    int count = 0;
+    Cell* parent;
+    for (parent = cell->mNext->mNext; parent != NULL; parent = parent->mNext)
+        count++;
+    Cell** focus = malloc(sizeof(Cell*) * (count > 0 ? count : 1));
+    Cell** args = malloc(sizeof(Cell*) * (count > 0 ? count : 1));
+    int i = 0;
+    for (parent = cell->mNext->mNext; parent != NULL; parent = parent->mNext)
+        focus[i++] = firstMember(recurse_eval(parent->mSub, environment)->mStructure);
+
+    Procedure applied;
+    int prepared = prepareProcedure(procedure, count, &applied);
+    if (prepared <= 0) {
+        free(focus);
+        free(args);
+        return reportError("map", prepared == 0 ? "not a procedure" : "wrong number of parameters");
+    }
+
+    // Build the output in one forward pass
+    Cell* head = iniCell();
+    Cell* tail = NULL;
+    while (count > 0) {
+        for (i = 0; i < count; i++) {
+            if (focus[i] == NULL || focus[i]->mSub == NULL) break;
+            args[i] = focus[i]->mSub;
+            focus[i] = focus[i]->mNext;
+        }
+        if (i < count) break;
+
+        List* result = applyProcedure(&applied, args);
+        if (tail == NULL) tail = head;
+        else {
+            tail->mNext = iniCell();
+            tail = tail->mNext;
+        }
+        tail->mSub = result != NULL ? result->mStructure : FALSE;
+    }
+    free(focus);
+    free(args);
+    return wrapStructure(head);
+}
+
+/****************************************************************
+ Helper function for recurse_eval(Cell*) that collects the members
+ of a list for which a predicate evaluates to TRUE, in order.
+*/
+static List* filter(Cell* cell, List* environment)
+{
+    if (cell->mNext == NULL || cell->mNext->mNext == NULL)
+        return reportError("filter", "missing parameters");
+    Cell* procedure = recurse_eval(cell->mNext->mSub, environment)->mStructure;
+    Cell* focus = firstMember(recurse_eval(cell->mNext->mNext->mSub, environment)->mStructure);
+
+    Procedure applied;
+    int prepared = prepareProcedure(procedure, 1, &applied);
+    if (prepared <= 0)
+        return reportError("filter", prepared == 0 ? "not a procedure" : "wrong number of parameters");
+
+    Cell* head = iniCell();
+    Cell* tail = NULL;
+    for (; focus != NULL && focus->mSub != NULL; focus = focus->mNext) {
+        List* keep = applyProcedure(&applied, &focus->mSub);
+        if (keep == NULL || keep->mStructure != TRUE) continue;
+        if (tail == NULL) tail = head;
+        else {
+            tail->mNext = iniCell();
+            tail = tail->mNext;
+        }
+        tail->mSub = focus->mSub;
+    }
+    return wrapStructure(head);
+}
+
+/****************************************************************
+ Helper function for recurse_eval(Cell*) that folds a list from
+ the left. For (fold f init list) the procedure is called as
+ (f member accumulated) where accumulated starts as init and then
+ holds the result of the previous call.
+*/
+static List* fold(Cell* cell, List* environment)
+{
+    if (cell->mNext == NULL || cell->mNext->mNext == NULL || cell->mNext->mNext->mNext == NULL)
+        return reportError("fold", "missing parameters");
+    Cell* procedure = recurse_eval(cell->mNext->mSub, environment)->mStructure;
+    List* accumulated = recurse_eval(cell->mNext->mNext->mSub, environment);
+    Cell* focus = firstMember(recurse_eval(cell->mNext->mNext->mNext->mSub, environment)->mStructure);
+
+    Procedure applied;
+    int prepared = prepareProcedure(procedure, 2, &applied);
+    if (prepared <= 0)
+        return reportError("fold", prepared == 0 ? "not a procedure" : "wrong number of parameters");
+
+    Cell* args[2];
+    for (; focus != NULL && focus->mSub != NULL; focus = focus->mNext) {
+        args[0] = focus->mSub;
+        args[1] = accumulated != NULL ? accumulated->mStructure : FALSE;
+        accumulated = applyProcedure(&applied, args);
+    }
+    return accumulated;
+}
+
+/****************************************************************
+ Helper function for recurse_eval(Cell*) that applies a procedure
+ to the members of one or more lists for its side effects only.
+ Like define, nothing is printed.
+*/
+static List* forEach(Cell* cell, List* environment)
+{
+    if (cell->mNext == NULL || cell->mNext->mNext == NULL)
+        return reportError("for-each", "missing parameters");
+    List* ignored = map(cell, environment);
+    if (ignored->mStructure == FALSE) return ignored;
+    return NULL;
+}
+
+/****************************************************************
+ Helper function for recurse_eval(Cell*) that calls a procedure
+ with the members of a list as its parameters. Parameters listed
+ before the list, as in (apply f a b list), come first.
+
+ Applying +, *, min or max to nothing but a list of integers, or
+ of numbers including flonums, packs the list into an array for
+ the kernels of Numeric instead of going through a call form with
+ one quoted slot per member.
+*/
+static List* apply(Cell* cell, List* environment)
+{
+    if (cell->mNext == NULL)
+        return reportError("apply", "missing parameters");
+    Cell* procedure = recurse_eval(cell->mNext->mSub, environment)->mStructure;
+
+    // Evaluate the parameters listed before the final list
+    int direct = 0;
+    Cell* parent;
+    for (parent = cell->mNext->mNext; parent != NULL && parent->mNext != NULL; parent = parent->mNext)
+        direct++;
+    if (parent == NULL) return reportError("apply", "missing list of parameters");
+    Cell** listed = malloc(sizeof(Cell*) * (direct > 0 ? direct : 1));
+    int i = 0;
+    for (parent = cell->mNext->mNext; parent->mNext != NULL; parent = parent->mNext)
+        listed[i++] = recurse_eval(parent->mSub, environment)->mStructure;
+    int count;
+    Cell** members = listMembers(recurse_eval(parent->mSub, environment)->mStructure, &count);
+
+    // Reduce homogeneous integers with a kernel
+    if (direct == 0 && procedure != NULL && procedure->mSymbol != NULL) {
+        char* sym = procedure->mSymbol;
+        int isReduction = (strcmp(sym, "+") == 0) || (strcmp(sym, "*") == 0)
+                          || (count > 0 && ((strcmp(sym, "min") == 0) || (strcmp(sym, "max") == 0)));
+        long* packed = isReduction ? packFixnums(members, count) : NULL;
+        int isFixnums = packed != NULL;
+        if (isFixnums) {
+            long result;
+            int overflow = 0;
+            if (strcmp(sym, "+") == 0) overflow = sumFixnums(packed, count, &result);
+            else if (strcmp(sym, "*") == 0) overflow = productFixnums(packed, count, &result);
+            else if (strcmp(sym, "min") == 0) result = minFixnums(packed, count);
+            else result = maxFixnums(packed, count);
+            free(packed);
+            if (overflow == 0) {
+                free(listed);
+                free(members);
+                return wrapNumber(result);
+            }
+        }
+
+        // Lists holding flonums reduce with the flonum kernels
+        double* flonums = isReduction && !isFixnums && countFlonums(members, count) > 0
+                           ? packFlonums(members, count) : NULL;
+        if (flonums != NULL) {
+            double result;
+            if (strcmp(sym, "+") == 0) result = sumFlonums(flonums, count);
+            else if (strcmp(sym, "*") == 0) result = productFlonums(flonums, count);
+            else if (strcmp(sym, "min") == 0) result = minFlonums(flonums, count);
+            else result = maxFlonums(flonums, count);
+            free(flonums);
+            free(listed);
+            free(members);
+            return wrapValue(flonumNumber(result));
+        }
+    }
+
+    // Otherwise call the procedure with every parameter
+    Cell** args = malloc(sizeof(Cell*) * (direct + count > 0 ? direct + count : 1));
+    for (i = 0; i < direct; i++)
+        args[i] = listed[i];
+    for (i = 0; i < count; i++)
+        args[direct + i] = members[i];
+    free(listed);
+    free(members);
+
+    Procedure applied;
+    int prepared = prepareProcedure(procedure, direct + count, &applied);
+    if (prepared <= 0) {
+        free(args);
+        return reportError("apply", prepared == 0 ? "not a procedure" : "wrong number of parameters");
+    }
+    List* result = applyProcedure(&applied, args);
+    free(args);
+    return result;
+}
+
+/****************************************************************
+ Helper function for recurse_eval(Cell*) that sorts a list into a
+ new one by a procedure telling whether its first parameter goes
+ before its second, as in
+
+    (sort '(3 1 2) <)
+
+ The sort is stable, so members neither of which goes before the
+ other keep their order. Integers sorted by < or > are packed into
+ an array for the sort of Numeric, which sorts a large one on a
+ thread per processor, and other numbers sorted by these are
+ compared without a call, so anything else in the list is an error
+ for them. Any other procedure is called for every comparison of a
+ merge sort of the members.
+*/
+static List* sort(Cell* cell, List* environment)
+{
+    if (cell->mNext == NULL || cell->mNext->mNext == NULL)
+        return reportError("sort", "missing list or procedure");
+    List* list = recurse_eval(cell->mNext->mSub, environment);
+    Cell* procedure = recurse_eval(cell->mNext->mNext->mSub, environment)->mStructure;
+    Procedure applied;
+    int prepared = prepareProcedure(procedure, 2, &applied);
+    if (prepared <= 0)
+        return reportError("sort", prepared == 0 ? "not a procedure" : "wrong number of parameters");
+    Cell* value = list->mStructure;
+    if (firstMember(value) == NULL
+        && (value == NULL || value->mType != CELL_PLAIN || value->mSub != NULL
+            || (value->mSymbol != NULL && strcmp(value->mSymbol, "()") != 0)))
+        return reportError("sort", "not a list");
+    int count;
+    Cell** members = listMembers(value, &count);
+    if (count < 2) {
+        free(members);
+        return list;
+    }
+
+    // Builtins cannot be shadowed, so < and > are the comparisons
+    int direction = 0;
+    if (procedure->mSymbol != NULL && strcmp(procedure->mSymbol, "<") == 0) direction = 1;
+    else if (procedure->mSymbol != NULL && strcmp(procedure->mSymbol, ">") == 0) direction = -1;
+    Cell** sorted = malloc(sizeof(Cell*) * count);
+    long* packed = direction != 0 ? packFixnums(members, count) : NULL;
+    int i;
+    if (packed != NULL) {
+        int* order = malloc(sizeof(int) * count);
+        sortFixnums(packed, order, count, direction < 0);
+        for (i = 0; i < count; i++)
+            sorted[i] = members[order[i]];
+        free(order);
+        free(packed);
+    } else {
+        for (i = 0; i < count && direction != 0; i++)
+            if (numberOf(members[i]).mKind == NUMBER_NONE) {
+                free(sorted);
+                free(members);
+                return reportError("sort", "not a list of numbers");
+            }
+        sortMembers(members, sorted, count, &applied, direction);
+        memcpy(sorted, members, sizeof(Cell*) * count);
+    }
+    Cell* head = buildList(sorted, count);
+    free(sorted);
+    free(members);
+    return wrapStructure(head);
+}
+
+/****************************************************************
+ Helper function for recurse_eval(Cell*) that puts off evaluating
+ an expression, as in (delay (f x)), giving a promise of its value
+ for force(List*).
+*/
+static List* delay(Cell* cell, List* environment)
+{
+    if (cell->mNext == NULL) return reportError("delay", "missing expression");
+    return wrapStructure(makePromise(cell->mNext->mSub, environment));
+}
+
+/****************************************************************
+ Helper function for recurse_eval(Cell*) that gives the value of
+ a promise, evaluating its expression only the first time. Any
+ other value is given as is.
+*/
+static List* force(List* value)
+{
+    return wrapStructure(forceValue(value->mStructure));
+}
+
+/****************************************************************
+ Helper function for recurse_eval(Cell*) that builds a stream, as
+ in (cons-stream 1 (integers-from 2)). The first operand is
+ evaluated right away and the second is delayed, so the stream is
+ a pair whose rest is a promise, only computed by stream-cdr.
+*/
+static List* consStream(Cell* cell, List* environment)
+{
+    if (cell->mNext == NULL || cell->mNext->mNext == NULL)
+        return reportError("cons-stream", "missing parameters");
+    List* first = recurse_eval(cell->mNext->mSub, environment);
+    return cons(first, wrapStructure(makePromise(cell->mNext->mNext->mSub, environment)));
+}
+
+/****************************************************************
+ Helper function for recurse_eval(Cell*) that gives the first
+ member of a stream. Like the other stream functions, it takes a
+ list as a stream that is already computed.
+*/
+static List* streamCar(List* stream)
+{
+    Cell* focus = firstMember(forceValue(stream->mStructure));
+    if (focus == NULL) return reportError("stream-car", "empty stream");
+    return wrapStructure(focus->mSub);
+}
+
+/****************************************************************
+ Helper function for recurse_eval(Cell*) that gives the rest of a
+ stream, computing it the first time it is asked for.
+*/
+static List* streamCdr(List* stream)
+{
+    Cell* focus = firstMember(forceValue(stream->mStructure));
+    if (focus == NULL) return reportError("stream-cdr", "empty stream");
+    if (focus->mNext == NULL) return wrapStructure(iniCell());
+    return wrapStructure(forceValue(focus->mNext));
+}
+
+/****************************************************************
+ Helper function for recurse_eval(Cell*) that applies a procedure
+ to the members of a stream as they are asked for. Only the first
+ member is mapped right away; the rest is a promise to map the
+ rest of the given stream.
+*/
+static List* streamMap(Cell* cell, List* environment)
+{
+    if (cell->mNext == NULL || cell->mNext->mNext == NULL)
+        return reportError("stream-map", "missing parameters");
+    Cell* procedure = recurse_eval(cell->mNext->mSub, environment)->mStructure;
+    Cell* focus = firstMember(forceValue(recurse_eval(cell->mNext->mNext->mSub, environment)->mStructure));
+    if (focus == NULL) return wrapStructure(iniCell());
+
+    Procedure applied;
+    int prepared = prepareProcedure(procedure, 1, &applied);
+    if (prepared <= 0)
+        return reportError("stream-map", prepared == 0 ? "not a procedure" : "wrong number of parameters");
+    List* mapped = applyProcedure(&applied, &focus->mSub);
+    if (mapped == NULL) mapped = wrapStructure(FALSE);
+    if (focus->mNext == NULL) return cons(mapped, wrapStructure(iniCell()));
+    return cons(mapped, wrapStructure(delayedCall("stream-map", procedure, focus->mNext)));
+}
+
+/****************************************************************
+ Helper function for recurse_eval(Cell*) that keeps the members of
+ a stream for which a predicate evaluates to TRUE. The given
+ stream is forced only as far as its first member kept, and the
+ rest is a promise to go on from there.
+*/
+static List* streamFilter(Cell* cell, List* environment)
+{
+    if (cell->mNext == NULL || cell->mNext->mNext == NULL)
+        return reportError("stream-filter", "missing parameters");
+    Cell* procedure = recurse_eval(cell->mNext->mSub, environment)->mStructure;
+    Cell* focus = firstMember(forceValue(recurse_eval(cell->mNext->mNext->mSub, environment)->mStructure));
+
+    Procedure applied;
+    int prepared = prepareProcedure(procedure, 1, &applied);
+    if (prepared <= 0)
+        return reportError("stream-filter", prepared == 0 ? "not a procedure" : "wrong number of parameters");
+    for (; focus != NULL; focus = focus->mNext != NULL ? firstMember(forceValue(focus->mNext)) : NULL) {
+        List* keep = applyProcedure(&applied, &focus->mSub);
+        if (keep == NULL || keep->mStructure != TRUE) continue;
+        if (focus->mNext == NULL) return cons(wrapStructure(focus->mSub), wrapStructure(iniCell()));
+        return cons(wrapStructure(focus->mSub), wrapStructure(delayedCall("stream-filter", procedure, focus->mNext)));
+    }
+    return wrapStructure(iniCell());
+}
+
+/****************************************************************
+ Helper function for recurse_eval(Cell*) that gives a stream of
+ at most the given number of first members of a stream, as in
+ (stream-take (integers-from 1) 10). Nothing past them is ever
+ computed.
+*/
+static List* streamTake(List* stream, List* count)
+{
+    if (count->mStructure == NULL || count->mStructure->mSymbol == NULL)
+        return reportError("stream-take", "not a number");
+    long n = atol(count->mStructure->mSymbol);
+    Cell* focus = n > 0 ? firstMember(forceValue(stream->mStructure)) : NULL;
+    if (focus == NULL) return wrapStructure(iniCell());
+    if (n == 1 || focus->mNext == NULL) return cons(wrapStructure(focus->mSub), wrapStructure(iniCell()));
+    return cons(wrapStructure(focus->mSub), wrapStructure(delayedCall("stream-take", focus->mNext,
+                                                                      wrapNumber(n - 1)->mStructure)));
+}
+
+/****************************************************************
+ Helper function for recurse_eval(Cell*) that computes every
+ member of a finite stream into a list.
+*/
+static List* streamToList(List* stream)
+{
+    Cell* head = iniCell();
+    Cell* tail = NULL;
+    Cell* focus;
+    for (focus = firstMember(forceValue(stream->mStructure)); focus != NULL;
+         focus = focus->mNext != NULL ? firstMember(forceValue(focus->mNext)) : NULL) {
+        if (tail == NULL) tail = head;
+        else {
+            tail->mNext = iniCell();
+            tail = tail->mNext;
+        }
+        tail->mSub = focus->mSub;
+    }
+    return wrapStructure(head);
+}
+
+/****************************************************************
+ Helper function for recurse_eval(Cell*) that gives the smallest
+ of any number of numerical atoms.
+*/
+static List* minimum(Cell* cell, List* environment)
+{
+    Cell* parent = cell->mNext;
+    Number least = operandOf(recurse_eval(parent->mSub, environment));
+    int inexact = least.mKind == NUMBER_FLONUM;
+    for (parent = parent->mNext; parent != NULL; parent = parent->mNext) {
+        Number value = operandOf(recurse_eval(parent->mSub, environment));
+        if (compareNumbers(value, least) < 0) least = value;
+        if (value.mKind == NUMBER_FLONUM) inexact = 1;
+    }
+    // Any flonum among the operands makes the result a flonum
+    if (inexact) least = flonumNumber(doubleOf(least));
+    return wrapValue(least);
+}
+
+/****************************************************************
+ Helper function for recurse_eval(Cell*) that gives the largest
+ of any number of numerical atoms.
+*/
+static List* maximum(Cell* cell, List* environment)
+{
+    Cell* parent = cell->mNext;
+    Number most = operandOf(recurse_eval(parent->mSub, environment));
+    int inexact = most.mKind == NUMBER_FLONUM;
+    for (parent = parent->mNext; parent != NULL; parent = parent->mNext) {
+        Number value = operandOf(recurse_eval(parent->mSub, environment));
+        if (compareNumbers(value, most) > 0) most = value;
+        if (value.mKind == NUMBER_FLONUM) inexact = 1;
+    }
+    // Any flonum among the operands makes the result a flonum
+    if (inexact) most = flonumNumber(doubleOf(most));
+    return wrapValue(most);
+}
+
+/****************************************************************
+ Helper function for recurse_eval(Cell*) that reduces a vector of
+ numbers to its sum, product, smallest or largest member, as
+ named by the given vector-sum, vector-product, vector-min or
+ vector-max.
+
+ Vectors of fixnums go through the kernels of Numeric, as do
+ vectors holding flonums once converted to doubles. Should an
+ integer kernel overflow, or a member already be a bignum, the
+ reduction is redone exactly member by member.
+*/
+static List* vectorReduce(char* name, List* vector)
+{
+    if (vector->mStructure == NULL || vector->mStructure->mType != CELL_VECTOR)
+        return reportError(name, "not a vector");
+    Vector* items = vector->mStructure->mData;
+    int isSum = strcmp(name, "vector-sum") == 0;
+    int isProduct = strcmp(name, "vector-product") == 0;
+    if (items->mLength == 0 && !isSum && !isProduct) return reportError(name, "empty vector");
+
+    long* packed = packFixnums(items->mItems, items->mLength);
+    double* flonums = packed == NULL && countFlonums(items->mItems, items->mLength) > 0
+                       ? packFlonums(items->mItems, items->mLength) : NULL;
+    if (packed != NULL) {
+        long result = 0;
+        int overflow = 0;
+        if (isSum) overflow = sumFixnums(packed, items->mLength, &result);
+        else if (isProduct) overflow = productFixnums(packed, items->mLength, &result);
+        else if (strcmp(name, "vector-min") == 0) result = minFixnums(packed, items->mLength);
+        else result = maxFixnums(packed, items->mLength);
+        free(packed);
+        if (overflow == 0) return wrapNumber(result);
+    }
+    if (flonums != NULL) {
+        double result;
+        if (isSum) result = sumFlonums(flonums, items->mLength);
+        else if (isProduct) result = productFlonums(flonums, items->mLength);
+        else if (strcmp(name, "vector-min") == 0) result = minFlonums(flonums, items->mLength);
+        else result = maxFlonums(flonums, items->mLength);
+        free(flonums);
+        return wrapValue(flonumNumber(result));
+    }
+
+    Number* values = listNumbers(items->mItems, items->mLength);
+    if (values == NULL) return reportError(name, "not a vector of numbers");
+    Number result = isSum ? fixnumNumber(0) : isProduct ? fixnumNumber(1) : values[0];
+    int i;
+    for (i = 0; i < items->mLength; i++) {
+        if (isSum) result = addNumbers(result, values[i]);
+        else if (isProduct) result = multiplyNumbers(result, values[i]);
+        else if (strcmp(name, "vector-min") == 0) {
+            if (compareNumbers(values[i], result) < 0) result = values[i];
+        } else if (compareNumbers(values[i], result) > 0) result = values[i];
+    }
+    free(values);
+    return wrapValue(result);
+}
+
+/****************************************************************
+ Helper function for recurse_eval(Cell*) that gives the dot
+ product of two vectors of numbers of the same length. Falls
+ back to exact arithmetic like vectorReduce(char*, List*).
+*/
+static List* vectorDot(List* va, List* vb)
+{
+    if (va->mStructure == NULL || va->mStructure->mType != CELL_VECTOR
+        || vb->mStructure == NULL || vb->mStructure->mType != CELL_VECTOR)
+        return reportError("vector-dot", "not a vector");
+    Vector* a = va->mStructure->mData;
+    Vector* b = vb->mStructure->mData;
+    if (a->mLength != b->mLength) return reportError("vector-dot", "lengths differ");
+
+    long* packedA = packFixnums(a->mItems, a->mLength);
+    long* packedB = packFixnums(b->mItems, b->mLength);
+    if (packedA != NULL && packedB != NULL) {
+        long result;
+        int overflow = dotFixnums(packedA, packedB, a->mLength, &result);
+        free(packedA);
+        free(packedB);
+        if (overflow == 0) return wrapNumber(result);
+    } else {
+        free(packedA);
+        free(packedB);
+        if (countFlonums(a->mItems, a->mLength) > 0 || countFlonums(b->mItems, b->mLength) > 0) {
+            double* flonumsA = packFlonums(a->mItems, a->mLength);
+            double* flonumsB = packFlonums(b->mItems, b->mLength);
+            if (flonumsA != NULL && flonumsB != NULL) {
+                double result = dotFlonums(flonumsA, flonumsB, a->mLength);
+                free(flonumsA);
+                free(flonumsB);
+                return wrapValue(flonumNumber(result));
+            }
+            free(flonumsA);
+            free(flonumsB);
+        }
+    }
+
+    Number* valuesA = listNumbers(a->mItems, a->mLength);
+    Number* valuesB = listNumbers(b->mItems, b->mLength);
+    if (valuesA == NULL || valuesB == NULL) {
+        free(valuesA);
+        free(valuesB);
+        return reportError("vector-dot", "not a vector of numbers");
+    }
+    Number sum = fixnumNumber(0);
+    int i;
+    for (i = 0; i < a->mLength; i++)
+        sum = addNumbers(sum, multiplyNumbers(valuesA[i], valuesB[i]));
+    free(valuesA);
+    free(valuesB);
+    return wrapValue(sum);
+}
+
+/****************************************************************
+ Helper function for recurse_eval(Cell*) that adds two vectors of
+ numbers of the same length member by member into a new vector.
+*/
+static List* vectorAdd(List* va, List* vb)
+{
+    if (va->mStructure == NULL || va->mStructure->mType != CELL_VECTOR
+        || vb->mStructure == NULL || vb->mStructure->mType != CELL_VECTOR)
+        return reportError("vector-map+", "not a vector");
+    Vector* a = va->mStructure->mData;
+    Vector* b = vb->mStructure->mData;
+    if (a->mLength != b->mLength) return reportError("vector-map+", "lengths differ");
+
+    Cell* host = iniVector(a->mLength);
+    Vector* sum = host->mData;
+    int i;
+    long* packedA = packFixnums(a->mItems, a->mLength);
+    long* packedB = packFixnums(b->mItems, b->mLength);
+    if (packedA != NULL && packedB != NULL
+        && addFixnums(packedA, packedB, a->mLength, packedA) == 0) {
+        for (i = 0; i < a->mLength; i++)
+            sum->mItems[i] = wrapNumber(packedA[i])->mStructure;
+        free(packedA);
+        free(packedB);
+        return wrapStructure(host);
+    }
+    free(packedA);
+    free(packedB);
+
+    // Every sum is a flonum when either vector holds only flonums
+    if (countFlonums(a->mItems, a->mLength) == a->mLength
+        || countFlonums(b->mItems, b->mLength) == b->mLength) {
+        double* flonumsA = packFlonums(a->mItems, a->mLength);
+        double* flonumsB = packFlonums(b->mItems, b->mLength);
+        if (flonumsA != NULL && flonumsB != NULL) {
+            addFlonums(flonumsA, flonumsB, a->mLength, flonumsA);
+            for (i = 0; i < a->mLength; i++)
+                sum->mItems[i] = wrapValue(flonumNumber(flonumsA[i]))->mStructure;
+            free(flonumsA);
+            free(flonumsB);
+            return wrapStructure(host);
+        }
+        free(flonumsA);
+        free(flonumsB);
+    }
+
+    Number* valuesA = listNumbers(a->mItems, a->mLength);
+    Number* valuesB = listNumbers(b->mItems, b->mLength);
+    if (valuesA == NULL || valuesB == NULL) {
+        free(valuesA);
+        free(valuesB);
+        return reportError("vector-map+", "not a vector of numbers");
+    }
+    for (i = 0; i < a->mLength; i++)
+        sum->mItems[i] = wrapValue(addNumbers(valuesA[i], valuesB[i]))->mStructure;
+    free(valuesA);
+    free(valuesB);
+    return wrapStructure(host);
+}
+
+/****************************************************************
+ Helper function for recurse_eval(Cell*) that multiplies every
+ member of a vector of numbers by a factor into a new vector.
+*/
+static List* vectorScale(List* vector, List* factor)
+{
+    if (vector->mStructure == NULL || vector->mStructure->mType != CELL_VECTOR)
+        return reportError("vector-scale", "not a vector");
+    Vector* items = vector->mStructure->mData;
+    Number by = numberOf(factor->mStructure);
+    if (by.mKind == NUMBER_NONE) return reportError("vector-scale", "not a numerical factor");
+
+    Cell* host = iniVector(items->mLength);
+    Vector* scaled = host->mData;
+    int i;
+    long* packed = by.mKind == NUMBER_FIXNUM ? packFixnums(items->mItems, items->mLength) : NULL;
+    if (packed != NULL && scaleFixnums(packed, items->mLength, by.mFixnum, packed) == 0) {
+        for (i = 0; i < items->mLength; i++)
+            scaled->mItems[i] = wrapNumber(packed[i])->mStructure;
+        free(packed);
+        return wrapStructure(host);
+    }
+    free(packed);
+
+    // Every product is a flonum when the factor or all members are
+    if (by.mKind == NUMBER_FLONUM || countFlonums(items->mItems, items->mLength) == items->mLength) {
+        double* flonums = packFlonums(items->mItems, items->mLength);
+        if (flonums != NULL) {
+            scaleFlonums(flonums, items->mLength, doubleOf(by), flonums);
+            for (i = 0; i < items->mLength; i++)
+                scaled->mItems[i] = wrapValue(flonumNumber(flonums[i]))->mStructure;
+            free(flonums);
+            return wrapStructure(host);
+        }
+    }
+
+    Number* values = listNumbers(items->mItems, items->mLength);
+    if (values == NULL) return reportError("vector-scale", "not a vector of numbers");
+    for (i = 0; i < items->mLength; i++)
+        scaled->mItems[i] = wrapValue(multiplyNumbers(values[i], by))->mStructure;
+    free(values);
+    return wrapStructure(host);
+}
+
+/****************************************************************
+ Helper function for recurse_eval(Cell*) that defines a function
+ exactly like define does and memoizes it, as in
+
+    (define-memo (fib n) (...))
+    (define-memo (fib n) (...) 100)
+
+ where the optional last parameter bounds how many results are
+ kept. Only pure functions should be memoized, as a call with
+ arguments seen before no longer runs the body. The cache belongs
+ to this definition, so redefining the function drops it.
+*/
+static List* defineMemo(Cell* cell, List* environment)
+{
+    if (cell->mNext == NULL || cell->mNext->mSub->mSub == NULL || cell->mNext->mNext == NULL)
+        return reportError("define-memo", "not a function definition");
+    List* key = wrapStructure(cell->mNext->mSub);
+    long limit = MEMO_LIMIT;
+    if (cell->mNext->mNext->mNext != NULL
+        && (!fixnumOperand(recurse_eval(cell->mNext->mNext->mNext->mSub, environment), &limit) || limit < 0 || limit > INT_MAX))
+        return reportError("define-memo", "limit not a non-negative integer");
+    defineFunction(key, wrapStructure(cell->mNext->mNext->mSub));
+
+    Cell* definition = hashGet(mFunctions, key->mStructure->mSub);
+    definition->mData = iniMemoTable((int) limit, equalCells);
+    // Calls inlined before it was memoized would skip the cache
+    refreshInliners(key->mStructure->mSub);
+    return NULL;
+}
+
+/****************************************************************
+ Helper function for recurse_eval(Cell*) that memoizes an already
+ defined function in place, as in (memoize fib) or (memoize fib
+ 100), and gives back the function. Memoizing a function again
+ starts over with an empty cache.
+*/
+static List* memoize(Cell* cell, List* environment)
+{
+    mCacheable = 0;
+    if (cell->mNext == NULL) return reportError("memoize", "missing parameters");
+    Cell* procedure = recurse_eval(cell->mNext->mSub, environment)->mStructure;
+    Cell* definition = memoizedDefinition("memoize", procedure);
+    if (definition == NULL) return wrapStructure(FALSE);
+    long limit = MEMO_LIMIT;
+    if (cell->mNext->mNext != NULL
+        && (!fixnumOperand(recurse_eval(cell->mNext->mNext->mSub, environment), &limit) || limit < 0 || limit > INT_MAX))
+        return reportError("memoize", "limit not a non-negative integer");
+    definition->mData = iniMemoTable((int) limit, equalCells);
+    refreshInliners(definition->mSub->mSub);
+    return wrapStructure(procedure);
+}
+
+/****************************************************************
+ Helper function for recurse_eval(Cell*) that describes the cache
+ of a memoized function as an association list,
+
+    ((hits 10) (misses 4) (evictions 0) (size 4) (limit 4096))
+
+ A redefined function has no cache until memoized again.
+*/
+static List* memoStats(List* function)
+{
+    mCacheable = 0;
+    Cell* definition = memoizedDefinition("memo-stats", function->mStructure);
+    if (definition == NULL) return wrapStructure(FALSE);
+    MemoTable* memo = definition->mData;
+    if (memo == NULL) return reportError("memo-stats", "function is not memoized");
+
+    char* names[] = {"hits", "misses", "evictions", "size", "limit"};
+    Cell* values[] = {wrapNumber(memo->mHits)->mStructure, wrapNumber(memo->mMisses)->mStructure,
+                      wrapNumber(memo->mEvictions)->mStructure, wrapNumber(memo->mCount)->mStructure,
+                      wrapNumber(memo->mLimit)->mStructure};
+    return statsList(names, values, 5);
+}
+
+/****************************************************************
+ Helper function for recurse_eval(Cell*) that describes the cache
+ of top level results as an association list,
+
+    ((hits 10) (misses 4) (hit-rate 0.714285714285714)
+     (invalidations 1) (size 3) (bytes 1296))
+
+ where bytes counts the cache's own tables and cells, the results
+ themselves being shared with the rest of the program.
+*/
+static List* resultCacheStats()
+{
+    mCacheable = 0;
+    if (mResults == NULL) return reportError("result-cache-stats", "results are not cached");
+
+    long bytes = (mResults->mCapacity + mReaders->mCapacity + mVolatile->mCapacity) * sizeof(HashEntry)
+                 + 3 * sizeof(HashTable) + mCacheCells * sizeof(Cell);
+    long lookups = mCacheHits + mCacheMisses;
+    double rate = lookups > 0 ? (double) mCacheHits / lookups : 0;
+    char* names[] = {"hits", "misses", "hit-rate", "invalidations", "size", "bytes"};
+    Cell* values[] = {wrapNumber(mCacheHits)->mStructure, wrapNumber(mCacheMisses)->mStructure,
+                      wrapValue(flonumNumber(rate))->mStructure, wrapNumber(mCacheInvalidations)->mStructure,
+                      wrapNumber(mResults->mCount)->mStructure, wrapNumber(bytes)->mStructure};
+    return statsList(names, values, 6);
+}
+
+/****************************************************************
+ Helper function for recurse_eval(Cell*) that reports what the
+ interpreter allocated so far by site (see allocator.h), as a list
+ of (site objects bytes) ending with the totals,
+
+    ((evaluation 120 2880) (parser 40 960) (cons 12 288) ...
+     (total 310 7440))
+*/
+static List* memoryStats()
+{
+    mCacheable = 0;
+    Cell* rows[SITE_COUNT + 1];
+    long totalObjects = 0;
+    long totalBytes = 0;
+    int i;
+    for (i = 0; i <= SITE_COUNT; i++) {
+        long bytes;
+        long objects;
+        Cell* row[3];
+        row[0] = iniCell();
+        if (i < SITE_COUNT) {
+            objects = siteAllocations(i, &bytes);
+            totalObjects += objects;
+            totalBytes += bytes;
+            row[0]->mSymbol = siteName(i);
+        } else {
+            objects = totalObjects;
+            bytes = totalBytes;
+            row[0]->mSymbol = "total";
+        }
+        row[1] = wrapNumber(objects)->mStructure;
+        row[2] = wrapNumber(bytes)->mStructure;
+        rows[i] = buildList(row, 3);
+    }
+    return wrapStructure(buildList(rows, SITE_COUNT + 1));
+}
+
+/****************************************************************
+ Helper function for recurse_eval(Cell*) that prints the cells each
+ global retains: every variable, every user defined function along
+ with its cache of results when memoized, and the cache of top
+ level results. Cells shared between globals count for the first
+ listed, from the newest variable to the oldest, then functions.
+ Variables defined again still retain their old value, and are
+ listed once per definition. Like define, nothing else is printed.
+*/
+static List* heapSnapshot()
+{
+    mCacheable = 0;
+    AddressSet* seen = iniAddressSet();
+    int capacity = 64;
+    int count = 0;
+    char** names = malloc(sizeof(char*) * capacity);
+    char** kinds = malloc(sizeof(char*) * capacity);
+    long* cells = malloc(sizeof(long) * capacity);
+    long* bytes = malloc(sizeof(long) * capacity);
+
+    // Gather variables, functions and the result cache in order
+    Cell* binding = mAssocVars->mStructure;
+    int index = 0;
+    int cacheListed = mResults == NULL || mResults->mCount == 0;
+    Cell* key = NULL;
+    Cell* value = NULL;
+    while (1) {
+        Cell* root = NULL;
+        char* kind;
+        char* name;
+        if (binding != NULL && binding->mSub != NULL) {
+            root = binding->mSub;
+            kind = "variable";
+            name = root->mSub->mSymbol;
+            // The cell linking the binding into the list is its own
+            addAddress(seen, binding);
+            binding = binding->mNext;
+        } else if (index != -1 && (index = hashNext(mFunctions, index, &key, &value)) != -1) {
+            root = value;
+            kind = "function";
+            name = key->mSymbol;
+        } else if (!cacheListed) {
+            cacheListed = 1;
+            kind = "cache";
+            name = "(result cache)";
+        } else break;
+
+        if (count == capacity) {
+            capacity *= 2;
+            names = realloc(names, sizeof(char*) * capacity);
+            kinds = realloc(kinds, sizeof(char*) * capacity);
+            cells = realloc(cells, sizeof(long) * capacity);
+            bytes = realloc(bytes, sizeof(long) * capacity);
+        }
+        names[count] = name;
+        kinds[count] = kind;
+        bytes[count] = 0;
+        if (root != NULL) {
+            cells[count] = retainedBy(root, seen, &bytes[count]);
+            // A memoized function retains its cached arguments and results
+            if (root->mData != NULL) {
+                MemoEntry* entry;
+                for (entry = ((MemoTable*) root->mData)->mNewest; entry != NULL; entry = entry->mOlder) {
+                    cells[count] += retainedBy(entry->mArguments, seen, &bytes[count]);
+                    cells[count] += retainedBy(entry->mResult, seen, &bytes[count]);
+                }
+            }
+        } else {
+            cells[count] = 0;
+            int slot = 0;
+            while ((slot = hashNext(mResults, slot, &key, &value)) != -1) {
+                cells[count] += retainedBy(key, seen, &bytes[count]);
+                cells[count] += retainedBy(value, seen, &bytes[count]);
+            }
+        }
+        count++;
+    }
+
+    // Print from the most cells retained
+    int* order = malloc(sizeof(int) * (count > 0 ? count : 1));
+    int i;
+    for (i = 0; i < count; i++) {
+        int j = i;
+        for (; j > 0 && cells[order[j - 1]] < cells[i]; j--)
+            order[j] = order[j - 1];
+        order[j] = i;
+    }
+    long totalCells = 0;
+    long totalBytes = 0;
+    fflush(stdout);
+    printf("%12s %12s  %-9s %s\n", "cells", "bytes", "kind", "global");
+    for (i = 0; i < count; i++) {
+        int k = order[i];
+        printf("%12ld %12ld  %-9s %s\n", cells[k], bytes[k], kinds[k], names[k]);
+        totalCells += cells[k];
+        totalBytes += bytes[k];
+    }
+    printf("%12ld %12ld  %-9s %s\n", totalCells, totalBytes, "", "total");
+    fflush(stdout);
+
+    free(order);
+    free(names);
+    free(kinds);
+    free(cells);
+    free(bytes);
+    freeAddressSet(seen);
+    return NULL;
+}
+
+/****************************************************************
+ Helper for heapSnapshot() that counts the cells reachable from the
+ given one and not in the given set yet, adding them to it. The
+ bytes of those cells and of what they own, such as the items of a
+ vector or the entries of a hash table, are added to the last
+ parameter. Structures are walked with a stack of their own, as
+ long lists would overflow the C stack.
 */
-static List* assoc(Cell* symbolParent, List* assocList)
+static long retainedBy(Cell* root, AddressSet* seen, long* bytes)
 {
-    // Assoc list is empty so end early
-    if (assocList->mStructure == NULL) return wrapStructure(symbolParent);
+    int capacity = 256;
+    int depth = 0;
+    Cell** stack = malloc(sizeof(Cell*) * capacity);
+    long cells = 0;
+    stack[depth++] = root;
+    while (depth > 0) {
+        Cell* cell = stack[--depth];
+        if (cell == NULL || !addAddress(seen, cell)) continue;
+        cells++;
+        *bytes += sizeof(Cell);
+        // At most four cells are pushed below, besides the items
+        Cell* pushed[4] = { cell->mSub, cell->mNext, NULL, NULL };
+        Cell** items = NULL;
+        int itemCount = 0;
+        if (cell->mType == CELL_VECTOR) {
+            Vector* vector = cell->mData;
+            *bytes += sizeof(Vector) + sizeof(Cell*) * vector->mLength;
+            items = vector->mItems;
+            itemCount = vector->mLength;
+        } else if (cell->mType == CELL_CLOSURE) {
+            Closure* closure = cell->mData;
+            *bytes += sizeof(Closure) + 2 * sizeof(Cell*) * closure->mCount;
+            pushed[2] = closure->mFormals;
+            pushed[3] = closure->mBody;
+            items = closure->mValues;
+            itemCount = closure->mCount;
+        } else if (cell->mType == CELL_PROMISE) {
+            Promise* promise = cell->mData;
+            *bytes += sizeof(Promise);
+            // Its environment is counted for the variables bound there
+            pushed[2] = promise->mValue != NULL ? promise->mValue : promise->mExpression;
+        } else if (cell->mType == CELL_HASH) {
+            HashTable* table = cell->mData;
+            *bytes += sizeof(HashTable) + sizeof(HashEntry) * table->mCapacity;
+        }
 
-    // Search the immediate give Cell if it's lone (missing a sub branch)
-    Cell* found = NULL;
-    if (symbolParent->mSub == NULL) found = findAssoc(symbolParent, assocList->mStructure);
-    else found = findAssoc(symbolParent->mSub, assocList->mStructure);
-
-    // Return any match
-    if (found != NULL) {
-        return wrapStructure(found);
-        // Return #f, synonymous to the empty list ()
-    } else {
-        Cell* empty = iniCell();
-        empty->mSymbol = malloc(sizeof(char) * 20);
-        strcpy(empty->mSymbol, "#f");
-        return wrapStructure(empty);
+        int needed = depth + 4 + itemCount + (cell->mType == CELL_HASH ? 2 * ((HashTable*) cell->mData)->mCount : 0);
+        if (needed > capacity) {
+            while (needed > capacity)
+                capacity *= 2;
+            stack = realloc(stack, sizeof(Cell*) * capacity);
+        }
+        int i;
+        for (i = 0; i < 4; i++)
+            if (pushed[i] != NULL) stack[depth++] = pushed[i];
+        for (i = 0; i < itemCount; i++)
+            stack[depth++] = items[i];
+        if (cell->mType == CELL_HASH) {
+            Cell* key;
+            Cell* value;
+            int slot = 0;
+            while ((slot = hashNext(cell->mData, slot, &key, &value)) != -1) {
+                stack[depth++] = key;
+                stack[depth++] = value;
+            }
+        }
     }
+    free(stack);
+    return cells;
 }
 
 /****************************************************************
- Helper function for assoc(Cell*, List*) that recursively
- scans the association list in assoc(Cell*, List*) for a match.
+ Helper function for recurse_eval(Cell*) that writes every global
+ to an image file, which the --image option maps back in place of
+ evaluating the code that defined them (see image.h), as in
+
+    (save-image "lib.img")
+
+ The roots of the image are the list of variables, then five per
+ function: its name, its definition, its limit of memoized results
+ or NULL, its body as written and the functions it inlined, both
+ kept for level 2 of the optimization pass, and last the list of
+ the forms defining macros. Compiled functions are
+ left out, as their code is not the interpreter's to write, so
+ their library must be loaded again with --native.
 */
-static Cell* findAssoc(Cell* symbol, Cell* pair)
+static List* saveImage(Cell* cell, List* environment)
 {
-    // Bail out early if NULL (in the case that the cell itself contains #f or empty list)
-    if (pair->mSub == NULL) {
+    mCacheable = 0;
+    char* path = fileName("save-image", cell, environment);
+    if (path == NULL) return wrapStructure(FALSE);
+
+    int capacity = 2 + 5 * (mFunctions->mCount > 0 ? mFunctions->mCount : 1);
+    Cell** roots = malloc(sizeof(Cell*) * capacity);
+    int count = 0;
+    roots[count++] = mAssocVars->mStructure;
+    Cell* key;
+    Cell* definition;
+    int i = 0;
+    while ((i = hashNext(mFunctions, i, &key, &definition)) != -1) {
+        if (definition->mNext->mSub != NULL && definition->mNext->mSub->mType == CELL_NATIVE) continue;
+        roots[count++] = key;
+        roots[count++] = definition;
+        MemoTable* memo = definition->mData;
+        roots[count++] = memo != NULL ? wrapNumber(memo->mLimit)->mStructure : NULL;
+        roots[count++] = mSources != NULL ? hashGet(mSources, key) : NULL;
+        roots[count++] = mInlined != NULL ? hashGet(mInlined, key) : NULL;
+    }
+    Cell* macros = NULL;
+    i = 0;
+    while (mMacros != NULL && (i = hashNext(mMacros, i, &key, &definition)) != -1) {
+        Cell* link = iniCell();
+        link->mSub = definition;
+        link->mNext = macros;
+        macros = link;
+    }
+    roots[count++] = macros;
+    Cell* fixed[] = { TRUE, FALSE, mNoMatch };
+    int saved = writeImage(path, roots, count, fixed, 3);
+    free(roots);
+    free(path);
+    return wrapStructure(saved ? TRUE : FALSE);
+}
+
+/****************************************************************
+ Helper giving the newly allocated file name that the builtin
+ named by the first parameter is called with, as in (load "a.scm"),
+ or NULL after reporting an error. A string keeps its quotes in
+ the symbol, which are dropped.
+*/
+static char* fileName(char* builtin, Cell* cell, List* environment)
+{
+    if (cell->mNext == NULL) {
+        reportError(builtin, "missing file name");
         return NULL;
     }
+    Cell* name = recurse_eval(cell->mNext->mSub, environment)->mStructure;
+    if (name == NULL || name->mSymbol == NULL) {
+        reportError(builtin, "file name is not a string");
+        return NULL;
+    }
+    char* path = name->mSymbol;
+    int length = strlen(path);
+    char* unquoted = malloc(sizeof(char) * (length + 1));
+    if (length >= 2 && path[0] == '"' && path[length - 1] == '"') {
+        memcpy(unquoted, path + 1, length - 2);
+        unquoted[length - 2] = '\0';
+    } else strcpy(unquoted, path);
+    return unquoted;
+}
 
-    // Find the lowest Cell* with a symbol
-    Cell* focus = pair;
-    while (focus->mSub != NULL)
-        focus = focus->mSub;
+/****************************************************************
+ Helper function for recurse_eval(Cell*) that evaluates every top
+ level form of a file in turn, as if typed at the prompt, without
+ printing the results, as in
 
-    if (focus != pair && strcmp(symbol->mSymbol, focus->mSymbol) == 0) {
-        return pair->mSub;
-    } else if (pair->mNext != NULL) {
-        return findAssoc(symbol, pair->mNext);
-    } else return NULL;
+    (load "lib.scm")
+
+ The forms parsed are kept beside the file, in lib.scm.ast, so
+ that loading it again skips the parser (see astcache.h). Like
+ define, nothing is printed.
+*/
+static List* load(Cell* cell, List* environment)
+{
+    mCacheable = 0;
+    char* path = fileName("load", cell, environment);
+    if (path == NULL) return wrapStructure(FALSE);
+    int count;
+    Cell** forms = loadForms(path, &count);
+    free(path);
+    if (forms == NULL) return reportError("load", "cannot read file");
+    int i;
+    for (i = 0; i < count; i++) {
+        Cell* form = expandSyntax(forms[i]);
+        if (form != NULL) recurse_eval(optimize(form), mAssocVars);
+    }
+    free(forms);
+    return NULL;
 }
 
 /****************************************************************
- Helper function for recurse_eval(Cell*) that checks whether or
- not two Lists are equal in content. This function represents
- the keyword "equal?".
+ Helper function for recurse_eval(Cell*) that gives the data of a
+ file as one list, each datum of the file a member, as in
+
+    (define rows (load-data "rows.scm"))
+
+ Lists within are parsed only once reached, by car and cdr or by
+ functions such as assoc, length and equal? (see reader.h), so a
+ large file costs little more than its index until it is used.
 */
-static List* isEqual(List* la, List* lb)
+static List* loadData(Cell* cell, List* environment)
 {
-    // Recursively compare the structure
-    if (la->mStructure != NULL && lb->mStructure != NULL)
-        return wrapStructure(compareEqual(la->mStructure, lb->mStructure));
-        // NULL is equal to NULL
-    else if (la->mStructure == NULL && lb->mStructure == NULL)
-        return wrapStructure(TRUE);
-    else // Not equal all other cases
-        return wrapStructure(FALSE);
+    mCacheable = 0;
+    char* path = fileName("load-data", cell, environment);
+    if (path == NULL) return wrapStructure(FALSE);
+    Cell* data = readData(path);
+    free(path);
+    if (data == NULL) return reportError("load-data", "cannot read data from file");
+    return wrapStructure(data);
 }
 
 /****************************************************************
- Helper function for isEqual(List*, List*) to recursively
- compare the two Lists for equality.
+ Helper function for recurse_eval(Cell*) that defines a macro by
+ pattern rules, as in
+
+    (define-syntax my-or
+      (syntax-rules ()
+        ((_) #f)
+        ((_ e) e)
+        ((_ e r ...) (let ((t e)) (if t t (my-or r ...))))))
+
+ Each rule pairs a pattern, a list headed by any keyword, with the
+ template of the code that a use matching it stands for. The
+ symbols in the list after syntax-rules are literals, matching
+ only themselves. Uses are expanded before the input holding them
+ is evaluated (see expandSyntax(Cell*)), so a function body using
+ a macro is kept expanded and a macro costs nothing when called.
+ Like define, nothing is printed.
 */
-static Cell* compareEqual(Cell* c1, Cell* c2)
+static List* defineSyntax(Cell* cell)
 {
-    // Compare symbol
-    if (c1->mSymbol != NULL && c2->mSymbol != NULL) {
-        // Check if symbols are the same
-        if (strcmp(c1->mSymbol, c2->mSymbol) != 0)
-            return FALSE;
-    } else if (((c1->mSymbol == NULL) && (c2->mSymbol != NULL))
-               || ((c1->mSymbol != NULL) && (c2->mSymbol == NULL))) {
-        return FALSE;
+    mCacheable = 0;
+    if (cell->mNext == NULL || cell->mNext->mNext == NULL)
+        return reportError("define-syntax", "missing name or rules");
+    Cell* name = cell->mNext->mSub;
+    if (name->mSub != NULL || name->mSymbol == NULL || name->mType != CELL_PLAIN)
+        return reportError("define-syntax", "not a macro name");
+    if (isBuiltin(name->mSymbol)) return reportError("define-syntax", "cannot redefine a builtin");
+
+    Cell* rules = cell->mNext->mNext->mSub;
+    if (rules->mSub == NULL || rules->mSub->mSymbol == NULL
+        || strcmp(rules->mSub->mSymbol, "syntax-rules") != 0 || rules->mNext == NULL)
+        return reportError("define-syntax", "expected (syntax-rules (literal ...) rule ...)");
+    Cell* literals = rules->mNext->mSub;
+    if (literals->mSub == NULL && strcmp(literals->mSymbol, "()") != 0)
+        return reportError("define-syntax", "literals are not a list");
+    Cell* focus;
+    for (focus = literals->mSub != NULL ? literals : NULL; focus != NULL; focus = focus->mNext)
+        if (focus->mSub->mSub != NULL || focus->mSub->mSymbol == NULL)
+            return reportError("define-syntax", "literal is not a symbol");
+    for (focus = rules->mNext->mNext; focus != NULL; focus = focus->mNext) {
+        Cell* rule = focus->mSub;
+        if (rule->mSub == NULL || rule->mSub->mSub == NULL || rule->mNext == NULL
+            || rule->mNext->mNext != NULL)
+            return reportError("define-syntax", "rule is not (pattern template)");
     }
 
-    // Recurse compare down
-    Cell* equals = TRUE;
-    if ((c1->mSub != NULL) && (c2->mSub != NULL))
-        equals = compareEqual(c1->mSub, c2->mSub);
-    // Branch existence does not match
-    else if (((c1->mSub == NULL) && (c2->mSub != NULL))
-            || ((c1->mSub != NULL) && (c2->mSub == NULL))) {
-        return FALSE;
+    if (mMacros == NULL) mMacros = iniHashTable(equalCells);
+    hashPut(mMacros, name, cell);
+    return NULL;
+}
+
+/****************************************************************
+ Helper that builds an association list pairing each of the given
+ names with its value, for the functions reporting on caches.
+*/
+static List* statsList(char** names, Cell** values, int count)
+{
+    Cell** pairs = malloc(sizeof(Cell*) * count);
+    int i;
+    for (i = 0; i < count; i++) {
+        Cell* pair[2];
+        pair[0] = iniCell();
+        pair[0]->mSymbol = names[i];
+        pair[1] = values[i];
+        pairs[i] = buildList(pair, 2);
     }
+    List* list = wrapStructure(buildList(pairs, count));
+    free(pairs);
+    return list;
+}
 
-    // Bail out early if found reason to not match
-    if (equals == FALSE) return FALSE;
+/****************************************************************
+ Helper that finds the current definition of the user defined
+ function named by the given procedure value, reporting a misuse
+ of the named builtin when there is none.
+*/
+static Cell* memoizedDefinition(char* builtin, Cell* procedure)
+{
+    if (procedure == NULL || procedure->mSymbol == NULL) {
+        reportError(builtin, "not a function");
+        return NULL;
+    }
+    Cell* definition = lookupFunction(procedure);
+    if (definition == NULL) reportError(builtin, "not a user defined function");
+    return definition;
+}
 
-    // Recurse compare on same level
-    if ((c1->mNext != NULL) && (c2->mNext != NULL))
-        equals = compareEqual(c1->mNext, c2->mNext);
-    else if (((c1->mNext != NULL) && (c2->mNext == NULL))
-             || ((c1->mNext == NULL) && (c2->mNext != NULL)))
-        return FALSE;
-    // Assume branch is matched in every way
-    return equals;
+/****************************************************************
+ Helper function for recurse_eval(Cell*) that prints the profile
+ recorded since profiling started, see setProfiling(int). Given
+ 'stacks, as in (profile-report 'stacks), it prints the collapsed
+ stacks of the calls instead, for flamegraph tools. Like define,
+ nothing else is printed.
+*/
+static List* profileReportOf(Cell* cell)
+{
+    fflush(stdout);
+    if (cell->mNext != NULL) {
+        Cell* kind = recurse_eval(cell->mNext->mSub, mAssocVars)->mStructure;
+        if (kind == NULL || kind->mSymbol == NULL || strcmp(kind->mSymbol, "stacks") != 0)
+            return reportError("profile-report", "unknown kind of report");
+        profileStacks(stdout);
+    } else profileReport(stdout);
+    fflush(stdout);
+    return NULL;
 }
 
 /****************************************************************
- Helper function for recurse_eval(Cell*) that appends two Lists
- into one. The second List is tacked onto the end of the first.
+ Helper that resolves a procedure value for applyProcedure(...)
+ given the number of arguments it will be applied to. Returns 0
+ when the value cannot be called, and -1 when it is a user defined
+ function or a closure taking another number of parameters, as
+ these would read past the arguments or ignore some of them.
+
+ A user defined function is applied by binding its formal
+ parameters directly to the argument values. A builtin of
+ recurse_eval(Cell*) is given a reusable call form, (symbol 'slot
+ 'slot ...), so that applying it costs a single dispatch and no
+ environment. Special forms and any other symbol cannot be called.
 */
-static List* append(List* la, List* lb)
+static int prepareProcedure(Cell* procedure, int count, Procedure* applied)
 {
-    Cell* head = appendSubstitute(la->mStructure, lb);
-    return wrapStructure(head);
+    applied->mForm = NULL;
+    applied->mSlots = NULL;
+    applied->mFormals = NULL;
+    applied->mBody = NULL;
+    applied->mMemo = NULL;
+    applied->mClosure = NULL;
+    applied->mCount = count;
+    applied->mName = NULL;
+    if (procedure != NULL && procedure->mType == CELL_CLOSURE) {
+        applied->mClosure = procedure;
+        applied->mName = "(lambda)";
+        // Formals given as a single symbol take any number
+        Cell* formals = ((Closure*) procedure->mData)->mFormals;
+        if (formals->mSub == NULL && strcmp(formals->mSymbol, "()") != 0) return 1;
+        return countFormals(formals->mSub != NULL ? formals : NULL) == count ? 1 : -1;
+    }
+    if (procedure == NULL || procedure->mSymbol == NULL) return 0;
+
+    // Check for a user defined function first
+    Cell* definition = lookupFunction(procedure);
+    if (definition != NULL) {
+        if (countFormals(definition->mSub->mNext) != count) return -1;
+        applied->mFormals = definition->mSub->mNext;
+        applied->mBody = definition->mNext->mSub;
+        applied->mMemo = definition->mData;
+        applied->mName = procedure->mSymbol;
+        return 1;
+    }
+    if (!isBuiltin(procedure->mSymbol)) return 0;
+    int i;
+    for (i = 0; mSpecialForms[i] != NULL; i++)
+        if (strcmp(procedure->mSymbol, mSpecialForms[i]) == 0) return 0;
+    prepareForm(procedure, count, applied);
+    return 1;
 }
 
 /****************************************************************
- Helper function for append(List*, List*) that joins the two
- Lists non-destructively. That is, the original cons cell
- structure remains with their pointers pointing to the original
- individual List structures.
+ Helper that counts the formal parameters of a definition or
+ closure, given the first of them.
 */
-static Cell* appendSubstitute(Cell* cell, List* secondList)
+static int countFormals(Cell* formals)
 {
-    // Create substitute cell
-    Cell* surrogate = iniCell();
-    surrogate->mSub = cell->mSub;
+    int count = 0;
+    Cell* formal;
+    for (formal = formals; formal != NULL; formal = formal->mNext)
+        count++;
+    return count;
+}
 
-    // Build the list along the same level
-    if (cell->mNext != NULL) {
-        surrogate->mNext = appendSubstitute(cell->mNext, secondList);
+/****************************************************************
+ Helper for prepareProcedure(...) giving the named function of
+ recurse_eval(Cell*) a call form, (symbol 'slot 'slot ...), with
+ as many slots as the given number of arguments.
+*/
+static void prepareForm(Cell* procedure, int count, Procedure* applied)
+{
+    applied->mFormals = NULL;
+    applied->mBody = NULL;
+    applied->mMemo = NULL;
+    applied->mClosure = NULL;
+    applied->mCount = count;
+    applied->mName = NULL;
+
+    // Build (symbol (quote slot) (quote slot) ...)
+    Cell* form = iniCell();
+    form->mSub = procedure;
+    applied->mForm = form;
+    applied->mSlots = allocate(sizeof(Cell*) * (count > 0 ? count : 1));
+    Cell* tail = form;
+    int i;
+    for (i = 0; i < count; i++) {
+        Cell* quoted = iniCell();
+        quoted->mSub = iniCell();
+        quoted->mSub->mSymbol = "quote";
+        quoted->mNext = iniCell();
+        applied->mSlots[i] = quoted->mNext;
+
+        tail->mNext = iniCell();
+        tail = tail->mNext;
+        tail->mSub = quoted;
+    }
+}
+
+/****************************************************************
+ Helper that applies a procedure resolved by prepareProcedure(...)
+ to the given evaluated arguments.
+*/
+static List* applyProcedure(Procedure* applied, Cell** args)
+{
+    if (applied->mForm != NULL) {
+        Cell* slot = applied->mForm->mNext;
+        int i;
+        for (i = 0; slot != NULL; i++, slot = slot->mNext)
+            applied->mSlots[i]->mSub = args[i];
+        return recurse_eval(applied->mForm, mAssocVars);
+    }
+    if (mProfiling) profileEnter(applied->mName, 0);
+    List* result;
+    if (applied->mClosure != NULL) result = applyClosure(applied->mClosure, args, applied->mCount);
+    else result = applyDefinition(applied->mFormals, applied->mBody, applied->mMemo, args);
+    if (mProfiling) profileExit();
+    return result;
+}
+
+/****************************************************************
+ Helper that applies a user defined function, given its formal
+ parameters and body, to the given evaluated arguments. When the
+ function is memoized, the arguments are first looked up in its
+ cache, and a result computed on a miss is cached in turn. A
+ compiled function is handed the arguments as they are.
+*/
+static List* applyDefinition(Cell* formals, Cell* body, MemoTable* memo, Cell** args)
+{
+    int count = countFormals(formals);
+    Cell* formal;
+
+    Cell* key = NULL;
+    if (memo != NULL) {
+        key = buildList(args, count);
+        Cell* cached = memoGet(memo, key);
+        if (cached != NULL) {
+            // A cached vector may have changed since it was built
+            if (mRecording && holdsNative(cached)) mCacheable = 0;
+            return wrapStructure(cached);
+        }
+    }
+
+    List* result;
+    if (body->mType == CELL_NATIVE) {
+        result = wrapStructure(((NativeFunction) body->mData)(args));
     } else {
-        // Tack on the second list
-        surrogate->mNext = secondList->mStructure;
+        // Bind each formal parameter to its value without evaluating
+        List* localEnv = iniAssocList();
+        int i;
+        for (i = 0, formal = formals; formal != NULL; i++, formal = formal->mNext)
+            localEnv = define(wrapStructure(formal->mSub), wrapStructure(args[i]), localEnv);
+        result = recurse_eval(body, localEnv);
     }
 
-    return surrogate;
+    if (memo != NULL && result != NULL && result->mStructure != NULL)
+        memoPut(memo, key, result->mStructure);
+    return result;
 }
 
 /****************************************************************
- Helper function for recurse_eval(Cell*) that evaluates a
- condition and returns an expression if the condition evaluates
- to TRUE. This function supports the keyword "else".
+ Helper that makes a closure with the given formal parameters and
+ body, copying from the given environment the value of every
+ variable the body may use that is bound there locally. The
+ variables a body may use are found once and kept on the given
+ form (see freeVariables(...)), along with the body converted to
+ read them from frames, which every closure made by the form
+ shares. When a name is given, the closure is also bound to it, so
+ that it can call itself.
 */
-static List* cond(Cell* cell, List* environment)
+static Cell* makeClosure(Cell* form, Cell* formals, Cell* body, List* environment, Cell* name)
 {
-    Cell* pairParent = cell->mNext;
-    while (pairParent != NULL) {
+    Cell* candidates = freeVariables(form, formals, body);
+    int count = name != NULL ? 1 : 0;
+    Cell* candidate;
+    for (candidate = candidates; candidate != NULL; candidate = candidate->mNext)
+        count++;
 
-        // Check for else keyword if should directly evaluate
-        if ((pairParent->mSub != NULL) && (pairParent->mSub->mSub != NULL)
-            && (pairParent->mSub->mSub->mSymbol != NULL)
-            && ((strcmp(pairParent->mSub->mSub->mSymbol, "else") == 0)
-                || (strcmp(pairParent->mSub->mSub->mSymbol, "#t") == 0)))
-            return recurse_eval(pairParent->mSub->mNext->mSub, environment);
-        // Resolve condition
-        List* resolution = recurse_eval(pairParent->mSub->mSub, environment);
-        // Evaluate expression if condition is true
-        if (resolution->mStructure == TRUE)
-            return recurse_eval(pairParent->mSub->mNext->mSub, environment);
-        // Focus on next predicate expression pair
-        pairParent = pairParent->mNext;
+    Closure* closure = allocate(sizeof(Closure));
+    closure->mFormals = formals;
+    closure->mBody = body;
+    closure->mNames = allocate(sizeof(Cell*) * (count > 0 ? count : 1));
+    closure->mValues = allocate(sizeof(Cell*) * (count > 0 ? count : 1));
+    closure->mCount = 0;
+    for (candidate = candidates; candidate != NULL; candidate = candidate->mNext) {
+        if (name != NULL && strcmp(candidate->mSub->mSymbol, name->mSymbol) == 0) continue;
+        closure->mNames[closure->mCount] = candidate->mSub;
+        closure->mValues[closure->mCount++] = localValue(candidate->mSub, environment);
     }
-    // Return an empty list (equivalent to NULL and FALSE)
-    return wrapStructure(FALSE);
+
+    Cell* made = iniCell();
+    made->mType = CELL_CLOSURE;
+    made->mData = closure;
+    if (name != NULL) {
+        closure->mNames[closure->mCount] = name;
+        closure->mValues[closure->mCount++] = made;
+    }
+    Cell* kept = form->mData;
+    closure->mCode = kept->mSub;
+    kept->mSub = closureCode(closure);
+    return made;
 }
 
 /****************************************************************
- Helper function for recurse_eval(Cell*) that evaluates a
- condition and returns an expression if the condition evaluates
- to TRUE, and another expression if FALSE.
+ Helper for makeClosure(...) giving the value bound to a symbol in
+ the given environment by a let, a parameter or the like, or NULL
+ when it is unbound there or bound globally.
 */
-static List* alternateIf(Cell* cell, List* environment)
+static Cell* localValue(Cell* symbol, List* environment)
 {
-    Cell* condition = cell->mNext->mSub;
-    List* resolution = recurse_eval(condition, environment);
-    if (resolution->mStructure == TRUE)
-        return recurse_eval(cell->mNext->mNext->mSub, environment);
-    else
-        return recurse_eval(cell->mNext->mNext->mNext->mSub, environment);
+    Cell* element;
+    for (element = environment->mStructure; element != NULL; element = element->mNext) {
+        if (element == mAssocVars->mStructure) return NULL;
+        if (element->mType == CELL_VECTOR) {
+            Vector* vector = element->mData;
+            Closure* closure = vector->mItems[0]->mData;
+            int index = slotIndex(closure, symbol);
+            if (index < 0) return NULL;
+            if (index < vector->mLength - 1) return vector->mItems[index + 1];
+            return closure->mValues[index - (vector->mLength - 1)];
+        }
+        if (element->mSub == NULL) return NULL;
+        if (bindsSymbol(element, symbol)) return cadr(wrapStructure(element->mSub))->mStructure;
+    }
+    return NULL;
 }
 
 /****************************************************************
- Helper function for recurse_eval(Cell*) that binds the given
- value to the given name. Currently, this function only binds
- values to names once per runtime of the program. That is,
- binding to name "dog" a second time will not change the value
- until the program is restarted.
+ Helper that applies a closure to the given evaluated arguments.
+ The body runs in an environment of its own, ending with a frame
+ of the closure and the arguments, so reading a variable is an
+ index into the frame (see Closure).
 */
-static List* define(List* symbol, List* value, List* environment)
+static List* applyClosure(Cell* procedure, Cell** args, int count)
 {
+    Closure* closure = procedure->mData;
+    Cell* formals = closure->mFormals;
+    if (formals->mSub != NULL && count < countFormals(formals))
+        return reportError("lambda", "too few parameters");
+    return evalBody(closureCode(closure), wrapStructure(makeFrame(procedure, args, count)));
+}
 
-    // Bury the values one level deep
-    Cell* emptyList = iniCell();
-    emptyList->mSymbol = malloc(sizeof(char) * 20);
-    strcpy(emptyList->mSymbol, "#f");
-    List* droppedLevel = cons(value, wrapStructure(emptyList));
+/****************************************************************
+ Helper for applyClosure(...) making the frame of a call, a
+ CELL_VECTOR Cell holding the closure followed by its parameters.
+ Formals given as a single symbol take the list of all arguments.
+*/
+static Cell* makeFrame(Cell* procedure, Cell** args, int count)
+{
+    Cell* formals = ((Closure*) procedure->mData)->mFormals;
+    int params = count;
+    if (formals->mSub != NULL) params = countFormals(formals);
+    else params = strcmp(formals->mSymbol, "()") != 0 ? 1 : 0;
 
-    // Insert the symbol into the pair
-    List* pair = cons(symbol, droppedLevel);
+    Vector* vector = allocateAt(sizeof(Vector), SITE_ENVIRONMENT);
+    vector->mLength = params + 1;
+    vector->mItems = allocateAt(sizeof(Cell*) * (params + 1), SITE_ENVIRONMENT);
+    vector->mItems[0] = procedure;
+    if (formals->mSub != NULL) memcpy(vector->mItems + 1, args, sizeof(Cell*) * params);
+    else if (params == 1) vector->mItems[1] = buildList(args, count);
 
-    // Add to variable association list
-    environment = cons(pair, environment);
-    return environment;
+    Cell* frame = iniCellAt(SITE_ENVIRONMENT);
+    frame->mType = CELL_VECTOR;
+    frame->mData = vector;
+    return frame;
+}
+
+/****************************************************************
+ Helper giving the body of a closure with its reads of parameters
+ and of the variables of mNames turned into CELL_SLOT Cells that
+ index its frames (see Closure). The body is copied, and only the
+ parts that hold such reads.
+*/
+static Cell* closureCode(Closure* closure)
+{
+    if (closure->mCode != NULL) return closure->mCode;
+    Cell* head = iniCell();
+    Cell* tail = head;
+    Cell* expression;
+    for (expression = closure->mBody; expression != NULL; expression = expression->mNext) {
+        tail->mNext = iniCell();
+        tail = tail->mNext;
+        tail->mSub = convertExpression(expression->mSub, closure, NULL);
+    }
+    closure->mCode = head->mNext;
+    return closure->mCode;
+}
+
+/****************************************************************
+ Helper for closureCode(Closure*) converting an expression of the
+ body of a closure. The given chain holds the variables bound by
+ the let forms the expression is within, which are read by name.
+ Quoted data and the forms that keep code to run later, such as
+ lambda, delay or a named let, are left as they are and read their
+ variables by name too, as do builtins passed as values.
+*/
+static Cell* convertExpression(Cell* expression, Closure* closure, Cell* shadowed)
+{
+    if (expression == NULL) return NULL;
+    if (expression->mSub == NULL) {
+        if (expression->mSymbol == NULL || expression->mType != CELL_PLAIN || isBuiltin(expression->mSymbol))
+            return expression;
+        Cell* bound;
+        for (bound = shadowed; bound != NULL; bound = bound->mNext)
+            if (strcmp(bound->mSub->mSymbol, expression->mSymbol) == 0) return expression;
+        int index = slotIndex(closure, expression);
+        if (index < 0) return expression;
+        Cell* slot = iniCell();
+        slot->mSymbol = expression->mSymbol;
+        slot->mType = CELL_SLOT;
+        slot->mFixnum = index;
+        return slot;
+    }
+
+    char* sym = expression->mSub->mSymbol;
+    if (sym != NULL && expression->mSub->mSub == NULL) {
+        if (strcmp(sym, "quote") == 0 || strcmp(sym, "lambda") == 0 || strcmp(sym, "define") == 0
+            || strcmp(sym, "define-memo") == 0 || strcmp(sym, "define-syntax") == 0
+            || strcmp(sym, "delay") == 0 || strcmp(sym, "cons-stream") == 0)
+            return expression;
+        if (strcmp(sym, "let") == 0 || strcmp(sym, "let*") == 0 || strcmp(sym, "letrec") == 0) {
+            if (expression->mNext == NULL) return expression;
+            Cell* bindings = expression->mNext->mSub;
+            if (bindings->mSub == NULL) return expression;
+            Cell* binding;
+            for (binding = bindings; binding != NULL; binding = binding->mNext) {
+                if (binding->mSub == NULL || binding->mSub->mSub == NULL) return expression;
+                Cell* link = iniCell();
+                link->mSub = binding->mSub->mSub;
+                link->mNext = shadowed;
+                shadowed = link;
+            }
+        }
+    }
+
+    Cell* head = iniCell();
+    Cell* tail = head;
+    Cell* part;
+    for (part = expression; part != NULL; part = part->mNext) {
+        if (part != expression) {
+            tail->mNext = iniCell();
+            tail = tail->mNext;
+        }
+        tail->mSymbol = part->mSymbol;
+        tail->mSub = convertExpression(part->mSub, closure, shadowed);
+    }
+    return head;
+}
+
+/****************************************************************
+ Helper for recurse_eval(Cell*) that calls a closure with the
+ operands of the given call evaluated in the given environment.
+*/
+static List* callClosure(Cell* procedure, Cell* cell, List* environment)
+{
+    int count = 0;
+    Cell* param;
+    for (param = cell->mNext; param != NULL; param = param->mNext)
+        count++;
+    Cell** args = malloc(sizeof(Cell*) * (count > 0 ? count : 1));
+    int i = 0;
+    for (param = cell->mNext; param != NULL; param = param->mNext)
+        args[i++] = recurse_eval(param->mSub, environment)->mStructure;
+    List* result = applyClosure(procedure, args, count);
+    free(args);
+    return result;
+}
+
+/****************************************************************
+ Helper giving the symbols that a body may use as variables other
+ than the given formal parameters. The chain is worked out when
+ the given form is first evaluated and kept in its mData member,
+ behind a head cell so that an empty chain is kept too. Symbols
+ bound inside the body may be included, which only costs a lookup.
+*/
+static Cell* freeVariables(Cell* form, Cell* formals, Cell* body)
+{
+    if (form->mData == NULL) {
+        Cell* head = iniCell();
+        Cell* expression;
+        for (expression = body; expression != NULL; expression = expression->mNext)
+            collectFree(expression->mSub, formals, &head->mNext);
+        form->mData = head;
+    }
+    return ((Cell*) form->mData)->mNext;
 }
 
 /****************************************************************
- Helper function for recurse_eval(Cell*) that binds the given
- name and formal parameters to the given expression. Currently,
- this function only binds values to names once per runtime of
- the program. That is, binding to function name "add" a second
- time will not change the function definition until the program
- is restarted.
+ Helper for freeVariables(...) adding to the given chain every
+ symbol in an expression that may name a variable: not quoted, not
+ a number, #t or #f, not a formal parameter and not a builtin being
+ called.
 */
-static List* defineFunction(List* nameParams, List* expression)
+static void collectFree(Cell* expression, Cell* formals, Cell** found)
 {
-    // Bury the values one level deep
-    Cell* emptyList = iniCell();
-    emptyList->mSymbol = malloc(sizeof(char) * 20);
-    strcpy(emptyList->mSymbol, "#f");
-    List* droppedLevel = cons(expression, wrapStructure(emptyList));
-
-    // Insert the symbol into the pair
-    List* pair = cons(nameParams, droppedLevel);
-
-    // Add to variable association list
-    mAssocFns = cons(pair, mAssocFns);
+    if (expression == NULL) return;
+    if (expression->mSub == NULL) {
+        if (expression->mSymbol == NULL || tagNumber(expression) || isFormal(expression, formals)
+            || strcmp(expression->mSymbol, "#t") == 0 || strcmp(expression->mSymbol, "#f") == 0
+            || strcmp(expression->mSymbol, "()") == 0) return;
+        Cell* known;
+        for (known = *found; known != NULL; known = known->mNext)
+            if (strcmp(known->mSub->mSymbol, expression->mSymbol) == 0) return;
+        Cell* link = iniCell();
+        link->mSub = expression;
+        link->mNext = *found;
+        *found = link;
+        return;
+    }
 
-    // Return nothing
-    return NULL;
+    Cell* head = expression->mSub;
+    if (head->mSymbol != NULL && strcmp(head->mSymbol, "quote") == 0) return;
+    Cell* part;
+    for (part = expression; part != NULL; part = part->mNext) {
+        if (part == expression && head->mSymbol != NULL && isBuiltin(head->mSymbol)) continue;
+        collectFree(part->mSub, formals, found);
+    }
 }
 
 /****************************************************************
- Helper function for the shorthand support of calling cdr(List*)
- within car(List*).
+ Helper checking whether an atom names one of the given formal
+ parameters, be they a list or a single symbol.
 */
-static List* cadr(List* list)
+static int isFormal(Cell* atom, Cell* formals)
 {
-    return car(cdr(list));
+    if (formals->mSub == NULL)
+        return formals->mSymbol != NULL && strcmp(formals->mSymbol, atom->mSymbol) == 0;
+    Cell* formal;
+    for (formal = formals; formal != NULL; formal = formal->mNext)
+        if (formal->mSub->mSymbol != NULL && strcmp(formal->mSub->mSymbol, atom->mSymbol) == 0)
+            return 1;
+    return 0;
 }
 
 /****************************************************************
- Helper function for the shorthand support of calling
- car(cdr(cdr(List*)))).
+ Helper giving the value bound to a symbol in the given
+ environment, or NULL when it is not bound.
 */
-static List* caddr(List* list)
+static Cell* lookupVariable(Cell* symbol, List* environment)
 {
-    return car(cdr(cdr(list)));
+    if (symbol == NULL || symbol->mSymbol == NULL) return NULL;
+    List* value = variableOf(symbol, environment);
+    return value != NULL ? value->mStructure : NULL;
 }
 
 /****************************************************************
- Helper function for the shorthand support of calling
- car(cdr(cdr(cdr(List*)))).
+ Helper giving the value bound to a symbol in the given
+ environment, or NULL when it is not bound. Bindings are searched
+ up to the frame of the closure being applied, if any (see
+ Closure), past which the symbol is read from the frame, or from
+ the global environment as it is now when the closure left it
+ unbound. A CELL_SLOT Cell reads its frame directly.
 */
-static List* cadddr(List* list)
+static List* variableOf(Cell* symbol, List* environment)
 {
-    return car(cdr(cdr(cdr(list))));
+    Cell* element;
+    if (symbol->mType == CELL_SLOT) {
+        // Only the variables bound by the forms a slot is outside of
+        // come before its frame
+        for (element = environment->mStructure; element != NULL; element = element->mNext)
+            if (element->mType == CELL_VECTOR) return slotVariable(element, symbol->mFixnum);
+    }
+    if (environment == mAssocVars) return globalVariable(symbol);
+    for (element = environment->mStructure; element != NULL; element = element->mNext) {
+        if (element->mType == CELL_VECTOR) {
+            int index = slotIndex(((Vector*) element->mData)->mItems[0]->mData, symbol);
+            if (index >= 0) return slotVariable(element, index);
+            // Numbers and the like are never bound
+            if (tagNumber(symbol) || strcmp(symbol->mSymbol, "#t") == 0
+                || strcmp(symbol->mSymbol, "#f") == 0 || strcmp(symbol->mSymbol, "()") == 0)
+                return NULL;
+            return globalVariable(symbol);
+        }
+        if (element->mSub == NULL) return NULL;
+        if (bindsSymbol(element, symbol)) return cadr(wrapStructure(element->mSub));
+    }
+    return NULL;
 }
 
 /****************************************************************
- Helper function for the shorthand support of calling
- car(cdr(cdr(cdr(cdr(List*))))).
+ Helper for variableOf(Cell*, List*) giving the value of the
+ variable at the given index of a frame, or NULL when it is a
+ global that is not bound.
 */
-static List* caddddr(List* list)
+static List* slotVariable(Cell* frame, int index)
 {
-    return car(cdr(cdr(cdr(cdr(list)))));
+    Vector* vector = frame->mData;
+    Closure* closure = vector->mItems[0]->mData;
+    int params = vector->mLength - 1;
+    if (index < params) return wrapStructure(vector->mItems[index + 1]);
+    Cell* value = closure->mValues[index - params];
+    if (value != NULL) return wrapStructure(value);
+    return globalVariable(closure->mNames[index - params]);
 }
 
-
 /****************************************************************
- Helper function for the shorthand support of calling car(List*)
- within cdr(List*).
+ Helper for variableOf(Cell*, List*) giving the value of a global
+ variable, or NULL when it is not bound.
 */
-static List* cdar(List* list)
+static List* globalVariable(Cell* symbol)
 {
-    return cdr(car(list));
+    List* associated = assoc(symbol, mAssocVars);
+    if (associated->mStructure->mSymbol != NULL
+        && (strcmp(associated->mStructure->mSymbol, "#f") == 0))
+        return NULL;
+    return cadr(associated);
 }
 
 /****************************************************************
- Helper function for recurse_eval(Cell*) that wraps the given
- parameters into a list.
+ Helper giving the symbol a CELL_SLOT Cell reads, as the variables
+ of a frame are named by the atoms of the body of its closure.
 */
-static List* makeList(Cell* cell, List* environment)
+static Cell* slotName(Cell* slot, List* environment)
 {
-    Cell* parent = cell->mNext;
-    List* list = malloc(sizeof(List));
-    list->mStructure = iniCell();
-    Cell* tail = list->mStructure;
-    while (parent != NULL) {
-        // Evaluate member to attach
-        List* toJoin = recurse_eval(parent->mSub, environment);
-
-        // Attach evaluation to list and move to next member
-        tail->mSub = toJoin->mStructure;
-        parent = parent->mNext;
-
-        // Prep next attachment
-        if (parent != NULL) {
-            tail->mNext = iniCell();
-            tail = tail->mNext;
-        }
+    Cell* element;
+    for (element = environment->mStructure; element != NULL; element = element->mNext) {
+        if (element->mType != CELL_VECTOR) continue;
+        Vector* vector = element->mData;
+        Closure* closure = vector->mItems[0]->mData;
+        int index = slot->mFixnum - (vector->mLength - 1);
+        if (index >= 0 && index < closure->mCount) return closure->mNames[index];
+        break;
     }
-    return list;
+    return slot;
 }
 
 /****************************************************************
- Helper function for recurse_eval(Cell*) that gets the last
- member of a list.
+ Helper giving the index in the frames of the given closure of the
+ variable named by the given atom, or -1 when it has none. The
+ parameters come first and shadow the variables of mNames, of
+ which a later one shadows an earlier one, as the closure's own
+ name of a named let comes last.
 */
-static List* last(List* list)
+static int slotIndex(Closure* closure, Cell* atom)
 {
-    Cell* focus = list->mStructure;
-    while (focus != NULL) {
-        if (focus->mNext != NULL) focus = focus->mNext;
-        else break;
+    Cell* formals = closure->mFormals;
+    int params = 0;
+    if (formals->mSub != NULL) {
+        Cell* formal;
+        for (formal = formals; formal != NULL; formal = formal->mNext, params++)
+            if (formal->mSub->mSymbol != NULL && strcmp(formal->mSub->mSymbol, atom->mSymbol) == 0)
+                return params;
+    } else if (strcmp(formals->mSymbol, "()") != 0) {
+        if (strcmp(formals->mSymbol, atom->mSymbol) == 0) return 0;
+        params = 1;
     }
-    return wrapStructure(focus->mSub);
+    int i;
+    for (i = closure->mCount - 1; i >= 0; i--)
+        if (closure->mNames[i]->mSymbol == atom->mSymbol
+            || strcmp(closure->mNames[i]->mSymbol, atom->mSymbol) == 0) return params + i;
+    return -1;
 }
 
 /****************************************************************
- Helper function for recurse_eval(Cell*) that counts the number
- of members in the given list.
+ Helper that makes a promise to evaluate the given expression in
+ the given environment. Each define gives the global environment a
+ new head, so a promise made at top level keeps none and is forced
+ in the global environment as it is then, which lets a stream refer
+ to itself, as in (define ones (cons-stream 1 ones)).
 */
-static List* length(List* list)
+static Cell* makePromise(Cell* expression, List* environment)
 {
-    int count = 0;
+    Promise* promise = allocate(sizeof(Promise));
+    promise->mExpression = expression;
+    promise->mEnvironment = environment != mAssocVars ? environment : NULL;
+    promise->mValue = NULL;
 
-    // Count the length if the structure isn't empty
-    if (isEmptyStructure(list->mStructure) != 1) {
-        Cell* focus = list->mStructure;
-        while (focus != NULL) {
-            count++;
-            focus = focus->mNext;
+    Cell* made = iniCell();
+    made->mType = CELL_PROMISE;
+    made->mData = promise;
+    return made;
+}
+
+/****************************************************************
+ Helper giving the value of a promise, evaluated the first time
+ only, or the given value when it is not a promise. Should the
+ promise be forced again while its expression is evaluated, the
+ value computed first is the one kept.
+*/
+static Cell* forceValue(Cell* value)
+{
+    if (value == NULL || value->mType != CELL_PROMISE) return value;
+    Promise* promise = value->mData;
+    if (promise->mExpression != NULL) {
+        List* environment = promise->mEnvironment != NULL ? promise->mEnvironment : mAssocVars;
+        List* result = recurse_eval(promise->mExpression, environment);
+        if (promise->mExpression != NULL) {
+            promise->mValue = result != NULL ? result->mStructure : FALSE;
+            promise->mExpression = NULL;
+            promise->mEnvironment = NULL;
         }
     }
-    // Generate List and convert number to string
-    List* countList = malloc(sizeof(List));
-    countList->mStructure = iniCell();
-    countList->mStructure->mSymbol = malloc(sizeof(char) * 20);
-    sprintf(countList->mStructure->mSymbol, "%i", count);
-    return countList;
+    return promise->mValue;
 }
 
 /****************************************************************
- Helper function for recurse_eval(Cell*) that adds any number
- of numerical atoms.
+ Helper that makes a promise to call the named stream function on
+ two values already evaluated, as (name 'first 'second), so that
+ the stream functions can put off the rest of their work.
 */
-static List* add(Cell* cell, List* environment)
+static Cell* delayedCall(char* name, Cell* first, Cell* second)
 {
-    Cell* parent = cell->mNext;
-    int sum = 0;
-    while (parent != NULL) {
-        List* member = recurse_eval(parent->mSub, environment);
-        sum += atoi(member->mStructure->mSymbol);
-
-        parent = parent->mNext;
+    Cell* form = iniCell();
+    form->mSub = iniCell();
+    form->mSub->mSymbol = name;
+    Cell* tail = form;
+    Cell* values[2] = { first, second };
+    int i;
+    for (i = 0; i < 2; i++) {
+        tail->mNext = iniCell();
+        tail = tail->mNext;
+        tail->mSub = iniCell();
+        tail->mSub->mSub = iniCell();
+        tail->mSub->mSub->mSymbol = "quote";
+        tail->mSub->mNext = iniCell();
+        tail->mSub->mNext->mSub = values[i];
     }
+    return makePromise(form, mAssocVars);
+}
 
-    Cell* num = iniCell();
-    char* numSym = malloc(sizeof(char) * 20);
-    sprintf(numSym, "%i", sum);
-    num->mSymbol = numSym;
+/****************************************************************
+ Helper evaluating a chain of expressions in turn, giving the
+ value of the last one.
+*/
+static List* evalBody(Cell* body, List* environment)
+{
+    List* result = wrapStructure(FALSE);
+    for (; body != NULL; body = body->mNext)
+        result = recurse_eval(body->mSub, environment);
+    return result;
+}
 
-    return wrapStructure(num);
+/****************************************************************
+ Helper that gives the first cons cell of an evaluated list, or
+ NULL when the given value is not a list with members (an atom,
+ native data, #t / #f or the empty list). Members are found by
+ following mNext for as long as the cell has a non-NULL mSub.
+*/
+static Cell* firstMember(Cell* cell)
+{
+    forceData(cell);
+    if (cell == NULL || cell == TRUE || cell == FALSE
+        || cell->mSymbol != NULL || cell->mType != CELL_PLAIN
+        || cell->mSub == NULL) return NULL;
+    return cell;
 }
 
 /****************************************************************
- Helper function for recurse_eval(Cell*) that subtracts any
- number of numerical atoms.
+ Helper that copies the members of an evaluated list into a new
+ array and gives their count through the second parameter.
 */
-static List* subtract(Cell* cell, List* environment)
+static Cell** listMembers(Cell* list, int* count)
 {
-    Cell* parent = cell->mNext;
-    List* firstNum = recurse_eval(parent->mSub, environment);
-    int difference = atoi(firstNum->mStructure->mSymbol);
-    parent = parent->mNext;
+    Cell* focus;
+    int length = 0;
+    for (focus = firstMember(list); focus != NULL && focus->mSub != NULL; focus = focus->mNext)
+        length++;
 
-    // Begin subtracting all other numbers
-    while (parent != NULL) {
-        List* member = recurse_eval(parent->mSub, environment);
-        difference -= atoi(member->mStructure->mSymbol);
+    Cell** members = malloc(sizeof(Cell*) * (length > 0 ? length : 1));
+    int i = 0;
+    for (focus = firstMember(list); i < length; focus = focus->mNext)
+        members[i++] = focus->mSub;
+    *count = length;
+    return members;
+}
 
-        parent = parent->mNext;
+/****************************************************************
+ Helper that packs the given values into a new array of integers
+ for the kernels of Numeric. Returns NULL unless every value is
+ an integer atom that fits in a long.
+*/
+static long* packFixnums(Cell** items, int count)
+{
+    long* packed = malloc(sizeof(long) * (count > 0 ? count : 1));
+    int i;
+    for (i = 0; i < count; i++) {
+        Number value = numberOf(items[i]);
+        if (value.mKind != NUMBER_FIXNUM) break;
+        packed[i] = value.mFixnum;
     }
-
-    Cell* num = iniCell();
-    char* numSym = malloc(sizeof(char) * 20);
-    sprintf(numSym, "%i", difference);
-    num->mSymbol = numSym;
-
-    return wrapStructure(num);
+    if (i < count) {
+        free(packed);
+        return NULL;
+    }
+    return packed;
 }
 
 /****************************************************************
- Helper function for recurse_eval(Cell*) that multiplies any
- number of numerical atoms.
+ Helper that packs the given values into a new array of doubles
+ for the flonum kernels of Numeric. Returns NULL unless every value
+ is a numerical atom. Integers alone must stay exact, so callers
+ only pack values once countFlonums(Cell**, int) finds flonums.
 */
-static List* multiply(Cell* cell, List* environment)
+static double* packFlonums(Cell** items, int count)
 {
-    Cell* parent = cell->mNext;
-    int product = 1;
-    while (parent != NULL) {
-        List* member = recurse_eval(parent->mSub, environment);
-        product *= atoi(member->mStructure->mSymbol);
-
-        parent = parent->mNext;
+    double* packed = malloc(sizeof(double) * (count > 0 ? count : 1));
+    int i;
+    for (i = 0; i < count; i++) {
+        Number value = numberOf(items[i]);
+        if (value.mKind == NUMBER_NONE) break;
+        packed[i] = doubleOf(value);
     }
-
-    Cell* num = iniCell();
-    char* numSym = malloc(sizeof(char) * 20);
-    sprintf(numSym, "%i", product);
-    num->mSymbol = numSym;
-
-    return wrapStructure(num);
+    if (i < count) {
+        free(packed);
+        return NULL;
+    }
+    return packed;
 }
 
 /****************************************************************
- Helper function for recurse_eval(Cell*) that evaluates to TRUE
- if all given parameters also evaluate to TRUE. Otherwise, this
- function returns FALSE.
+ Helper counting how many of the given values are flonums.
 */
-static List* logicAnd(Cell* cell, List* environment)
+static int countFlonums(Cell** items, int count)
 {
-    Cell* parent = cell->mNext;
-
-    while (parent != NULL) {
-        List* resolution = recurse_eval(parent->mSub, environment);
-        if (resolution->mStructure == FALSE) return wrapStructure(FALSE);
-        parent = parent->mNext;
-    }
-    return wrapStructure(TRUE);
+    int flonums = 0;
+    int i;
+    for (i = 0; i < count; i++)
+        if (items[i] != NULL && items[i]->mType == CELL_FLONUM) flonums++;
+    return flonums;
 }
 
 /****************************************************************
- Helper function for recurse_eval(Cell*) that evaluates to TRUE
- if at least one of its given parameters evaluate to TRUE. If
- none evaluate to TRUE, this function returns FALSE.
+ Helper for sort(Cell*, List*) sorting the given members in place
+ with a merge sort, using the scratch array of the same count.
+ Halves already in order are not merged, so a sorted list costs a
+ single comparison per member.
 */
-static List* logicOr(Cell* cell, List* environment)
+static void sortMembers(Cell** members, Cell** scratch, int count, Procedure* applied, int direction)
 {
-    Cell* parent = cell->mNext;
+    if (count < 2) return;
+    int half = count / 2;
+    sortMembers(members, scratch, half, applied, direction);
+    sortMembers(members + half, scratch + half, count - half, applied, direction);
+    if (!sortsBefore(members[half], members[half - 1], applied, direction)) return;
+    mergeMembers(members, half, members + half, count - half, scratch, applied, direction);
+    memcpy(members, scratch, sizeof(Cell*) * count);
+}
 
-    while (parent != NULL) {
-        List* resolution = recurse_eval(parent->mSub, environment);
-        if (resolution->mStructure == TRUE) return wrapStructure(TRUE);
-        parent = parent->mNext;
+/****************************************************************
+ Helper for sortMembers(...) merging two sorted arrays into the
+ output. A member of the second array goes first only when it
+ sorts before, which keeps the sort stable.
+*/
+static void mergeMembers(Cell** a, int countA, Cell** b, int countB, Cell** output,
+                         Procedure* applied, int direction)
+{
+    int i = 0;
+    int j = 0;
+    int k = 0;
+    while (i < countA && j < countB) {
+        if (sortsBefore(b[j], a[i], applied, direction)) output[k++] = b[j++];
+        else output[k++] = a[i++];
     }
-    return wrapStructure(FALSE);
+    while (i < countA)
+        output[k++] = a[i++];
+    while (j < countB)
+        output[k++] = b[j++];
 }
 
 /****************************************************************
- Helper function for recurse_eval(Cell*) that inverts the
- evaluated value of its given parameter. If its parameter's
- evaluation returns TRUE, this function returns FALSE. If the
- parameter evaluates to FALSE, this function returns TRUE.
+ Helper for sortMembers(...) checking whether the first member
+ goes before the second, comparing numbers directly when given a
+ direction, 1 for < and -1 for >, and otherwise calling the
+ procedure.
 */
-static List* logicNot(List* list)
+static int sortsBefore(Cell* c1, Cell* c2, Procedure* applied, int direction)
 {
-    if (list->mStructure == TRUE) return wrapStructure(FALSE);
-    else return wrapStructure(TRUE);
+    if (direction != 0) return compareNumbers(numberOf(c1), numberOf(c2)) * direction < 0;
+    Cell* args[2] = { c1, c2 };
+    List* result = applyProcedure(applied, args);
+    return result != NULL && result->mStructure == TRUE;
 }
 
 /****************************************************************
- Helper function for recurse_eval(Cell*) that checks whether or
- not a numerical atom is less than another numerical atom.
+ Helper that strings the given values into a new list in a single
+ forward pass. No members produces the empty list.
 */
-static List* lessThan(List* la, List* lb)
+static Cell* buildList(Cell** items, int count)
 {
-    int num1 = atoi(la->mStructure->mSymbol);
-    int num2 = atoi(lb->mStructure->mSymbol);
-    if (num1 < num2) return wrapStructure(TRUE);
-    else return wrapStructure(FALSE);
+    Cell* head = iniCell();
+    Cell* tail = head;
+    int i;
+    for (i = 0; i < count; i++) {
+        if (i > 0) {
+            tail->mNext = iniCell();
+            tail = tail->mNext;
+        }
+        tail->mSub = items[i];
+    }
+    return head;
 }
 
 /****************************************************************
- Helper function for recurse_eval(Cell*) that checks whether or
- not a numerical atom is greater than another numerical atom.
+ Helper function dynamically allocating a CELL_VECTOR Cell along
+ with its contiguous array of the given number of members. The
+ members are left for the caller to fill.
 */
-static List* greaterThan(List* la, List* lb)
+static Cell* iniVector(int length)
 {
-    int num1 = atoi(la->mStructure->mSymbol);
-    int num2 = atoi(lb->mStructure->mSymbol);
-    if (num1 > num2) return wrapStructure(TRUE);
-    else return wrapStructure(FALSE);
+    // Vectors can be changed in place, so results built from them
+    // are not cached
+    mCacheable = 0;
+    Vector* vector = allocate(sizeof(Vector));
+    vector->mLength = length;
+    vector->mItems = allocate(sizeof(Cell*) * (length > 0 ? length : 1));
+
+    Cell* cell = iniCell();
+    cell->mType = CELL_VECTOR;
+    cell->mData = vector;
+    return cell;
 }
 
 /****************************************************************
- Helper function for recurse_eval(Cell*) that checks whether or
- not a numerical atom is less than or equal to another numerical
- atom.
+ Helper that wraps a number into a List holding a numerical atom.
 */
-static List* lessThanOrEqualTo(List* la, List* lb)
+static List* wrapNumber(long value)
 {
-    int num1 = atoi(la->mStructure->mSymbol);
-    int num2 = atoi(lb->mStructure->mSymbol);
-    if (num1 <= num2) return wrapStructure(TRUE);
-    else return wrapStructure(FALSE);
+    return wrapValue(fixnumNumber(value));
 }
 
 /****************************************************************
- Helper function for recurse_eval(Cell*) that checks whether or
- not a numerical atom is greater than or equal to another numerical
- atom.
+ Helper that wraps any Number into a List holding a numerical
+ atom with its value already cached.
 */
-static List* greaterThanOrEqualTo(List* la, List* lb)
+static List* wrapValue(Number value)
 {
-    int num1 = atoi(la->mStructure->mSymbol);
-    int num2 = atoi(lb->mStructure->mSymbol);
-    if (num1 >= num2) return wrapStructure(TRUE);
-    else return wrapStructure(FALSE);
+    int site = enterSite(SITE_ARITHMETIC);
+    Cell* num = iniCell();
+    setNumber(num, value);
+    List* list = wrapStructure(num);
+    leaveSite(site);
+    return list;
 }
 
 /****************************************************************
- Helper function for recurse_eval(Cell*) that checks whether or
- not a given List* actually refers to a list structure or just a
- standalone atom.
+ Helper giving the value of an evaluated operand of an arithmetic
+ function. Like atoi() before it, anything that isn't a numerical
+ atom counts as 0.
 */
-static List* isList(List* list)
+static Number operandOf(List* list)
 {
-    if (list->mStructure == NULL || list->mStructure->mSub == NULL) return wrapStructure(FALSE);
-    else return wrapStructure(TRUE);
+    Number value = numberOf(list->mStructure);
+    if (value.mKind == NUMBER_NONE) return fixnumNumber(0);
+    return value;
 }
 
 /****************************************************************
- Helper function for recurse_eval(Cell*) that checks whether or
- not a given List* refers to a numerical atom.
+ Helper giving the value of an evaluated index, length or limit
+ through the last parameter. Returns 0 unless the operand is an
+ integer small enough to be a fixnum, which is all such counts
+ can be, so that flonums are not truncated and symbols and lists
+ are not taken for 0.
 */
-static List* isNumber(List* list)
+static int fixnumOperand(List* list, long* value)
 {
-    Cell* cell = list->mStructure;
-    if (cell->mSub != NULL) cell = cell->mSub;
+    Number number = numberOf(list != NULL ? list->mStructure : NULL);
+    if (number.mKind != NUMBER_FIXNUM) return 0;
+    *value = number.mFixnum;
+    return 1;
+}
 
-    // Cell isn't a number if a single character is not a digit
-    char* symbol = cell->mSymbol;
-    char ch;
-    int len = strlen(symbol);
+/****************************************************************
+ Helper that gives the exact values of the given members in a new
+ array. Unlike packFixnums(Cell**, int) it accepts integers of any
+ size. Returns NULL unless every member is an integer atom.
+*/
+static Number* listNumbers(Cell** items, int count)
+{
+    Number* values = malloc(sizeof(Number) * (count > 0 ? count : 1));
     int i;
-    for (i = 0; i < len; i++) {
-        ch = symbol[i];
+    for (i = 0; i < count; i++) {
+        values[i] = numberOf(items[i]);
+        if (values[i].mKind == NUMBER_NONE) {
+            free(values);
+            return NULL;
+        }
+    }
+    return values;
+}
 
-        // Not a number the moment a non-digit char is found
-        // (with the exception of '-' at the front) for negatives
-        if ((ch != '0') && (ch != '1') && (ch != '2')
-            && (ch != '3') && (ch != '4') && (ch != '5')
-            && (ch != '6') && (ch != '7') && (ch != '8')
-            && (ch != '9') && ((i != 0) || (ch != '-')))
-            return wrapStructure(FALSE);
+/****************************************************************
+ Helper that reports a misuse of the named function to the user.
+ The evaluation carries on with #f (the empty list) as the result.
+*/
+static List* reportError(char* function, char* message)
+{
+    // Errors while folding a constant just keep the call as written
+    if (mFolding) {
+        mFoldFailed = 1;
+        return wrapStructure(FALSE);
     }
-    return wrapStructure(TRUE);
+    // A cached result would silence the report next time
+    mCacheable = 0;
+    printf("%s: %s.\n", function, message);
+    return wrapStructure(FALSE);
+}
+
+/****************************************************************
+ Helper deciding whether two evaluated values are equal? for the
+ purpose of matching hash table keys.
+*/
+static int equalCells(Cell* c1, Cell* c2)
+{
+    if (c1 == c2) return 1;
+    return compareEqual(c1, c2) == TRUE;
 }
 
 /****************************************************************
@@ -1007,7 +5708,19 @@ static List* isNumber(List* list)
 */
 static List* wrapStructure(Cell* cell)
 {
-    List* list = malloc(sizeof(List));
+    List* list = allocate(sizeof(List));
+    list->mStructure = cell;
+    return list;
+}
+
+/****************************************************************
+ Helper function wrapping a Cell like wrapStructure(Cell*), with
+ the wrapper counted at the given site unless another one has been
+ entered.
+*/
+static List* wrapStructureAt(Cell* cell, int site)
+{
+    List* list = allocateAt(sizeof(List), site);
     list->mStructure = cell;
     return list;
 }
@@ -1018,20 +5731,50 @@ static List* wrapStructure(Cell* cell)
 */
 static Cell* iniCell()
 {
-    Cell* cell = malloc(sizeof(Cell));
+    Cell* cell = allocate(sizeof(Cell));
+    cell->mSub = NULL;
+    cell->mNext = NULL;
+    cell->mSymbol = NULL;
+    cell->mType = CELL_PLAIN;
+    cell->mHash = 0;
+    cell->mData = NULL;
+    return cell;
+}
+
+/****************************************************************
+ Helper function allocating a new cons cell like iniCell(), counted
+ at the given site unless another one has been entered.
+*/
+static Cell* iniCellAt(int site)
+{
+    Cell* cell = allocateAt(sizeof(Cell), site);
     cell->mSub = NULL;
     cell->mNext = NULL;
     cell->mSymbol = NULL;
+    cell->mType = CELL_PLAIN;
+    cell->mHash = 0;
+    cell->mData = NULL;
     return cell;
 }
 
+/****************************************************************
+ Helper function allocating a cell, all members NULL, that links
+ bookkeeping such as the reads noted for the result cache and is
+ freed again. It comes straight from malloc, as the allocator never
+ takes memory back.
+*/
+static Cell* iniLinkCell()
+{
+    return calloc(1, sizeof(Cell));
+}
+
 /****************************************************************
  Helper function dynamically allocating a new association list.
 */
 static List* iniAssocList()
 {
-    Cell* empty = iniCell();
-    empty->mSymbol = malloc(sizeof(char) * 20);
+    Cell* empty = iniCellAt(SITE_ENVIRONMENT);
+    empty->mSymbol = allocateAt(sizeof(char) * 20, SITE_ENVIRONMENT);
     strcpy(empty->mSymbol, "#f");
-    return wrapStructure(empty);
+    return wrapStructureAt(empty, SITE_ENVIRONMENT);
 }
@@ -25,4 +25,100 @@ extern Cell* FALSE;
 */
 List* eval(List*);
 
+/****************************************************************
+ Turns caching of top level results on or off. While on, eval(List*)
+ answers an input equal to one already seen from the result of its
+ first evaluation, as long as no global symbol it read has been
+ defined again since. Inputs that define something, report an error
+ or touch vectors or hash tables, which can change in place, are
+ always evaluated. The function call (result-cache-stats) gives
+ the hit rate and memory used.
+*/
+void setResultCaching(int);
+
+/****************************************************************
+ Sets the level of the optimization pass run over top level input
+ and the bodies of functions as they are defined. Level 0, the
+ default, evaluates code exactly as written, and level 1 folds
+ calls of pure builtins on constants, reduces if and cond with a
+ constant test to the branch taken and turns chains of car and cdr
+ into a single builtin such as cadr. Level 2 also inlines calls of
+ small non-recursive functions into the bodies of other functions,
+ optimizing those bodies again whenever an inlined function is
+ redefined.
+*/
+void setOptimizationLevel(int);
+
+/****************************************************************
+ Turns profiling of calls on or off. While on, every call that
+ recurse_eval dispatches to a builtin or a user defined function
+ is counted and timed, along with the chain of calls leading to
+ it (see profiler.h). Turning it on starts a new profile, which
+ the function calls (profile-start), (profile-stop) and
+ (profile-report) also control from Scheme. While off, the cost
+ is a single test per evaluation.
+*/
+void setProfiling(int);
+
+/****************************************************************
+ Gives 1 while profiling calls and 0 otherwise.
+*/
+int isProfiling();
+
+/****************************************************************
+ Maps a heap image written by the function call (save-image file)
+ into memory, defining every variable and function it holds as
+ they were when it was written (see image.h). The variables
+ defined so far are replaced, while functions are added to those
+ defined so far. Returns 1 on success and 0 after printing what
+ went wrong.
+*/
+int loadImage(char*);
+
+/****************************************************************
+ Resources an evaluation can be given a budget of, see
+ setBudget(int, long). Steps are evaluations of a cell by the
+ evaluator, bytes those allocated (see allocator.h), depth the
+ evaluations nested within each other, and milliseconds the wall
+ clock time since eval(List*) was called.
+*/
+enum budgetKind {
+    BUDGET_STEPS = 0,
+    BUDGET_BYTES,
+    BUDGET_DEPTH,
+    BUDGET_MILLISECONDS,
+    BUDGET_COUNT
+};
+
+/****************************************************************
+ Limits every call of eval(List*) to the given amount of one
+ resource, or lifts the limit when given 0, the default. An
+ evaluation running over any of its budgets is abandoned where it
+ stands, with whatever it defined so far kept, and eval(List*)
+ reports the budget exceeded and returns (), so that a runaway
+ input neither hangs the caller nor, given a budget of depth,
+ overflows the C stack, of which the usual 8 MB hold about 20000
+ levels. While no budget is set, the cost is a single test per
+ evaluation.
+*/
+void setBudget(int, long);
+
+/****************************************************************
+ Gives the given form with every use of a macro defined by the
+ function call (define-syntax name (syntax-rules ...)) replaced
+ by its expansion, which is expanded in turn, or the form itself
+ when it uses none. Top level input and the forms of loaded files
+ are expanded once, before they are evaluated, so the bodies of
+ functions are defined expanded. Returns NULL after reporting a
+ use that matches no rule.
+*/
+Cell* expandSyntax(Cell*);
+
+/****************************************************************
+ Gives 1 when the given name is one of the functions handled by
+ the evaluator itself, which a user defined function of the same
+ name cannot shadow, and 0 otherwise.
+*/
+int isBuiltin(char*);
+
 #endif
@@ -0,0 +1,292 @@
+#include <stdlib.h>
+#include <string.h>
+#include "parser.h"
+#include "evaluation.h"
+#include "hashtable.h"
+#include "reader.h"
+
+/****************************************************************
+ File: Hashtable.c
+ ----------------
+ Implementation for hashtable.h interface. Tables use open
+ addressing with linear probing over a power of two number of
+ slots. Removed entries leave a marker behind so that probing for
+ keys stored past them still succeeds; the markers are dropped
+ whenever the table grows.
+ ****************************************************************/
+
+// Marker for slots whose entry was removed
+static Cell mRemoved;
+
+// Symbol table of interned symbol text
+static char** mSymbols = NULL;
+static int mSymbolCount = 0;
+static int mSymbolCapacity = 0;
+
+// Prototypes for private helpers
+static int findSlot(HashTable*, Cell*, unsigned int);
+static void grow(HashTable*);
+static unsigned int mixHash(unsigned int, unsigned int);
+static unsigned int hashText(char*);
+static unsigned int hashAtom(char*);
+static unsigned int hashNode(Cell*);
+
+// Cells of a level hashCell() can gather without allocating
+#define LEVEL_BUFFER 64
+
+/****************************************************************
+ iniHashTable(): See header file for documentation.
+*/
+HashTable* iniHashTable(int (*equals)(Cell*, Cell*))
+{
+    HashTable* table = malloc(sizeof(HashTable));
+    table->mCount = 0;
+    table->mUsed = 0;
+    table->mCapacity = 16;
+    table->mEntries = calloc(table->mCapacity, sizeof(HashEntry));
+    table->mEquals = equals;
+    return table;
+}
+
+/****************************************************************
+ hashGet(): See header file for documentation.
+*/
+Cell* hashGet(HashTable* table, Cell* key)
+{
+    int slot = findSlot(table, key, hashCell(key));
+    Cell* found = table->mEntries[slot].mKey;
+    if (found == NULL || found == &mRemoved) return NULL;
+    return table->mEntries[slot].mValue;
+}
+
+/****************************************************************
+ hashPut(): See header file for documentation.
+*/
+void hashPut(HashTable* table, Cell* key, Cell* value)
+{
+    // Keep at most three quarters of the slots occupied
+    if ((table->mUsed + 1) * 4 > table->mCapacity * 3) grow(table);
+
+    unsigned int hash = hashCell(key);
+    int slot = findSlot(table, key, hash);
+    HashEntry* entry = &table->mEntries[slot];
+    if (entry->mKey == NULL || entry->mKey == &mRemoved) {
+        // Reused slots are already counted in mUsed
+        if (entry->mKey == NULL) table->mUsed++;
+        table->mCount++;
+        entry->mHash = hash;
+        entry->mKey = key;
+    }
+    entry->mValue = value;
+}
+
+/****************************************************************
+ hashRemove(): See header file for documentation.
+*/
+int hashRemove(HashTable* table, Cell* key)
+{
+    int slot = findSlot(table, key, hashCell(key));
+    HashEntry* entry = &table->mEntries[slot];
+    if (entry->mKey == NULL || entry->mKey == &mRemoved) return 0;
+
+    entry->mKey = &mRemoved;
+    entry->mValue = NULL;
+    table->mCount--;
+    return 1;
+}
+
+/****************************************************************
+ hashNext(): See header file for documentation.
+*/
+int hashNext(HashTable* table, int index, Cell** key, Cell** value)
+{
+    while (index < table->mCapacity) {
+        HashEntry* entry = &table->mEntries[index++];
+        if (entry->mKey != NULL && entry->mKey != &mRemoved) {
+            *key = entry->mKey;
+            *value = entry->mValue;
+            return index;
+        }
+    }
+    return -1;
+}
+
+/****************************************************************
+ hashCell() implementation notes: The hash walks a structure the
+ same way equal? compares it. A level is folded from its last cell
+ back to the given one, so that the hash of any cell builds on the
+ hash of the cell after it. That lets a Cell whose mHash is cached
+ stand in for everything after it on its level, and cells along a
+ level are gathered in a loop so long lists don't deepen the C
+ stack. No hash is ever 0, which marks an mHash not yet computed.
+*/
+unsigned int hashCell(Cell* cell)
+{
+    if (cell != NULL && cell->mHash != 0) return cell->mHash;
+    // Lazy data hash as the lists they stand for
+    forceData(cell);
+
+    // Gather the level up to the first cell with a cached hash
+    Cell* nearby[LEVEL_BUFFER];
+    Cell** level = nearby;
+    int count = 0;
+    Cell* focus;
+    for (focus = cell; focus != NULL && focus->mHash == 0; focus = focus->mNext)
+        count++;
+    if (count > LEVEL_BUFFER) level = malloc(sizeof(Cell*) * count);
+    int i = 0;
+    for (focus = cell; focus != NULL && focus->mHash == 0; focus = focus->mNext)
+        level[i++] = focus;
+
+    unsigned int hash = focus != NULL ? focus->mHash : 17;
+    for (i = count - 1; i >= 0; i--) {
+        hash = mixHash(hash, hashNode(level[i]));
+        if (hash == 0) hash = 1;
+    }
+    if (level != nearby) free(level);
+    return hash;
+}
+
+/****************************************************************
+ internSymbol(): See header file for documentation. The symbol
+ table uses the same open addressing scheme as HashTable, but as
+ symbols are never removed it needs no removal markers.
+*/
+char* internSymbol(char* text)
+{
+    if ((mSymbolCount + 1) * 4 > mSymbolCapacity * 3) {
+        // Grow and re-insert every symbol
+        int oldCapacity = mSymbolCapacity;
+        char** old = mSymbols;
+        mSymbolCapacity = oldCapacity == 0 ? 256 : oldCapacity * 2;
+        mSymbols = calloc(mSymbolCapacity, sizeof(char*));
+        int i;
+        for (i = 0; i < oldCapacity; i++) {
+            if (old[i] == NULL) continue;
+            int slot = hashText(old[i]) & (mSymbolCapacity - 1);
+            while (mSymbols[slot] != NULL)
+                slot = (slot + 1) & (mSymbolCapacity - 1);
+            mSymbols[slot] = old[i];
+        }
+        free(old);
+    }
+
+    int slot = hashText(text) & (mSymbolCapacity - 1);
+    while (mSymbols[slot] != NULL) {
+        if (strcmp(mSymbols[slot], text) == 0) return mSymbols[slot];
+        slot = (slot + 1) & (mSymbolCapacity - 1);
+    }
+    mSymbols[slot] = malloc(strlen(text) + 1);
+    strcpy(mSymbols[slot], text);
+    mSymbolCount++;
+    return mSymbols[slot];
+}
+
+/****************************************************************
+ Private helper that probes for the given key. The returned slot
+ either holds the key or is the unused slot where the key would
+ be inserted, reusing the first removed slot passed on the way.
+*/
+static int findSlot(HashTable* table, Cell* key, unsigned int hash)
+{
+    int mask = table->mCapacity - 1;
+    int slot = hash & mask;
+    int reusable = -1;
+    while (table->mEntries[slot].mKey != NULL) {
+        HashEntry* entry = &table->mEntries[slot];
+        if (entry->mKey == &mRemoved) {
+            if (reusable == -1) reusable = slot;
+        } else if (entry->mHash == hash
+                   && (entry->mKey == key || table->mEquals(entry->mKey, key))) {
+            return slot;
+        }
+        slot = (slot + 1) & mask;
+    }
+    if (reusable != -1) return reusable;
+    return slot;
+}
+
+/****************************************************************
+ Private helper that doubles the slots of a table and re-inserts
+ its live entries, dropping removal markers.
+*/
+static void grow(HashTable* table)
+{
+    int oldCapacity = table->mCapacity;
+    HashEntry* old = table->mEntries;
+
+    // Only grow when live entries fill the table, otherwise rebuild
+    // at the same size to clear out removal markers
+    if (table->mCount * 2 >= oldCapacity) table->mCapacity = oldCapacity * 2;
+    table->mEntries = calloc(table->mCapacity, sizeof(HashEntry));
+    table->mUsed = table->mCount;
+
+    int mask = table->mCapacity - 1;
+    int i;
+    for (i = 0; i < oldCapacity; i++) {
+        if (old[i].mKey == NULL || old[i].mKey == &mRemoved) continue;
+        int slot = old[i].mHash & mask;
+        while (table->mEntries[slot].mKey != NULL)
+            slot = (slot + 1) & mask;
+        table->mEntries[slot] = old[i];
+    }
+    free(old);
+}
+
+/****************************************************************
+ Private helper combining a value into a running hash.
+*/
+static unsigned int mixHash(unsigned int hash, unsigned int value)
+{
+    return hash ^ (value + 0x9e3779b9 + (hash << 6) + (hash >> 2));
+}
+
+/****************************************************************
+ Private helper hashing symbol text (FNV-1a).
+*/
+static unsigned int hashText(char* text)
+{
+    unsigned int hash = 2166136261u;
+    while (*text != '\0') {
+        hash ^= (unsigned char) *text++;
+        hash *= 16777619u;
+    }
+    return hash;
+}
+
+/****************************************************************
+ Private helper hashing an atom. Numerical atoms hash by their
+ integer value and all other symbols by their text.
+*/
+static unsigned int hashAtom(char* symbol)
+{
+    char* end;
+    long value = strtol(symbol, &end, 10);
+    if (end != symbol && *end == '\0')
+        return mixHash((unsigned int) value, (unsigned int) ((unsigned long) value >> 32));
+    return hashText(symbol);
+}
+
+/****************************************************************
+ Private helper hashing a single cell of a level, without the
+ cells after it. Hash tables, procedures and promises only equal
+ themselves, so they are hashed by address.
+*/
+static unsigned int hashNode(Cell* cell)
+{
+    unsigned int hash = 0;
+    if (cell->mType == CELL_VECTOR) {
+        Vector* vector = cell->mData;
+        int i;
+        hash = mixHash(hash, 3);
+        for (i = 0; i < vector->mLength; i++)
+            hash = mixHash(hash, hashCell(vector->mItems[i]));
+    } else if (cell->mType == CELL_HASH || cell->mType == CELL_CLOSURE || cell->mType == CELL_PROMISE) {
+        hash = mixHash(hash, (unsigned int) ((size_t) cell >> 4));
+    } else {
+        if (cell->mSymbol != NULL) hash = mixHash(hash, hashAtom(cell->mSymbol));
+        else hash = mixHash(hash, 1);
+        if (cell->mSub != NULL) hash = mixHash(hash, hashCell(cell->mSub));
+    }
+    return hash;
+}
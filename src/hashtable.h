@@ -0,0 +1,92 @@
+#ifndef HASHTABLE_H_INCLUDED
+#define HASHTABLE_H_INCLUDED
+
+#include "parser.h"
+
+/****************************************************************
+ File: Hashtable.h
+ ----------------
+ Interface for Hashtable, an open addressing table keyed by
+ evaluated values, along with the symbol table used by Parser to
+ intern symbols.
+
+ Keys are hashed structurally by hashCell(Cell*) so that any two
+ keys the table's equality function considers equal land in the
+ same slot chain. Symbols hash by their text, numerical atoms by
+ their integer value, and lists and vectors by their members.
+ ****************************************************************/
+
+/****************************************************************
+ Slot of a HashTable. An unused slot has a NULL mKey.
+*/
+typedef struct hashEntry HashEntry;
+struct hashEntry {
+    unsigned int mHash;
+    Cell* mKey;
+    Cell* mValue;
+};
+
+/****************************************************************
+ Table referenced by the mData member of a CELL_HASH Cell. mUsed
+ counts live entries plus removed slots still occupying a probe
+ position, and mEquals decides whether two keys match.
+*/
+typedef struct hashTable HashTable;
+struct hashTable {
+    int mCount;
+    int mUsed;
+    int mCapacity;
+    HashEntry* mEntries;
+    int (*mEquals)(Cell*, Cell*);
+};
+
+/****************************************************************
+ Creates an empty table comparing keys with the given function.
+*/
+HashTable* iniHashTable(int (*equals)(Cell*, Cell*));
+
+/****************************************************************
+ Gives the value stored under the given key, or NULL when the key
+ is not in the table.
+*/
+Cell* hashGet(HashTable*, Cell*);
+
+/****************************************************************
+ Stores the value under the given key, replacing any value the
+ key already had.
+*/
+void hashPut(HashTable*, Cell*, Cell*);
+
+/****************************************************************
+ Removes the given key. Returns 1 if the key was in the table and
+ 0 otherwise.
+*/
+int hashRemove(HashTable*, Cell*);
+
+/****************************************************************
+ Iterates the entries of a table. Starting from index 0, each call
+ fills in the key and value of the next entry at or after the
+ index and returns the index to pass to the following call, or
+ -1 once every entry has been visited.
+
+    int i = 0;
+    Cell* key;
+    Cell* value;
+    while ((i = hashNext(table, i, &key, &value)) != -1) { ... }
+*/
+int hashNext(HashTable*, int, Cell**, Cell**);
+
+/****************************************************************
+ Structural hash of an evaluated value, consistent with equal?.
+ The hash of a Cell covers it and every cell after it on its
+ level, and is never 0. A Cell's cached mHash is trusted as is.
+*/
+unsigned int hashCell(Cell*);
+
+/****************************************************************
+ Gives the shared copy of the given symbol text so that equal
+ symbols produced by Parser are the same string in memory.
+*/
+char* internSymbol(char*);
+
+#endif
@@ -0,0 +1,657 @@
+#include <stdlib.h>
+#include <string.h>
+#include <stdio.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "image.h"
+#include "hashtable.h"
+#include "bignum.h"
+#include "allocator.h"
+#include "reader.h"
+
+/****************************************************************
+ File: Image.c
+ ----------------
+ Implementation for image.h interface. An image is laid out as
+
+    header | roots | cells | symbol text | native data
+
+ where roots, references in cells and native data are all offsets
+ from the start of the file, 0 standing for NULL and 1 up to the
+ number of fixed cells for those. Native data are records of
+ longs, described at writeData(Cell*). Writing first gathers every
+ cell reachable from the roots, numbering them in the order found,
+ so that the offset of any cell is known before any is written.
+
+ Mapping an image checks its hash first, then that every offset in
+ it leads within the file, before a single cell is touched, so that
+ a damaged image is refused instead of crashing the process later.
+ ****************************************************************/
+
+#define IMAGE_MAGIC "SCMIMAGE"
+
+/****************************************************************
+ Start of every image. Offsets are from the start of the file.
+*/
+typedef struct imageHeader ImageHeader;
+struct imageHeader {
+    char mMagic[8];
+    int mCellSize;
+    int mRootCount;
+    long mCellCount;
+    long mCellsAt;
+    long mSymbolsAt;
+    long mDataAt;
+    long mSize;
+    // FNV-1a hash of everything after the header
+    unsigned long mChecksum;
+};
+
+/****************************************************************
+ Map from addresses to numbers, for the cells and symbol text
+ already given a place in the image. Unused slots hold NULL.
+*/
+typedef struct placeMap PlaceMap;
+struct placeMap {
+    void** mKeys;
+    long* mValues;
+    long mCount;
+    long mCapacity;
+};
+
+/****************************************************************
+ Growable run of bytes, for the sections written after the cells.
+*/
+typedef struct section Section;
+struct section {
+    char* mBytes;
+    long mLength;
+    long mCapacity;
+};
+
+// Cells of the image being written, in the order found
+static Cell** mCells = NULL;
+static long mCellCount = 0;
+static PlaceMap mPlaces;
+static PlaceMap mSymbolPlaces;
+static Section mSymbols;
+static Section mData;
+static Cell** mFixed = NULL;
+static int mFixedCount = 0;
+static long mCellsAt = 0;
+
+// Prototypes for private helpers
+static int gatherCells(Cell**, int);
+static long reference(Cell*);
+static long symbolReference(char*);
+static long writeData(Cell*);
+static void appendWord(long);
+static void appendBytes(Section*, void*, long);
+static long* findPlace(PlaceMap*, void*, int);
+static void freeWriter();
+static Cell* resolve(char*, long, Cell**, int);
+static unsigned long hashBytes(unsigned long, char*, long);
+static int checkImage(char*, int);
+static int checkReference(ImageHeader*, long, int);
+
+/****************************************************************
+ writeImage(): See header file for documentation.
+*/
+int writeImage(char* path, Cell** roots, int rootCount, Cell** fixed, int fixedCount)
+{
+    mFixed = fixed;
+    mFixedCount = fixedCount;
+    if (gatherCells(roots, rootCount) == 0) {
+        freeWriter();
+        return 0;
+    }
+
+    ImageHeader header;
+    memcpy(header.mMagic, IMAGE_MAGIC, 8);
+    header.mCellSize = sizeof(Cell);
+    header.mRootCount = rootCount;
+    header.mCellCount = mCellCount;
+    header.mCellsAt = sizeof(ImageHeader) + sizeof(long) * rootCount;
+    mCellsAt = header.mCellsAt;
+    header.mSymbolsAt = header.mCellsAt + sizeof(Cell) * mCellCount;
+
+    // Cells refer to symbol text and data by their offsets within
+    // the sections first, and to the sections once their sizes are
+    // known
+    Cell* records = malloc(sizeof(Cell) * (mCellCount > 0 ? mCellCount : 1));
+    long i;
+    for (i = 0; i < mCellCount; i++) {
+        Cell* cell = mCells[i];
+        Cell* record = &records[i];
+        memcpy(record, cell, sizeof(Cell));
+        record->mSymbol = (char*) symbolReference(cell->mSymbol);
+        record->mNext = (Cell*) reference(cell->mNext);
+        record->mSub = (Cell*) reference(cell->mSub);
+        if (cell->mType == CELL_PLAIN || cell->mType == CELL_BIGNUM) record->mData = NULL;
+        else if (cell->mType != CELL_FIXNUM && cell->mType != CELL_FLONUM)
+            record->mData = (void*) writeData(cell);
+    }
+    header.mDataAt = header.mSymbolsAt + mSymbols.mLength;
+    // Keep the data aligned for the longs it is made of
+    header.mDataAt = (header.mDataAt + 7) & ~7L;
+    header.mSize = header.mDataAt + mData.mLength;
+    for (i = 0; i < mCellCount; i++) {
+        Cell* record = &records[i];
+        if (record->mSymbol != NULL) record->mSymbol = (char*) ((long) record->mSymbol - 1 + header.mSymbolsAt);
+        if (record->mType != CELL_PLAIN && record->mType != CELL_BIGNUM && record->mType != CELL_FIXNUM
+            && record->mType != CELL_FLONUM) record->mData = (void*) ((long) record->mData + header.mDataAt);
+    }
+
+    // Write beside the file and move over it, as the file replaced
+    // may be mapped by this very process
+    char* written = malloc(sizeof(char) * (strlen(path) + 8));
+    sprintf(written, "%s.part", path);
+    FILE* file = fopen(written, "wb");
+    if (file == NULL) {
+        printf("save-image: cannot write %s.\n", path);
+        free(written);
+        free(records);
+        freeWriter();
+        return 0;
+    }
+    long* rootPlaces = malloc(sizeof(long) * (rootCount > 0 ? rootCount : 1));
+    for (i = 0; i < rootCount; i++)
+        rootPlaces[i] = reference(roots[i]);
+    static char padding[8];
+    unsigned long checksum = 14695981039346656037UL;
+    checksum = hashBytes(checksum, (char*) rootPlaces, sizeof(long) * rootCount);
+    checksum = hashBytes(checksum, (char*) records, sizeof(Cell) * mCellCount);
+    checksum = hashBytes(checksum, mSymbols.mBytes, mSymbols.mLength);
+    checksum = hashBytes(checksum, padding, header.mDataAt - header.mSymbolsAt - mSymbols.mLength);
+    header.mChecksum = hashBytes(checksum, mData.mBytes, mData.mLength);
+    int failed = fwrite(&header, sizeof(ImageHeader), 1, file) != 1
+                 || fwrite(rootPlaces, sizeof(long), rootCount, file) != (size_t) rootCount
+                 || fwrite(records, sizeof(Cell), mCellCount, file) != (size_t) mCellCount
+                 || fwrite(mSymbols.mBytes, 1, mSymbols.mLength, file) != (size_t) mSymbols.mLength
+                 || fwrite(padding, 1, header.mDataAt - header.mSymbolsAt - mSymbols.mLength, file)
+                    != (size_t) (header.mDataAt - header.mSymbolsAt - mSymbols.mLength)
+                 || fwrite(mData.mBytes, 1, mData.mLength, file) != (size_t) mData.mLength;
+    failed = fclose(file) != 0 || failed;
+    if (!failed) failed = rename(written, path) != 0;
+    if (failed) {
+        printf("save-image: cannot write %s.\n", path);
+        remove(written);
+    }
+    free(rootPlaces);
+    free(written);
+    free(records);
+    freeWriter();
+    return !failed;
+}
+
+/****************************************************************
+ mapImage(): See header file for documentation.
+*/
+Cell** mapImage(char* path, int* rootCount, Cell** fixed, int fixedCount, int (*equals)(Cell*, Cell*))
+{
+    int descriptor = open(path, O_RDONLY);
+    if (descriptor < 0) {
+        printf("image: cannot read %s.\n", path);
+        return NULL;
+    }
+    struct stat status;
+    if (fstat(descriptor, &status) != 0 || status.st_size < (off_t) sizeof(ImageHeader)) {
+        printf("image: %s is not an image.\n", path);
+        close(descriptor);
+        return NULL;
+    }
+    // Private pages, so that the cells can change without the file
+    char* base = mmap(NULL, status.st_size, PROT_READ | PROT_WRITE, MAP_PRIVATE, descriptor, 0);
+    close(descriptor);
+    if (base == MAP_FAILED) {
+        printf("image: cannot map %s.\n", path);
+        return NULL;
+    }
+    ImageHeader* header = (ImageHeader*) base;
+    if (memcmp(header->mMagic, IMAGE_MAGIC, 8) != 0 || header->mCellSize != sizeof(Cell)
+        || header->mSize != status.st_size) {
+        printf("image: %s is not an image of this build.\n", path);
+        munmap(base, status.st_size);
+        return NULL;
+    }
+    if (hashBytes(14695981039346656037UL, base + sizeof(ImageHeader), status.st_size - sizeof(ImageHeader))
+            != header->mChecksum || !checkImage(base, fixedCount)) {
+        printf("image: %s is not an image.\n", path);
+        munmap(base, status.st_size);
+        return NULL;
+    }
+
+    Cell* cells = (Cell*) (base + header->mCellsAt);
+    long i;
+    for (i = 0; i < header->mCellCount; i++) {
+        Cell* cell = &cells[i];
+        if (cell->mSymbol != NULL) cell->mSymbol = base + (long) cell->mSymbol;
+        cell->mNext = resolve(base, (long) cell->mNext, fixed, fixedCount);
+        cell->mSub = resolve(base, (long) cell->mSub, fixed, fixedCount);
+        long* words = NULL;
+        if (cell->mType == CELL_VECTOR || cell->mType == CELL_CLOSURE || cell->mType == CELL_PROMISE)
+            words = (long*) (base + (long) cell->mData);
+        int j;
+        if (cell->mType == CELL_BIGNUM) {
+            cell->mData = bignumFromText(cell->mSymbol);
+        } else if (cell->mType == CELL_VECTOR) {
+            Vector* vector = allocate(sizeof(Vector));
+            vector->mLength = words[0];
+            vector->mItems = (Cell**) &words[1];
+            for (j = 0; j < vector->mLength; j++)
+                vector->mItems[j] = resolve(base, words[j + 1], fixed, fixedCount);
+            cell->mData = vector;
+        } else if (cell->mType == CELL_CLOSURE) {
+            Closure* closure = allocate(sizeof(Closure));
+            closure->mFormals = resolve(base, words[0], fixed, fixedCount);
+            closure->mBody = resolve(base, words[1], fixed, fixedCount);
+            closure->mCode = NULL;
+            closure->mCount = words[2];
+            closure->mNames = (Cell**) &words[3];
+            closure->mValues = (Cell**) &words[3 + closure->mCount];
+            for (j = 0; j < 2 * closure->mCount; j++)
+                closure->mNames[j] = resolve(base, words[3 + j], fixed, fixedCount);
+            cell->mData = closure;
+        } else if (cell->mType == CELL_PROMISE) {
+            Promise* promise = allocate(sizeof(Promise));
+            promise->mExpression = resolve(base, words[0], fixed, fixedCount);
+            promise->mValue = resolve(base, words[1], fixed, fixedCount);
+            promise->mEnvironment = NULL;
+            if (words[2]) {
+                promise->mEnvironment = allocate(sizeof(List));
+                promise->mEnvironment->mStructure = resolve(base, words[3], fixed, fixedCount);
+            }
+            cell->mData = promise;
+        }
+    }
+    // Keys are hashed by structure, so only once every cell is whole
+    for (i = 0; i < header->mCellCount; i++) {
+        Cell* cell = &cells[i];
+        if (cell->mType != CELL_HASH) continue;
+        long* words = (long*) (base + (long) cell->mData);
+        HashTable* table = iniHashTable(equals);
+        long j;
+        for (j = 0; j < words[0]; j++)
+            hashPut(table, resolve(base, words[1 + 2 * j], fixed, fixedCount),
+                    resolve(base, words[2 + 2 * j], fixed, fixedCount));
+        cell->mData = table;
+    }
+
+    long* rootPlaces = (long*) (base + sizeof(ImageHeader));
+    Cell** roots = malloc(sizeof(Cell*) * (header->mRootCount > 0 ? header->mRootCount : 1));
+    for (i = 0; i < header->mRootCount; i++)
+        roots[i] = resolve(base, rootPlaces[i], fixed, fixedCount);
+    *rootCount = header->mRootCount;
+    return roots;
+}
+
+/****************************************************************
+ Private helper numbering every cell reachable from the given
+ roots into mCells, walking with a stack of its own as long lists
+ would overflow the C stack. Returns 0 after printing what went
+ wrong when a cell cannot be written.
+*/
+static int gatherCells(Cell** roots, int rootCount)
+{
+    long capacity = 1024;
+    while (capacity < rootCount)
+        capacity *= 2;
+    long depth = 0;
+    Cell** stack = malloc(sizeof(Cell*) * capacity);
+    long cellCapacity = 1024;
+    mCells = malloc(sizeof(Cell*) * cellCapacity);
+    mCellCount = 0;
+    int i;
+    for (i = 0; i < rootCount; i++)
+        stack[depth++] = roots[i];
+    while (depth > 0) {
+        Cell* cell = stack[--depth];
+        if (cell == NULL || reference(cell) != -1) continue;
+        // Lazy data are written as the lists they stand for
+        forceData(cell);
+        if (cell->mType == CELL_NATIVE) {
+            printf("save-image: compiled functions cannot be saved.\n");
+            free(stack);
+            return 0;
+        }
+        *findPlace(&mPlaces, cell, 1) = mCellCount;
+        if (mCellCount == cellCapacity) {
+            cellCapacity *= 2;
+            mCells = realloc(mCells, sizeof(Cell*) * cellCapacity);
+        }
+        mCells[mCellCount++] = cell;
+
+        // Gather what the cell refers to, at most two cells beside
+        // the items of its native data
+        Cell** items = NULL;
+        long itemCount = 0;
+        Cell* extra[2] = { NULL, NULL };
+        if (cell->mType == CELL_VECTOR) {
+            items = ((Vector*) cell->mData)->mItems;
+            itemCount = ((Vector*) cell->mData)->mLength;
+        } else if (cell->mType == CELL_CLOSURE) {
+            Closure* closure = cell->mData;
+            extra[0] = closure->mFormals;
+            extra[1] = closure->mBody;
+            items = closure->mValues;
+            itemCount = closure->mCount;
+        } else if (cell->mType == CELL_PROMISE) {
+            Promise* promise = cell->mData;
+            extra[0] = promise->mValue != NULL ? promise->mValue : promise->mExpression;
+            if (promise->mEnvironment != NULL) extra[1] = promise->mEnvironment->mStructure;
+        }
+        long needed = depth + 4 + itemCount * 2;
+        if (cell->mType == CELL_HASH) needed += 2 * ((HashTable*) cell->mData)->mCount;
+        if (needed > capacity) {
+            while (needed > capacity)
+                capacity *= 2;
+            stack = realloc(stack, sizeof(Cell*) * capacity);
+        }
+        stack[depth++] = cell->mSub;
+        stack[depth++] = cell->mNext;
+        stack[depth++] = extra[0];
+        stack[depth++] = extra[1];
+        long j;
+        for (j = 0; j < itemCount; j++)
+            stack[depth++] = items[j];
+        if (cell->mType == CELL_CLOSURE) {
+            for (j = 0; j < itemCount; j++)
+                stack[depth++] = ((Closure*) cell->mData)->mNames[j];
+        } else if (cell->mType == CELL_HASH) {
+            Cell* key;
+            Cell* value;
+            int slot = 0;
+            while ((slot = hashNext(cell->mData, slot, &key, &value)) != -1) {
+                stack[depth++] = key;
+                stack[depth++] = value;
+            }
+        }
+    }
+    free(stack);
+    return 1;
+}
+
+/****************************************************************
+ Private helper giving the offset a cell is written at, or the
+ number standing for NULL or a fixed cell. Gives -1 for a cell not
+ gathered yet.
+*/
+static long reference(Cell* cell)
+{
+    if (cell == NULL) return 0;
+    int i;
+    for (i = 0; i < mFixedCount; i++)
+        if (mFixed[i] == cell) return i + 1;
+    long* place = findPlace(&mPlaces, cell, 0);
+    if (place == NULL) return -1;
+    return mCellsAt + sizeof(Cell) * *place;
+}
+
+/****************************************************************
+ Private helper giving the offset of the given symbol text within
+ the symbol section, adding the text the first time it is seen.
+ Offsets are given plus one, so that NULL text gives 0.
+*/
+static long symbolReference(char* symbol)
+{
+    if (symbol == NULL) return 0;
+    long* place = findPlace(&mSymbolPlaces, symbol, 0);
+    if (place != NULL) return *place;
+    long offset = mSymbols.mLength;
+    appendBytes(&mSymbols, symbol, strlen(symbol) + 1);
+    *findPlace(&mSymbolPlaces, symbol, 1) = offset + 1;
+    return offset + 1;
+}
+
+/****************************************************************
+ Private helper writing the native data of a cell to the data
+ section, and giving its offset within the section. Every record
+ is a run of longs, where cells are given by reference(Cell*):
+
+    vector:   length, items
+    closure:  formals, body, count, names, values
+    promise:  expression, value, 1 if it has an environment, the
+              environment
+    hash:     count, then each key followed by its value
+*/
+static long writeData(Cell* cell)
+{
+    long offset = mData.mLength;
+    long i;
+    if (cell->mType == CELL_VECTOR) {
+        Vector* vector = cell->mData;
+        appendWord(vector->mLength);
+        for (i = 0; i < vector->mLength; i++)
+            appendWord(reference(vector->mItems[i]));
+    } else if (cell->mType == CELL_CLOSURE) {
+        Closure* closure = cell->mData;
+        appendWord(reference(closure->mFormals));
+        appendWord(reference(closure->mBody));
+        appendWord(closure->mCount);
+        for (i = 0; i < closure->mCount; i++)
+            appendWord(reference(closure->mNames[i]));
+        for (i = 0; i < closure->mCount; i++)
+            appendWord(reference(closure->mValues[i]));
+    } else if (cell->mType == CELL_PROMISE) {
+        Promise* promise = cell->mData;
+        appendWord(promise->mValue != NULL ? 0 : reference(promise->mExpression));
+        appendWord(reference(promise->mValue));
+        appendWord(promise->mEnvironment != NULL);
+        appendWord(promise->mEnvironment != NULL ? reference(promise->mEnvironment->mStructure) : 0);
+    } else if (cell->mType == CELL_HASH) {
+        HashTable* table = cell->mData;
+        appendWord(table->mCount);
+        Cell* key;
+        Cell* value;
+        int slot = 0;
+        while ((slot = hashNext(table, slot, &key, &value)) != -1) {
+            appendWord(reference(key));
+            appendWord(reference(value));
+        }
+    }
+    return offset;
+}
+
+/****************************************************************
+ Private helper adding a long to the data section.
+*/
+static void appendWord(long word)
+{
+    appendBytes(&mData, &word, sizeof(long));
+}
+
+/****************************************************************
+ Private helper adding bytes to a section, growing it as needed.
+*/
+static void appendBytes(Section* section, void* bytes, long length)
+{
+    if (section->mLength + length > section->mCapacity) {
+        if (section->mCapacity == 0) section->mCapacity = 4096;
+        while (section->mLength + length > section->mCapacity)
+            section->mCapacity *= 2;
+        section->mBytes = realloc(section->mBytes, section->mCapacity);
+    }
+    memcpy(section->mBytes + section->mLength, bytes, length);
+    section->mLength += length;
+}
+
+/****************************************************************
+ Private helper giving the number kept for an address, or NULL when
+ there is none. When the last parameter is 1, a missing address is
+ added and the place for its number given instead.
+*/
+static long* findPlace(PlaceMap* map, void* key, int adding)
+{
+    if (adding && (map->mCount + 1) * 2 > map->mCapacity) {
+        // Grow and re-insert every address
+        long oldCapacity = map->mCapacity;
+        void** oldKeys = map->mKeys;
+        long* oldValues = map->mValues;
+        map->mCapacity = oldCapacity == 0 ? 1024 : oldCapacity * 2;
+        map->mKeys = calloc(map->mCapacity, sizeof(void*));
+        map->mValues = malloc(sizeof(long) * map->mCapacity);
+        map->mCount = 0;
+        long i;
+        for (i = 0; i < oldCapacity; i++)
+            if (oldKeys[i] != NULL) *findPlace(map, oldKeys[i], 1) = oldValues[i];
+        free(oldKeys);
+        free(oldValues);
+    }
+    if (map->mCapacity == 0) return NULL;
+
+    long mask = map->mCapacity - 1;
+    size_t hash = (size_t) key;
+    long slot = (long) ((hash >> 4) ^ (hash >> 16)) & mask;
+    while (map->mKeys[slot] != NULL) {
+        if (map->mKeys[slot] == key) return &map->mValues[slot];
+        slot = (slot + 1) & mask;
+    }
+    if (!adding) return NULL;
+    map->mKeys[slot] = key;
+    map->mCount++;
+    return &map->mValues[slot];
+}
+
+/****************************************************************
+ Private helper freeing what writing an image gathered.
+*/
+static void freeWriter()
+{
+    free(mCells);
+    mCells = NULL;
+    mCellCount = 0;
+    free(mPlaces.mKeys);
+    free(mPlaces.mValues);
+    memset(&mPlaces, 0, sizeof(PlaceMap));
+    free(mSymbolPlaces.mKeys);
+    free(mSymbolPlaces.mValues);
+    memset(&mSymbolPlaces, 0, sizeof(PlaceMap));
+    free(mSymbols.mBytes);
+    memset(&mSymbols, 0, sizeof(Section));
+    free(mData.mBytes);
+    memset(&mData, 0, sizeof(Section));
+}
+
+/****************************************************************
+ Private helper turning a reference read from an image mapped at
+ the given address back into a cell.
+*/
+static Cell* resolve(char* base, long place, Cell** fixed, int fixedCount)
+{
+    if (place == 0) return NULL;
+    if (place <= fixedCount) return fixed[place - 1];
+    return (Cell*) (base + place);
+}
+
+/****************************************************************
+ Private helper carrying the given 64 bit FNV-1a hash on over the
+ given bytes.
+*/
+static unsigned long hashBytes(unsigned long hash, char* bytes, long length)
+{
+    long i;
+    for (i = 0; i < length; i++) {
+        hash ^= (unsigned char) bytes[i];
+        hash *= 1099511628211UL;
+    }
+    return hash;
+}
+
+/****************************************************************
+ Private helper checking, before any cell is touched, that every
+ offset of an image mapped at the given address is within the
+ file: the sections, the roots, the references and symbol text of
+ every cell and the native data records. Returns 0 for a damaged
+ image, which could otherwise send a pointer anywhere.
+*/
+static int checkImage(char* base, int fixedCount)
+{
+    ImageHeader* header = (ImageHeader*) base;
+    long size = header->mSize;
+    if (header->mRootCount < 0 || header->mCellCount < 0
+        || header->mCellCount > size / (long) sizeof(Cell)
+        || header->mCellsAt != (long) sizeof(ImageHeader) + (long) sizeof(long) * header->mRootCount
+        || header->mSymbolsAt != header->mCellsAt + (long) sizeof(Cell) * header->mCellCount
+        || header->mDataAt < header->mSymbolsAt || header->mDataAt > size
+        || header->mDataAt % (long) sizeof(long) != 0)
+        return 0;
+
+    long* rootPlaces = (long*) (base + sizeof(ImageHeader));
+    long i;
+    for (i = 0; i < header->mRootCount; i++)
+        if (!checkReference(header, rootPlaces[i], fixedCount)) return 0;
+
+    Cell* cells = (Cell*) (base + header->mCellsAt);
+    for (i = 0; i < header->mCellCount; i++) {
+        Cell* cell = &cells[i];
+        if (!checkReference(header, (long) cell->mNext, fixedCount)
+            || !checkReference(header, (long) cell->mSub, fixedCount))
+            return 0;
+        // Symbol text must end within its section
+        long symbol = (long) cell->mSymbol;
+        if (symbol != 0 && (symbol < header->mSymbolsAt || symbol >= header->mDataAt
+                            || memchr(base + symbol, '\0', header->mDataAt - symbol) == NULL))
+            return 0;
+        int type = cell->mType;
+        if (type == CELL_FIXNUM || type == CELL_BIGNUM || type == CELL_FLONUM) {
+            if (symbol == 0) return 0;
+            continue;
+        }
+        // A plain cell has no data, and anything else there would be
+        // taken for the cache of a memoized function
+        if (type == CELL_PLAIN) {
+            if (cell->mData != NULL) return 0;
+            continue;
+        }
+        if (type != CELL_VECTOR && type != CELL_CLOSURE && type != CELL_PROMISE && type != CELL_HASH)
+            return 0;
+
+        // The record must fit in the file, and so must its cells
+        long at = (long) cell->mData;
+        if (at < header->mDataAt || at >= size || at % (long) sizeof(long) != 0) return 0;
+        long* words = (long*) (base + at);
+        long available = (size - at) / (long) sizeof(long);
+        if (available < 1) return 0;
+        long first;
+        long count;
+        if (type == CELL_VECTOR) {
+            first = 1;
+            count = words[0];
+        } else if (type == CELL_HASH) {
+            if (words[0] < 0 || words[0] > available / 2) return 0;
+            first = 1;
+            count = 2 * words[0];
+        } else if (type == CELL_CLOSURE) {
+            if (available < 3 || words[2] < 0 || words[2] > available / 2) return 0;
+            if (!checkReference(header, words[0], fixedCount) || !checkReference(header, words[1], fixedCount))
+                return 0;
+            first = 3;
+            count = 2 * words[2];
+        } else {
+            if (available < 4 || !checkReference(header, words[0], fixedCount)
+                || !checkReference(header, words[1], fixedCount) || !checkReference(header, words[3], fixedCount))
+                return 0;
+            first = 4;
+            count = 0;
+        }
+        if (count < 0 || count > available - first) return 0;
+        long j;
+        for (j = first; j < first + count; j++)
+            if (!checkReference(header, words[j], fixedCount)) return 0;
+    }
+    return 1;
+}
+
+/****************************************************************
+ Private helper telling whether a reference read from the given
+ image stands for NULL, a fixed cell or the start of one of its
+ cells.
+*/
+static int checkReference(ImageHeader* header, long place, int fixedCount)
+{
+    if (place >= 0 && place <= fixedCount) return 1;
+    return place >= header->mCellsAt && place < header->mSymbolsAt
+           && (place - header->mCellsAt) % (long) sizeof(Cell) == 0;
+}
@@ -0,0 +1,50 @@
+#ifndef IMAGE_H_INCLUDED
+#define IMAGE_H_INCLUDED
+
+#include "parser.h"
+
+/****************************************************************
+ File: Image.h
+ ----------------
+ Interface for Image, which writes the cells reachable from a set
+ of roots to a file and maps such a file back into memory, for the
+ heap images of save-image and the --image option.
+
+ An image holds the cells themselves as the process lays them out,
+ with every pointer replaced by its offset from the start of the
+ file. Mapping the file privately and adding its address to those
+ offsets gives back cells ready for use, without reading a single
+ token. Mapping is not lazy, though: the whole file is hashed and
+ checked, and every cell fixed up, before any is used, so loading
+ touches every page of the image. The cells stay in the mapping for
+ the rest of the run, which may change them as freely as any other
+ cell.
+
+ Vectors, closures and promises keep their items in the mapping as
+ well, while hash tables are built again and bignums read again
+ from their text. The bookkeeping of the evaluator that plain cells
+ carry in mData is left out, to be worked out again as needed, and
+ a compiled function body cannot be written at all. Cells given as
+ fixed, such as TRUE and FALSE, are written as references to the
+ same cells of the process mapping the image. An image is only
+ read by a build with the same layout of Cell.
+ ****************************************************************/
+
+/****************************************************************
+ Writes the cells reachable from the given roots to the file at
+ the given path. The last two parameters give the fixed cells.
+ Roots may be NULL. Returns 1 on success and 0 after printing what
+ went wrong.
+*/
+int writeImage(char*, Cell**, int, Cell**, int);
+
+/****************************************************************
+ Maps the image at the given path, giving back its roots in the
+ order written and their number through the second parameter. The
+ fixed cells must be given in the same order as when writing, and
+ hash tables in the image compare keys with the given function.
+ Returns NULL after printing what went wrong.
+*/
+Cell** mapImage(char*, int*, Cell**, int, int (*equals)(Cell*, Cell*));
+
+#endif
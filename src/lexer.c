@@ -13,13 +13,31 @@
  Data members
  ------------
  lexeme:    "String" variable that contains the token.
- c:         The current character in the input stream from the keyboard.
+ capacity:  Length of the lexeme array given to startTokens().
+ c:         The current character in the input stream, or EOF.
  lookahead: Set to 1 iff the previous call to getToken() required
             looking ahead.
+ source:    Stream the characters are read from, the keyboard unless
+            changed with pushTokenSource().
+ saved:     Streams pushed over by pushTokenSource(), most recent
+            first, along with their c and lookahead.
  ****************************************************************/
+typedef struct tokenSource TokenSource;
+struct tokenSource {
+  FILE *stream;
+  int c;
+  int lookahead;
+  TokenSource *previous;
+};
+
 static char *lexeme;
-static char c;
+static int capacity;
+static int c;
 static int lookahead;
+static FILE *source;
+static TokenSource *saved;
+
+static void skipBlanks ();
 
 /****************************************************************
  Function: newToken()
@@ -49,9 +67,72 @@ void startTokens (int maxLength)
 {
   lookahead = 0;
   lexeme = NULL;
+  capacity = maxLength;
+  source = stdin;
   newToken(maxLength);
 }//startTokens
 
+/****************************************************************
+ pushTokenSource(): See header file for documentation.
+ ****************************************************************/
+void pushTokenSource (FILE *stream)
+{
+  TokenSource *pushed = malloc(sizeof(TokenSource));
+  pushed->stream = source;
+  pushed->c = c;
+  pushed->lookahead = lookahead;
+  pushed->previous = saved;
+  saved = pushed;
+  source = stream;
+  lookahead = 0;
+}//pushTokenSource
+
+/****************************************************************
+ popTokenSource(): See header file for documentation.
+ ****************************************************************/
+void popTokenSource ()
+{
+  TokenSource *popped = saved;
+  if (popped == NULL)
+    return;
+  source = popped->stream;
+  c = popped->c;
+  lookahead = popped->lookahead;
+  saved = popped->previous;
+  free(popped);
+}//popTokenSource
+
+/****************************************************************
+ moreTokens(): See header file for documentation. The first
+ character after the blanks is kept as lookahead for getToken().
+ ****************************************************************/
+int moreTokens ()
+{
+  if (!lookahead)
+   c = getc(source);
+  skipBlanks();
+  lookahead = 1;
+  return c != EOF;
+}//moreTokens
+
+/****************************************************************
+ Function: skipBlanks()
+ ----------------------
+ Private function that reads past white space and comments, which
+ run from a ";" to the end of the line, starting at the current
+ character.
+ ****************************************************************/
+static void skipBlanks ()
+{
+  while ((c == ' ') || (c == '\n') || (c == '\t') || (c == '\r') || (c == ';')) {
+    if (c == ';')
+      while ((c != '\n') && (c != EOF))
+        c = getc(source);
+    else
+      c = getc(source);
+   }
+}//skipBlanks
+
 /****************************************************************
  getToken() implementation notes: The function works by getting
  the first character, in case the previous call required lookahead,
@@ -66,27 +147,31 @@ void startTokens (int maxLength)
          are t and f, in which case "#t" or "#f" are returned.
      (4) Default case: Scan for a string of characters, and return as
          a string.
+ At the end of the input ")" is returned, so that a list left open
+ is closed there.
  ****************************************************************/
 char *getToken ()
  {
   int i;                            //local index for lexeme
 
   if (!lookahead)                   //get first char
-   c = getchar();
+   c = getc(source);
 
-  while ((c == ' ') || (c == '\n')) //skip white space
-   c = getchar();
+  skipBlanks();                     //skip white space
 
-  if ((c == ')') || (c == '\'')) {  //Case (1): right paren or quote
+  if (c == EOF) {                   //end of input
+    strcpy(lexeme, ")");
+    lookahead = 1;
+   }
+  else if ((c == ')') || (c == '\'')) {  //Case (1): right paren or quote
     lexeme[0] = c;
     lexeme[1] = '\0';
     lookahead = 0;
    }
   else if (c == '(') {              //Case (2): left paren or ()
     lookahead = 1;
-    c = getchar();
-    while ((c == ' ') || (c == '\n'))
-     c = getchar();
+    c = getc(source);
+    skipBlanks();
     if (c == ')') {
       strcpy(lexeme, "()");          //empty list token
       lookahead = 0;
@@ -96,7 +181,7 @@ char *getToken ()
    }
   else if (c == '#') {              //Case (3): #t or #f
     lookahead = 0;
-    c = getchar();
+    c = getc(source);
     if ((c != 't') && (c != 'f')) {
         printf("Illegal symbol after #.\n");
         exit(1);
@@ -109,9 +194,11 @@ char *getToken ()
   else {                            //Case (4): scan for symbol
     i = 0;
     lookahead = 1;
-    while ((c != '(') && (c != ')') && (c != '\'') && (c != ' ') && (c != '\n')) {
-      lexeme[i++] = c;
-      c = getchar();
+    while ((c != '(') && (c != ')') && (c != '\'') && (c != ' ') && (c != '\n')
+           && (c != '\t') && (c != '\r') && (c != ';') && (c != EOF)) {
+      if (i < capacity - 1)
+        lexeme[i++] = c;
+      c = getc(source);
      }/* while */
     lexeme[i] = '\0';
    }
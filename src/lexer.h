@@ -8,6 +8,13 @@
 #ifndef LEXER
 #define LEXER
 #include <stdlib.h>
+#include <stdio.h>
+
+/****************************************************************
+ Maximum length of a token, including its terminating '\0'. Long
+ enough for the digits of large integer literals.
+ */
+#define TOKEN_LENGTH 1024
 
 /****************************************************************
  Function: startTokens(int maxLength)
@@ -35,6 +42,10 @@ void startTokens (int maxLength);
  symbols or literals, and are returned as strings. (For ease
  in scanning, there is one exception: the "#" sign is excluded
  except at the beginning of #t or #f.)
+
+ Comments run from a ";" to the end of the line and are skipped
+ like white space. Once the stream has ended ")" is returned, so
+ a list left open at the end of a file is closed there.
  
  To invoke this, one may, for example, declare a string variable
  named token:
@@ -64,9 +75,34 @@ void startTokens (int maxLength);
  in the same way without losing the information in token.
      
  WARNING: Tokens may be at most maxLength characters long (see
- startTokens()). This function is not guaranteed to work for longer
- tokens, although it may work in most cases.
+ startTokens()). Longer symbols are cut short at that length.
  */
 char * getToken ();
 
+/****************************************************************
+ Function: moreTokens()
+ ----------------------
+ Skips white space and comments, and returns 1 if a token follows
+ in the current stream or 0 once the stream has ended. Blocks until
+ the next character is typed when reading from the keyboard.
+ */
+int moreTokens ();
+
+/****************************************************************
+ Function: pushTokenSource(FILE *stream)
+ ---------------------------------------
+ Makes getToken() read from the given stream, such as a file being
+ loaded, until popTokenSource() is called. The stream read before
+ is saved along with any character it had looked ahead at.
+ */
+void pushTokenSource (FILE *stream);
+
+/****************************************************************
+ Function: popTokenSource()
+ --------------------------
+ Goes back to reading from the stream that was current before the
+ last call to pushTokenSource(). The popped stream is not closed.
+ */
+void popTokenSource ();
+
 #endif
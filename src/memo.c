@@ -0,0 +1,184 @@
+#include <stdlib.h>
+#include "parser.h"
+#include "hashtable.h"
+#include "memo.h"
+
+/****************************************************************
+ File: Memo.c
+ ----------------
+ Implementation for memo.h interface. The index works like the one
+ of HashTable: open addressing with linear probing over a power of
+ two number of slots, with evicted entries leaving a marker behind
+ until the index is rebuilt.
+ ****************************************************************/
+
+// Marker for slots whose entry was evicted
+static MemoEntry mEvicted;
+
+// Prototypes for private helpers
+static int findSlot(MemoTable*, Cell*, unsigned int);
+static void rebuild(MemoTable*);
+static void detach(MemoTable*, MemoEntry*);
+static void pushNewest(MemoTable*, MemoEntry*);
+static void evictOldest(MemoTable*);
+
+/****************************************************************
+ iniMemoTable(): See header file for documentation.
+*/
+MemoTable* iniMemoTable(int limit, int (*equals)(Cell*, Cell*))
+{
+    MemoTable* table = malloc(sizeof(MemoTable));
+    table->mCount = 0;
+    table->mUsed = 0;
+    table->mCapacity = 16;
+    table->mLimit = limit;
+    table->mSlots = calloc(table->mCapacity, sizeof(MemoEntry*));
+    table->mNewest = NULL;
+    table->mOldest = NULL;
+    table->mHits = 0;
+    table->mMisses = 0;
+    table->mEvictions = 0;
+    table->mEquals = equals;
+    return table;
+}
+
+/****************************************************************
+ memoGet(): See header file for documentation.
+*/
+Cell* memoGet(MemoTable* table, Cell* arguments)
+{
+    MemoEntry* entry = table->mSlots[findSlot(table, arguments, hashCell(arguments))];
+    if (entry == NULL || entry == &mEvicted) {
+        table->mMisses++;
+        return NULL;
+    }
+    table->mHits++;
+    if (entry != table->mNewest) {
+        detach(table, entry);
+        pushNewest(table, entry);
+    }
+    return entry->mResult;
+}
+
+/****************************************************************
+ memoPut(): See header file for documentation.
+*/
+void memoPut(MemoTable* table, Cell* arguments, Cell* result)
+{
+    unsigned int hash = hashCell(arguments);
+    int slot = findSlot(table, arguments, hash);
+    MemoEntry* entry = table->mSlots[slot];
+    if (entry != NULL && entry != &mEvicted) {
+        // Already cached by a nested call with the same arguments
+        entry->mResult = result;
+        return;
+    }
+
+    if (table->mLimit > 0 && table->mCount >= table->mLimit) {
+        evictOldest(table);
+        slot = findSlot(table, arguments, hash);
+    }
+    // Keep at most three quarters of the slots occupied
+    if (table->mSlots[slot] == NULL && (table->mUsed + 1) * 4 > table->mCapacity * 3) {
+        rebuild(table);
+        slot = findSlot(table, arguments, hash);
+    }
+
+    entry = malloc(sizeof(MemoEntry));
+    entry->mHash = hash;
+    entry->mArguments = arguments;
+    entry->mResult = result;
+    if (table->mSlots[slot] == NULL) table->mUsed++;
+    table->mSlots[slot] = entry;
+    table->mCount++;
+    pushNewest(table, entry);
+}
+
+/****************************************************************
+ Private helper that probes for the given arguments. The returned
+ slot either holds them or is the free slot where they would be
+ inserted, reusing the first evicted slot passed on the way.
+*/
+static int findSlot(MemoTable* table, Cell* arguments, unsigned int hash)
+{
+    int mask = table->mCapacity - 1;
+    int slot = hash & mask;
+    int reusable = -1;
+    while (table->mSlots[slot] != NULL) {
+        MemoEntry* entry = table->mSlots[slot];
+        if (entry == &mEvicted) {
+            if (reusable == -1) reusable = slot;
+        } else if (entry->mHash == hash && table->mEquals(entry->mArguments, arguments)) {
+            return slot;
+        }
+        slot = (slot + 1) & mask;
+    }
+    if (reusable != -1) return reusable;
+    return slot;
+}
+
+/****************************************************************
+ Private helper that re-inserts every live entry into a fresh
+ index, doubling it only when live entries fill half of it.
+*/
+static void rebuild(MemoTable* table)
+{
+    int oldCapacity = table->mCapacity;
+    MemoEntry** old = table->mSlots;
+    if (table->mCount * 2 >= oldCapacity) table->mCapacity = oldCapacity * 2;
+    table->mSlots = calloc(table->mCapacity, sizeof(MemoEntry*));
+    table->mUsed = table->mCount;
+
+    int mask = table->mCapacity - 1;
+    int i;
+    for (i = 0; i < oldCapacity; i++) {
+        if (old[i] == NULL || old[i] == &mEvicted) continue;
+        int slot = old[i]->mHash & mask;
+        while (table->mSlots[slot] != NULL)
+            slot = (slot + 1) & mask;
+        table->mSlots[slot] = old[i];
+    }
+    free(old);
+}
+
+/****************************************************************
+ Private helper taking an entry out of the recency list.
+*/
+static void detach(MemoTable* table, MemoEntry* entry)
+{
+    if (entry->mNewer != NULL) entry->mNewer->mOlder = entry->mOlder;
+    else table->mNewest = entry->mOlder;
+    if (entry->mOlder != NULL) entry->mOlder->mNewer = entry->mNewer;
+    else table->mOldest = entry->mNewer;
+}
+
+/****************************************************************
+ Private helper putting an entry at the front of the recency list.
+*/
+static void pushNewest(MemoTable* table, MemoEntry* entry)
+{
+    entry->mNewer = NULL;
+    entry->mOlder = table->mNewest;
+    if (table->mNewest != NULL) table->mNewest->mNewer = entry;
+    else table->mOldest = entry;
+    table->mNewest = entry;
+}
+
+/****************************************************************
+ Private helper dropping the least recently used entry.
+*/
+static void evictOldest(MemoTable* table)
+{
+    MemoEntry* oldest = table->mOldest;
+    if (oldest == NULL) return;
+    detach(table, oldest);
+
+    int mask = table->mCapacity - 1;
+    int slot = oldest->mHash & mask;
+    while (table->mSlots[slot] != oldest)
+        slot = (slot + 1) & mask;
+    table->mSlots[slot] = &mEvicted;
+    table->mCount--;
+    table->mEvictions++;
+    free(oldest);
+}
@@ -0,0 +1,71 @@
+#ifndef MEMO_H_INCLUDED
+#define MEMO_H_INCLUDED
+
+#include "parser.h"
+
+/****************************************************************
+ File: Memo.h
+ ----------------
+ Interface for Memo, a bounded cache of the results of a pure
+ function keyed by the list of its evaluated arguments.
+
+ Arguments are hashed structurally by hashCell(Cell*) and compared
+ with the table's equality function, so calls with equal? arguments
+ share a result. Once the table holds its limit of entries, storing
+ another evicts the least recently used one.
+ ****************************************************************/
+
+/****************************************************************
+ Cached call. Entries are kept in a list from the most to the
+ least recently used through mOlder and mNewer.
+*/
+typedef struct memoEntry MemoEntry;
+struct memoEntry {
+    unsigned int mHash;
+    Cell* mArguments;
+    Cell* mResult;
+    MemoEntry* mOlder;
+    MemoEntry* mNewer;
+};
+
+/****************************************************************
+ Cache of one function. mSlots is an open addressing index of the
+ entries, and mUsed counts live entries plus removed slots still
+ occupying a probe position, as in HashTable. A mLimit of 0 means
+ the table is unbounded.
+*/
+typedef struct memoTable MemoTable;
+struct memoTable {
+    int mCount;
+    int mUsed;
+    int mCapacity;
+    int mLimit;
+    MemoEntry** mSlots;
+    MemoEntry* mNewest;
+    MemoEntry* mOldest;
+    long mHits;
+    long mMisses;
+    long mEvictions;
+    int (*mEquals)(Cell*, Cell*);
+};
+
+/****************************************************************
+ Creates an empty table holding at most the given number of
+ entries and comparing arguments with the given function.
+*/
+MemoTable* iniMemoTable(int, int (*equals)(Cell*, Cell*));
+
+/****************************************************************
+ Gives the result cached for the given list of arguments and marks
+ it as the most recently used, or gives NULL when there is none.
+ Counts a hit or a miss either way.
+*/
+Cell* memoGet(MemoTable*, Cell*);
+
+/****************************************************************
+ Caches the result for the given list of arguments, evicting the
+ least recently used entry when the table is full.
+*/
+void memoPut(MemoTable*, Cell*, Cell*);
+
+#endif
@@ -0,0 +1,74 @@
+#ifndef NATIVE_H_INCLUDED
+#define NATIVE_H_INCLUDED
+
+#include <stdlib.h>
+
+#include "parser.h"
+#include "number.h"
+#include "evaluation.h"
+
+/****************************************************************
+ File: Native.h
+ ----------------
+ Interface for the runtime that C code generated by compileFile()
+ calls into (see compiler.h). Generated code only needs this file.
+
+ A compiled function receives its evaluated arguments and gives its
+ value as Cells, exactly like a function run by the interpreter.
+ Its body is a CELL_NATIVE Cell holding the C function, so calls
+ from interpreted code, apply, map and memoization reach it like
+ any other user defined function.
+ ****************************************************************/
+
+/****************************************************************
+ C function behind a compiled function, given an array of its
+ evaluated arguments.
+*/
+typedef Cell* (*NativeFunction)(Cell**);
+
+/****************************************************************
+ Defines the named function with the given formal parameters, of
+ which there are as many as the given count, to run the given C
+ function. Redefining a function, compiled or not, replaces it in
+ place as define does.
+*/
+void nativeDefine(char*, char**, int, NativeFunction);
+
+/****************************************************************
+ Calls whatever the head of the given call form names with the
+ given evaluated arguments, as the interpreter would: a builtin
+ first and else a user defined function. A name that is neither
+ gives back the call form.
+*/
+Cell* nativeCall(Cell*, Cell**, int);
+
+/****************************************************************
+ Gives the value of the given text read as quoted data.
+*/
+Cell* nativeDatum(char*);
+
+/****************************************************************
+ Reads and evaluates the expression in the given text, as typed
+ at the prompt but without printing its value.
+*/
+void nativeEvaluate(char*);
+
+/****************************************************************
+ Gives the value of an operand of arithmetic, where anything that
+ is not a numerical atom counts as 0, and boxes a Number back into
+ a new numerical atom.
+*/
+Number nativeOperand(Cell*);
+Cell* nativeBox(Number);
+
+/****************************************************************
+ Builtins compiled to direct calls. nativeNull(Cell*) and
+ nativeEqual(Cell*, Cell*) give 1 or 0 rather than #t or #f.
+*/
+Cell* nativeCar(Cell*);
+Cell* nativeCdr(Cell*);
+Cell* nativeCons(Cell*, Cell*);
+int nativeNull(Cell*);
+int nativeEqual(Cell*, Cell*);
+
+#endif
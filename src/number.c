@@ -0,0 +1,306 @@
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <math.h>
+#include <errno.h>
+#include "parser.h"
+#include "bignum.h"
+#include "number.h"
+#include "allocator.h"
+
+/****************************************************************
+ File: Number.c
+ ----------------
+ Implementation for number.h interface. Every operation first
+ tries the fast path of two fixnums with an overflow checked
+ machine instruction, and only promotes both operands to Bignums
+ when that overflows. Bignum results are demoted back to fixnums
+ whenever they fit. An operation with a flonum operand is done
+ with doubles instead.
+
+ Flonums print with the fewest digits that read back as the same
+ double, always with a '.' or an exponent so they never look like
+ integers.
+ ****************************************************************/
+
+// Prototypes for private helpers
+static int isIntegerText(char*);
+static int isFlonumText(char*);
+static char* flonumText(double);
+static Bignum* toBignum(Number);
+static Number bignumNumber(Bignum*);
+
+/****************************************************************
+ tagNumber(): See header file for documentation.
+*/
+int tagNumber(Cell* cell)
+{
+    if (cell->mType == CELL_FIXNUM || cell->mType == CELL_BIGNUM
+        || cell->mType == CELL_FLONUM) return 1;
+    if (cell->mType != CELL_PLAIN || cell->mSymbol == NULL) return 0;
+
+    // Flonums are read once and their text made canonical, so that
+    // equal values are also equal? and hash alike
+    if (isFlonumText(cell->mSymbol)) {
+        cell->mType = CELL_FLONUM;
+        cell->mFlonum = strtod(cell->mSymbol, NULL);
+        cell->mSymbol = flonumText(cell->mFlonum);
+        return 1;
+    }
+    if (isIntegerText(cell->mSymbol) == 0) return 0;
+
+    errno = 0;
+    long value = strtol(cell->mSymbol, NULL, 10);
+    if (errno == ERANGE) {
+        cell->mType = CELL_BIGNUM;
+        cell->mData = bignumFromText(cell->mSymbol);
+    } else {
+        cell->mType = CELL_FIXNUM;
+        cell->mFixnum = value;
+    }
+    return 1;
+}
+
+/****************************************************************
+ numberOf(): See header file for documentation.
+*/
+Number numberOf(Cell* cell)
+{
+    Number number;
+    number.mKind = NUMBER_NONE;
+    number.mFixnum = 0;
+    number.mBignum = NULL;
+    number.mFlonum = 0;
+    if (cell == NULL || tagNumber(cell) == 0) return number;
+
+    if (cell->mType == CELL_FIXNUM) {
+        number.mKind = NUMBER_FIXNUM;
+        number.mFixnum = cell->mFixnum;
+    } else if (cell->mType == CELL_FLONUM) {
+        number.mKind = NUMBER_FLONUM;
+        number.mFlonum = cell->mFlonum;
+    } else {
+        number.mKind = NUMBER_BIGNUM;
+        number.mBignum = cell->mData;
+    }
+    return number;
+}
+
+/****************************************************************
+ fixnumNumber(): See header file for documentation.
+*/
+Number fixnumNumber(long value)
+{
+    Number number;
+    number.mKind = NUMBER_FIXNUM;
+    number.mFixnum = value;
+    number.mBignum = NULL;
+    number.mFlonum = 0;
+    return number;
+}
+
+/****************************************************************
+ flonumNumber(): See header file for documentation.
+*/
+Number flonumNumber(double value)
+{
+    Number number;
+    number.mKind = NUMBER_FLONUM;
+    number.mFixnum = 0;
+    number.mBignum = NULL;
+    number.mFlonum = value;
+    return number;
+}
+
+/****************************************************************
+ doubleOf(): See header file for documentation.
+*/
+double doubleOf(Number number)
+{
+    if (number.mKind == NUMBER_FLONUM) return number.mFlonum;
+    if (number.mKind == NUMBER_BIGNUM) return bignumToDouble(number.mBignum);
+    return (double) number.mFixnum;
+}
+
+/****************************************************************
+ setNumber(): See header file for documentation.
+*/
+void setNumber(Cell* cell, Number number)
+{
+    if (number.mKind == NUMBER_BIGNUM) {
+        cell->mType = CELL_BIGNUM;
+        cell->mData = number.mBignum;
+        cell->mSymbol = bignumToText(number.mBignum);
+    } else if (number.mKind == NUMBER_FLONUM) {
+        cell->mType = CELL_FLONUM;
+        cell->mFlonum = number.mFlonum;
+        cell->mSymbol = flonumText(number.mFlonum);
+    } else {
+        cell->mType = CELL_FIXNUM;
+        cell->mFixnum = number.mFixnum;
+        cell->mSymbol = allocate(sizeof(char) * 24);
+        sprintf(cell->mSymbol, "%li", number.mFixnum);
+    }
+}
+
+/****************************************************************
+ addNumbers(): See header file for documentation.
+*/
+Number addNumbers(Number a, Number b)
+{
+    long sum;
+    if (a.mKind == NUMBER_FIXNUM && b.mKind == NUMBER_FIXNUM
+        && !__builtin_add_overflow(a.mFixnum, b.mFixnum, &sum))
+        return fixnumNumber(sum);
+    if (a.mKind == NUMBER_FLONUM || b.mKind == NUMBER_FLONUM)
+        return flonumNumber(doubleOf(a) + doubleOf(b));
+    return bignumNumber(bignumAdd(toBignum(a), toBignum(b)));
+}
+
+/****************************************************************
+ subtractNumbers(): See header file for documentation.
+*/
+Number subtractNumbers(Number a, Number b)
+{
+    long difference;
+    if (a.mKind == NUMBER_FIXNUM && b.mKind == NUMBER_FIXNUM
+        && !__builtin_sub_overflow(a.mFixnum, b.mFixnum, &difference))
+        return fixnumNumber(difference);
+    if (a.mKind == NUMBER_FLONUM || b.mKind == NUMBER_FLONUM)
+        return flonumNumber(doubleOf(a) - doubleOf(b));
+    return bignumNumber(bignumSubtract(toBignum(a), toBignum(b)));
+}
+
+/****************************************************************
+ multiplyNumbers(): See header file for documentation.
+*/
+Number multiplyNumbers(Number a, Number b)
+{
+    long product;
+    if (a.mKind == NUMBER_FIXNUM && b.mKind == NUMBER_FIXNUM
+        && !__builtin_mul_overflow(a.mFixnum, b.mFixnum, &product))
+        return fixnumNumber(product);
+    if (a.mKind == NUMBER_FLONUM || b.mKind == NUMBER_FLONUM)
+        return flonumNumber(doubleOf(a) * doubleOf(b));
+    return bignumNumber(bignumMultiply(toBignum(a), toBignum(b)));
+}
+
+/****************************************************************
+ divideNumbers(): See header file for documentation.
+*/
+Number divideNumbers(Number a, Number b)
+{
+    if (a.mKind == NUMBER_FLONUM || b.mKind == NUMBER_FLONUM)
+        return flonumNumber(doubleOf(a) / doubleOf(b));
+
+    Number none;
+    none.mKind = NUMBER_NONE;
+    none.mFixnum = 0;
+    none.mBignum = NULL;
+    none.mFlonum = 0;
+    if (b.mKind == NUMBER_FIXNUM && b.mFixnum == 0) return none;
+
+    // LONG_MIN / -1 is the one fixnum quotient that overflows
+    if (a.mKind == NUMBER_FIXNUM && b.mKind == NUMBER_FIXNUM
+        && !(b.mFixnum == -1 && a.mFixnum == -__LONG_MAX__ - 1)) {
+        if (a.mFixnum % b.mFixnum == 0) return fixnumNumber(a.mFixnum / b.mFixnum);
+        return flonumNumber((double) a.mFixnum / (double) b.mFixnum);
+    }
+
+    Bignum* remainder;
+    Bignum* quotient = bignumDivide(toBignum(a), toBignum(b), &remainder);
+    if (remainder->mSign == 0) return bignumNumber(quotient);
+    return flonumNumber(doubleOf(a) / doubleOf(b));
+}
+
+/****************************************************************
+ compareNumbers(): See header file for documentation.
+*/
+int compareNumbers(Number a, Number b)
+{
+    if (a.mKind == NUMBER_FIXNUM && b.mKind == NUMBER_FIXNUM)
+        return (a.mFixnum > b.mFixnum) - (a.mFixnum < b.mFixnum);
+    if (a.mKind == NUMBER_FLONUM || b.mKind == NUMBER_FLONUM) {
+        double x = doubleOf(a);
+        double y = doubleOf(b);
+        return (x > y) - (x < y);
+    }
+    return bignumCompare(toBignum(a), toBignum(b));
+}
+
+/****************************************************************
+ Private helper checking that text is an optional '-' followed by
+ one or more digits and nothing else.
+*/
+static int isIntegerText(char* text)
+{
+    if (*text == '-') text++;
+    if (*text == '\0') return 0;
+    for (; *text != '\0'; text++)
+        if (*text < '0' || *text > '9') return 0;
+    return 1;
+}
+
+/****************************************************************
+ Private helper checking that text is a decimal flonum: an
+ optional '-', digits with a '.' somewhere among them and an
+ optional exponent, or digits with an exponent alone.
+*/
+static int isFlonumText(char* text)
+{
+    char* end;
+    if (*text == '-') text++;
+    if ((*text < '0' || *text > '9') && *text != '.') return 0;
+    if (strchr(text, '.') == NULL && strchr(text, 'e') == NULL
+        && strchr(text, 'E') == NULL) return 0;
+    if (strpbrk(text, "xXpPnN") != NULL) return 0;
+    strtod(text, &end);
+    return end != text && *end == '\0';
+}
+
+/****************************************************************
+ Private helper giving the newly allocated canonical text of a
+ flonum, trying more digits until the text reads back exactly.
+*/
+static char* flonumText(double value)
+{
+    char* text = allocate(sizeof(char) * 32);
+    if (isnan(value)) strcpy(text, "+nan.0");
+    else if (isinf(value)) strcpy(text, value > 0 ? "+inf.0" : "-inf.0");
+    else {
+        int digits;
+        for (digits = 15; digits < 17; digits++) {
+            sprintf(text, "%.*g", digits, value);
+            if (strtod(text, NULL) == value) break;
+        }
+        if (digits == 17) sprintf(text, "%.17g", value);
+        if (strpbrk(text, ".e") == NULL) strcat(text, ".0");
+    }
+    return text;
+}
+
+/****************************************************************
+ Private helper promoting a Number to a Bignum.
+*/
+static Bignum* toBignum(Number number)
+{
+    if (number.mKind == NUMBER_BIGNUM) return number.mBignum;
+    return bignumFromLong(number.mFixnum);
+}
+
+/****************************************************************
+ Private helper wrapping a Bignum result into a Number, demoting
+ it to a fixnum when it fits in a long.
+*/
+static Number bignumNumber(Bignum* big)
+{
+    long value;
+    if (bignumToLong(big, &value)) return fixnumNumber(value);
+
+    Number number;
+    number.mKind = NUMBER_BIGNUM;
+    number.mFixnum = 0;
+    number.mBignum = big;
+    number.mFlonum = 0;
+    return number;
+}
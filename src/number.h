@@ -0,0 +1,101 @@
+#ifndef NUMBER_H_INCLUDED
+#define NUMBER_H_INCLUDED
+
+#include "parser.h"
+#include "bignum.h"
+
+/****************************************************************
+ File: Number.h
+ ----------------
+ Interface for Number, the numerical tower behind numerical atoms.
+
+ A numerical atom keeps its text in mSymbol like any other atom,
+ so printing and equal? are unchanged, and also caches its value
+ in the Cell: a CELL_FIXNUM keeps a long in mFixnum, a CELL_BIGNUM
+ keeps a Bignum in mData and a CELL_FLONUM keeps a double in
+ mFlonum. Arithmetic works on the cached value and only falls back
+ to Bignum when a long would overflow, so results that fit in a
+ long never allocate limbs.
+
+ Integers are exact and flonums are not. Any operation with a
+ flonum operand converts the other operand to a double and gives
+ a flonum.
+ ****************************************************************/
+
+/****************************************************************
+ Kinds of Number. NUMBER_NONE marks a value that is not numerical.
+ */
+enum numberKind {
+    NUMBER_NONE = 0,
+    NUMBER_FIXNUM,
+    NUMBER_BIGNUM,
+    NUMBER_FLONUM
+};
+
+/****************************************************************
+ Value of a numerical atom, passed around by value. Only the
+ member matching mKind is meaningful.
+*/
+typedef struct number Number;
+struct number {
+    int mKind;
+    long mFixnum;
+    Bignum* mBignum;
+    double mFlonum;
+};
+
+/****************************************************************
+ Caches the value of the given atom in the Cell if its text is a
+ number. Returns 1 for a numerical atom and 0 otherwise.
+*/
+int tagNumber(Cell*);
+
+/****************************************************************
+ Gives the value of a numerical atom, tagging it first if needed.
+ Anything else gives a Number of kind NUMBER_NONE.
+*/
+Number numberOf(Cell*);
+
+/****************************************************************
+ Wraps a long into a Number.
+*/
+Number fixnumNumber(long);
+
+/****************************************************************
+ Wraps a double into a Number.
+*/
+Number flonumNumber(double);
+
+/****************************************************************
+ Converts any numerical value into the nearest double.
+*/
+double doubleOf(Number);
+
+/****************************************************************
+ Turns the given Cell into a numerical atom holding the Number,
+ filling in both its text and its cached value.
+*/
+void setNumber(Cell*, Number);
+
+/****************************************************************
+ Exact arithmetic. Operands must be numerical.
+*/
+Number addNumbers(Number, Number);
+Number subtractNumbers(Number, Number);
+Number multiplyNumbers(Number, Number);
+
+/****************************************************************
+ Division. Integers that divide evenly give an exact integer and
+ otherwise the quotient is a flonum, as there are no rationals.
+ Dividing by an exact zero gives a Number of kind NUMBER_NONE.
+*/
+Number divideNumbers(Number, Number);
+
+/****************************************************************
+ Compares two numerical values, giving a negative number, zero,
+ or a positive number when the first is respectively less than,
+ equal to, or greater than the second.
+*/
+int compareNumbers(Number, Number);
+
+#endif
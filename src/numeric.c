@@ -0,0 +1,520 @@
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <pthread.h>
+#include "numeric.h"
+
+/****************************************************************
+ File: Numeric.c
+ ----------------
+ Implementation for numeric.h interface.
+
+ The kernels avoid a per-member overflow check, which would keep
+ the compiler from vectorizing them, by first checking that every
+ member fits in a narrower width with a loop that vectorizes on
+ its own (see fitsBits()). When the members are narrow enough that
+ the whole computation provably cannot overflow, a plain loop does
+ the work and is vectorized. Otherwise a scalar loop checks every
+ step. This file is compiled with -O3 so that the plain loops are
+ vectorized.
+
+ Floating point addition isn't associative, so the compiler won't
+ split a single running sum of doubles across vector lanes on its
+ own. The flonum reductions spell the lanes out instead, keeping
+ FLONUM_LANES independent partial results that are combined at
+ the end.
+
+ Sorting is a stable merge sort of the values paired with their
+ positions, merging back and forth between two arrays rather than
+ copying every merge back. A descending sort inverts the bits of
+ the values, which reverses their order without the overflow of
+ negating them, so that the loops only ever compare one way. A
+ large array is split into one part per processor, each sorted on
+ a thread of its own, and the sorted parts are then merged two by
+ two, every pair on a thread, until one is left.
+ ****************************************************************/
+
+// Members of a dot product block are at most 2^(DOT_BITS - 1),
+// so each block of DOT_BLOCK products sums to well below 2^63
+#define DOT_BITS 24
+#define DOT_BLOCK 32768
+
+// Number of partial results kept by the flonum reductions
+#define FLONUM_LANES 8
+
+// Fewest values each thread sorts, and the longest run sorted by
+// insertion rather than merged
+#define SORT_PART 65536
+#define SORT_RUN 16
+
+/****************************************************************
+ A value being sorted along with its position in the input.
+*/
+typedef struct sortKey SortKey;
+struct sortKey {
+    long mKey;
+    int mIndex;
+};
+
+/****************************************************************
+ Work of one thread of sortFixnums(const long*, int*, int, int):
+ sorting the keys of the range from mBegin to mEnd in place, using
+ the same range of mTo, a copy, for scratch, or merging the sorted
+ ranges either side of mMiddle from mFrom into mTo.
+*/
+typedef struct sortPart SortPart;
+struct sortPart {
+    SortKey* mFrom;
+    SortKey* mTo;
+    int mBegin;
+    int mMiddle;
+    int mEnd;
+};
+
+// Prototypes for private helpers
+static int fitsBits(const long*, int, int);
+static void runParts(void* (*)(void*), SortPart*, int);
+static void* sortPart(void*);
+static void* mergePart(void*);
+static void sortKeys(SortKey*, SortKey*, int);
+static void mergeKeys(SortKey*, int, SortKey*, int, SortKey*);
+
+/****************************************************************
+ sumFixnums(): See header file for documentation. With members
+ of at most 2^31 in magnitude, a sum of fewer than 2^31 of them
+ fits in 64 bits.
+*/
+int sumFixnums(const long* values, int count, long* result)
+{
+    int i;
+    long sum = 0;
+    if (fitsBits(values, count, 32)) {
+        for (i = 0; i < count; i++)
+            sum += values[i];
+        *result = sum;
+        return 0;
+    }
+
+    for (i = 0; i < count; i++)
+        if (__builtin_add_overflow(sum, values[i], &sum)) return 1;
+    *result = sum;
+    return 0;
+}
+
+/****************************************************************
+ productFixnums(): See header file for documentation. Products
+ outgrow any fixed width quickly, so every step is checked.
+*/
+int productFixnums(const long* values, int count, long* result)
+{
+    int i;
+    long product = 1;
+    for (i = 0; i < count; i++) {
+        if (values[i] == 0) {
+            *result = 0;
+            return 0;
+        }
+        if (__builtin_mul_overflow(product, values[i], &product)) {
+            // A later zero still makes the exact product fit
+            int j;
+            for (j = i + 1; j < count; j++)
+                if (values[j] == 0) {
+                    *result = 0;
+                    return 0;
+                }
+            return 1;
+        }
+    }
+    *result = product;
+    return 0;
+}
+
+/****************************************************************
+ minFixnums(): See header file for documentation.
+*/
+long minFixnums(const long* values, int count)
+{
+    int i;
+    long least = values[0];
+    for (i = 1; i < count; i++)
+        least = values[i] < least ? values[i] : least;
+    return least;
+}
+
+/****************************************************************
+ maxFixnums(): See header file for documentation.
+*/
+long maxFixnums(const long* values, int count)
+{
+    int i;
+    long most = values[0];
+    for (i = 1; i < count; i++)
+        most = values[i] > most ? values[i] : most;
+    return most;
+}
+
+/****************************************************************
+ dotFixnums(): See header file for documentation. Narrow members
+ are summed in blocks small enough to never overflow, and only
+ the block sums are combined with a check.
+*/
+int dotFixnums(const long* a, const long* b, int count, long* result)
+{
+    int i;
+    long sum = 0;
+    if (fitsBits(a, count, DOT_BITS) && fitsBits(b, count, DOT_BITS)) {
+        int start;
+        for (start = 0; start < count; start += DOT_BLOCK) {
+            int end = start + DOT_BLOCK < count ? start + DOT_BLOCK : count;
+            long block = 0;
+            for (i = start; i < end; i++)
+                block += a[i] * b[i];
+            if (__builtin_add_overflow(sum, block, &sum)) return 1;
+        }
+        *result = sum;
+        return 0;
+    }
+
+    for (i = 0; i < count; i++) {
+        long product;
+        if (__builtin_mul_overflow(a[i], b[i], &product)) return 1;
+        if (__builtin_add_overflow(sum, product, &sum)) return 1;
+    }
+    *result = sum;
+    return 0;
+}
+
+/****************************************************************
+ addFixnums(): See header file for documentation.
+*/
+int addFixnums(const long* a, const long* b, int count, long* output)
+{
+    int i;
+    if (fitsBits(a, count, 62) && fitsBits(b, count, 62)) {
+        for (i = 0; i < count; i++)
+            output[i] = a[i] + b[i];
+        return 0;
+    }
+
+    // Checked into a local, as the output may alias an input
+    for (i = 0; i < count; i++) {
+        long sum;
+        if (__builtin_add_overflow(a[i], b[i], &sum)) return 1;
+        output[i] = sum;
+    }
+    return 0;
+}
+
+/****************************************************************
+ scaleFixnums(): See header file for documentation.
+*/
+int scaleFixnums(const long* values, int count, long factor, long* output)
+{
+    int i;
+    if (factor > -(1L << 31) && factor < (1L << 31) && fitsBits(values, count, 32)) {
+        for (i = 0; i < count; i++)
+            output[i] = values[i] * factor;
+        return 0;
+    }
+
+    for (i = 0; i < count; i++) {
+        long product;
+        if (__builtin_mul_overflow(values[i], factor, &product)) return 1;
+        output[i] = product;
+    }
+    return 0;
+}
+
+/****************************************************************
+ sumFlonums(): See header file for documentation.
+*/
+double sumFlonums(const double* values, int count)
+{
+    double lanes[FLONUM_LANES] = {0};
+    int i, lane;
+    int whole = count - count % FLONUM_LANES;
+    for (i = 0; i < whole; i += FLONUM_LANES)
+        for (lane = 0; lane < FLONUM_LANES; lane++)
+            lanes[lane] += values[i + lane];
+    for (; i < count; i++)
+        lanes[0] += values[i];
+
+    double sum = 0;
+    for (lane = 0; lane < FLONUM_LANES; lane++)
+        sum += lanes[lane];
+    return sum;
+}
+
+/****************************************************************
+ productFlonums(): See header file for documentation.
+*/
+double productFlonums(const double* values, int count)
+{
+    double lanes[FLONUM_LANES];
+    int i, lane;
+    for (lane = 0; lane < FLONUM_LANES; lane++)
+        lanes[lane] = 1;
+    int whole = count - count % FLONUM_LANES;
+    for (i = 0; i < whole; i += FLONUM_LANES)
+        for (lane = 0; lane < FLONUM_LANES; lane++)
+            lanes[lane] *= values[i + lane];
+    for (; i < count; i++)
+        lanes[0] *= values[i];
+
+    double product = 1;
+    for (lane = 0; lane < FLONUM_LANES; lane++)
+        product *= lanes[lane];
+    return product;
+}
+
+/****************************************************************
+ minFlonums(): See header file for documentation.
+*/
+double minFlonums(const double* values, int count)
+{
+    double lanes[FLONUM_LANES];
+    int i, lane;
+    for (lane = 0; lane < FLONUM_LANES; lane++)
+        lanes[lane] = values[0];
+    int whole = count - count % FLONUM_LANES;
+    for (i = 0; i < whole; i += FLONUM_LANES)
+        for (lane = 0; lane < FLONUM_LANES; lane++)
+            lanes[lane] = values[i + lane] < lanes[lane] ? values[i + lane] : lanes[lane];
+    for (; i < count; i++)
+        lanes[0] = values[i] < lanes[0] ? values[i] : lanes[0];
+
+    double least = lanes[0];
+    for (lane = 1; lane < FLONUM_LANES; lane++)
+        least = lanes[lane] < least ? lanes[lane] : least;
+    return least;
+}
+
+/****************************************************************
+ maxFlonums(): See header file for documentation.
+*/
+double maxFlonums(const double* values, int count)
+{
+    double lanes[FLONUM_LANES];
+    int i, lane;
+    for (lane = 0; lane < FLONUM_LANES; lane++)
+        lanes[lane] = values[0];
+    int whole = count - count % FLONUM_LANES;
+    for (i = 0; i < whole; i += FLONUM_LANES)
+        for (lane = 0; lane < FLONUM_LANES; lane++)
+            lanes[lane] = values[i + lane] > lanes[lane] ? values[i + lane] : lanes[lane];
+    for (; i < count; i++)
+        lanes[0] = values[i] > lanes[0] ? values[i] : lanes[0];
+
+    double most = lanes[0];
+    for (lane = 1; lane < FLONUM_LANES; lane++)
+        most = lanes[lane] > most ? lanes[lane] : most;
+    return most;
+}
+
+/****************************************************************
+ dotFlonums(): See header file for documentation.
+*/
+double dotFlonums(const double* a, const double* b, int count)
+{
+    double lanes[FLONUM_LANES] = {0};
+    int i, lane;
+    int whole = count - count % FLONUM_LANES;
+    for (i = 0; i < whole; i += FLONUM_LANES)
+        for (lane = 0; lane < FLONUM_LANES; lane++)
+            lanes[lane] += a[i + lane] * b[i + lane];
+    for (; i < count; i++)
+        lanes[0] += a[i] * b[i];
+
+    double sum = 0;
+    for (lane = 0; lane < FLONUM_LANES; lane++)
+        sum += lanes[lane];
+    return sum;
+}
+
+/****************************************************************
+ addFlonums(): See header file for documentation.
+*/
+void addFlonums(const double* a, const double* b, int count, double* output)
+{
+    int i;
+    for (i = 0; i < count; i++)
+        output[i] = a[i] + b[i];
+}
+
+/****************************************************************
+ scaleFlonums(): See header file for documentation.
+*/
+void scaleFlonums(const double* values, int count, double factor, double* output)
+{
+    int i;
+    for (i = 0; i < count; i++)
+        output[i] = values[i] * factor;
+}
+
+/****************************************************************
+ sortFixnums(): See header file for documentation.
+*/
+void sortFixnums(const long* values, int* order, int count, int descending)
+{
+    SortKey* keys = malloc(sizeof(SortKey) * (count > 0 ? count : 1));
+    SortKey* scratch = malloc(sizeof(SortKey) * (count > 0 ? count : 1));
+    int i;
+    for (i = 0; i < count; i++) {
+        keys[i].mKey = descending ? ~values[i] : values[i];
+        keys[i].mIndex = i;
+    }
+    memcpy(scratch, keys, sizeof(SortKey) * count);
+
+    long processors = sysconf(_SC_NPROCESSORS_ONLN);
+    int partCount = count / SORT_PART + 1;
+    if (processors >= 1 && partCount > processors) partCount = processors;
+    SortPart* parts = malloc(sizeof(SortPart) * partCount);
+    int* bounds = malloc(sizeof(int) * (partCount + 1));
+    for (i = 0; i <= partCount; i++)
+        bounds[i] = (long) count * i / partCount;
+    for (i = 0; i < partCount; i++) {
+        parts[i].mFrom = keys;
+        parts[i].mTo = scratch;
+        parts[i].mBegin = bounds[i];
+        parts[i].mEnd = bounds[i + 1];
+    }
+    runParts(sortPart, parts, partCount);
+
+    // Merge neighbouring runs, leaving an odd one out to be copied
+    SortKey* from = keys;
+    SortKey* to = scratch;
+    int runs = partCount;
+    while (runs > 1) {
+        int merges = 0;
+        for (i = 0; i < runs; i += 2, merges++) {
+            parts[merges].mFrom = from;
+            parts[merges].mTo = to;
+            parts[merges].mBegin = bounds[i];
+            parts[merges].mMiddle = bounds[i + 1];
+            parts[merges].mEnd = bounds[i + 2 < runs ? i + 2 : runs];
+        }
+        runParts(mergePart, parts, merges);
+        for (i = 0; i <= merges; i++)
+            bounds[i] = bounds[2 * i < runs ? 2 * i : runs];
+        runs = merges;
+        SortKey* merged = to;
+        to = from;
+        from = merged;
+    }
+
+    for (i = 0; i < count; i++)
+        order[i] = from[i].mIndex;
+    free(bounds);
+    free(parts);
+    free(scratch);
+    free(keys);
+}
+
+/****************************************************************
+ Private helper running the given work on every part, the first
+ on the calling thread. A part whose thread cannot be started is
+ run on the calling thread as well.
+*/
+static void runParts(void* (*work)(void*), SortPart* parts, int count)
+{
+    pthread_t* threads = malloc(sizeof(pthread_t) * count);
+    int* started = calloc(count, sizeof(int));
+    int i;
+    for (i = 1; i < count; i++) {
+        started[i] = pthread_create(&threads[i], NULL, work, &parts[i]) == 0;
+        if (!started[i]) work(&parts[i]);
+    }
+    work(&parts[0]);
+    for (i = 1; i < count; i++)
+        if (started[i]) pthread_join(threads[i], NULL);
+    free(started);
+    free(threads);
+}
+
+/****************************************************************
+ Private helper sorting the range of one part in place.
+*/
+static void* sortPart(void* data)
+{
+    SortPart* part = data;
+    sortKeys(part->mFrom + part->mBegin, part->mTo + part->mBegin, part->mEnd - part->mBegin);
+    return NULL;
+}
+
+/****************************************************************
+ Private helper merging the two sorted ranges of one part.
+*/
+static void* mergePart(void* data)
+{
+    SortPart* part = data;
+    mergeKeys(part->mFrom + part->mBegin, part->mMiddle - part->mBegin,
+              part->mFrom + part->mMiddle, part->mEnd - part->mMiddle,
+              part->mTo + part->mBegin);
+    return NULL;
+}
+
+/****************************************************************
+ Private helper sorting the given keys in place with a merge sort,
+ given a scratch array holding a copy of them. Each half is sorted
+ within the scratch array, using the keys for scratch in turn, and
+ merged back into the keys. Short runs are sorted by insertion.
+*/
+static void sortKeys(SortKey* keys, SortKey* scratch, int count)
+{
+    if (count <= SORT_RUN) {
+        int i;
+        for (i = 1; i < count; i++) {
+            SortKey key = keys[i];
+            int j = i;
+            while (j > 0 && keys[j - 1].mKey > key.mKey) {
+                keys[j] = keys[j - 1];
+                j--;
+            }
+            keys[j] = key;
+        }
+        return;
+    }
+    int half = count / 2;
+    sortKeys(scratch, keys, half);
+    sortKeys(scratch + half, keys + half, count - half);
+    mergeKeys(scratch, half, scratch + half, count - half, keys);
+}
+
+/****************************************************************
+ Private helper merging two sorted arrays into the output. A key
+ of the second array goes first only when less, which keeps equal
+ keys in their order.
+*/
+static void mergeKeys(SortKey* a, int countA, SortKey* b, int countB, SortKey* output)
+{
+    int i = 0;
+    int j = 0;
+    int k = 0;
+    while (i < countA && j < countB) {
+        int second = b[j].mKey < a[i].mKey;
+        output[k++] = second ? b[j] : a[i];
+        j += second;
+        i += !second;
+    }
+    memcpy(output + k, a + i, sizeof(SortKey) * (countA - i));
+    memcpy(output + k + countA - i, b + j, sizeof(SortKey) * (countB - j));
+}
+
+/****************************************************************
+ Private helper checking that every value lies within
+ [-2^(bits - 1), 2^(bits - 1)). Offsetting a value by 2^(bits - 1)
+ maps that range onto [0, 2^bits), so any bit at or above the
+ given width marks a value out of range. The bits are OR-ed
+ together without branching so the loop vectorizes.
+*/
+static int fitsBits(const long* values, int count, int bits)
+{
+    unsigned long offset = 1UL << (bits - 1);
+    unsigned long outside = 0;
+    int i;
+    for (i = 0; i < count; i++) {
+        unsigned long shifted = (unsigned long) values[i] + offset;
+        outside |= shifted >> bits;
+    }
+    return outside == 0;
+}
@@ -0,0 +1,79 @@
+#ifndef NUMERIC_H_INCLUDED
+#define NUMERIC_H_INCLUDED
+
+/****************************************************************
+ File: Numeric.h
+ ----------------
+ Interface for Numeric, a package of arithmetic kernels over
+ contiguous arrays of integers, along with a sort. Evaluation
+ packs homogeneous numerical lists and vectors into arrays and
+ hands them to these kernels instead of walking cons cells one
+ member at a time.
+
+ Every integer kernel that can overflow returns 0 on success and
+ 1 when the exact result does not fit in a long, in which case
+ the output is left unspecified. The flonum kernels work the same
+ way over arrays of doubles and never fail.
+ ****************************************************************/
+
+/****************************************************************
+ Sum of the given values.
+*/
+int sumFixnums(const long*, int, long*);
+
+/****************************************************************
+ Product of the given values.
+*/
+int productFixnums(const long*, int, long*);
+
+/****************************************************************
+ Smallest of the given values. The count must be at least one.
+*/
+long minFixnums(const long*, int);
+
+/****************************************************************
+ Largest of the given values. The count must be at least one.
+*/
+long maxFixnums(const long*, int);
+
+/****************************************************************
+ Sum of the products of the members of two arrays of the given
+ count.
+*/
+int dotFixnums(const long*, const long*, int, long*);
+
+/****************************************************************
+ Adds two arrays of the given count member by member into the
+ output array.
+*/
+int addFixnums(const long*, const long*, int, long*);
+
+/****************************************************************
+ Multiplies each member of an array of the given count by a
+ factor into the output array.
+*/
+int scaleFixnums(const long*, int, long, long*);
+
+/****************************************************************
+ Flonum counterparts of the kernels above. Sums are accumulated in
+ several independent lanes, so their rounding may differ slightly
+ from adding the values strictly left to right.
+*/
+double sumFlonums(const double*, int);
+double productFlonums(const double*, int);
+double minFlonums(const double*, int);
+double maxFlonums(const double*, int);
+double dotFlonums(const double*, const double*, int);
+void addFlonums(const double*, const double*, int, double*);
+void scaleFlonums(const double*, int, double, double*);
+
+/****************************************************************
+ Gives through the second parameter the positions of the values
+ of an array of the given count in sorted order, ascending, or
+ descending when the last parameter is 1. The sort is stable, so
+ equal values keep their order. Arrays of more than 65536 values
+ are sorted on a thread per processor.
+*/
+void sortFixnums(const long*, int*, int, int);
+
+#endif
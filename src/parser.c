@@ -4,6 +4,10 @@
 #include "parser.h"
 #include "evaluation.h"
 #include "lexer.h"
+#include "hashtable.h"
+#include "number.h"
+#include "allocator.h"
+#include "reader.h"
 
 
 /****************************************************************
@@ -29,10 +33,20 @@
 // Private members and "constants"
 static char* mToken;
 
+// Hash-consing of quoted data, where mConsTable maps every shared
+// cell to itself
+static int mHashConsing = 0;
+static HashTable* mConsTable = NULL;
+
 // Prototypes for private helper functions
 static Cell* recurse_express();
 static void recurse_print(Cell*, int);
+static void print_value(Cell*);
+static void print_vector(Vector*);
 static Cell* iniCell();
+static Cell* hashCons(Cell*);
+static Cell* internCell(Cell*);
+static int sameCell(Cell*, Cell*);
 
 /****************************************************************
  Private helper for S_Expression that recurses and returns a
@@ -57,8 +71,9 @@ static Cell* recurse_express()
         // Not seeing an open parenthesis means single quoting standalone symbol (not a list)
         if (strcmp(mToken, "(") != 0) {
             Cell* singleSymbol = shortHand->mNext->mSub;
-            singleSymbol->mSymbol = malloc(sizeof(char) * 20);
-            strcpy(singleSymbol->mSymbol, mToken);
+            singleSymbol->mSymbol = internSymbol(mToken);
+            tagNumber(singleSymbol);
+            if (mHashConsing) shortHand->mNext->mSub = hashCons(singleSymbol);
             return shortHand;
         }
     }
@@ -86,14 +101,22 @@ static Cell* recurse_express()
 
         // Found end of level
         temp->mNext = NULL;
+
+        // Share the datum of an explicit (quote datum)
+        if (mHashConsing && shortHand == NULL && local->mSub->mSymbol != NULL
+            && strcmp(local->mSub->mSymbol, "quote") == 0 && local->mNext != NULL)
+            local->mNext->mSub = hashCons(local->mNext->mSub);
     } else {
-        // Attach dynamic symbol to the local to become "first"
+        // Attach interned symbol to the local to become "first",
+        // caching its value if it is a number
         local = iniCell();
-        local->mSymbol = malloc(sizeof(char) * 20);
-        strcpy(local->mSymbol, mToken);
+        local->mSymbol = internSymbol(mToken);
+        tagNumber(local);
     }
-    if (shortHand != NULL)
+    if (shortHand != NULL) {
+        if (mHashConsing) shortHand->mNext->mSub = hashCons(shortHand->mNext->mSub);
         return shortHand;
+    }
     return local;
 }
 
@@ -105,14 +128,33 @@ static Cell* recurse_express()
 List* S_Expression()
 {
     // Pull the first token for parsing
-    mToken = malloc(sizeof(char) * 20);
+    if (mToken == NULL) mToken = malloc(sizeof(char) * TOKEN_LENGTH);
     strcpy(mToken, getToken());
-    // Parse for structure
-    List* list = malloc(sizeof(List));
+    // Parse for structure, counting what it allocates as the parser's
+    int site = enterSite(SITE_PARSER);
+    List* list = allocate(sizeof(List));
     list->mStructure = recurse_express();
+    leaveSite(site);
     return list;
 }
 
+/****************************************************************
+ setHashConsing(): See header file for documentation.
+*/
+void setHashConsing(int enabled)
+{
+    mHashConsing = enabled;
+    if (enabled && mConsTable == NULL) mConsTable = iniHashTable(sameCell);
+}
+
+/****************************************************************
+ isHashConsing(): See header file for documentation.
+*/
+int isHashConsing()
+{
+    return mHashConsing;
+}
+
 /****************************************************************
  Prints the structure of the given List on one line.
 */
@@ -125,9 +167,12 @@ void printList(List* list)
     if (list != NULL) {
         if (list->mStructure == FALSE) printf("()");
         else if (list->mStructure == TRUE) printf("#t");
-        // Case of single symbol
+        // Case of single symbol, including numbers
         else if (list->mStructure != NULL && list->mStructure->mSymbol != NULL) {
             printf("%s", list->mStructure->mSymbol);
+        // Native data such as vectors
+        } else if (list->mStructure != NULL && list->mStructure->mType != CELL_PLAIN) {
+            print_value(list->mStructure);
         } else if (list->mStructure != NULL) {
             // Normal case structure
             printf("(");
@@ -144,9 +189,19 @@ void printList(List* list)
 */
 static void recurse_print(Cell* cell, int level)
 {
-    // Print the symbol
+    // The rest of a stream not computed yet
+    if (cell->mType == CELL_PROMISE) {
+        printf(". #<promise>");
+        if (level != 0) printf(")");
+        return;
+    }
+    // Print the symbol, parsing lazy data first
+    forceData(cell->mSub);
     if (cell->mSub != NULL && cell->mSub->mSymbol != NULL) {
         printf(" %s ", cell->mSub->mSymbol);
+    // Native data nested within the structure
+    } else if (cell->mSub != NULL && cell->mSub->mType != CELL_PLAIN) {
+        print_value(cell->mSub);
     // Recurse down and print open parenth with each level
     } else if (cell->mSub != NULL) {
         printf("(");
@@ -158,15 +213,111 @@ static void recurse_print(Cell* cell, int level)
 
 }
 
+/****************************************************************
+ Helper to print a single evaluated value, such as a member of a
+ Vector, in the same style as printList(List*) without the
+ surrounding line formatting.
+*/
+static void print_value(Cell* cell)
+{
+    if (cell == NULL) return;
+    forceData(cell);
+    if (cell == FALSE) printf(" () ");
+    else if (cell == TRUE) printf(" #t ");
+    else if (cell->mSymbol != NULL) printf(" %s ", cell->mSymbol);
+    else if (cell->mType == CELL_VECTOR) print_vector(cell->mData);
+    else if (cell->mType == CELL_HASH) printf("#<hash-table %i>", ((HashTable*) cell->mData)->mCount);
+    else if (cell->mType == CELL_CLOSURE) printf("#<procedure>");
+    else if (cell->mType == CELL_PROMISE) printf("#<promise>");
+    else {
+        printf("(");
+        if (cell->mSub != NULL) recurse_print(cell, 0);
+        printf(")");
+    }
+}
+
+/****************************************************************
+ Helper to print the members of a Vector as "#( a b c )".
+*/
+static void print_vector(Vector* vector)
+{
+    int i;
+    printf("#(");
+    for (i = 0; i < vector->mLength; i++)
+        print_value(vector->mItems[i]);
+    printf(")");
+}
+
 /****************************************************************
  Helper function dynamically allocating a new cons cell. All
  members of the output Cell is initialized to NULL.
 */
 static Cell* iniCell()
 {
-    Cell* cell = malloc(sizeof(Cell));
+    Cell* cell = allocate(sizeof(Cell));
     cell->mSub = NULL;
     cell->mNext = NULL;
     cell->mSymbol = NULL;
+    cell->mType = CELL_PLAIN;
+    cell->mHash = 0;
+    cell->mData = NULL;
     return cell;
 }
+
+/****************************************************************
+ Helper that swaps a freshly parsed datum for its shared copy,
+ sharing every subtree along the way. Cells along a level are
+ shared from the last back to the first, so each cell is shared
+ only once everything it references is. Cells with a cached hash
+ are already shared.
+*/
+static Cell* hashCons(Cell* cell)
+{
+    if (cell == NULL || cell->mHash != 0) return cell;
+
+    int count = 0;
+    Cell* rest;
+    for (rest = cell; rest != NULL && rest->mHash == 0; rest = rest->mNext)
+        count++;
+    Cell** level = malloc(sizeof(Cell*) * count);
+    int i = 0;
+    for (rest = cell; rest != NULL && rest->mHash == 0; rest = rest->mNext)
+        level[i++] = rest;
+
+    for (i = count - 1; i >= 0; i--) {
+        level[i]->mSub = hashCons(level[i]->mSub);
+        level[i]->mNext = rest;
+        rest = internCell(level[i]);
+    }
+    free(level);
+    return rest;
+}
+
+/****************************************************************
+ Helper giving the shared copy of a cell whose sub branch and next
+ cell are already shared, dropping the given cell if a copy exists
+ or making it the shared copy otherwise. A dropped cell is given
+ back to the allocator, for the next cell parsed to reuse.
+*/
+static Cell* internCell(Cell* cell)
+{
+    cell->mHash = hashCell(cell);
+    Cell* shared = hashGet(mConsTable, cell);
+    if (shared != NULL) {
+        release(cell, sizeof(Cell));
+        return shared;
+    }
+    hashPut(mConsTable, cell, cell);
+    return cell;
+}
+
+/****************************************************************
+ Helper deciding whether two cells can be shared. Everything they
+ reference is already shared, so comparing references suffices.
+*/
+static int sameCell(Cell* c1, Cell* c2)
+{
+    if (c1->mType != c2->mType || c1->mSub != c2->mSub || c1->mNext != c2->mNext) return 0;
+    if (c1->mSymbol == c2->mSymbol) return 1;
+    return c1->mSymbol != NULL && c2->mSymbol != NULL && strcmp(c1->mSymbol, c2->mSymbol) == 0;
+}
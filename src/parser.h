@@ -23,6 +23,41 @@
  Author: Christian Ramos
  ****************************************************************/
 
+/****************************************************************
+ Kinds of Cell. A CELL_PLAIN Cell is either a symbol or a cons
+ cell as described below. Numerical atoms keep their text in
+ mSymbol like any other atom and cache their value: a CELL_FIXNUM
+ in mFixnum, a CELL_BIGNUM as a Bignum in mData and a CELL_FLONUM
+ unboxed in mFlonum (see number.h). A plain cons cell may carry
+ bookkeeping of the evaluator in mData, such as the cache of a
+ memoized function on its definition.
+ Every other kind carries native data through the mData member
+ and has neither mSymbol, mSub nor mNext. A CELL_NATIVE Cell is
+ the body of a compiled function and holds a NativeFunction (see
+ native.h), a CELL_CLOSURE Cell is a procedure made by lambda and
+ a CELL_PROMISE Cell is an expression put off by delay. A stream
+ is a pair whose mNext is a CELL_PROMISE Cell for its rest. A
+ CELL_LAZY Cell is a list of a file read by load-data that is not
+ parsed yet, and turns into its first cons cell once it is (see
+ reader.h). A CELL_SLOT Cell is an atom of the body of a closure
+ that reads a variable of the frame the closure is applied in,
+ keeping its name in mSymbol and its index in mFixnum. It is only
+ found in the bodies the evaluator converts, never in values.
+ ****************************************************************/
+enum cellType {
+    CELL_PLAIN = 0,
+    CELL_VECTOR,
+    CELL_HASH,
+    CELL_FIXNUM,
+    CELL_BIGNUM,
+    CELL_FLONUM,
+    CELL_NATIVE,
+    CELL_CLOSURE,
+    CELL_PROMISE,
+    CELL_LAZY,
+    CELL_SLOT
+};
+
 /****************************************************************
  Cell to reference the next cons cell or a symbol
  ****************************************************************/
@@ -33,6 +68,18 @@ struct node {
     Cell* mNext;
     // "rest"
     Cell* mSub;
+    // One of enum cellType
+    int mType;
+    // Cached structural hash, 0 until known (see hashCell())
+    unsigned int mHash;
+    union {
+        // Native data for Cells that are not CELL_PLAIN
+        void* mData;
+        // Value of a CELL_FIXNUM
+        long mFixnum;
+        // Value of a CELL_FLONUM
+        double mFlonum;
+    };
 };
 
 /****************************************************************
@@ -49,6 +96,62 @@ struct stringOfCells {
     Cell* mStructure;
 };
 
+/****************************************************************
+ Contiguous array of Cells referenced by the mData member of a
+ CELL_VECTOR Cell. Each member of mItems is the evaluated value
+ of an element, exactly as it would appear as the mStructure of
+ a List.
+*/
+typedef struct vectorOfCells Vector;
+struct vectorOfCells {
+    int mLength;
+    Cell** mItems;
+};
+
+/****************************************************************
+ Procedure made by lambda, referenced by the mData member of a
+ CELL_CLOSURE Cell. Every variable its body may use is given a
+ place in mNames, and the value of those bound locally where it
+ was made is copied into mValues at that moment. The others are
+ left NULL and read from the global environment as it is when
+ they are used, so that a closure sees globals defined after it,
+ itself among them. mFormals is either the list of formal
+ parameters or a single symbol taking the list of all arguments,
+ and mBody is the chain of expressions evaluated in turn.
+
+ Applying a closure makes a frame, a CELL_VECTOR Cell holding the
+ closure followed by the arguments, that ends the environment its
+ body runs in instead of chaining to the environment it was made
+ in. mCode is the body with its reads of parameters and variables
+ turned into CELL_SLOT Cells indexing the frame, the parameters
+ first and then mValues, worked out on first use.
+*/
+typedef struct closure Closure;
+struct closure {
+    Cell* mFormals;
+    Cell* mBody;
+    int mCount;
+    Cell** mNames;
+    Cell** mValues;
+    Cell* mCode;
+};
+
+/****************************************************************
+ Value of an expression whose evaluation is put off until it is
+ forced, referenced by the mData member of a CELL_PROMISE Cell.
+ Until then mExpression is evaluated in mEnvironment, or in the
+ global environment as it is when forced if mEnvironment is NULL,
+ as it is for a promise made at top level. The first force keeps
+ the value in mValue and drops both, so later forces give the same
+ value and what the expression referred to is no longer held.
+*/
+typedef struct promise Promise;
+struct promise {
+    Cell* mExpression;
+    List* mEnvironment;
+    Cell* mValue;
+};
+
 /****************************************************************
  Function to call for building the structure of the given code
  input.
@@ -60,4 +163,19 @@ List* S_Expression();
 */
 void printList(List*);
 
+/****************************************************************
+ Turns hash-consing of quoted data on or off for the expressions
+ built afterwards. While on, every quoted datum, as in 'x, '(a b)
+ or (quote (a b)), is made of shared cells: structurally equal
+ subtrees across all input are the same cells in memory, each
+ with its structural hash cached. Quoted data must then never be
+ modified in place, which no builtin does.
+*/
+void setHashConsing(int);
+
+/****************************************************************
+ Gives 1 while hash-consing quoted data and 0 otherwise.
+*/
+int isHashConsing();
+
 #endif
@@ -0,0 +1,359 @@
+#include <stdlib.h>
+#include <string.h>
+#include <stdio.h>
+#include <time.h>
+#include "profiler.h"
+
+/****************************************************************
+ File: Profiler.c
+ ----------------
+ Implementation for profiler.h interface. Each function called is
+ an entry found by name in an open addressing table, and each node
+ of the calling context tree is a call of an entry from a given
+ parent node. Open calls are kept on a stack of frames holding the
+ time they started and the time spent in the calls they made.
+ ****************************************************************/
+
+/****************************************************************
+ Totals of one function.
+*/
+typedef struct profileEntry ProfileEntry;
+struct profileEntry {
+    char* mName;
+    int mBuiltin;
+    long mCalls;
+    // Calls open on the stack, so recursion is only timed once
+    int mActive;
+    long mInclusive;
+    long mExclusive;
+};
+
+/****************************************************************
+ Calls of an entry from one chain of callers. Children of a node
+ are linked through mSibling.
+*/
+typedef struct profileNode ProfileNode;
+struct profileNode {
+    ProfileEntry* mEntry;
+    ProfileNode* mParent;
+    ProfileNode* mChild;
+    ProfileNode* mSibling;
+    long mCalls;
+    long mExclusive;
+};
+
+/****************************************************************
+ Call still open.
+*/
+typedef struct profileFrame ProfileFrame;
+struct profileFrame {
+    ProfileNode* mNode;
+    long mStart;
+    long mChildren;
+};
+
+/****************************************************************
+ Edge of the call graph, gathered for the report.
+*/
+typedef struct profileEdge ProfileEdge;
+struct profileEdge {
+    ProfileEntry* mCaller;
+    ProfileEntry* mCallee;
+    long mCalls;
+};
+
+// Entries by name
+static ProfileEntry** mEntries = NULL;
+static int mEntryCount = 0;
+static int mEntryCapacity = 0;
+// Root of the calling context tree, standing for the top level
+static ProfileNode* mRoot = NULL;
+// Open calls
+static ProfileFrame* mFrames = NULL;
+static int mDepth = 0;
+static int mFrameCapacity = 0;
+
+// Prototypes for private helpers
+static ProfileEntry* findEntry(char*, int);
+static unsigned int hashName(char*);
+static ProfileNode* findChild(ProfileNode*, ProfileEntry*);
+static long now();
+static void freeNodes(ProfileNode*);
+static void gatherEdges(ProfileNode*, ProfileEdge**, int*, int*);
+static void writeStacks(FILE*, ProfileNode*, char*, int);
+static int byExclusive(const void*, const void*);
+static int byCalls(const void*, const void*);
+
+/****************************************************************
+ profileReset(): See header file for documentation.
+*/
+void profileReset()
+{
+    int i;
+    for (i = 0; i < mEntryCapacity; i++)
+        free(mEntries[i]);
+    free(mEntries);
+    mEntries = NULL;
+    mEntryCount = 0;
+    mEntryCapacity = 0;
+    freeNodes(mRoot);
+    mRoot = calloc(1, sizeof(ProfileNode));
+    mDepth = 0;
+}
+
+/****************************************************************
+ profileEnter(): See header file for documentation.
+*/
+void profileEnter(char* name, int builtin)
+{
+    if (mRoot == NULL) profileReset();
+    if (mDepth == mFrameCapacity) {
+        mFrameCapacity = mFrameCapacity == 0 ? 64 : mFrameCapacity * 2;
+        mFrames = realloc(mFrames, sizeof(ProfileFrame) * mFrameCapacity);
+    }
+    ProfileEntry* entry = findEntry(name, builtin);
+    ProfileNode* parent = mDepth > 0 ? mFrames[mDepth - 1].mNode : mRoot;
+    ProfileFrame* frame = &mFrames[mDepth++];
+    frame->mNode = findChild(parent, entry);
+    frame->mChildren = 0;
+    entry->mCalls++;
+    entry->mActive++;
+    frame->mNode->mCalls++;
+    frame->mStart = now();
+}
+
+/****************************************************************
+ profileExit(): See header file for documentation.
+*/
+void profileExit()
+{
+    if (mDepth == 0) return;
+    long elapsed = now() - mFrames[mDepth - 1].mStart;
+    ProfileFrame* frame = &mFrames[--mDepth];
+    ProfileEntry* entry = frame->mNode->mEntry;
+    long exclusive = elapsed - frame->mChildren;
+    entry->mExclusive += exclusive;
+    frame->mNode->mExclusive += exclusive;
+    if (--entry->mActive == 0) entry->mInclusive += elapsed;
+    if (mDepth > 0) mFrames[mDepth - 1].mChildren += elapsed;
+}
+
+/****************************************************************
+ profileUnwind(): See header file for documentation.
+*/
+void profileUnwind()
+{
+    while (mDepth > 0)
+        profileExit();
+}
+
+/****************************************************************
+ profileReport(): See header file for documentation.
+*/
+void profileReport(FILE* out)
+{
+    ProfileEntry** sorted = malloc(sizeof(ProfileEntry*) * (mEntryCount > 0 ? mEntryCount : 1));
+    int count = 0;
+    int i;
+    for (i = 0; i < mEntryCapacity; i++)
+        if (mEntries[i] != NULL) sorted[count++] = mEntries[i];
+    qsort(sorted, count, sizeof(ProfileEntry*), byExclusive);
+
+    fprintf(out, "%12s %14s %14s  %-8s %s\n", "calls", "inclusive ms", "exclusive ms", "kind", "function");
+    for (i = 0; i < count; i++)
+        fprintf(out, "%12ld %14.3f %14.3f  %-8s %s\n", sorted[i]->mCalls, sorted[i]->mInclusive / 1e6,
+                sorted[i]->mExclusive / 1e6, sorted[i]->mBuiltin ? "builtin" : "user", sorted[i]->mName);
+    free(sorted);
+
+    ProfileEdge* edges = NULL;
+    int edgeCount = 0;
+    int edgeCapacity = 0;
+    if (mRoot != NULL) gatherEdges(mRoot, &edges, &edgeCount, &edgeCapacity);
+    qsort(edges, edgeCount, sizeof(ProfileEdge), byCalls);
+    fprintf(out, "\n%12s  %s\n", "calls", "caller -> callee");
+    for (i = 0; i < edgeCount; i++)
+        fprintf(out, "%12ld  %s -> %s\n", edges[i].mCalls, edges[i].mCaller->mName, edges[i].mCallee->mName);
+    free(edges);
+}
+
+/****************************************************************
+ profileStacks(): See header file for documentation.
+*/
+void profileStacks(FILE* out)
+{
+    if (mRoot == NULL) return;
+    ProfileNode* child;
+    for (child = mRoot->mChild; child != NULL; child = child->mSibling)
+        writeStacks(out, child, NULL, 0);
+}
+
+/****************************************************************
+ Private helper finding the entry of the named function, adding it
+ the first time.
+*/
+static ProfileEntry* findEntry(char* name, int builtin)
+{
+    if ((mEntryCount + 1) * 2 > mEntryCapacity) {
+        // Grow and re-insert every entry
+        int oldCapacity = mEntryCapacity;
+        ProfileEntry** old = mEntries;
+        mEntryCapacity = oldCapacity == 0 ? 64 : oldCapacity * 2;
+        mEntries = calloc(mEntryCapacity, sizeof(ProfileEntry*));
+        int i;
+        for (i = 0; i < oldCapacity; i++) {
+            if (old[i] == NULL) continue;
+            unsigned int slot = hashName(old[i]->mName) & (mEntryCapacity - 1);
+            while (mEntries[slot] != NULL)
+                slot = (slot + 1) & (mEntryCapacity - 1);
+            mEntries[slot] = old[i];
+        }
+        free(old);
+    }
+
+    unsigned int slot = hashName(name) & (mEntryCapacity - 1);
+    while (mEntries[slot] != NULL) {
+        if (mEntries[slot]->mName == name || strcmp(mEntries[slot]->mName, name) == 0)
+            return mEntries[slot];
+        slot = (slot + 1) & (mEntryCapacity - 1);
+    }
+    ProfileEntry* entry = calloc(1, sizeof(ProfileEntry));
+    entry->mName = name;
+    entry->mBuiltin = builtin;
+    mEntries[slot] = entry;
+    mEntryCount++;
+    return entry;
+}
+
+/****************************************************************
+ Private helper hashing a function name (djb2).
+*/
+static unsigned int hashName(char* name)
+{
+    unsigned int hash = 5381;
+    while (*name != '\0')
+        hash = hash * 33 + (unsigned char) *name++;
+    return hash;
+}
+
+/****************************************************************
+ Private helper finding the node for calls of an entry from the
+ given node, adding it the first time. A found node is moved to the
+ front of its siblings, as the same call tends to be made again.
+*/
+static ProfileNode* findChild(ProfileNode* parent, ProfileEntry* entry)
+{
+    ProfileNode* previous = NULL;
+    ProfileNode* child;
+    for (child = parent->mChild; child != NULL; previous = child, child = child->mSibling) {
+        if (child->mEntry != entry) continue;
+        if (previous != NULL) {
+            previous->mSibling = child->mSibling;
+            child->mSibling = parent->mChild;
+            parent->mChild = child;
+        }
+        return child;
+    }
+    child = calloc(1, sizeof(ProfileNode));
+    child->mEntry = entry;
+    child->mParent = parent;
+    child->mSibling = parent->mChild;
+    parent->mChild = child;
+    return child;
+}
+
+/****************************************************************
+ Private helper giving a monotonic time in nanoseconds.
+*/
+static long now()
+{
+    struct timespec time;
+    clock_gettime(CLOCK_MONOTONIC, &time);
+    return time.tv_sec * 1000000000L + time.tv_nsec;
+}
+
+/****************************************************************
+ Private helper freeing a node and everything below it. Siblings
+ are followed in a loop and only children recursed into, which is
+ as deep as the deepest stack recorded.
+*/
+static void freeNodes(ProfileNode* node)
+{
+    while (node != NULL) {
+        ProfileNode* sibling = node->mSibling;
+        freeNodes(node->mChild);
+        free(node);
+        node = sibling;
+    }
+}
+
+/****************************************************************
+ Private helper adding the calls of every node below the given one
+ to the edge between the entries of the node and of its parent.
+*/
+static void gatherEdges(ProfileNode* node, ProfileEdge** edges, int* count, int* capacity)
+{
+    ProfileNode* child;
+    for (child = node->mChild; child != NULL; child = child->mSibling) {
+        if (node != mRoot) {
+            int i;
+            for (i = 0; i < *count; i++)
+                if ((*edges)[i].mCaller == node->mEntry && (*edges)[i].mCallee == child->mEntry) break;
+            if (i == *count) {
+                if (*count == *capacity) {
+                    *capacity = *capacity == 0 ? 64 : *capacity * 2;
+                    *edges = realloc(*edges, sizeof(ProfileEdge) * *capacity);
+                }
+                (*edges)[i].mCaller = node->mEntry;
+                (*edges)[i].mCallee = child->mEntry;
+                (*edges)[i].mCalls = 0;
+                (*count)++;
+            }
+            (*edges)[i].mCalls += child->mCalls;
+        }
+        gatherEdges(child, edges, count, capacity);
+    }
+}
+
+/****************************************************************
+ Private helper writing the stack ending at the given node, then
+ every stack through it. The given prefix holds the names of the
+ callers, separated by ';'.
+*/
+static void writeStacks(FILE* out, ProfileNode* node, char* prefix, int length)
+{
+    int nameLength = strlen(node->mEntry->mName);
+    char* stack = malloc(sizeof(char) * (length + nameLength + 2));
+    if (length > 0) {
+        memcpy(stack, prefix, length);
+        stack[length++] = ';';
+    }
+    memcpy(stack + length, node->mEntry->mName, nameLength + 1);
+    length += nameLength;
+
+    long microseconds = node->mExclusive / 1000;
+    if (microseconds > 0) fprintf(out, "%s %ld\n", stack, microseconds);
+    ProfileNode* child;
+    for (child = node->mChild; child != NULL; child = child->mSibling)
+        writeStacks(out, child, stack, length);
+    free(stack);
+}
+
+/****************************************************************
+ Private helper ordering entries from the most exclusive time.
+*/
+static int byExclusive(const void* a, const void* b)
+{
+    long first = (*(ProfileEntry**) a)->mExclusive;
+    long second = (*(ProfileEntry**) b)->mExclusive;
+    return first < second ? 1 : first > second ? -1 : 0;
+}
+
+/****************************************************************
+ Private helper ordering edges from the most calls.
+*/
+static int byCalls(const void* a, const void* b)
+{
+    long first = ((ProfileEdge*) a)->mCalls;
+    long second = ((ProfileEdge*) b)->mCalls;
+    return first < second ? 1 : first > second ? -1 : 0;
+}
@@ -0,0 +1,58 @@
+#ifndef PROFILER_H_INCLUDED
+#define PROFILER_H_INCLUDED
+
+#include <stdio.h>
+
+/****************************************************************
+ File: Profiler.h
+ ----------------
+ Interface for Profiler, which keeps call counts and timings of
+ the functions called while evaluating, for the profiling mode of
+ the evaluator (see setProfiling(int)).
+
+ Calls are recorded in a tree of calling contexts, one node per
+ distinct chain of callers, so that the report can give both the
+ totals of each function and the edges of the call graph, and the
+ collapsed stacks read by flamegraph tools. The inclusive time of
+ a recursive function only counts its outermost calls.
+ ****************************************************************/
+
+/****************************************************************
+ Forgets everything recorded so far.
+*/
+void profileReset();
+
+/****************************************************************
+ Records a call to the named function, which is a builtin when the
+ second parameter is 1 and a user defined function otherwise. The
+ name must stay valid until the next reset. Every call to
+ profileEnter(char*, int) is closed by a call to profileExit().
+*/
+void profileEnter(char*, int);
+
+/****************************************************************
+ Records the return from the function last entered.
+*/
+void profileExit();
+
+/****************************************************************
+ Closes every call still open, as when evaluation is abandoned
+ partway through.
+*/
+void profileUnwind();
+
+/****************************************************************
+ Writes the report of every function called, sorted from the most
+ exclusive time to the least, followed by the edges of the call
+ graph sorted by their number of calls.
+*/
+void profileReport(FILE*);
+
+/****************************************************************
+ Writes one line per distinct stack of calls, "outer;inner count",
+ where count is the exclusive time of the innermost call in
+ microseconds, as read by flamegraph.pl and similar tools.
+*/
+void profileStacks(FILE*);
+
+#endif
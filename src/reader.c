@@ -0,0 +1,794 @@
+#include <stdlib.h>
+#include <string.h>
+#include <stddef.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "reader.h"
+#include "lexer.h"
+#include "hashtable.h"
+#include "number.h"
+#include "allocator.h"
+
+/****************************************************************
+ File: Reader.c
+ ----------------
+ Implementation for reader.h interface. Tokens are found as the
+ lexer finds them, straight from the text: the lexer reads no
+ string literals, so the only state a line break does not end is
+ the depth of parentheses, and a part starting after a line break
+ starts outside any token or comment. A quote at the top level
+ takes the token after it into its form, as S_Expression() does.
+
+ Every part runs on a thread of its own but the first, which runs
+ on the calling thread. The forms found are checked to take up
+ exactly the tokens between their starts, so that a text the
+ depths get wrong is given back to S_Expression() rather than read
+ differently.
+ ****************************************************************/
+
+// Bytes of text worth a thread of their own, and cells per block
+#define READER_PART 65536
+#define READER_BLOCK 16384
+
+/****************************************************************
+ Symbol met by a part. Cells of the part point at mText until the
+ symbol is interned, which makes mAtom the atom S_Expression()
+ would make for it.
+*/
+typedef struct localSymbol LocalSymbol;
+struct localSymbol {
+    Cell mAtom;
+    LocalSymbol* mNextSymbol;
+    unsigned int mHash;
+    int mLength;
+    char mText[];
+};
+
+/****************************************************************
+ Part of the text read by one thread.
+*/
+typedef struct readerPart ReaderPart;
+struct readerPart {
+    char* mText;
+    long mLength;
+    long mBegin;
+    long mEnd;
+    // The depth at the end of the part is the larger of mFloor and
+    // mRise more than the depth mDepth at its start
+    long mRise;
+    long mFloor;
+    long mDepth;
+    // Tokens starting in the part at the top level, and whether
+    // each is a quote
+    long* mStarts;
+    char* mQuotes;
+    int mStartCount;
+    int mStartCapacity;
+    // Forms of the whole text, of which the part parses mFormCount
+    // from mFirstForm on
+    long* mFormStarts;
+    int mAllForms;
+    int mFirstForm;
+    int mFormCount;
+    Cell** mForms;
+    // Blocks the cells of the part are made in, the last holding
+    // mBlockUsed cells
+    Cell** mBlocks;
+    int mBlockCount;
+    int mBlockCapacity;
+    int mBlockUsed;
+    // Symbols met, found by their text through an open addressing
+    // table and listed most recent first
+    LocalSymbol** mSlots;
+    int mSlotCapacity;
+    int mSymbolCount;
+    LocalSymbol* mSymbols;
+    // Current token, read up to mStop, which is ")" made up at
+    // mStop as the lexer makes it up at the end of its input
+    long mAt;
+    long mStop;
+    int mKind;
+    char* mToken;
+    int mTokenLength;
+    int mClosedAtEnd;
+    int mFailed;
+};
+
+/****************************************************************
+ List of a data file, by the positions of its parentheses. The
+ whole file is read as a list from -1 to its length.
+*/
+typedef struct dataFile DataFile;
+typedef struct dataList DataList;
+struct dataList {
+    long mOpen;
+    long mClose;
+    DataFile* mFile;
+};
+
+/****************************************************************
+ Data file mapped by readData(), with its lists in the order they
+ open, apart from the whole file.
+*/
+struct dataFile {
+    char* mText;
+    long mLength;
+    DataList* mLists;
+    long mListCount;
+    DataList mWhole;
+};
+
+// Blocks of cells are counted by the allocator, one part at a time
+static pthread_mutex_t mBlockLock = PTHREAD_MUTEX_INITIALIZER;
+
+// Prototypes for private helpers
+static void runParts(void* (*)(void*), ReaderPart*, int);
+static void* sumDepths(void*);
+static void* findStarts(void*);
+static void* parsePart(void*);
+static void* fixSymbols(void*);
+static Cell* parseDatum(ReaderPart*);
+static void nextToken(ReaderPart*);
+static long skipBlanks(char*, long, long);
+static long skipToken(char*, long, long);
+static Cell* newCell(ReaderPart*);
+static char* symbolText(ReaderPart*, char*, int);
+static void internSymbols(ReaderPart*);
+static void freePart(ReaderPart*, int);
+static int indexData(DataFile*);
+static DataList* findList(DataFile*, long);
+static Cell* dataDatum(DataFile*, long*, long);
+static Cell* dataAtom(char*, int);
+static Cell* dataCell();
+
+/****************************************************************
+ readForms(): See header file for documentation.
+*/
+Cell** readForms(char* text, long length, int* count)
+{
+    long processors = sysconf(_SC_NPROCESSORS_ONLN);
+    int partCount = length / READER_PART + 1;
+    if (processors >= 1 && partCount > processors) partCount = processors;
+    ReaderPart* parts = calloc(partCount, sizeof(ReaderPart));
+    int i;
+    for (i = 0; i < partCount; i++) {
+        long begin = length * i / partCount;
+        while (begin > 0 && begin < length && text[begin - 1] != '\n')
+            begin++;
+        parts[i].mText = text;
+        parts[i].mLength = length;
+        parts[i].mBegin = begin;
+        if (i > 0) parts[i - 1].mEnd = begin;
+    }
+    parts[partCount - 1].mEnd = length;
+
+    // Depths at the start of every part, then the tokens at the top
+    // level in each
+    runParts(sumDepths, parts, partCount);
+    for (i = 1; i < partCount; i++) {
+        long depth = parts[i - 1].mDepth + parts[i - 1].mRise;
+        parts[i].mDepth = depth > parts[i - 1].mFloor ? depth : parts[i - 1].mFloor;
+    }
+    runParts(findStarts, parts, partCount);
+
+    // A form starts at every such token but the one after a quote
+    int starts = 0;
+    for (i = 0; i < partCount; i++)
+        starts += parts[i].mStartCount;
+    long* formStarts = malloc(sizeof(long) * (starts > 0 ? starts : 1));
+    int forms = 0;
+    int quoted = 0;
+    int j;
+    for (i = 0; i < partCount; i++) {
+        for (j = 0; j < parts[i].mStartCount; j++) {
+            if (quoted) {
+                quoted = 0;
+                continue;
+            }
+            formStarts[forms++] = parts[i].mStarts[j];
+            quoted = parts[i].mQuotes[j];
+        }
+    }
+    Cell** parsed = malloc(sizeof(Cell*) * (forms > 0 ? forms : 1));
+    for (i = 0, j = 0; i < partCount; i++) {
+        parts[i].mFormStarts = formStarts;
+        parts[i].mAllForms = forms;
+        parts[i].mForms = parsed;
+        parts[i].mFirstForm = j;
+        while (j < forms && formStarts[j] < parts[i].mEnd)
+            j++;
+        parts[i].mFormCount = j - parts[i].mFirstForm;
+    }
+    runParts(parsePart, parts, partCount);
+
+    int failed = 0;
+    for (i = 0; i < partCount; i++)
+        failed = failed || parts[i].mFailed;
+    if (!failed) {
+        int site = enterSite(SITE_PARSER);
+        for (i = 0; i < partCount; i++)
+            internSymbols(&parts[i]);
+        leaveSite(site);
+        runParts(fixSymbols, parts, partCount);
+        *count = forms;
+    } else {
+        free(parsed);
+        parsed = NULL;
+    }
+
+    for (i = 0; i < partCount; i++)
+        freePart(&parts[i], !failed);
+    free(formStarts);
+    free(parts);
+    return parsed;
+}
+
+/****************************************************************
+ Private helper running the given phase on every part, the first
+ on the calling thread. A part whose thread cannot be started is
+ run on the calling thread as well.
+*/
+static void runParts(void* (*phase)(void*), ReaderPart* parts, int count)
+{
+    pthread_t* threads = malloc(sizeof(pthread_t) * count);
+    int* started = calloc(count, sizeof(int));
+    int i;
+    for (i = 1; i < count; i++) {
+        started[i] = pthread_create(&threads[i], NULL, phase, &parts[i]) == 0;
+        if (!started[i]) phase(&parts[i]);
+    }
+    phase(&parts[0]);
+    for (i = 1; i < count; i++)
+        if (started[i]) pthread_join(threads[i], NULL);
+    free(started);
+    free(threads);
+}
+
+/****************************************************************
+ Private helper, the first phase, summing up how a part changes
+ the depth. A stray ")" at the top level leaves the depth at 0, as
+ S_Expression() reads it as an atom.
+*/
+static void* sumDepths(void* data)
+{
+    ReaderPart* part = data;
+    long at;
+    for (at = skipBlanks(part->mText, part->mBegin, part->mEnd); at < part->mEnd;
+         at = skipBlanks(part->mText, skipToken(part->mText, at, part->mEnd), part->mEnd)) {
+        if (part->mText[at] == '(') {
+            part->mRise++;
+            part->mFloor++;
+        } else if (part->mText[at] == ')') {
+            part->mRise--;
+            if (part->mFloor > 0) part->mFloor--;
+        }
+    }
+    return NULL;
+}
+
+/****************************************************************
+ Private helper, the second phase, listing the tokens of a part
+ that start at the top level.
+*/
+static void* findStarts(void* data)
+{
+    ReaderPart* part = data;
+    long depth = part->mDepth;
+    long at;
+    for (at = skipBlanks(part->mText, part->mBegin, part->mEnd); at < part->mEnd;
+         at = skipBlanks(part->mText, skipToken(part->mText, at, part->mEnd), part->mEnd)) {
+        if (depth == 0) {
+            if (part->mStartCount == part->mStartCapacity) {
+                part->mStartCapacity = part->mStartCapacity == 0 ? 256 : part->mStartCapacity * 2;
+                part->mStarts = realloc(part->mStarts, sizeof(long) * part->mStartCapacity);
+                part->mQuotes = realloc(part->mQuotes, sizeof(char) * part->mStartCapacity);
+            }
+            part->mStarts[part->mStartCount] = at;
+            part->mQuotes[part->mStartCount++] = part->mText[at] == '\'';
+        }
+        if (part->mText[at] == '(') depth++;
+        else if (part->mText[at] == ')' && depth > 0) depth--;
+    }
+    return NULL;
+}
+
+/****************************************************************
+ Private helper, the third phase, parsing the forms starting in a
+ part. Each must end right where the next one starts.
+*/
+static void* parsePart(void* data)
+{
+    ReaderPart* part = data;
+    int i;
+    for (i = part->mFirstForm; i < part->mFirstForm + part->mFormCount && !part->mFailed; i++) {
+        part->mAt = part->mFormStarts[i];
+        part->mStop = i + 1 < part->mAllForms ? part->mFormStarts[i + 1] : part->mLength;
+        part->mClosedAtEnd = 0;
+        nextToken(part);
+        part->mForms[i] = parseDatum(part);
+        if (skipBlanks(part->mText, part->mAt, part->mStop) != part->mStop
+            || (part->mClosedAtEnd && part->mStop != part->mLength))
+            part->mFailed = 1;
+    }
+    return NULL;
+}
+
+/****************************************************************
+ Private helper, the last phase, giving every atom of a part its
+ interned symbol, and its value if it is a number.
+*/
+static void* fixSymbols(void* data)
+{
+    ReaderPart* part = data;
+    int i, j;
+    for (i = 0; i < part->mBlockCount; i++) {
+        Cell* block = part->mBlocks[i];
+        int used = i + 1 < part->mBlockCount ? READER_BLOCK : part->mBlockUsed;
+        for (j = 0; j < used; j++) {
+            Cell* cell = &block[j];
+            if (cell->mSymbol == NULL) continue;
+            LocalSymbol* symbol = (LocalSymbol*) (cell->mSymbol - offsetof(LocalSymbol, mText));
+            Cell* next = cell->mNext;
+            Cell* sub = cell->mSub;
+            *cell = symbol->mAtom;
+            cell->mNext = next;
+            cell->mSub = sub;
+        }
+    }
+    return NULL;
+}
+
+/****************************************************************
+ Private helper parsing the datum at the current token, as
+ recurse_express() in parser.c does.
+*/
+static Cell* parseDatum(ReaderPart* part)
+{
+    Cell* shortHand = NULL;
+    Cell* local = NULL;
+    Cell* temp = NULL;
+
+    // Single quote as explicit "(quote"
+    if (part->mKind == '\'') {
+        shortHand = newCell(part);
+        shortHand->mSub = newCell(part);
+        shortHand->mSub->mSymbol = symbolText(part, "quote", 5);
+        shortHand->mNext = newCell(part);
+        shortHand->mNext->mSub = newCell(part);
+        local = shortHand->mNext->mSub;
+        nextToken(part);
+        if (part->mKind != '(') {
+            local->mSymbol = symbolText(part, part->mToken, part->mTokenLength);
+            return shortHand;
+        }
+    }
+
+    if (part->mKind == '(') {
+        nextToken(part);
+        if (shortHand == NULL) local = newCell(part);
+        local->mSub = parseDatum(part);
+        nextToken(part);
+        temp = local;
+        while (part->mKind != ')') {
+            temp->mNext = newCell(part);
+            temp = temp->mNext;
+            temp->mSub = parseDatum(part);
+            nextToken(part);
+        }
+        temp->mNext = NULL;
+    } else {
+        local = newCell(part);
+        local->mSymbol = symbolText(part, part->mToken, part->mTokenLength);
+    }
+    return shortHand != NULL ? shortHand : local;
+}
+
+/****************************************************************
+ Private helper reading the next token of a part, as getToken()
+ does. A "#" followed by other than t or f fails the part, which
+ then reads ")" up to the end of the form.
+*/
+static void nextToken(ReaderPart* part)
+{
+    char* text = part->mText;
+    long at = skipBlanks(text, part->mAt, part->mStop);
+    part->mKind = 'a';
+    part->mToken = &text[at];
+    part->mTokenLength = 1;
+    if (at < part->mStop && text[at] == '#'
+        && (at + 1 == part->mStop || (text[at + 1] != 't' && text[at + 1] != 'f')))
+        part->mFailed = 1;
+
+    if (at >= part->mStop || part->mFailed) {
+        part->mKind = ')';
+        part->mToken = ")";
+        part->mClosedAtEnd = 1;
+        part->mAt = part->mStop;
+    } else if (text[at] == ')' || text[at] == '\'') {
+        part->mKind = text[at];
+        part->mAt = at + 1;
+    } else if (text[at] == '(') {
+        long after = skipBlanks(text, at + 1, part->mStop);
+        if (after < part->mStop && text[after] == ')') {
+            part->mToken = "()";
+            part->mTokenLength = 2;
+            part->mAt = after + 1;
+        } else {
+            part->mKind = '(';
+            part->mAt = at + 1;
+        }
+    } else {
+        part->mAt = skipToken(text, at, part->mStop);
+        part->mTokenLength = part->mAt - at;
+        // Longer symbols are cut short as by the lexer
+        if (part->mTokenLength > TOKEN_LENGTH - 1) part->mTokenLength = TOKEN_LENGTH - 1;
+    }
+}
+
+/****************************************************************
+ Private helper giving the position of the first token at or after
+ the given one, skipping white space and comments, or the end.
+*/
+static long skipBlanks(char* text, long at, long end)
+{
+    while (at < end) {
+        char c = text[at];
+        if (c == ';') {
+            while (at < end && text[at] != '\n')
+                at++;
+        } else if (c == ' ' || c == '\n' || c == '\t' || c == '\r') {
+            at++;
+        } else {
+            break;
+        }
+    }
+    return at;
+}
+
+/****************************************************************
+ Private helper giving the position right after the token at the
+ given one. Parentheses and quotes are tokens of their own, and
+ "#" takes the character after it.
+*/
+static long skipToken(char* text, long at, long end)
+{
+    char c = text[at];
+    if (c == '(' || c == ')' || c == '\'') return at + 1;
+    if (c == '#') return at + 2 < end ? at + 2 : end;
+    while (at < end) {
+        c = text[at];
+        if (c == '(' || c == ')' || c == '\'' || c == ' ' || c == '\n' || c == '\t'
+            || c == '\r' || c == ';') break;
+        at++;
+    }
+    return at;
+}
+
+/****************************************************************
+ Private helper making a cell of a part, all members NULL.
+*/
+static Cell* newCell(ReaderPart* part)
+{
+    if (part->mBlockCount == 0 || part->mBlockUsed == READER_BLOCK) {
+        if (part->mBlockCount == part->mBlockCapacity) {
+            part->mBlockCapacity = part->mBlockCapacity == 0 ? 16 : part->mBlockCapacity * 2;
+            part->mBlocks = realloc(part->mBlocks, sizeof(Cell*) * part->mBlockCapacity);
+        }
+        pthread_mutex_lock(&mBlockLock);
+        part->mBlocks[part->mBlockCount++] = allocateAt(sizeof(Cell) * READER_BLOCK, SITE_PARSER);
+        pthread_mutex_unlock(&mBlockLock);
+        part->mBlockUsed = 0;
+    }
+    Cell* cell = &part->mBlocks[part->mBlockCount - 1][part->mBlockUsed++];
+    cell->mSub = NULL;
+    cell->mNext = NULL;
+    cell->mSymbol = NULL;
+    cell->mType = CELL_PLAIN;
+    cell->mHash = 0;
+    cell->mData = NULL;
+    return cell;
+}
+
+/****************************************************************
+ Private helper giving the text of the symbol of a part with the
+ given text, adding it the first time.
+*/
+static char* symbolText(ReaderPart* part, char* text, int length)
+{
+    if ((part->mSymbolCount + 1) * 4 > part->mSlotCapacity * 3) {
+        // Grow and re-insert every symbol
+        part->mSlotCapacity = part->mSlotCapacity == 0 ? 1024 : part->mSlotCapacity * 2;
+        free(part->mSlots);
+        part->mSlots = calloc(part->mSlotCapacity, sizeof(LocalSymbol*));
+        LocalSymbol* symbol;
+        for (symbol = part->mSymbols; symbol != NULL; symbol = symbol->mNextSymbol) {
+            unsigned int slot = symbol->mHash & (part->mSlotCapacity - 1);
+            while (part->mSlots[slot] != NULL)
+                slot = (slot + 1) & (part->mSlotCapacity - 1);
+            part->mSlots[slot] = symbol;
+        }
+    }
+
+    // FNV-1a, as for interned symbols
+    unsigned int hash = 2166136261u;
+    int i;
+    for (i = 0; i < length; i++) {
+        hash ^= (unsigned char) text[i];
+        hash *= 16777619u;
+    }
+    unsigned int slot = hash & (part->mSlotCapacity - 1);
+    LocalSymbol* symbol;
+    while ((symbol = part->mSlots[slot]) != NULL) {
+        if (symbol->mHash == hash && symbol->mLength == length
+            && memcmp(symbol->mText, text, length) == 0) return symbol->mText;
+        slot = (slot + 1) & (part->mSlotCapacity - 1);
+    }
+    symbol = malloc(sizeof(LocalSymbol) + length + 1);
+    memcpy(symbol->mText, text, length);
+    symbol->mText[length] = '\0';
+    symbol->mHash = hash;
+    symbol->mLength = length;
+    symbol->mNextSymbol = part->mSymbols;
+    part->mSymbols = symbol;
+    part->mSlots[slot] = symbol;
+    part->mSymbolCount++;
+    return symbol->mText;
+}
+
+/****************************************************************
+ Private helper interning the symbols of a part on the calling
+ thread, tagging those that are numbers.
+*/
+static void internSymbols(ReaderPart* part)
+{
+    LocalSymbol* symbol;
+    for (symbol = part->mSymbols; symbol != NULL; symbol = symbol->mNextSymbol) {
+        Cell* atom = &symbol->mAtom;
+        atom->mSymbol = internSymbol(symbol->mText);
+        atom->mNext = NULL;
+        atom->mSub = NULL;
+        atom->mType = CELL_PLAIN;
+        atom->mHash = 0;
+        atom->mData = NULL;
+        tagNumber(atom);
+    }
+}
+
+/****************************************************************
+ Private helper freeing what a part used while reading, and its
+ cells as well unless they are kept.
+*/
+static void freePart(ReaderPart* part, int keepCells)
+{
+    int i;
+    if (!keepCells)
+        for (i = 0; i < part->mBlockCount; i++)
+            free(part->mBlocks[i]);
+    free(part->mBlocks);
+    while (part->mSymbols != NULL) {
+        LocalSymbol* next = part->mSymbols->mNextSymbol;
+        free(part->mSymbols);
+        part->mSymbols = next;
+    }
+    free(part->mSlots);
+    free(part->mStarts);
+    free(part->mQuotes);
+}
+
+/****************************************************************
+ readData(): See header file for documentation.
+*/
+Cell* readData(char* path)
+{
+    int file = open(path, O_RDONLY);
+    if (file < 0) return NULL;
+    struct stat status;
+    char* text = NULL;
+    if (fstat(file, &status) == 0 && S_ISREG(status.st_mode)) {
+        if (status.st_size == 0) text = "";
+        else text = mmap(NULL, status.st_size, PROT_READ, MAP_PRIVATE, file, 0);
+        if (text == MAP_FAILED) text = NULL;
+    }
+    close(file);
+    if (text == NULL) return NULL;
+
+    DataFile* data = malloc(sizeof(DataFile));
+    data->mText = text;
+    data->mLength = status.st_size;
+    data->mWhole.mOpen = -1;
+    data->mWhole.mClose = status.st_size;
+    data->mWhole.mFile = data;
+    if (!indexData(data)) {
+        if (status.st_size > 0) munmap(text, status.st_size);
+        free(data);
+        return NULL;
+    }
+    Cell* whole = allocateAt(sizeof(Cell), SITE_PARSER);
+    whole->mSymbol = NULL;
+    whole->mNext = NULL;
+    whole->mSub = NULL;
+    whole->mType = CELL_LAZY;
+    whole->mHash = 0;
+    whole->mData = &data->mWhole;
+    return forceData(whole);
+}
+
+/****************************************************************
+ forceData(): See header file for documentation. The members are
+ linked from the given Cell on, which becomes the first cons cell,
+ so that whatever referred to it refers to the list.
+*/
+Cell* forceData(Cell* cell)
+{
+    if (cell == NULL || cell->mType != CELL_LAZY) return cell;
+    DataList* list = cell->mData;
+    char* text = list->mFile->mText;
+    int site = enterSite(SITE_PARSER);
+    cell->mType = CELL_PLAIN;
+    cell->mData = NULL;
+    Cell* link = NULL;
+    long at = skipBlanks(text, list->mOpen + 1, list->mClose);
+    while (at < list->mClose) {
+        if (link == NULL) link = cell;
+        else {
+            link->mNext = dataCell();
+            link = link->mNext;
+        }
+        link->mSub = dataDatum(list->mFile, &at, list->mClose);
+        at = skipBlanks(text, at, list->mClose);
+    }
+    leaveSite(site);
+    return cell;
+}
+
+/****************************************************************
+ Private helper listing the lists of a data file, or giving 0 for
+ a file readData() turns down. A "()" is an atom, as the lexer
+ reads it, and not listed.
+*/
+static int indexData(DataFile* data)
+{
+    char* text = data->mText;
+    long length = data->mLength;
+    long capacity = 0;
+    long* open = NULL;
+    long depth = 0;
+    long openCapacity = 0;
+    int valid = 1;
+    data->mLists = NULL;
+    data->mListCount = 0;
+    long at = skipBlanks(text, 0, length);
+    while (valid && at < length) {
+        char c = text[at];
+        if (c == '(') {
+            long after = skipBlanks(text, at + 1, length);
+            if (after < length && text[after] == ')') {
+                at = after + 1;
+            } else {
+                if (data->mListCount == capacity) {
+                    capacity = capacity == 0 ? 1024 : capacity * 2;
+                    data->mLists = realloc(data->mLists, sizeof(DataList) * capacity);
+                }
+                if (depth == openCapacity) {
+                    openCapacity = openCapacity == 0 ? 64 : openCapacity * 2;
+                    open = realloc(open, sizeof(long) * openCapacity);
+                }
+                DataList* list = &data->mLists[data->mListCount];
+                list->mOpen = at;
+                list->mClose = -1;
+                list->mFile = data;
+                open[depth++] = data->mListCount++;
+                at++;
+            }
+        } else if (c == ')') {
+            if (depth == 0) valid = 0;
+            else data->mLists[open[--depth]].mClose = at++;
+        } else if (c == '\'') {
+            long after = skipBlanks(text, at + 1, length);
+            if (after == length || text[after] == ')') valid = 0;
+            at++;
+        } else if (c == '#') {
+            if (at + 1 == length || (text[at + 1] != 't' && text[at + 1] != 'f')) valid = 0;
+            at += 2;
+        } else {
+            at = skipToken(text, at, length);
+        }
+        at = skipBlanks(text, at, length);
+    }
+    free(open);
+    if (!valid || depth != 0) {
+        free(data->mLists);
+        return 0;
+    }
+    return 1;
+}
+
+/****************************************************************
+ Private helper finding the list of a data file that opens at the
+ given position.
+*/
+static DataList* findList(DataFile* data, long at)
+{
+    long low = 0;
+    long high = data->mListCount - 1;
+    while (low < high) {
+        long middle = (low + high) / 2;
+        if (data->mLists[middle].mOpen < at) low = middle + 1;
+        else high = middle;
+    }
+    return &data->mLists[low];
+}
+
+/****************************************************************
+ Private helper parsing the datum of a data file at the given
+ position, up to the given end, and moving the position past it.
+ A list is left to a CELL_LAZY Cell.
+*/
+static Cell* dataDatum(DataFile* data, long* at, long end)
+{
+    char* text = data->mText;
+    long start = *at;
+    if (text[start] == '(') {
+        long after = skipBlanks(text, start + 1, end);
+        if (after < end && text[after] == ')') {
+            *at = after + 1;
+            return dataAtom("()", 2);
+        }
+        DataList* list = findList(data, start);
+        *at = list->mClose + 1;
+        Cell* lazy = dataCell();
+        lazy->mType = CELL_LAZY;
+        lazy->mData = list;
+        return lazy;
+    }
+    if (text[start] == '\'') {
+        Cell* quoted = dataCell();
+        quoted->mSub = dataAtom("quote", 5);
+        quoted->mNext = dataCell();
+        *at = skipBlanks(text, start + 1, end);
+        // As in the parser, a quote takes a quote after it as a symbol
+        if (text[*at] == '\'') {
+            quoted->mNext->mSub = dataAtom("'", 1);
+            (*at)++;
+        } else quoted->mNext->mSub = dataDatum(data, at, end);
+        return quoted;
+    }
+    *at = skipToken(text, start, end);
+    int length = *at - start;
+    // Longer symbols are cut short as by the lexer
+    if (length > TOKEN_LENGTH - 1) length = TOKEN_LENGTH - 1;
+    return dataAtom(&text[start], length);
+}
+
+/****************************************************************
+ Private helper making the atom of the given text, interned and
+ tagged if it is a number.
+*/
+static Cell* dataAtom(char* text, int length)
+{
+    char symbol[TOKEN_LENGTH];
+    memcpy(symbol, text, length);
+    symbol[length] = '\0';
+    Cell* atom = dataCell();
+    atom->mSymbol = internSymbol(symbol);
+    tagNumber(atom);
+    return atom;
+}
+
+/****************************************************************
+ Private helper making a cell of a data file, all members NULL.
+*/
+static Cell* dataCell()
+{
+    Cell* cell = allocate(sizeof(Cell));
+    cell->mSub = NULL;
+    cell->mNext = NULL;
+    cell->mSymbol = NULL;
+    cell->mType = CELL_PLAIN;
+    cell->mHash = 0;
+    cell->mData = NULL;
+    return cell;
+}
@@ -0,0 +1,62 @@
+#ifndef READER_H_INCLUDED
+#define READER_H_INCLUDED
+
+#include "parser.h"
+
+/****************************************************************
+ File: Reader.h
+ ----------------
+ Interface for Reader, which parses every top level form of a
+ large text at once, on as many threads as there are processors,
+ for files read by the function call (load file), and reads data
+ files lazily for the function call (load-data file).
+
+ The text is split at line breaks into one part per thread. Each
+ thread first sums up how its part changes the depth of parentheses,
+ which gives the depth at the start of every part and so where
+ every top level form starts, quoted forms starting at their quote.
+ Each thread then parses the forms starting in its part, making
+ their cells in blocks of its own, and collects the symbols it
+ meets in a table of its own, so that only the distinct symbols of
+ each part are interned, one part after another, before the
+ threads put the interned symbols into their cells.
+
+ A data file is mapped and only indexed up front, by the positions
+ of the parentheses of every list. Its lists are CELL_LAZY Cells
+ until first reached, when forceData(Cell*) parses the members of
+ one list in place, leaving the lists among them lazy in turn. The
+ file stays mapped for the rest of the run.
+ ****************************************************************/
+
+/****************************************************************
+ Gives the top level forms of the given text of the given length,
+ each as the structure S_Expression() would produce, and their
+ number through the last parameter. The text need not end in '\0'.
+ Returns NULL when the text holds what the lexer reports, such as a
+ "#" followed by other than t or f, or that S_Expression() reads
+ otherwise than the depths tell, such as a quote right before a
+ closing parenthesis, leaving such a text to S_Expression().
+ Quoted data are not shared while hash-consing, so callers parse
+ the text with S_Expression() then.
+*/
+Cell** readForms(char*, long, int*);
+
+/****************************************************************
+ Gives the data of the file at the given path as one list, with
+ every datum of the file a member, as S_Expression() would read
+ them between parentheses. The list itself is parsed. Returns NULL
+ when the file cannot be read, or holds an unbalanced parenthesis,
+ a quote before a closing one or a "#" followed by other than t
+ or f.
+*/
+Cell* readData(char*);
+
+/****************************************************************
+ Gives the given Cell, having parsed it in place first if it is a
+ CELL_LAZY Cell. Its members are parsed, the lists among them
+ being CELL_LAZY Cells themselves. Any other Cell, or NULL, is
+ given back as it is.
+*/
+Cell* forceData(Cell*);
+
+#endif
@@ -4,16 +4,85 @@
 #include "lexer.h"
 #include "parser.h"
 #include "evaluation.h"
+#include "compiler.h"
+#include "profiler.h"
 
 // Prototype for function responsible for checking for the
 // exit command (exit) from the user
 static void exitCheck(List*);
+// Prototype for the function printing the profile on the way out
+static void reportProfile();
+
+// File the collapsed stacks of the profile go to, if any
+static char* mStacksPath = NULL;
 
 /****************************************************************
  Tests the usage of the functions outlined in the parser header.
+ The option --hash-cons shares the cells of equal quoted data
+ (see setHashConsing(int)), --result-cache reuses the results
+ of repeated inputs (see setResultCaching(int)) and -O<level>
+ sets the level of optimization (see setOptimizationLevel(int)).
+ The option --native lib.so loads a library of compiled functions
+ before the first prompt, and may be given more than once, while
+ --compile lib.scm -o lib.c only translates the functions of a
+ file into C, or builds them into a library when the output ends
+ in .so (see compiler.h). The option --profile profiles every call
+ and prints the report when the program ends, and --profile-stacks
+ file writes the collapsed stacks of the profile to the given file
+ as well (see setProfiling(int)). The options --max-steps,
+ --max-bytes, --max-depth and --max-ms each followed by a number
+ give every input a budget, past which it is abandoned and the
+ next prompt shown (see setBudget(int, long)). The option --image
+ file maps a heap image written by (save-image file) before the
+ first prompt, ahead of any --native library (see loadImage(char*)).
 */
-int main()
+int main(int argc, char** argv)
 {
+    char* compiled = NULL;
+    char* output = NULL;
+    char* image = NULL;
+    char** natives = malloc(sizeof(char*) * argc);
+    int nativeCount = 0;
+    int i;
+    for (i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--compile") == 0 && i + 1 < argc) compiled = argv[++i];
+        else if (strcmp(argv[i], "-o") == 0 && i + 1 < argc) output = argv[++i];
+        else if (strcmp(argv[i], "--image") == 0 && i + 1 < argc) image = argv[++i];
+        else if (strcmp(argv[i], "--native") == 0 && i + 1 < argc) natives[nativeCount++] = argv[++i];
+        else if (strcmp(argv[i], "--hash-cons") == 0) setHashConsing(1);
+        else if (strcmp(argv[i], "--result-cache") == 0) setResultCaching(1);
+        else if (strcmp(argv[i], "--profile") == 0) setProfiling(1);
+        else if (strcmp(argv[i], "--profile-stacks") == 0 && i + 1 < argc) {
+            mStacksPath = argv[++i];
+            setProfiling(1);
+        }
+        else if (strcmp(argv[i], "--max-steps") == 0 && i + 1 < argc) setBudget(BUDGET_STEPS, atol(argv[++i]));
+        else if (strcmp(argv[i], "--max-bytes") == 0 && i + 1 < argc) setBudget(BUDGET_BYTES, atol(argv[++i]));
+        else if (strcmp(argv[i], "--max-depth") == 0 && i + 1 < argc) setBudget(BUDGET_DEPTH, atol(argv[++i]));
+        else if (strcmp(argv[i], "--max-ms") == 0 && i + 1 < argc)
+            setBudget(BUDGET_MILLISECONDS, atol(argv[++i]));
+        else if (strncmp(argv[i], "-O", 2) == 0 && argv[i][2] >= '0' && argv[i][2] <= '9')
+            setOptimizationLevel(atoi(argv[i] + 2));
+        else {
+            printf("Unknown option %s.\n", argv[i]);
+            return 1;
+        }
+    }
+
+    startTokens(TOKEN_LENGTH);
+    if (isProfiling()) atexit(reportProfile);
+    if (compiled != NULL) {
+        if (output == NULL) {
+            printf("Usage: schemer --compile lib.scm -o lib.c\n");
+            return 1;
+        }
+        return compileFile(compiled, output) ? 0 : 1;
+    }
+    if (image != NULL && loadImage(image) == 0) return 1;
+    for (i = 0; i < nativeCount; i++)
+        if (loadNative(natives[i]) == 0) return 1;
+    free(natives);
+
     // Prompt according to the sample run
     printf("A prototype evaluator for Scheme.\n");
     printf("Type Scheme expressions using quote,\n");
@@ -21,17 +90,27 @@ int main()
     printf("The function call (exit) quits.\n");
 
     // Repeatedly handle scheme expressions
-    startTokens(20);
     while (1) {
         printf("\nscheme> ");
+        fflush(stdout);
+        // End quietly when the input runs out
+        if (moreTokens() == 0) {
+            printf("\n");
+            return 0;
+        }
         // Read and print a given expression
         List* list = S_Expression();
         // Check input for (exit) command
         exitCheck(list);
         // Evaluate the input
         List* evalList = eval(list);
-        // Print the evaluated structure
-        printList(evalList);
+        // Print the evaluated structure, timing it as a call of its
+        // own while profiling
+        if (isProfiling()) {
+            profileEnter("(print)", 1);
+            printList(evalList);
+            profileExit();
+        } else printList(evalList);
     }
 }
 
@@ -57,3 +136,21 @@ static void exitCheck(List* list)
         }
     }
 }
+
+/****************************************************************
+ Private function printing the profile recorded when the program
+ ends, and writing its collapsed stacks if asked to.
+*/
+static void reportProfile()
+{
+    printf("\n");
+    profileReport(stdout);
+    if (mStacksPath == NULL) return;
+    FILE* file = fopen(mStacksPath, "w");
+    if (file == NULL) {
+        printf("profile: cannot write %s.\n", mStacksPath);
+        return;
+    }
+    profileStacks(file);
+    fclose(file);
+}
@@ -0,0 +1,22 @@
+; A closure sees globals as they are when it runs, itself among them
+(define count-down (lambda (n) (if (< n 1) 0 (+ 1 (count-down (- n 1))))))
+(count-down 3)
+(define rate 10)
+(define scaled (lambda (x) (* x rate)))
+(scaled 2)
+(define rate 20)
+(scaled 2)
+(define later (lambda (x) (+ x defined-after)))
+(define defined-after 5)
+(later 1)
+; Variables bound locally are copied when the closure is made
+(define adder (lambda (n) (lambda (x) (+ x n))))
+(define add5 (adder 5))
+(define n 100)
+(add5 1)
+(define shadow (lambda (x) (let* ((x (+ x 1)) (y (* x 2))) (list x y))))
+(shadow 1)
+(define sum-to (lambda (n) (let loop ((i n) (acc 0)) (if (< i 1) acc (loop (- i 1) (+ acc i))))))
+(sum-to 10)
+(letrec ((even (lambda (n) (if (equal? n 0) #t (odd (- n 1))))) (odd (lambda (n) (if (equal? n 0) #f (even (- n 1)))))) (even 10))
+((lambda args args) 1 2 3)
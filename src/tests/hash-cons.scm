@@ -0,0 +1,9 @@
+; Duplicate quoted data found while hash-consing is given back
+(define (parsed stats) (car (cdr (car (cdr stats)))))
+(define start (parsed (memory-stats)))
+'((alpha beta) (gamma delta) (1 2 3 4 5 6 7 8))
+(define first (- (parsed (memory-stats)) start))
+(define start (parsed (memory-stats)))
+'((alpha beta) (gamma delta) (1 2 3 4 5 6 7 8))
+(define again (- (parsed (memory-stats)) start))
+(- first again)
@@ -0,0 +1,17 @@
+; Only builtins that take values and user functions can be applied
+(map 'foo '(1 2))
+(map quote '(1 2))
+(map delay '(1 2))
+(map define '(1 2))
+(sort '(2 1) 'foo)
+(apply 'foo '(1 2))
+(map list '(1 2))
+(apply + '(1 2))
+(define (twice x) (* 2 x))
+(map twice '(1 2 3))
+(map twice '(1 2) '(3 4))
+(map)
+(filter car)
+(fold car)
+(for-each)
+(apply)
@@ -0,0 +1,23 @@
+; Results reading data that can change in place are never reused
+(define v (vector 1 2 3))
+(define first-of (let ((w v)) (lambda () (vector-ref w 0))))
+(first-of)
+(vector-set! v 0 9)
+(first-of)
+(define all-of (let ((w v)) (delay w)))
+(vector-ref (force all-of) 1)
+(vector-set! v 1 8)
+(vector-ref (force all-of) 1)
+(define table (make-hash-table))
+(define lookup (let ((t table)) (lambda (k) (hash-ref t k))))
+(hash-set! table 'a 1)
+(lookup 'a)
+(hash-set! table 'a 2)
+(lookup 'a)
+; Pure results are reused until a define rebinds what they read
+(define xs '(1 2 3))
+(length xs)
+(length xs)
+(define xs '(1 2))
+(length xs)
+(result-cache-stats)
@@ -0,0 +1,8 @@
+; Promises made at top level see the globals defined after them
+(define ones (cons-stream 1 ones))
+(stream->list (stream-take ones 3))
+(define answer (delay later))
+(define later 42)
+(force answer)
+(define integers-from (lambda (n) (cons-stream n (integers-from (+ n 1)))))
+(stream->list (stream-take (stream-filter (lambda (x) (equal? (* 2 (/ x 2)) x)) (integers-from 1)) 3))